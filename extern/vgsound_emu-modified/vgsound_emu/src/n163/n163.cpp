@@ -74,6 +74,147 @@ void n163_core::tick()
 	}
 }
 
+// same as calling tick() len times, but the voice registers are decoded
+// only once per run. during a run the chip only writes the accumulators,
+// so everything else stays valid (they are still written back every tick
+// since waveforms may overlap them).
+// out receives the output of every tick. if voice_snap isn't null, it
+// receives the per-voice outputs (8 per entry, in voice_out() order)
+// every time the voice cycle wraps around. returns the number of wraps.
+u32 n163_core::tick_run(s16 *out, s16 *voice_snap, u32 len)
+{
+	u32 i	   = 0;
+	u32 cycles = 0;
+
+	if (m_disable)
+	{
+		m_out = 0;
+		std::fill_n(out, len, 0);
+		return 0;
+	}
+
+	const u8 voices = bitfield(m_ram[0x7f], 4, 3) + 1;
+	const u8 last	= 0x78 - ((voices - 1) << 3);
+	const s16 div	= m_multiplex ? 1 : voices;
+
+	// left over from a larger voice count. this one wraps around
+	if (len > 0 && m_voice_cycle < last)
+	{
+		tick();
+		out[i++] = m_out;
+		if (voice_snap != nullptr)
+		{
+			for (int j = 0; j < 8; j++)
+			{
+				voice_snap[j] = voice_out(j);
+			}
+		}
+		cycles++;
+	}
+
+	u32 freq[8], accum[8];
+	u16 length[8];
+	u8 wave_pos[8];
+	s16 volume[8];
+	// whether a waveform may read the registers of the active voices
+	bool overlap = false;
+	for (u8 cycle = 0x78; cycle >= last; cycle -= 0x8)
+	{
+		const u8 v = (cycle >> 3) & 7;
+		freq[v]	   = m_ram[cycle + 0] | (u32(m_ram[cycle + 2]) << 8) |
+				  (bitfield<u32>(m_ram[cycle + 4], 0, 2) << 16);
+		accum[v] = m_ram[cycle + 1] | (u32(m_ram[cycle + 3]) << 8) |
+				   (u32(m_ram[cycle + 5]) << 16);
+		length[v]	= 256 - (m_ram[cycle + 4] & 0xfc);
+		wave_pos[v] = m_ram[cycle + 6];
+		volume[v]	= bitfield(m_ram[cycle + 7], 0, 4);
+
+		// the position stays below the length once it is there, so the
+		// waveform covers wave_pos to wave_pos+length-1 (in nibbles).
+		if (bitfield(accum[v], 16, 8) >= length[v] || wave_pos[v] + length[v] > 256 ||
+			((wave_pos[v] + length[v] - 1) >> 1) >= last)
+		{
+			overlap = true;
+		}
+		if (cycle == last)
+		{
+			break;
+		}
+	}
+
+	for (; i < len; i++)
+	{
+		const u8 v		 = (m_voice_cycle >> 3) & 7;
+		u32 acc			 = accum[v];
+		const u8 addr	 = wave_pos[v] + bitfield(acc, 16, 8);
+		const s16 wave	 = (bitfield(m_ram[bitfield(addr, 1, 7)], bitfield(addr, 0) << 2, 4) - 8);
+		const s16 vo	 = (wave * volume[v]);
+		m_voice_out[v] = vo;
+
+		// accumulate address
+		acc = bitfield(acc + freq[v], 0, 24);
+		if (bitfield(acc, 16, 8) >= length[v])
+		{
+			acc = bitfield(acc, 0, 18);
+		}
+		accum[v] = acc;
+		if (overlap)
+		{
+			m_ram[m_voice_cycle + 1] = bitfield(acc, 0, 8);
+			m_ram[m_voice_cycle + 3] = bitfield(acc, 8, 8);
+			m_ram[m_voice_cycle + 5] = bitfield(acc, 16, 8);
+		}
+
+		// update voice cycle
+		bool flush = m_multiplex;
+		bool wrap  = false;
+		m_voice_cycle -= 0x8;
+		if (m_voice_cycle < last)
+		{
+			flush		  = true;
+			wrap		  = true;
+			m_voice_cycle = 0x78;
+		}
+
+		m_acc += vo;
+		if (flush)
+		{
+			m_out = m_acc / div;
+			m_acc = 0;
+		}
+		out[i] = m_out;
+
+		if (wrap)
+		{
+			if (voice_snap != nullptr)
+			{
+				for (int j = 0; j < 8; j++)
+				{
+					voice_snap[cycles * 8 + j] = voice_out(j);
+				}
+			}
+			cycles++;
+		}
+	}
+
+	// writeback to register
+	if (!overlap)
+	{
+		for (u8 cycle = 0x78; cycle >= last; cycle -= 0x8)
+		{
+			const u8 v		   = (cycle >> 3) & 7;
+			m_ram[cycle + 1] = bitfield(accum[v], 0, 8);
+			m_ram[cycle + 3] = bitfield(accum[v], 8, 8);
+			m_ram[cycle + 5] = bitfield(accum[v], 16, 8);
+			if (cycle == last)
+			{
+				break;
+			}
+		}
+	}
+	return cycles;
+}
+
 void n163_core::reset()
 {
 	// reset this chip
@@ -78,6 +78,7 @@ class n163_core : public vgsound_emu_core
 		// internal state
 		void reset();
 		void tick();
+		u32 tick_run(s16 *out, s16 *voice_snap, u32 len);
 
 		// sound output pin
 		inline s16 out() { return m_out; }
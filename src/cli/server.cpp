@@ -0,0 +1,556 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "server.h"
+#include "../ta-log.h"
+#include "../fileutils.h"
+#include <fmt/printf.h>
+#include <chrono>
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+static std::atomic<bool> serverQuit(false);
+
+#ifndef _WIN32
+static void handleServerTerm(int) {
+  serverQuit=true;
+}
+#endif
+
+struct FurnaceServerFormat {
+  const char* name;
+  DivAudioExportFormats format;
+};
+
+static const FurnaceServerFormat serverFormats[]={
+  {"wav", DIV_EXPORT_FORMAT_WAV},
+  {"wav24", DIV_EXPORT_FORMAT_WAV_24},
+  {"wavfloat", DIV_EXPORT_FORMAT_WAV_FLOAT},
+  {"flac", DIV_EXPORT_FORMAT_FLAC},
+  {"ogg", DIV_EXPORT_FORMAT_OGG},
+  {"raw16", DIV_EXPORT_FORMAT_RAW_S16},
+  {"raw24", DIV_EXPORT_FORMAT_RAW_S24},
+  {"rawfloat", DIV_EXPORT_FORMAT_RAW_F32},
+  {NULL, DIV_EXPORT_FORMAT_WAV}
+};
+
+static bool endsWith(const String& str, const char* suffix) {
+  size_t len=strlen(suffix);
+  if (str.size()<len) return false;
+  for (size_t i=0; i<len; i++) {
+    char c=str[str.size()-len+i];
+    if (c>='A' && c<='Z') c+='a'-'A';
+    if (c!=suffix[i]) return false;
+  }
+  return true;
+}
+
+// values may not span lines
+static String oneLine(String str) {
+  for (char& i: str) {
+    if (i=='\n' || i=='\r') i=' ';
+  }
+  return str;
+}
+
+FurnaceServerConn::~FurnaceServerConn() {
+  if (fd<0) return;
+  fclose(in);
+  fclose(out);
+}
+
+bool FurnaceServerConn::readRequest(DivConfig& ret) {
+  String block;
+  char line[4096];
+  ret.clear();
+  while (true) {
+    if (fgets(line,4096,in)==NULL) return false;
+    if (line[0]=='\n' || (line[0]=='\r' && line[1]=='\n')) {
+      // skip empty lines between requests
+      if (block.empty()) continue;
+      break;
+    }
+    block+=line;
+  }
+  ret.loadFromMemory(block.c_str());
+  return true;
+}
+
+void FurnaceServerConn::send(DivConfig& msg) {
+  String data=msg.toString()+"\n";
+  std::lock_guard<std::mutex> lock(writeLock);
+  fwrite(data.c_str(),1,data.size(),out);
+  fflush(out);
+}
+
+bool FurnaceServer::shouldQuit() {
+  std::lock_guard<std::mutex> lock(jobLock);
+  return quit || draining || serverQuit;
+}
+
+void FurnaceServer::stop(bool drain) {
+  std::lock_guard<std::mutex> lock(jobLock);
+  if (drain) {
+    draining=true;
+  } else {
+    quit=true;
+  }
+  jobCond.notify_all();
+}
+
+void FurnaceServer::render(DivEngine* e, FurnaceServerJob& job) {
+  DivConfig& req=job.req;
+  String id=req.getString("id","");
+  String fileName=req.getString("file","");
+  String audioOut=req.getString("audio","");
+  String vgmOut=req.getString("vgm","");
+  String zsmOut=req.getString("zsm","");
+  String cmdOut=req.getString("cmdstream","");
+  std::chrono::steady_clock::time_point startTime=std::chrono::steady_clock::now();
+
+  auto reply=[&job,&id](DivConfig& msg) {
+    msg.set("id",id);
+    job.conn->send(msg);
+  };
+  auto fail=[&reply](String what) {
+    DivConfig msg;
+    msg.set("event","error");
+    msg.set("message",oneLine(what));
+    reply(msg);
+  };
+
+  if (fileName.empty()) {
+    fail("no file given");
+    return;
+  }
+  if (audioOut.empty() && vgmOut.empty() && zsmOut.empty() && cmdOut.empty()) {
+    fail("nothing to export");
+    return;
+  }
+
+  // read the song
+  FILE* f=ps_fopen(fileName.c_str(),"rb");
+  if (f==NULL) {
+    fail(fmt::sprintf("could not open file! (%s)",strerror(errno)));
+    return;
+  }
+  ssize_t len=-1;
+  if (fseek(f,0,SEEK_END)==0) len=ftell(f);
+  if (len<=0 || fseek(f,0,SEEK_SET)!=0) {
+    fail("could not open file! (size error)");
+    fclose(f);
+    return;
+  }
+  unsigned char* file=new unsigned char[len];
+  if (fread(file,1,(size_t)len,f)!=(size_t)len) {
+    fail(fmt::sprintf("could not open file! (read error: %s)",strerror(errno)));
+    fclose(f);
+    delete[] file;
+    return;
+  }
+  fclose(f);
+  // load() takes ownership of the buffer
+  if (!e->load(file,(size_t)len)) {
+    fail(fmt::sprintf("could not open file! (%s)",e->getLastError()));
+    return;
+  }
+
+  int subSong=req.getInt("subsong",0);
+  if (subSong<0 || subSong>=(int)e->song.subsong.size()) {
+    fail("subsong out of range");
+    return;
+  }
+  e->changeSongP(subSong);
+
+  int quality=req.getInt("quality",DIV_QUALITY_NORMAL);
+  if (quality<DIV_QUALITY_DRAFT || quality>DIV_QUALITY_ACCURATE) {
+    fail("quality out of range");
+    return;
+  }
+  e->setQualityTier((DivQualityTier)quality);
+
+  DivConfig loaded;
+  loaded.set("event","loaded");
+  loaded.set("name",oneLine(e->song.name));
+  loaded.set("subsongs",(int)e->song.subsong.size());
+  reply(loaded);
+
+  // VGM, ZSM and command stream
+  if (!vgmOut.empty() || !zsmOut.empty() || !cmdOut.empty()) {
+    DivMultiExport ex;
+    ex.vgm=!vgmOut.empty();
+    ex.vgmVersion=req.getInt("vgmVersion",0x171);
+    ex.vgmOptimize=req.getBool("vgmOptimize",false);
+    ex.zsm=!zsmOut.empty();
+    ex.zsmRate=req.getInt("zsmRate",60);
+    ex.cmd=!cmdOut.empty();
+    ex.cmdBinary=req.getBool("binary",false);
+    ex.cmdCompress=req.getBool("compress",false);
+    if (!e->saveMulti(ex)) {
+      fail(fmt::sprintf("could not export! (%s)",e->getLastError()));
+      if (ex.vgmOut!=NULL) delete ex.vgmOut;
+      if (ex.zsmOut!=NULL) delete ex.zsmOut;
+      if (ex.cmdOut!=NULL) delete ex.cmdOut;
+      return;
+    }
+    String writeError;
+    auto writeOut=[e,&writeError](SafeWriter* w, const String& path, bool compress) {
+      if (w==NULL) return;
+      FILE* out=ps_fopen(path.c_str(),"wb");
+      if (out==NULL) {
+        writeError=fmt::sprintf("could not write %s! (%s)",path,strerror(errno));
+      } else {
+        if (compress) {
+          if (!e->writeVGZ(w,out)) writeError=fmt::sprintf("could not compress file! (%s)",e->getLastError());
+        } else if (fwrite(w->getFinalBuf(),1,w->size(),out)!=w->size()) {
+          writeError=fmt::sprintf("could not write %s! (%s)",path,strerror(errno));
+        }
+        fclose(out);
+      }
+      w->finish();
+      delete w;
+    };
+    writeOut(ex.vgmOut,vgmOut,endsWith(vgmOut,".vgz"));
+    writeOut(ex.zsmOut,zsmOut,false);
+    writeOut(ex.cmdOut,cmdOut,false);
+    if (!writeError.empty()) {
+      fail(writeError);
+      return;
+    }
+  }
+
+  // audio
+  if (!audioOut.empty()) {
+    DivAudioExportFormats format=DIV_EXPORT_FORMAT_WAV;
+    String formatName=req.getString("format","");
+    if (formatName.empty()) {
+      if (endsWith(audioOut,".flac")) {
+        format=DIV_EXPORT_FORMAT_FLAC;
+      } else if (endsWith(audioOut,".ogg")) {
+        format=DIV_EXPORT_FORMAT_OGG;
+      } else if (endsWith(audioOut,".raw")) {
+        format=DIV_EXPORT_FORMAT_RAW_S16;
+      }
+    } else {
+      bool found=false;
+      for (int i=0; serverFormats[i].name; i++) {
+        if (formatName==serverFormats[i].name) {
+          format=serverFormats[i].format;
+          found=true;
+          break;
+        }
+      }
+      if (!found) {
+        fail("invalid format");
+        return;
+      }
+    }
+    // same meaning as -loops
+    int loops=req.getInt("loops",0);
+    loops=(loops<0)?0:(loops+1);
+    double fadeOut=req.getDouble("fadeOut",0.0);
+
+    if (audioOut=="-") {
+      fail("audio can only be exported to a file");
+      return;
+    }
+    if (!e->saveAudio(audioOut.c_str(),loops,DIV_EXPORT_MODE_ONE,fadeOut,format)) {
+      fail("could not export audio!");
+      return;
+    }
+    int progressInterval=MAX(10,req.getInt("progressInterval",250));
+    while (e->isExporting()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(progressInterval));
+      if (!e->isExporting()) break;
+      if (serverQuit) {
+        e->haltAudioFile();
+        break;
+      }
+      DivConfig progress;
+      progress.set("event","progress");
+      progress.set("order",e->getOrder());
+      progress.set("orders",e->curSubSong->ordersLen);
+      progress.set("seconds",e->getTotalSeconds());
+      reply(progress);
+    }
+    e->waitAudioFile();
+  }
+
+  DivConfig done;
+  done.set("event","done");
+  done.set("time",(double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-startTime).count()/1000000.0);
+  reply(done);
+}
+
+void FurnaceServer::runWorker(DivEngine* e) {
+  while (true) {
+    FurnaceServerJob job;
+    {
+      std::unique_lock<std::mutex> lock(jobLock);
+      jobCond.wait(lock,[this]() {
+        return quit || draining || !jobs.empty();
+      });
+      if (quit || serverQuit || jobs.empty()) break;
+      job=jobs.front();
+      jobs.pop_front();
+    }
+    render(e,job);
+  }
+}
+
+void FurnaceServer::runReader(std::shared_ptr<FurnaceServerConn> conn) {
+  DivConfig req;
+  while (conn->readRequest(req)) {
+    String cmd=req.getString("cmd","render");
+    DivConfig msg;
+    msg.set("id",req.getString("id",""));
+    if (cmd=="render") {
+      std::lock_guard<std::mutex> lock(jobLock);
+      if (quit || draining) {
+        msg.set("event","error");
+        msg.set("message","server is shutting down");
+      } else {
+        FurnaceServerJob job;
+        job.conn=conn;
+        job.req=req;
+        jobs.push_back(job);
+        jobCond.notify_one();
+        msg.set("event","queued");
+        msg.set("position",(int)jobs.size());
+      }
+    } else if (cmd=="ping") {
+      std::lock_guard<std::mutex> lock(jobLock);
+      msg.set("event","pong");
+      msg.set("version",DIV_VERSION);
+      msg.set("instances",(int)engines.size());
+      msg.set("queued",(int)jobs.size());
+    } else if (cmd=="quit") {
+      msg.set("event","bye");
+      conn->send(msg);
+      stop(true);
+      break;
+    } else {
+      msg.set("event","error");
+      msg.set("message","unknown command");
+    }
+    conn->send(msg);
+  }
+  conn->done=true;
+}
+
+bool FurnaceServer::init(const String& path, int instances, bool renderCache) {
+  if (instances<1) instances=1;
+  socketPath="";
+
+#ifdef _WIN32
+  if (path!="-") {
+    logE("the render server only supports standard input/output (-) on Windows.");
+    return false;
+  }
+#else
+  struct sigaction termsa;
+  sigemptyset(&termsa.sa_mask);
+  termsa.sa_flags=0;
+  termsa.sa_handler=handleServerTerm;
+  sigaction(SIGINT,&termsa,NULL);
+  sigaction(SIGTERM,&termsa,NULL);
+  // clients may go away while we write to them
+  signal(SIGPIPE,SIG_IGN);
+
+  if (path!="-") {
+    struct sockaddr_un addr;
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family=AF_UNIX;
+    if (path.size()>=sizeof(addr.sun_path)) {
+      logE("socket path is too long!");
+      return false;
+    }
+    strncpy(addr.sun_path,path.c_str(),sizeof(addr.sun_path)-1);
+
+    listenFD=socket(AF_UNIX,SOCK_STREAM,0);
+    if (listenFD<0) {
+      logE("could not create socket! (%s)",strerror(errno));
+      return false;
+    }
+    // remove a stale socket, but never anything else
+    struct stat st;
+    if (lstat(path.c_str(),&st)==0) {
+      if (!S_ISSOCK(st.st_mode)) {
+        logE("%s exists and is not a socket!",path);
+        close(listenFD);
+        listenFD=-1;
+        return false;
+      }
+      unlink(path.c_str());
+    }
+    if (bind(listenFD,(struct sockaddr*)&addr,sizeof(addr))!=0) {
+      logE("could not bind to %s! (%s)",path,strerror(errno));
+      close(listenFD);
+      listenFD=-1;
+      return false;
+    }
+    if (listen(listenFD,16)!=0) {
+      logE("could not listen on %s! (%s)",path,strerror(errno));
+      close(listenFD);
+      listenFD=-1;
+      unlink(path.c_str());
+      return false;
+    }
+    socketPath=path;
+  }
+#endif
+
+  // engines are initialized one after another, before any job runs
+  for (int i=0; i<instances; i++) {
+    DivEngine* e=new DivEngine;
+    e->setAudio(DIV_AUDIO_DUMMY);
+    e->setView(DIV_STATUS_NOTHING);
+    e->setConsoleMode(true);
+    if (!e->init()) {
+      logE("could not initialize engine %d!",i);
+      delete e;
+      return false;
+    }
+    if (renderCache) e->setRenderCache(true);
+    engines.push_back(e);
+  }
+
+  for (DivEngine* i: engines) {
+    workers.push_back(new std::thread([this,i]() {
+      runWorker(i);
+    }));
+  }
+
+  if (socketPath.empty()) {
+    logI("render server ready on standard input/output (%d instances).",instances);
+  } else {
+    logI("render server listening on %s (%d instances).",socketPath,instances);
+  }
+  return true;
+}
+
+void FurnaceServer::loop() {
+  if (socketPath.empty()) {
+    // serve standard input until it is closed, then finish the queue
+    runReader(std::make_shared<FurnaceServerConn>(stdin,stdout,-1));
+    return;
+  }
+
+#ifndef _WIN32
+  while (!shouldQuit()) {
+    struct pollfd pfd;
+    pfd.fd=listenFD;
+    pfd.events=POLLIN;
+    pfd.revents=0;
+    int ready=poll(&pfd,1,250);
+
+    // clean up after clients which went away
+    for (size_t i=0; i<readers.size(); i++) {
+      if (readers[i].conn->done) {
+        readers[i].thread->join();
+        delete readers[i].thread;
+        readers.erase(readers.begin()+i);
+        i--;
+      }
+    }
+
+    if (ready<=0 || !(pfd.revents&POLLIN)) continue;
+    int fd=accept(listenFD,NULL,NULL);
+    if (fd<0) {
+      logW("could not accept connection! (%s)",strerror(errno));
+      continue;
+    }
+    int writeFD=dup(fd);
+    FILE* in=fdopen(fd,"r");
+    FILE* out=(writeFD<0)?NULL:fdopen(writeFD,"w");
+    if (in==NULL || out==NULL) {
+      logW("could not open connection!");
+      if (in!=NULL) {
+        fclose(in);
+      } else {
+        close(fd);
+      }
+      if (out!=NULL) {
+        fclose(out);
+      } else if (writeFD>=0) {
+        close(writeFD);
+      }
+      continue;
+    }
+    logD("client connected.");
+    FurnaceServerReader reader;
+    reader.conn=std::make_shared<FurnaceServerConn>(in,out,fd);
+    reader.thread=new std::thread([this](std::shared_ptr<FurnaceServerConn> conn) {
+      runReader(conn);
+    },reader.conn);
+    readers.push_back(reader);
+  }
+#endif
+}
+
+void FurnaceServer::finish() {
+  // queued jobs are finished unless we were interrupted
+  stop(!serverQuit);
+  for (std::thread* i: workers) {
+    i->join();
+    delete i;
+  }
+  workers.clear();
+  jobs.clear();
+
+#ifndef _WIN32
+  // wake up readers blocked on their clients
+  for (FurnaceServerReader& i: readers) {
+    shutdown(i.conn->fd,SHUT_RDWR);
+  }
+#endif
+  for (FurnaceServerReader& i: readers) {
+    i.thread->join();
+    delete i.thread;
+  }
+  readers.clear();
+
+#ifndef _WIN32
+  if (listenFD>=0) {
+    close(listenFD);
+    listenFD=-1;
+  }
+  if (!socketPath.empty()) {
+    unlink(socketPath.c_str());
+  }
+#endif
+
+  for (DivEngine* i: engines) {
+    i->quit();
+    delete i;
+  }
+  engines.clear();
+}
+
+FurnaceServer::FurnaceServer():
+  quit(false),
+  draining(false),
+  listenFD(-1) {
+}
@@ -0,0 +1,92 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _FUR_SERVER_H
+#define _FUR_SERVER_H
+
+#include "../engine/engine.h"
+#include <condition_variable>
+#include <memory>
+
+// a client of the render server. requests and replies are blocks of
+// key=value lines (as in the config file) terminated by an empty line.
+// the cmd key selects the request (render, ping or quit). render takes:
+// - file: the song to load, subsong and quality
+// - audio, format, loops, fadeOut and progressInterval for audio export
+// - vgm, vgmVersion and vgmOptimize for VGM
+// - zsm and zsmRate for ZSM
+// - cmdstream, binary and compress for the command stream
+struct FurnaceServerConn {
+  FILE* in;
+  FILE* out;
+  // socket, or -1 for standard input/output
+  int fd;
+  std::mutex writeLock;
+  std::atomic<bool> done;
+
+  bool readRequest(DivConfig& ret);
+  void send(DivConfig& msg);
+  FurnaceServerConn(FILE* i, FILE* o, int f):
+    in(i),
+    out(o),
+    fd(f),
+    done(false) {}
+  ~FurnaceServerConn();
+};
+
+struct FurnaceServerJob {
+  std::shared_ptr<FurnaceServerConn> conn;
+  DivConfig req;
+};
+
+struct FurnaceServerReader {
+  std::shared_ptr<FurnaceServerConn> conn;
+  std::thread* thread;
+};
+
+class FurnaceServer {
+  // engines are initialized once and reused for every job.
+  std::vector<DivEngine*> engines;
+  std::vector<std::thread*> workers;
+  std::vector<FurnaceServerReader> readers;
+  std::deque<FurnaceServerJob> jobs;
+  std::mutex jobLock;
+  std::condition_variable jobCond;
+  // stop after the current jobs
+  bool quit;
+  // stop once the queue is empty
+  bool draining;
+  String socketPath;
+  int listenFD;
+
+  void runWorker(DivEngine* e);
+  void runReader(std::shared_ptr<FurnaceServerConn> conn);
+  void render(DivEngine* e, FurnaceServerJob& job);
+  void stop(bool drain);
+  bool shouldQuit();
+
+  public:
+    // path is a Unix domain socket, or "-" for standard input/output.
+    bool init(const String& path, int instances, bool renderCache);
+    void loop();
+    void finish();
+    FurnaceServer();
+};
+
+#endif
@@ -0,0 +1,804 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cmdStream.h"
+#include "engine.h"
+#include "safeReader.h"
+#include "../ta-log.h"
+#include <zlib.h>
+
+void DivCSChannelState::write(SafeWriter* w) const {
+  w->writeI(readPos);
+  w->writeS(waitTicks);
+  w->writeC(ended?1:0);
+  w->writeC(0); // reserved
+}
+
+void DivCSChannelState::read(const unsigned char* buf) {
+  readPos=buf[0]|(buf[1]<<8)|(buf[2]<<16)|((unsigned int)buf[3]<<24);
+  waitTicks=buf[4]|(buf[5]<<8);
+  ended=buf[6]&1;
+}
+
+// length of the arguments of an extended command.
+// this must match writePackedCommandValues() in engine.cpp.
+static int getCommandLength(int cmd) {
+  switch (cmd) {
+    case DIV_CMD_SAMPLE_MODE:
+    case DIV_CMD_SAMPLE_FREQ:
+    case DIV_CMD_SAMPLE_BANK:
+    case DIV_CMD_SAMPLE_DIR:
+    case DIV_CMD_FM_HARD_RESET:
+    case DIV_CMD_FM_LFO:
+    case DIV_CMD_FM_LFO_WAVE:
+    case DIV_CMD_FM_FB:
+    case DIV_CMD_FM_EXTCH:
+    case DIV_CMD_FM_AM_DEPTH:
+    case DIV_CMD_FM_PM_DEPTH:
+    case DIV_CMD_STD_NOISE_FREQ:
+    case DIV_CMD_STD_NOISE_MODE:
+    case DIV_CMD_WAVE:
+    case DIV_CMD_GB_SWEEP_TIME:
+    case DIV_CMD_GB_SWEEP_DIR:
+    case DIV_CMD_PCE_LFO_MODE:
+    case DIV_CMD_PCE_LFO_SPEED:
+    case DIV_CMD_NES_DMC:
+    case DIV_CMD_C64_CUTOFF:
+    case DIV_CMD_C64_RESONANCE:
+    case DIV_CMD_C64_FILTER_MODE:
+    case DIV_CMD_C64_RESET_TIME:
+    case DIV_CMD_C64_RESET_MASK:
+    case DIV_CMD_C64_FILTER_RESET:
+    case DIV_CMD_C64_DUTY_RESET:
+    case DIV_CMD_C64_EXTENDED:
+    case DIV_CMD_AY_ENVELOPE_SET:
+    case DIV_CMD_AY_ENVELOPE_LOW:
+    case DIV_CMD_AY_ENVELOPE_HIGH:
+    case DIV_CMD_AY_NOISE_MASK_AND:
+    case DIV_CMD_AY_NOISE_MASK_OR:
+    case DIV_CMD_AY_AUTO_ENVELOPE:
+    case DIV_CMD_FDS_MOD_DEPTH:
+    case DIV_CMD_FDS_MOD_HIGH:
+    case DIV_CMD_FDS_MOD_LOW:
+    case DIV_CMD_FDS_MOD_POS:
+    case DIV_CMD_FDS_MOD_WAVE:
+    case DIV_CMD_SAA_ENVELOPE:
+    case DIV_CMD_AMIGA_FILTER:
+    case DIV_CMD_AMIGA_AM:
+    case DIV_CMD_AMIGA_PM:
+    case DIV_CMD_PRE_NOTE:
+    case DIV_CMD_GENESIS_LFO:
+    case DIV_CMD_ARCADE_LFO:
+    case DIV_CMD_QSOUND_ECHO_FEEDBACK:
+    case DIV_CMD_QSOUND_ECHO_LEVEL:
+    case DIV_CMD_QSOUND_SURROUND:
+    case DIV_CMD_X1_010_ENVELOPE_SHAPE:
+    case DIV_CMD_X1_010_ENVELOPE_ENABLE:
+    case DIV_CMD_X1_010_ENVELOPE_MODE:
+    case DIV_CMD_X1_010_ENVELOPE_PERIOD:
+    case DIV_CMD_X1_010_AUTO_ENVELOPE:
+    case DIV_CMD_X1_010_SAMPLE_BANK_SLOT:
+    case DIV_CMD_WS_SWEEP_TIME:
+    case DIV_CMD_WS_SWEEP_AMOUNT:
+    case DIV_CMD_N163_WAVE_POSITION:
+    case DIV_CMD_N163_WAVE_LENGTH:
+    case DIV_CMD_N163_WAVE_MODE:
+    case DIV_CMD_N163_WAVE_LOAD:
+    case DIV_CMD_N163_WAVE_LOADPOS:
+    case DIV_CMD_N163_WAVE_LOADLEN:
+    case DIV_CMD_N163_WAVE_LOADMODE:
+    case DIV_CMD_N163_CHANNEL_LIMIT:
+    case DIV_CMD_N163_GLOBAL_WAVE_LOAD:
+    case DIV_CMD_N163_GLOBAL_WAVE_LOADPOS:
+    case DIV_CMD_N163_GLOBAL_WAVE_LOADLEN:
+    case DIV_CMD_N163_GLOBAL_WAVE_LOADMODE:
+    case DIV_CMD_SU_SYNC_PERIOD_LOW:
+    case DIV_CMD_SU_SYNC_PERIOD_HIGH:
+    case DIV_CMD_ADPCMA_GLOBAL_VOLUME:
+    case DIV_CMD_SNES_ECHO:
+    case DIV_CMD_SNES_PITCH_MOD:
+    case DIV_CMD_SNES_INVERT:
+    case DIV_CMD_SNES_GAIN_MODE:
+    case DIV_CMD_SNES_GAIN:
+    case DIV_CMD_SNES_ECHO_ENABLE:
+    case DIV_CMD_SNES_ECHO_DELAY:
+    case DIV_CMD_SNES_ECHO_VOL_LEFT:
+    case DIV_CMD_SNES_ECHO_VOL_RIGHT:
+    case DIV_CMD_SNES_ECHO_FEEDBACK:
+    case DIV_CMD_NES_ENV_MODE:
+    case DIV_CMD_NES_LENGTH:
+    case DIV_CMD_NES_COUNT_MODE:
+    case DIV_CMD_NES_SWEEP:
+      return 1;
+    case DIV_CMD_FM_TL:
+    case DIV_CMD_FM_AM:
+    case DIV_CMD_FM_AR:
+    case DIV_CMD_FM_DR:
+    case DIV_CMD_FM_SL:
+    case DIV_CMD_FM_D2R:
+    case DIV_CMD_FM_RR:
+    case DIV_CMD_FM_DT:
+    case DIV_CMD_FM_DT2:
+    case DIV_CMD_FM_RS:
+    case DIV_CMD_FM_KSR:
+    case DIV_CMD_FM_VIB:
+    case DIV_CMD_FM_SUS:
+    case DIV_CMD_FM_WS:
+    case DIV_CMD_FM_SSG:
+    case DIV_CMD_FM_REV:
+    case DIV_CMD_FM_EG_SHIFT:
+    case DIV_CMD_FM_MULT:
+    case DIV_CMD_FM_FINE:
+    case DIV_CMD_AY_IO_WRITE:
+    case DIV_CMD_AY_AUTO_PWM:
+    case DIV_CMD_SU_SWEEP_PERIOD_LOW:
+    case DIV_CMD_SU_SWEEP_PERIOD_HIGH:
+    case DIV_CMD_SU_SWEEP_BOUND:
+    case DIV_CMD_SU_SWEEP_ENABLE:
+    case DIV_CMD_SNES_ECHO_FIR:
+    case DIV_CMD_C64_FINE_DUTY:
+    case DIV_CMD_C64_FINE_CUTOFF:
+    case DIV_CMD_LYNX_LFSR_LOAD:
+    case DIV_CMD_VOLUME:
+    case DIV_CMD_PITCH:
+    case DIV_CMD_LEGATO:
+    case DIV_CMD_QSOUND_ECHO_DELAY:
+    case DIV_CMD_X1_010_ENVELOPE_SLIDE:
+    case DIV_CMD_AY_ENVELOPE_SLIDE:
+    case DIV_CMD_FM_FIXFREQ:
+      return 2;
+    case DIV_CMD_NOTE_PORTA:
+    case DIV_CMD_SAMPLE_POS:
+      return 4;
+  }
+  return 0;
+}
+
+int DivCSPlayer::readByte(int ch) {
+  DivCSChannelState& c=chan[ch];
+  if (c.readPos>=chanLen[ch]) return -1;
+  if (flags&DIV_CS_FLAG_COMPRESSED) {
+    int block=c.readPos/blockSize;
+    if (block!=chanCurBlock[ch]) {
+      if (block>=(int)(chanBlocks[ch].size()/2)) return -1;
+      unsigned int off=chanBlocks[ch][block*2];
+      unsigned int compLen=chanBlocks[ch][block*2+1];
+      if (off>len || compLen>len-off) return -1;
+      uLongf blockLen=blockSize;
+      if (uncompress(chanBlock[ch],&blockLen,buf+off,compLen)!=Z_OK) {
+        logE("cmdStream: could not decompress block %d of channel %d!",block,ch);
+        return -1;
+      }
+      chanCurBlock[ch]=block;
+    }
+    return chanBlock[ch][(c.readPos++)-block*blockSize];
+  }
+  return chanData[ch][c.readPos++];
+}
+
+bool DivCSPlayer::readBytes(int ch, unsigned char* out, int count) {
+  for (int i=0; i<count; i++) {
+    int next=readByte(ch);
+    if (next<0) return false;
+    out[i]=next;
+  }
+  return true;
+}
+
+void DivCSPlayer::dispatchCmd(int cmd, int ch, int value, int value2) {
+  if (silent) return;
+  e->dispatchCmd(DivCommand((DivDispatchCmds)cmd,ch,value,value2));
+}
+
+void DivCSPlayer::runCommands(int ch) {
+  DivCSChannelState& c=chan[ch];
+  unsigned char arg[8];
+  while (!c.ended) {
+    int next=readByte(ch);
+    if (next<0) {
+      c.ended=true;
+      break;
+    }
+    if (next<0xb4) {
+      dispatchCmd(DIV_CMD_NOTE_ON,ch,next-60);
+      continue;
+    }
+    if (next>=0xe0 && next<0xf0) {
+      c.waitTicks=fastDelays[next-0xe0];
+      break;
+    }
+    if (next==0xfc || next==0xfd || next==0xfe) {
+      if (next==0xfc) {
+        if (!readBytes(ch,arg,2)) {
+          c.ended=true;
+          break;
+        }
+        c.waitTicks=arg[0]|(arg[1]<<8);
+      } else if (next==0xfd) {
+        if (!readBytes(ch,arg,1)) {
+          c.ended=true;
+          break;
+        }
+        c.waitTicks=arg[0];
+      } else {
+        c.waitTicks=1;
+      }
+      break;
+    }
+    int cmd=-1;
+    if (next>=0xd0 && next<0xe0) {
+      cmd=fastCmds[next-0xd0];
+    } else if (next==0xf7) {
+      cmd=readByte(ch);
+    }
+    if (cmd>=0) {
+      // extended command
+      int cmdLen=getCommandLength(cmd);
+      if (!readBytes(ch,arg,cmdLen)) {
+        c.ended=true;
+        break;
+      }
+      int value=0;
+      int value2=0;
+      if (cmdLen>=1) value=arg[0];
+      if (cmdLen>=2) value2=arg[1];
+      switch (cmd) {
+        case DIV_CMD_C64_FINE_DUTY:
+        case DIV_CMD_C64_FINE_CUTOFF:
+        case DIV_CMD_LYNX_LFSR_LOAD:
+        case DIV_CMD_QSOUND_ECHO_DELAY:
+          value=arg[0]|(arg[1]<<8);
+          value2=0;
+          break;
+        case DIV_CMD_VOLUME:
+        case DIV_CMD_PITCH:
+        case DIV_CMD_LEGATO:
+        case DIV_CMD_X1_010_ENVELOPE_SLIDE:
+        case DIV_CMD_AY_ENVELOPE_SLIDE:
+          value=(short)(arg[0]|(arg[1]<<8));
+          value2=0;
+          break;
+        case DIV_CMD_NOTE_PORTA:
+          value=(short)(arg[0]|(arg[1]<<8));
+          value2=(short)(arg[2]|(arg[3]<<8));
+          break;
+        case DIV_CMD_SAMPLE_POS:
+          value=arg[0]|(arg[1]<<8)|(arg[2]<<16)|((unsigned int)arg[3]<<24);
+          value2=0;
+          break;
+        case DIV_CMD_FM_TL:
+        case DIV_CMD_FM_AM:
+        case DIV_CMD_FM_AR:
+        case DIV_CMD_FM_DR:
+        case DIV_CMD_FM_SL:
+        case DIV_CMD_FM_D2R:
+        case DIV_CMD_FM_RR:
+        case DIV_CMD_FM_DT:
+        case DIV_CMD_FM_DT2:
+        case DIV_CMD_FM_RS:
+        case DIV_CMD_FM_KSR:
+        case DIV_CMD_FM_VIB:
+        case DIV_CMD_FM_SUS:
+        case DIV_CMD_FM_WS:
+        case DIV_CMD_FM_SSG:
+        case DIV_CMD_FM_REV:
+        case DIV_CMD_FM_EG_SHIFT:
+        case DIV_CMD_FM_MULT:
+        case DIV_CMD_FM_FINE:
+          // operator (-1 means all of them)
+          value=(signed char)arg[0];
+          break;
+        case DIV_CMD_FM_FIXFREQ:
+          value=arg[1]>>4;
+          value2=(arg[0]|(arg[1]<<8))&0x7ff;
+          break;
+        case DIV_CMD_NES_SWEEP:
+          value=(arg[0]&8)?1:0;
+          value2=arg[0]&0x77;
+          break;
+      }
+      dispatchCmd(cmd,ch,value,value2);
+      continue;
+    }
+    switch (next) {
+      case 0xb4: // note on (null)
+        dispatchCmd(DIV_CMD_NOTE_ON,ch,DIV_NOTE_NULL);
+        break;
+      case 0xb5: // note off
+      case 0xb6: // note off (env)
+      case 0xb7: // env release
+        dispatchCmd(next-0xb4,ch);
+        break;
+      case 0xb8: // instrument
+        if (!readBytes(ch,arg,1)) {
+          c.ended=true;
+          break;
+        }
+        dispatchCmd(DIV_CMD_INSTRUMENT,ch,arg[0]);
+        break;
+      case 0xbe: // panning
+        if (!readBytes(ch,arg,2)) {
+          c.ended=true;
+          break;
+        }
+        dispatchCmd(DIV_CMD_PANNING,ch,arg[0],arg[1]);
+        break;
+      case 0xc0: // pre porta
+        if (!readBytes(ch,arg,1)) {
+          c.ended=true;
+          break;
+        }
+        dispatchCmd(DIV_CMD_PRE_PORTA,ch,(arg[0]&0x80)?1:0,(arg[0]&0x40)?1:0);
+        break;
+      // hints. the effects they describe are in the stream as well, so they
+      // are skipped.
+      case 0xc2: // vibrato
+      case 0xc6: // arpeggio
+      case 0xc8: // volume slide
+      case 0xc9: // porta
+        if (!readBytes(ch,arg,2)) {
+          c.ended=true;
+        }
+        break;
+      case 0xc3: // vibrato range
+      case 0xc4: // vibrato shape
+      case 0xc5: // pitch
+      case 0xc7: // volume
+      case 0xca: // legato
+        if (!readBytes(ch,arg,1)) {
+          c.ended=true;
+        }
+        break;
+      case 0xfb: // tick rate
+        if (!readBytes(ch,arg,4)) {
+          c.ended=true;
+          break;
+        }
+        divider=(double)(arg[0]|(arg[1]<<8)|(arg[2]<<16)|((unsigned int)arg[3]<<24))/65536.0;
+        if (!silent) e->divider=divider;
+        break;
+      case 0xff: // end
+        c.ended=true;
+        break;
+      default:
+        logW("cmdStream: unknown command %.2x in channel %d!",next,ch);
+        c.ended=true;
+        break;
+    }
+  }
+}
+
+void DivCSPlayer::updateRow() {
+  if (rows.empty()) return;
+  while (curRowPos+1<rows.size() && rows[curRowPos+1].tick<=curTick) curRowPos++;
+  if (!silent) {
+    e->prevOrder=rows[curRowPos].order;
+    e->prevRow=rows[curRowPos].row;
+    e->curOrder=e->prevOrder;
+    e->curRow=e->prevRow;
+  }
+}
+
+int DivCSPlayer::getRowTick(int order, int row) {
+  for (DivCSRowPos& i: rows) {
+    if (i.order==order && i.row==row) return i.tick;
+  }
+  return -1;
+}
+
+int DivCSPlayer::getLoopTick() {
+  if (loopOrder<0) return -1;
+  return getRowTick(loopOrder,loopRow);
+}
+
+int DivCSPlayer::getTick() {
+  return curTick;
+}
+
+double DivCSPlayer::getDivider() {
+  return divider;
+}
+
+int DivCSPlayer::getChannelCount() {
+  return chans;
+}
+
+bool DivCSPlayer::hasIndex() {
+  return !rows.empty();
+}
+
+const DivCSChannelState* DivCSPlayer::getChanState(int ch) {
+  if (ch<0 || ch>=chans) return NULL;
+  return &chan[ch];
+}
+
+bool DivCSPlayer::seek(int tick, bool silentSeek) {
+  if (tick<0) return false;
+
+  // find the nearest keyframe.
+  // keyframes only hold the state of the player, not that of the chips (e.g.
+  // macro positions), so seeks which reach the dispatches start over from the
+  // beginning instead, like playSub() does.
+  const DivCSKeyframe* kf=NULL;
+  if (silentSeek) for (DivCSKeyframe& i: keyframes) {
+    if (i.tick>tick) break;
+    kf=&i;
+  }
+
+  for (int i=0; i<chans; i++) {
+    chan[i]=DivCSChannelState();
+    if (kf!=NULL) {
+      chan[i].read(buf+kf->stateOff+i*DIV_CS_STATE_SIZE);
+    }
+  }
+  if (kf!=NULL) {
+    curTick=kf->tick;
+    divider=kf->divider;
+  } else {
+    curTick=0;
+    divider=initDivider;
+  }
+
+  bool oldSilent=silent;
+  silent=silentSeek;
+  if (!silent) {
+    e->divider=divider;
+  }
+
+  // run the remaining ticks
+  while (curTick<tick) {
+    bool allEnded=true;
+    for (int i=0; i<chans; i++) {
+      if (chan[i].ended) continue;
+      if (chan[i].waitTicks>0) chan[i].waitTicks--;
+      if (chan[i].waitTicks==0) runCommands(i);
+      if (!chan[i].ended) allEnded=false;
+    }
+    if (allEnded) break;
+    if (!silent) {
+      for (int i=0; i<e->song.systemLen; i++) e->disCont[i].dispatch->tick(true);
+    }
+    curTick++;
+  }
+  silent=oldSilent;
+
+  curRowPos=0;
+  updateRow();
+  return curTick==tick;
+}
+
+bool DivCSPlayer::tick() {
+  bool ret=false;
+  bool allEnded=true;
+  for (int i=0; i<chans; i++) {
+    if (chan[i].ended) continue;
+    if (chan[i].waitTicks>0) chan[i].waitTicks--;
+    if (chan[i].waitTicks==0) runCommands(i);
+    if (!chan[i].ended) allEnded=false;
+  }
+  if (allEnded) {
+    ret=true;
+    int loopTick=getLoopTick();
+    if (loopTick>=0 && seek(loopTick,true)) {
+      for (int i=0; i<chans; i++) {
+        if (chan[i].ended) continue;
+        if (chan[i].waitTicks>0) chan[i].waitTicks--;
+        if (chan[i].waitTicks==0) runCommands(i);
+      }
+    } else {
+      return ret;
+    }
+  }
+  curTick++;
+  updateRow();
+  return ret;
+}
+
+bool DivCSPlayer::init() {
+  SafeReader r(buf,len);
+  unsigned int chanOff[DIV_MAX_CHANS];
+  unsigned int indexOff=0;
+  try {
+    char magic[4];
+    r.read(magic,4);
+    if (memcmp(magic,"FCS\0",4)!=0) {
+      logE("cmdStream: not a binary command stream!");
+      return false;
+    }
+    chans=r.readI();
+    if (chans<1 || chans>DIV_MAX_CHANS) {
+      logE("cmdStream: invalid channel count %d!",chans);
+      return false;
+    }
+    if (!silent && chans!=e->getTotalChannelCount()) {
+      logE("cmdStream: the stream has %d channels but the song has %d!",chans,e->getTotalChannelCount());
+      return false;
+    }
+    for (int i=0; i<chans; i++) {
+      chanOff[i]=r.readI();
+      if (chanOff[i]>len) {
+        logE("cmdStream: channel %d is out of bounds!",i);
+        return false;
+      }
+    }
+    r.read(fastDelays,16);
+    r.read(fastCmds,16);
+
+    // extension
+    flags=0;
+    blockSize=DIV_CS_BLOCK_SIZE;
+    initDivider=e->curSubSong->hz;
+    loopOrder=-1;
+    loopRow=0;
+    r.read(magic,4);
+    if (memcmp(magic,DIV_CS_EXT_MAGIC,4)==0) {
+      flags=r.readI();
+      blockSize=r.readI();
+      initDivider=(double)(unsigned int)r.readI()/65536.0;
+      r.readI(); // arpeggio speed
+      loopOrder=r.readI();
+      loopRow=r.readI();
+      indexOff=r.readI();
+      if (blockSize<16 || blockSize>1048576) {
+        logE("cmdStream: invalid block size!");
+        return false;
+      }
+    }
+
+    // channel streams
+    for (int i=0; i<chans; i++) {
+      unsigned int end=len;
+      for (int j=0; j<chans; j++) {
+        if (chanOff[j]>chanOff[i] && chanOff[j]<end) end=chanOff[j];
+      }
+      if (indexOff>chanOff[i] && indexOff<end) end=indexOff;
+      if (flags&DIV_CS_FLAG_COMPRESSED) {
+        r.seek(chanOff[i],SEEK_SET);
+        chanLen[i]=r.readI();
+        int blocks=r.readI();
+        if (blocks<0 || (size_t)blocks*8>len) {
+          logE("cmdStream: invalid block count in channel %d!",i);
+          return false;
+        }
+        chanBlocks[i].reserve(blocks*2);
+        for (int j=0; j<blocks*2; j++) {
+          chanBlocks[i].push_back(r.readI());
+        }
+        chanBlock[i]=new unsigned char[blockSize];
+        chanCurBlock[i]=-1;
+      } else {
+        chanData[i]=buf+chanOff[i];
+        chanLen[i]=end-chanOff[i];
+      }
+    }
+
+    // seek index
+    if (indexOff!=0) {
+      r.seek(indexOff,SEEK_SET);
+      int rowCount=r.readI();
+      if (rowCount<0 || (size_t)rowCount*8>len) {
+        logE("cmdStream: invalid seek index!");
+        return false;
+      }
+      rows.reserve(rowCount);
+      for (int i=0; i<rowCount; i++) {
+        DivCSRowPos p;
+        p.order=r.readS();
+        p.row=r.readS();
+        p.tick=r.readI();
+        rows.push_back(p);
+      }
+      int kfCount=r.readI();
+      if (kfCount<0 || (size_t)kfCount*8>len) {
+        logE("cmdStream: invalid seek index!");
+        return false;
+      }
+      keyframes.reserve(kfCount);
+      for (int i=0; i<kfCount; i++) {
+        DivCSKeyframe kf;
+        kf.tick=r.readI();
+        kf.divider=(double)(unsigned int)r.readI()/65536.0;
+        kf.stateOff=r.tell();
+        if (!r.seek(chans*DIV_CS_STATE_SIZE,SEEK_CUR) || r.tell()!=kf.stateOff+chans*DIV_CS_STATE_SIZE) {
+          logE("cmdStream: keyframe %d is truncated!",i);
+          return false;
+        }
+        keyframes.push_back(kf);
+      }
+    }
+  } catch (EndOfFileException& e) {
+    logE("cmdStream: premature end of file!");
+    return false;
+  }
+
+  seek(0,true);
+  return true;
+}
+
+DivCSPlayer::DivCSPlayer(DivEngine* en, unsigned char* f, size_t length, bool silentPlayer):
+  e(en),
+  buf(f),
+  len(length),
+  silent(silentPlayer),
+  chans(0),
+  flags(0),
+  blockSize(DIV_CS_BLOCK_SIZE),
+  loopOrder(-1),
+  loopRow(0),
+  initDivider(60.0),
+  divider(60.0),
+  curTick(0),
+  curRowPos(0) {
+  memset(fastDelays,0,16);
+  memset(fastCmds,0,16);
+  memset(chanData,0,DIV_MAX_CHANS*sizeof(void*));
+  memset(chanLen,0,DIV_MAX_CHANS*sizeof(unsigned int));
+  memset(chanBlock,0,DIV_MAX_CHANS*sizeof(void*));
+  memset(chanCurBlock,-1,DIV_MAX_CHANS*sizeof(int));
+}
+
+DivCSPlayer::~DivCSPlayer() {
+  for (int i=0; i<DIV_MAX_CHANS; i++) {
+    if (chanBlock[i]!=NULL) delete[] chanBlock[i];
+  }
+  delete[] buf;
+}
+
+SafeWriter* buildCSIndex(DivEngine* e, SafeWriter* stream, const std::vector<DivCSRowPos>& rowPos) {
+  unsigned char* copy=new unsigned char[stream->size()];
+  memcpy(copy,stream->getFinalBuf(),stream->size());
+  DivCSPlayer player(e,copy,stream->size(),true);
+  if (!player.init()) return NULL;
+
+  SafeWriter* w=new SafeWriter;
+  w->init();
+
+  // row positions
+  int maxOrder=0;
+  w->writeI(rowPos.size());
+  for (const DivCSRowPos& i: rowPos) {
+    w->writeS(i.order);
+    w->writeS(i.row);
+    w->writeI(i.tick);
+    if (i.order>maxOrder) maxOrder=i.order;
+  }
+
+  // a keyframe at the first row of every order
+  std::vector<bool> orderSeen(maxOrder+1,false);
+  std::vector<int> kfTicks;
+  for (const DivCSRowPos& i: rowPos) {
+    if (i.order<0 || orderSeen[i.order]) continue;
+    orderSeen[i.order]=true;
+    kfTicks.push_back(i.tick);
+  }
+
+  size_t kfCountPos=w->tell();
+  int kfCount=0;
+  w->writeI(0);
+  for (int i: kfTicks) {
+    while (player.getTick()<i) {
+      if (player.tick()) break;
+    }
+    if (player.getTick()!=i) break;
+    w->writeI(i);
+    w->writeI((int)(player.getDivider()*65536));
+    for (int j=0; j<player.getChannelCount(); j++) {
+      player.getChanState(j)->write(w);
+    }
+    kfCount++;
+  }
+  w->seek(kfCountPos,SEEK_SET);
+  w->writeI(kfCount);
+  w->seek(0,SEEK_END);
+
+  logD("cmdStream: index has %d rows and %d keyframes",(int)rowPos.size(),kfCount);
+  return w;
+}
+
+SafeWriter* compressCS(SafeWriter* stream) {
+  unsigned char* buf=stream->getFinalBuf();
+  size_t len=stream->size();
+  unsigned int chanOff[DIV_MAX_CHANS];
+  int chans=0;
+  size_t extOff=0;
+  int flags=0;
+
+  SafeReader r(buf,len);
+  try {
+    r.seek(4,SEEK_SET);
+    chans=r.readI();
+    if (chans<1 || chans>DIV_MAX_CHANS) return NULL;
+    for (int i=0; i<chans; i++) {
+      chanOff[i]=r.readI();
+      if (chanOff[i]>len) return NULL;
+    }
+    extOff=8+chans*4+32;
+    r.seek(extOff,SEEK_SET);
+    char magic[4];
+    r.read(magic,4);
+    if (memcmp(magic,DIV_CS_EXT_MAGIC,4)!=0) return NULL;
+    flags=r.readI();
+    if (flags&DIV_CS_FLAG_COMPRESSED) return NULL;
+  } catch (EndOfFileException& e) {
+    return NULL;
+  }
+
+  unsigned int dataStart=len;
+  for (int i=0; i<chans; i++) {
+    if (chanOff[i]<dataStart) dataStart=chanOff[i];
+  }
+
+  SafeWriter* w=new SafeWriter;
+  w->init();
+  w->write(buf,dataStart);
+
+  uLongf compCap=compressBound(DIV_CS_BLOCK_SIZE);
+  unsigned char* compBuf=new unsigned char[compCap];
+  bool failed=false;
+  for (int i=0; i<chans && !failed; i++) {
+    unsigned int end=len;
+    for (int j=0; j<chans; j++) {
+      if (chanOff[j]>chanOff[i] && chanOff[j]<end) end=chanOff[j];
+    }
+    unsigned int rawLen=end-chanOff[i];
+    int blocks=(rawLen+DIV_CS_BLOCK_SIZE-1)/DIV_CS_BLOCK_SIZE;
+
+    unsigned int newOff=w->tell();
+    w->writeI(rawLen);
+    w->writeI(blocks);
+    size_t tablePos=w->tell();
+    for (int j=0; j<blocks*2; j++) {
+      w->writeI(0);
+    }
+    for (int j=0; j<blocks; j++) {
+      unsigned int blockStart=j*DIV_CS_BLOCK_SIZE;
+      uLongf compLen=compCap;
+      if (compress2(compBuf,&compLen,buf+chanOff[i]+blockStart,MIN(DIV_CS_BLOCK_SIZE,rawLen-blockStart),9)!=Z_OK) {
+        logE("cmdStream: could not compress channel %d!",i);
+        failed=true;
+        break;
+      }
+      unsigned int blockOff=w->tell();
+      w->write(compBuf,compLen);
+      w->seek(tablePos+j*8,SEEK_SET);
+      w->writeI(blockOff);
+      w->writeI(compLen);
+      w->seek(0,SEEK_END);
+    }
+
+    w->seek(8+i*4,SEEK_SET);
+    w->writeI(newOff);
+    w->seek(0,SEEK_END);
+  }
+  delete[] compBuf;
+
+  if (failed) {
+    w->finish();
+    delete w;
+    return NULL;
+  }
+
+  w->seek(extOff+4,SEEK_SET);
+  w->writeI(flags|DIV_CS_FLAG_COMPRESSED);
+  w->writeI(DIV_CS_BLOCK_SIZE);
+  w->seek(0,SEEK_END);
+
+  logD("cmdStream: compressed %d bytes to %d",(int)len,(int)w->size());
+  return w;
+}
@@ -0,0 +1,148 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _CMD_STREAM_H
+#define _CMD_STREAM_H
+
+#include "defines.h"
+#include "dispatch.h"
+#include "safeWriter.h"
+#include <vector>
+
+// binary command stream layout:
+// - "FCS\0", channel count and channel stream offsets
+// - 16 preset delays and 16 preset commands
+// - extension ("FCSX"): flags, block size, tick rate (16.16), arpeggio
+//   speed, loop order/row (-1 if the song does not loop), seek index offset
+//   (0 if absent) and 8 reserved bytes
+// - channel streams. when compressed, each one starts with its length, the
+//   block count and the offset/length of every block.
+// - seek index: row count followed by order/row (short) and tick of each row
+//   in playback order, then keyframe count followed by tick, tick rate and
+//   the state of every channel at the beginning of each order.
+#define DIV_CS_EXT_MAGIC "FCSX"
+#define DIV_CS_EXT_SIZE 40
+// channel streams are split into zlib-compressed blocks
+#define DIV_CS_FLAG_COMPRESSED 1
+#define DIV_CS_BLOCK_SIZE 4096
+// size of a channel state in the seek index
+#define DIV_CS_STATE_SIZE 8
+
+class DivEngine;
+
+// everything the player knows about a channel.
+// this is what the seek index stores at every keyframe.
+struct DivCSChannelState {
+  unsigned int readPos;
+  int waitTicks;
+  bool ended;
+
+  void write(SafeWriter* w) const;
+  void read(const unsigned char* buf);
+
+  DivCSChannelState():
+    readPos(0),
+    waitTicks(0),
+    ended(false) {}
+};
+
+struct DivCSKeyframe {
+  int tick;
+  double divider;
+  // offset of the channel states in the stream
+  unsigned int stateOff;
+};
+
+struct DivCSRowPos {
+  int order, row, tick;
+};
+
+// plays a binary command stream (see DivEngine::saveCommand()) by sending
+// its commands straight to the dispatches of the loaded song, as recorded.
+// effects are stored as the commands they produced, so hints are skipped.
+// the stream may be compressed, and seeking uses the index if present.
+class DivCSPlayer {
+  DivEngine* e;
+  unsigned char* buf;
+  size_t len;
+  bool silent;
+
+  int chans;
+  int flags;
+  int blockSize;
+  int loopOrder, loopRow;
+  double initDivider, divider;
+  int curTick;
+  size_t curRowPos;
+
+  unsigned char fastDelays[16];
+  unsigned char fastCmds[16];
+
+  DivCSChannelState chan[DIV_MAX_CHANS];
+  // uncompressed streams
+  const unsigned char* chanData[DIV_MAX_CHANS];
+  unsigned int chanLen[DIV_MAX_CHANS];
+  // compressed streams
+  std::vector<unsigned int> chanBlocks[DIV_MAX_CHANS];
+  unsigned char* chanBlock[DIV_MAX_CHANS];
+  int chanCurBlock[DIV_MAX_CHANS];
+
+  std::vector<DivCSKeyframe> keyframes;
+  std::vector<DivCSRowPos> rows;
+
+  int readByte(int ch);
+  bool readBytes(int ch, unsigned char* out, int count);
+  void dispatchCmd(int cmd, int ch, int value=0, int value2=0);
+  void runCommands(int ch);
+  void updateRow();
+
+  public:
+    // returns the tick at which the given position starts, or -1.
+    int getRowTick(int order, int row);
+    int getLoopTick();
+    int getTick();
+    double getDivider();
+    int getChannelCount();
+    bool hasIndex();
+    const DivCSChannelState* getChanState(int ch);
+
+    // sets the player state to the beginning of the given tick.
+    // if silent is false, the dispatches receive the commands needed to
+    // get there (the caller should skip register writes meanwhile), which
+    // are all of them from the start of the stream.
+    // otherwise the nearest keyframe is used.
+    bool seek(int tick, bool silent);
+    // runs one tick. returns true if the stream ended.
+    bool tick();
+    bool init();
+
+    // if silent is true, nothing is sent to the engine (used when building
+    // the seek index).
+    // the player takes ownership of f.
+    DivCSPlayer(DivEngine* en, unsigned char* f, size_t length, bool silentPlayer=false);
+    ~DivCSPlayer();
+};
+
+// builds the seek index of an uncompressed binary command stream.
+// rowPos lists the first tick of each row in playback order.
+SafeWriter* buildCSIndex(DivEngine* e, SafeWriter* stream, const std::vector<DivCSRowPos>& rowPos);
+// splits the channel streams of a binary command stream into compressed blocks.
+SafeWriter* compressCS(SafeWriter* stream);
+
+#endif
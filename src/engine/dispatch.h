@@ -274,6 +274,16 @@ struct DivDelayedWrite {
     write(a,v) {}
 };
 
+// a change of output level, for platforms with edge output.
+// the level holds from time (a sample offset) until the next edge.
+struct DivDispatchEdge {
+  unsigned int time;
+  short val[2];
+  DivDispatchEdge(unsigned int t, short l, short r):
+    time(t),
+    val{l,r} {}
+};
+
 struct DivDispatchOscBuffer {
   bool follow;
   unsigned int rate;
@@ -303,6 +313,22 @@ class DivDispatch {
      * please honor these variables if needed.
      */
     bool skipRegisterWrites, dumpWrites;
+
+    /**
+     * whether to fill the per-channel oscilloscope buffers.
+     * this is false in draft quality. platforms may skip oscilloscope writes
+     * in their acquire loop when it is off.
+     */
+    bool captureOsc;
+
+    /**
+     * block acquire helper.
+     * splits [start,start+len) at the sample offsets where register writes
+     * are due (see applyDueWrites()) and renders the runs in between with
+     * acquireRun().
+     * platforms which support block rendering call this from acquire().
+     */
+    void acquireBlocks(short* bufL, short* bufR, size_t start, size_t len);
   public:
     /**
      * the rate the samples are provided.
@@ -326,6 +352,43 @@ class DivDispatch {
      */
     virtual void acquire(short* bufL, short* bufR, size_t start, size_t len);
 
+    /**
+     * render a run of samples during which no register writes are due.
+     * this is only called by acquireBlocks(), so the core may be clocked in a
+     * tight loop (or render the whole run at once if it can).
+     * @param bufL the left or mono channel buffer.
+     * @param bufR the right channel buffer.
+     * @param start the start offset.
+     * @param len the amount of samples to fill.
+     */
+    virtual void acquireRun(short* bufL, short* bufR, size_t start, size_t len);
+
+    /**
+     * apply the queued register writes which are due now.
+     * this is only called by acquireBlocks().
+     * @return the number of samples until the next queued write is due, or 0
+     * if the queue is empty.
+     */
+    virtual size_t applyDueWrites();
+
+    /**
+     * whether this platform currently renders through acquireEdges().
+     * @return whether it does.
+     */
+    virtual bool hasEdgeOutput();
+
+    /**
+     * render samples as a list of output level changes instead of a buffer.
+     * this is for 1-bit/pulse chips running at very high rates, whose output
+     * rarely changes. it must produce the same output as acquire().
+     * the first edge of every call shall be at start, the rest at the
+     * samples where the level may have changed (repeating a level is fine).
+     * @param edges the list to append the edges to.
+     * @param start the start offset.
+     * @param len the amount of samples to render.
+     */
+    virtual void acquireEdges(std::vector<DivDispatchEdge>& edges, size_t start, size_t len);
+
     /**
      * fill a write stream with data (e.g. for software-mixed PCM).
      * @param stream the write stream.
@@ -477,6 +540,12 @@ class DivDispatch {
      */
     virtual void setSkipRegisterWrites(bool value);
 
+    /**
+     * enable or disable oscilloscope capture.
+     * @param value whether to capture.
+     */
+    void setCaptureOsc(bool value);
+
     /**
      * notify instrument change.
      */
@@ -589,6 +658,8 @@ class DivDispatch {
      */
     virtual void quit();
 
+    DivDispatch():
+      captureOsc(true) {}
     virtual ~DivDispatch();
 };
 
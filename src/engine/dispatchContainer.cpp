@@ -88,7 +88,13 @@ void DivDispatchContainer::setQuality(bool lowQual) {
 }
 
 void DivDispatchContainer::acquire(size_t offset, size_t count) {
-  dispatch->acquire(bbIn[0],bbIn[1],offset,count);
+  // the output mode is chosen once per buffer
+  if (offset==0) edgeOutput=dispatch->hasEdgeOutput();
+  if (edgeOutput) {
+    dispatch->acquireEdges(edges,offset,count);
+  } else {
+    dispatch->acquire(bbIn[0],bbIn[1],offset,count);
+  }
 }
 
 void DivDispatchContainer::flush(size_t count) {
@@ -100,32 +106,42 @@ void DivDispatchContainer::flush(size_t count) {
 }
 
 void DivDispatchContainer::fillBuf(size_t runtotal, size_t offset, size_t size) {
+  if (edgeOutput) {
+    fillBufEdges(runtotal,offset,size);
+    return;
+  }
   if (dcOffCompensation && runtotal>0) {
     dcOffCompensation=false;
     prevSample[0]=bbIn[0][0];
     if (dispatch->isStereo()) prevSample[1]=bbIn[1][0];
   }
+  // only changes are fed to the resampler, so a chip holding its output
+  // (e.g. one running at its clock rate) costs one delta per run of samples.
   if (lowQuality) {
     for (size_t i=0; i<runtotal; i++) {
       temp[0]=bbIn[0][i];
+      if (temp[0]==prevSample[0]) continue;
       blip_add_delta_fast(bb[0],i,temp[0]-prevSample[0]);
       prevSample[0]=temp[0];
     }
 
     if (dispatch->isStereo()) for (size_t i=0; i<runtotal; i++) {
       temp[1]=bbIn[1][i];
+      if (temp[1]==prevSample[1]) continue;
       blip_add_delta_fast(bb[1],i,temp[1]-prevSample[1]);
       prevSample[1]=temp[1];
     }
   } else {
     for (size_t i=0; i<runtotal; i++) {
       temp[0]=bbIn[0][i];
+      if (temp[0]==prevSample[0]) continue;
       blip_add_delta(bb[0],i,temp[0]-prevSample[0]);
       prevSample[0]=temp[0];
     }
 
     if (dispatch->isStereo()) for (size_t i=0; i<runtotal; i++) {
       temp[1]=bbIn[1][i];
+      if (temp[1]==prevSample[1]) continue;
       blip_add_delta(bb[1],i,temp[1]-prevSample[1]);
       prevSample[1]=temp[1];
     }
@@ -145,6 +161,35 @@ void DivDispatchContainer::fillBuf(size_t runtotal, size_t offset, size_t size)
   }
 }
 
+void DivDispatchContainer::fillBufEdges(size_t runtotal, size_t offset, size_t size) {
+  if (dcOffCompensation && !edges.empty()) {
+    dcOffCompensation=false;
+    prevSample[0]=edges[0].val[0];
+    if (dispatch->isStereo()) prevSample[1]=edges[0].val[1];
+  }
+  bool stereo=dispatch->isStereo();
+  for (DivDispatchEdge& i: edges) {
+    if (lowQuality) {
+      if (i.val[0]!=prevSample[0]) blip_add_delta_fast(bb[0],i.time,i.val[0]-prevSample[0]);
+      if (stereo && i.val[1]!=prevSample[1]) blip_add_delta_fast(bb[1],i.time,i.val[1]-prevSample[1]);
+    } else {
+      if (i.val[0]!=prevSample[0]) blip_add_delta(bb[0],i.time,i.val[0]-prevSample[0]);
+      if (stereo && i.val[1]!=prevSample[1]) blip_add_delta(bb[1],i.time,i.val[1]-prevSample[1]);
+    }
+    prevSample[0]=i.val[0];
+    if (stereo) prevSample[1]=i.val[1];
+  }
+  edges.clear();
+
+  blip_end_frame(bb[0],runtotal);
+  blip_read_samples(bb[0],bbOut[0]+offset,size,0);
+
+  if (stereo) {
+    blip_end_frame(bb[1],runtotal);
+    blip_read_samples(bb[1],bbOut[1]+offset,size,0);
+  }
+}
+
 void DivDispatchContainer::clear() {
   blip_clear(bb[0]);
   blip_clear(bb[1]);
@@ -152,6 +197,7 @@ void DivDispatchContainer::clear() {
   temp[1]=0;
   prevSample[0]=0;
   prevSample[1]=0;
+  edges.clear();
   if (dispatch->getDCOffRequired()) {
     dcOffCompensation=true;
   }
@@ -164,6 +210,23 @@ void DivDispatchContainer::clear() {
   prevSample[1]=temp[1];*/
 }
 
+// picks an emulation core for the current quality tier.
+// draft uses the cheapest core, accurate the most precise one and normal
+// leaves the choice to the user's settings.
+static int pickCore(DivEngine* eng, const char* key, int fallback, int draft, int accurate) {
+  switch (eng->getQualityTier()) {
+    case DIV_QUALITY_DRAFT:
+      if (draft>=0) return draft;
+      break;
+    case DIV_QUALITY_ACCURATE:
+      if (accurate>=0) return accurate;
+      break;
+    default:
+      break;
+  }
+  return eng->getConfInt(key,fallback);
+}
+
 void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, double gotRate, const DivConfig& flags) {
   if (dispatch!=NULL) return;
 
@@ -192,27 +255,27 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
       break;
     case DIV_SYSTEM_YM2612:
       dispatch=new DivPlatformGenesis;
-      ((DivPlatformGenesis*)dispatch)->setYMFM(eng->getConfInt("ym2612Core",0));
+      ((DivPlatformGenesis*)dispatch)->setYMFM(pickCore(eng,"ym2612Core",0,1,0));
       ((DivPlatformGenesis*)dispatch)->setSoftPCM(false);
       break;
     case DIV_SYSTEM_YM2612_EXT:
       dispatch=new DivPlatformGenesisExt;
-      ((DivPlatformGenesisExt*)dispatch)->setYMFM(eng->getConfInt("ym2612Core",0));
+      ((DivPlatformGenesisExt*)dispatch)->setYMFM(pickCore(eng,"ym2612Core",0,1,0));
       ((DivPlatformGenesisExt*)dispatch)->setSoftPCM(false);
       break;
     case DIV_SYSTEM_YM2612_FRAC:
       dispatch=new DivPlatformGenesis;
-      ((DivPlatformGenesis*)dispatch)->setYMFM(eng->getConfInt("ym2612Core",0));
+      ((DivPlatformGenesis*)dispatch)->setYMFM(pickCore(eng,"ym2612Core",0,1,0));
       ((DivPlatformGenesis*)dispatch)->setSoftPCM(true);
       break;
     case DIV_SYSTEM_YM2612_FRAC_EXT:
       dispatch=new DivPlatformGenesisExt;
-      ((DivPlatformGenesisExt*)dispatch)->setYMFM(eng->getConfInt("ym2612Core",0));
+      ((DivPlatformGenesisExt*)dispatch)->setYMFM(pickCore(eng,"ym2612Core",0,1,0));
       ((DivPlatformGenesisExt*)dispatch)->setSoftPCM(true);
       break;
     case DIV_SYSTEM_SMS:
       dispatch=new DivPlatformSMS;
-      ((DivPlatformSMS*)dispatch)->setNuked(eng->getConfInt("snCore",0));
+      ((DivPlatformSMS*)dispatch)->setNuked(pickCore(eng,"snCore",0,0,1));
       break;
     case DIV_SYSTEM_GB:
       dispatch=new DivPlatformGB;
@@ -222,21 +285,21 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
       break;
     case DIV_SYSTEM_NES:
       dispatch=new DivPlatformNES;
-      ((DivPlatformNES*)dispatch)->setNSFPlay(eng->getConfInt("nesCore",0)==1);
+      ((DivPlatformNES*)dispatch)->setNSFPlay(pickCore(eng,"nesCore",0,-1,-1)==1);
       break;
     case DIV_SYSTEM_C64_6581:
       dispatch=new DivPlatformC64;
-      ((DivPlatformC64*)dispatch)->setFP(eng->getConfInt("c64Core",1)==1);
+      ((DivPlatformC64*)dispatch)->setFP(pickCore(eng,"c64Core",1,0,1)==1);
       ((DivPlatformC64*)dispatch)->setChipModel(true);
       break;
     case DIV_SYSTEM_C64_8580:
       dispatch=new DivPlatformC64;
-      ((DivPlatformC64*)dispatch)->setFP(eng->getConfInt("c64Core",1)==1);
+      ((DivPlatformC64*)dispatch)->setFP(pickCore(eng,"c64Core",1,0,1)==1);
       ((DivPlatformC64*)dispatch)->setChipModel(false);
       break;
     case DIV_SYSTEM_YM2151:
       dispatch=new DivPlatformArcade;
-      ((DivPlatformArcade*)dispatch)->setYMFM(eng->getConfInt("arcadeCore",0)==0);
+      ((DivPlatformArcade*)dispatch)->setYMFM(pickCore(eng,"arcadeCore",0,0,1)==0);
       break;
     case DIV_SYSTEM_YM2610:
     case DIV_SYSTEM_YM2610_FULL:
@@ -263,7 +326,7 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
       break;
     case DIV_SYSTEM_FDS:
       dispatch=new DivPlatformFDS;
-      ((DivPlatformFDS*)dispatch)->setNSFPlay(eng->getConfInt("fdsCore",0)==1);
+      ((DivPlatformFDS*)dispatch)->setNSFPlay(pickCore(eng,"fdsCore",0,-1,-1)==1);
       break;
     case DIV_SYSTEM_TIA:
       dispatch=new DivPlatformTIA;
@@ -441,6 +504,7 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
       dispatch=new DivPlatformDummy;
       break;
   }
+  dispatch->setCaptureOsc(eng->getQualityTier()!=DIV_QUALITY_DRAFT);
   dispatch->init(eng,chanCount,gotRate,flags);
 }
 
@@ -34,9 +34,14 @@
 #endif
 #include <math.h>
 #include <float.h>
+#include <algorithm>
 #ifdef HAVE_SNDFILE
 #include "sfWrapper.h"
 #endif
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 #include <fmt/printf.h>
 
 void process(void* u, float** in, float** out, int inChans, int outChans, unsigned int size) {
@@ -274,6 +279,368 @@ double DivEngine::benchmarkSeek() {
   return tAvg;
 }
 
+double DivEngine::benchmarkChips() {
+  double samplesPending[DIV_MAX_CHIPS];
+  double chipTime[DIV_MAX_CHIPS];
+  size_t chipSamples[DIV_MAX_CHIPS];
+  size_t bufLen=EXPORT_BUFSIZE;
+  short* buf[2];
+  buf[0]=new short[bufLen];
+  buf[1]=new short[bufLen];
+
+  for (int i=0; i<DIV_MAX_CHIPS; i++) {
+    samplesPending[i]=0.0;
+    chipTime[i]=0.0;
+    chipSamples[i]=0;
+  }
+
+  curOrder=0;
+  prevOrder=0;
+  remainingLoops=1;
+  playSub(false);
+
+  // run every chip for the length of each tick on its own
+  while (playing) {
+    if (nextTick(false,true)) break;
+    for (int i=0; i<song.systemLen; i++) {
+      samplesPending[i]+=(double)disCont[i].dispatch->rate/divider;
+      size_t count=(size_t)samplesPending[i];
+      samplesPending[i]-=count;
+      if (count>bufLen) {
+        delete[] buf[0];
+        delete[] buf[1];
+        bufLen=count+256;
+        buf[0]=new short[bufLen];
+        buf[1]=new short[bufLen];
+      }
+      std::chrono::high_resolution_clock::time_point timeStart=std::chrono::high_resolution_clock::now();
+      disCont[i].dispatch->acquire(buf[0],buf[1],0,count);
+      std::chrono::high_resolution_clock::time_point timeEnd=std::chrono::high_resolution_clock::now();
+      chipTime[i]+=(double)(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd-timeStart).count())/1000000000.0;
+      chipSamples[i]+=count;
+    }
+  }
+  playing=false;
+
+  delete[] buf[0];
+  delete[] buf[1];
+
+  double total=0.0;
+  for (int i=0; i<song.systemLen; i++) {
+    double songTime=(double)chipSamples[i]/MAX(1,disCont[i].dispatch->rate);
+    printf("[#%d] %s: %.0f samples at %dHz in %fs (%.2f Msamples/s, %.1fx realtime)\n",
+      i+1,
+      getSystemName(song.system[i]),
+      (double)chipSamples[i],
+      disCont[i].dispatch->rate,
+      chipTime[i],
+      (chipTime[i]>0.0)?((double)chipSamples[i]/chipTime[i]/1000000.0):0.0,
+      (chipTime[i]>0.0)?(songTime/chipTime[i]):0.0
+    );
+    total+=chipTime[i];
+  }
+  printf("[RESULT] %fs\n",total);
+  return total;
+}
+
+#define TEST_ENGINES_SAMPLES 441000
+
+bool DivEngine::testEngines(int instances) {
+  SafeWriter* w=saveFur();
+  if (w==NULL) {
+    logE("could not save the song for the test!");
+    return false;
+  }
+
+  // loads the song into a new engine and renders TEST_ENGINES_SAMPLES
+  // samples from the start. the engine is returned so that it can be quit
+  // later, or NULL on failure.
+  auto render=[w](std::vector<float>& out) -> DivEngine* {
+    DivEngine* e=new DivEngine;
+    e->setAudio(DIV_AUDIO_DUMMY);
+    e->setView(DIV_STATUS_NOTHING);
+    // load() takes ownership of the buffer
+    unsigned char* file=new unsigned char[w->size()];
+    memcpy(file,w->getFinalBuf(),w->size());
+    if (!e->load(file,w->size())) {
+      logE("could not load the song! (%s)",e->getLastError());
+      delete e;
+      return NULL;
+    }
+    if (!e->init()) {
+      logE("could not initialize engine!");
+      e->quit();
+      delete e;
+      return NULL;
+    }
+
+    float* outBuf[2];
+    outBuf[0]=new float[EXPORT_BUFSIZE];
+    outBuf[1]=new float[EXPORT_BUFSIZE];
+    out.resize(TEST_ENGINES_SAMPLES*2);
+
+    e->curOrder=0;
+    e->prevOrder=0;
+    e->remainingLoops=-1;
+    e->playSub(false);
+    for (size_t i=0; i<TEST_ENGINES_SAMPLES; i+=EXPORT_BUFSIZE) {
+      size_t len=MIN(EXPORT_BUFSIZE,TEST_ENGINES_SAMPLES-i);
+      e->nextBuf(NULL,outBuf,0,2,len);
+      for (size_t j=0; j<len; j++) {
+        out[(i+j)<<1]=outBuf[0][j];
+        out[((i+j)<<1)|1]=outBuf[1][j];
+      }
+    }
+    e->playing=false;
+
+    delete[] outBuf[0];
+    delete[] outBuf[1];
+    return e;
+  };
+
+  // reference
+  std::vector<float> ref;
+  DivEngine* refEngine=render(ref);
+  if (refEngine==NULL) {
+    w->finish();
+    delete w;
+    return false;
+  }
+  refEngine->quit();
+  delete refEngine;
+
+  // all instances at once
+  std::vector<std::vector<float>> outs(instances);
+  std::vector<DivEngine*> engines(instances,NULL);
+  std::vector<std::thread*> threads;
+  for (int i=0; i<instances; i++) {
+    threads.push_back(new std::thread([&render,&outs,&engines,i]() {
+      engines[i]=render(outs[i]);
+    }));
+  }
+  for (std::thread* i: threads) {
+    i->join();
+    delete i;
+  }
+
+  // engines are quit one at a time since quit() writes the configuration
+  bool ret=true;
+  for (int i=0; i<instances; i++) {
+    if (engines[i]==NULL) {
+      printf("[#%d] failed to render\n",i+1);
+      ret=false;
+      continue;
+    }
+    engines[i]->quit();
+    delete engines[i];
+
+    int mismatch=-1;
+    for (size_t j=0; j<ref.size(); j++) {
+      if (memcmp(&ref[j],&outs[i][j],sizeof(float))!=0) {
+        mismatch=j>>1;
+        break;
+      }
+    }
+    if (mismatch>=0) {
+      printf("[#%d] mismatch at sample %d\n",i+1,mismatch);
+      ret=false;
+    } else {
+      printf("[#%d] OK\n",i+1);
+    }
+  }
+
+  w->finish();
+  delete w;
+
+  printf("[RESULT] %s (%d engines, %d samples)\n",ret?"pass":"FAIL",instances,TEST_ENGINES_SAMPLES);
+  return ret;
+}
+
+#define TEST_CS_MAX_TICKS 100000
+
+bool DivEngine::testCommandStream() {
+  int seekOrder=curSubSong->ordersLen/2;
+  bool ret=true;
+
+  // runs playback for up to maxTicks ticks (or until the song ends) and
+  // collects the register writes of every chip (chip, address and value),
+  // as well as the position of each tick and where its writes begin.
+  // the stream stores each channel on its own, so within a tick the writes
+  // of different channels may come in another order than in the engine.
+  // the writes of each tick are thus sorted by chip and address, keeping
+  // the order of those to the same register. Furnace-specific writes
+  // (0xffffxxxx) are shared by all channels, so these are sorted by value too.
+  auto dump=[this](std::vector<unsigned int>& writes, std::vector<size_t>& tickStart, std::vector<DivCSRowPos>& tickPos, int maxTicks) {
+    std::vector<unsigned int> tickWrites;
+    std::vector<size_t> order;
+    writes.clear();
+    tickStart.clear();
+    tickPos.clear();
+    for (int i=0; i<maxTicks; i++) {
+      DivExportTick t;
+      runExportTick(t);
+      DivCSRowPos pos;
+      pos.order=t.prevOrder;
+      pos.row=t.prevRow;
+      pos.tick=i;
+      tickStart.push_back(writes.size());
+      tickPos.push_back(pos);
+      tickWrites.clear();
+      for (int j=0; j<song.systemLen; j++) {
+        std::vector<DivRegWrite>& chipWrites=disCont[j].dispatch->getRegisterWrites();
+        for (DivRegWrite& k: chipWrites) {
+          tickWrites.push_back(j);
+          tickWrites.push_back(k.addr);
+          tickWrites.push_back(k.val);
+        }
+        chipWrites.clear();
+      }
+      order.clear();
+      for (size_t j=0; j<tickWrites.size(); j+=3) order.push_back(j);
+      std::stable_sort(order.begin(),order.end(),[&tickWrites](size_t a, size_t b) {
+        if (tickWrites[a]!=tickWrites[b]) return tickWrites[a]<tickWrites[b];
+        if (tickWrites[a+1]!=tickWrites[b+1]) return tickWrites[a+1]<tickWrites[b+1];
+        if (tickWrites[a+1]>=0xffff0000) return tickWrites[a+2]<tickWrites[b+2];
+        return false;
+      });
+      for (size_t j: order) {
+        writes.push_back(tickWrites[j]);
+        writes.push_back(tickWrites[j+1]);
+        writes.push_back(tickWrites[j+2]);
+      }
+      if (t.songEnd) break;
+    }
+    tickStart.push_back(writes.size());
+  };
+
+  auto setDump=[this](bool enable) {
+    for (int i=0; i<song.systemLen; i++) {
+      disCont[i].dispatch->toggleRegisterDump(enable);
+      disCont[i].dispatch->getRegisterWrites().clear();
+    }
+  };
+
+  // reference: the engine's own playback, from the start and from the
+  // beginning of seekOrder.
+  // playSub() does not bring effects to the state they would have when
+  // playing through, so the engine gets to seekOrder by playing silently
+  // instead (which is what seekStream() does with the stream).
+  std::vector<unsigned int> refWrites[2];
+  std::vector<size_t> refTickStart[2];
+  std::vector<DivCSRowPos> refTickPos[2];
+  int seekTick=-1;
+  stop();
+  setDump(true);
+  for (int i=0; i<2; i++) {
+    curOrder=0;
+    prevOrder=0;
+    remainingLoops=-1;
+    playSub(false);
+    if (i) {
+      for (size_t j=0; j<refTickPos[0].size(); j++) {
+        if (refTickPos[0][j].order==seekOrder && refTickPos[0][j].row==0) {
+          seekTick=j;
+          break;
+        }
+      }
+      if (seekTick<0) break;
+      for (int j=0; j<song.systemLen; j++) disCont[j].dispatch->setSkipRegisterWrites(true);
+      for (int j=0; j<seekTick; j++) {
+        DivExportTick t;
+        runExportTick(t);
+      }
+      for (int j=0; j<song.systemLen; j++) disCont[j].dispatch->setSkipRegisterWrites(false);
+      if (seekTick>0) {
+        for (int j=0; j<song.systemLen; j++) disCont[j].dispatch->forceIns();
+      }
+    }
+    dump(refWrites[i],refTickStart[i],refTickPos[i],TEST_CS_MAX_TICKS);
+  }
+  playing=false;
+  setDump(false);
+  if (seekTick<0) {
+    printf("[order %d] not reached by the song. not testing seeks.\n",seekOrder);
+  }
+
+  std::vector<unsigned int> writes;
+  std::vector<size_t> tickStart;
+  std::vector<DivCSRowPos> tickPos;
+  for (int compress=0; compress<2; compress++) {
+    SafeWriter* w=saveCommand(true,NULL,compress);
+    if (w==NULL) {
+      logE("could not export the command stream!");
+      return false;
+    }
+    for (int i=0; i<(seekTick<0?1:2); i++) {
+      String name=fmt::sprintf("%s%s",i?fmt::sprintf("order %d",seekOrder):String("start"),compress?", compressed":"");
+      // the player takes ownership of the buffer
+      unsigned char* buf=new unsigned char[w->size()];
+      memcpy(buf,w->getFinalBuf(),w->size());
+      setDump(true);
+      if (!playStream(buf,w->size())) {
+        printf("[%s] could not play the command stream! (%s)\n",name.c_str(),lastError.c_str());
+        setDump(false);
+        ret=false;
+        continue;
+      }
+      if (i) {
+        // only the writes of the seek are compared
+        setDump(true);
+        if (!seekStream(seekOrder,0)) {
+          printf("[%s] could not seek! (%s)\n",name.c_str(),lastError.c_str());
+          killStream();
+          setDump(false);
+          ret=false;
+          continue;
+        }
+      }
+      dump(writes,tickStart,tickPos,refTickPos[i].size());
+      killStream();
+      setDump(false);
+
+      // compare tick by tick.
+      // the last tick is left out: when the song loops the engine starts
+      // playback over (which resets the chips), while the player just jumps
+      // to the loop point.
+      int ticks=MIN(tickPos.size(),refTickPos[i].size())-1;
+      int mismatch=-1;
+      for (int j=0; j<ticks; j++) {
+        size_t len=tickStart[j+1]-tickStart[j];
+        size_t refLen=refTickStart[i][j+1]-refTickStart[i][j];
+        if (len!=refLen || memcmp(writes.data()+tickStart[j],refWrites[i].data()+refTickStart[i][j],len*sizeof(unsigned int))!=0) {
+          mismatch=j;
+          break;
+        }
+      }
+      if (mismatch>=0) {
+        printf("[%s] mismatch at tick %d (order %d row %d)\n",name.c_str(),mismatch,refTickPos[i][mismatch].order,refTickPos[i][mismatch].row);
+        // show the writes of that tick (chip:address=value)
+        for (int j=0; j<2; j++) {
+          const std::vector<unsigned int>& which=j?writes:refWrites[i];
+          const std::vector<size_t>& whichStart=j?tickStart:refTickStart[i];
+          String list;
+          for (size_t k=whichStart[mismatch]; k<whichStart[mismatch+1] && k<whichStart[mismatch]+48; k+=3) {
+            list+=fmt::sprintf(" %d:%x=%x",which[k],which[k+1],which[k+2]);
+          }
+          if (whichStart[mismatch+1]-whichStart[mismatch]>48) list+=" ...";
+          printf("  %s:%s\n",j?"stream":"engine",list.c_str());
+        }
+        ret=false;
+      } else if (tickPos.size()!=refTickPos[i].size()) {
+        printf("[%s] stream ended after %d ticks instead of %d\n",name.c_str(),(int)tickPos.size(),(int)refTickPos[i].size());
+        ret=false;
+      } else {
+        printf("[%s] OK (%d ticks)\n",name.c_str(),(int)tickPos.size());
+      }
+    }
+    w->finish();
+    delete w;
+  }
+
+  printf("[RESULT] %s\n",ret?"pass":"FAIL");
+  return ret;
+}
+
 #define WRITE_TICK(x) \
   if (binary) { \
     if (!wroteTick[x]) { \
@@ -364,7 +731,6 @@ void writePackedCommandValues(SafeWriter* w, const DivCommand& c) {
     case DIV_CMD_SAMPLE_MODE:
     case DIV_CMD_SAMPLE_FREQ:
     case DIV_CMD_SAMPLE_BANK:
-    case DIV_CMD_SAMPLE_POS:
     case DIV_CMD_SAMPLE_DIR:
     case DIV_CMD_FM_HARD_RESET:
     case DIV_CMD_FM_LFO:
@@ -392,7 +758,6 @@ void writePackedCommandValues(SafeWriter* w, const DivCommand& c) {
     case DIV_CMD_AY_ENVELOPE_SET:
     case DIV_CMD_AY_ENVELOPE_LOW:
     case DIV_CMD_AY_ENVELOPE_HIGH:
-    case DIV_CMD_AY_ENVELOPE_SLIDE:
     case DIV_CMD_AY_NOISE_MASK_AND:
     case DIV_CMD_AY_NOISE_MASK_OR:
     case DIV_CMD_AY_AUTO_ENVELOPE:
@@ -405,6 +770,48 @@ void writePackedCommandValues(SafeWriter* w, const DivCommand& c) {
     case DIV_CMD_AMIGA_FILTER:
     case DIV_CMD_AMIGA_AM:
     case DIV_CMD_AMIGA_PM:
+    case DIV_CMD_PRE_NOTE:
+    case DIV_CMD_GENESIS_LFO:
+    case DIV_CMD_ARCADE_LFO:
+    case DIV_CMD_QSOUND_ECHO_FEEDBACK:
+    case DIV_CMD_QSOUND_ECHO_LEVEL:
+    case DIV_CMD_QSOUND_SURROUND:
+    case DIV_CMD_X1_010_ENVELOPE_SHAPE:
+    case DIV_CMD_X1_010_ENVELOPE_ENABLE:
+    case DIV_CMD_X1_010_ENVELOPE_MODE:
+    case DIV_CMD_X1_010_ENVELOPE_PERIOD:
+    case DIV_CMD_X1_010_AUTO_ENVELOPE:
+    case DIV_CMD_X1_010_SAMPLE_BANK_SLOT:
+    case DIV_CMD_WS_SWEEP_TIME:
+    case DIV_CMD_WS_SWEEP_AMOUNT:
+    case DIV_CMD_N163_WAVE_POSITION:
+    case DIV_CMD_N163_WAVE_LENGTH:
+    case DIV_CMD_N163_WAVE_MODE:
+    case DIV_CMD_N163_WAVE_LOAD:
+    case DIV_CMD_N163_WAVE_LOADPOS:
+    case DIV_CMD_N163_WAVE_LOADLEN:
+    case DIV_CMD_N163_WAVE_LOADMODE:
+    case DIV_CMD_N163_CHANNEL_LIMIT:
+    case DIV_CMD_N163_GLOBAL_WAVE_LOAD:
+    case DIV_CMD_N163_GLOBAL_WAVE_LOADPOS:
+    case DIV_CMD_N163_GLOBAL_WAVE_LOADLEN:
+    case DIV_CMD_N163_GLOBAL_WAVE_LOADMODE:
+    case DIV_CMD_SU_SYNC_PERIOD_LOW:
+    case DIV_CMD_SU_SYNC_PERIOD_HIGH:
+    case DIV_CMD_ADPCMA_GLOBAL_VOLUME:
+    case DIV_CMD_SNES_ECHO:
+    case DIV_CMD_SNES_PITCH_MOD:
+    case DIV_CMD_SNES_INVERT:
+    case DIV_CMD_SNES_GAIN_MODE:
+    case DIV_CMD_SNES_GAIN:
+    case DIV_CMD_SNES_ECHO_ENABLE:
+    case DIV_CMD_SNES_ECHO_DELAY:
+    case DIV_CMD_SNES_ECHO_VOL_LEFT:
+    case DIV_CMD_SNES_ECHO_VOL_RIGHT:
+    case DIV_CMD_SNES_ECHO_FEEDBACK:
+    case DIV_CMD_NES_ENV_MODE:
+    case DIV_CMD_NES_LENGTH:
+    case DIV_CMD_NES_COUNT_MODE:
       w->writeC(1); // length
       w->writeC(c.value);
       break;
@@ -429,6 +836,11 @@ void writePackedCommandValues(SafeWriter* w, const DivCommand& c) {
     case DIV_CMD_FM_FINE:
     case DIV_CMD_AY_IO_WRITE:
     case DIV_CMD_AY_AUTO_PWM:
+    case DIV_CMD_SU_SWEEP_PERIOD_LOW:
+    case DIV_CMD_SU_SWEEP_PERIOD_HIGH:
+    case DIV_CMD_SU_SWEEP_BOUND:
+    case DIV_CMD_SU_SWEEP_ENABLE:
+    case DIV_CMD_SNES_ECHO_FIR:
       w->writeC(2); // length
       w->writeC(c.value);
       w->writeC(c.value2);
@@ -436,9 +848,24 @@ void writePackedCommandValues(SafeWriter* w, const DivCommand& c) {
     case DIV_CMD_C64_FINE_DUTY:
     case DIV_CMD_C64_FINE_CUTOFF:
     case DIV_CMD_LYNX_LFSR_LOAD:
+    case DIV_CMD_VOLUME:
+    case DIV_CMD_PITCH:
+    case DIV_CMD_LEGATO:
+    case DIV_CMD_QSOUND_ECHO_DELAY:
+    case DIV_CMD_X1_010_ENVELOPE_SLIDE:
+    case DIV_CMD_AY_ENVELOPE_SLIDE:
       w->writeC(2); // length
       w->writeS(c.value);
       break;
+    case DIV_CMD_NOTE_PORTA:
+      w->writeC(4); // length
+      w->writeS(c.value);
+      w->writeS(c.value2);
+      break;
+    case DIV_CMD_SAMPLE_POS:
+      w->writeC(4); // length
+      w->writeI(c.value);
+      break;
     case DIV_CMD_FM_FIXFREQ:
       w->writeC(2); // length
       w->writeS((c.value<<12)|(c.value2&0x7ff));
@@ -454,18 +881,23 @@ void writePackedCommandValues(SafeWriter* w, const DivCommand& c) {
   }
 }
 
-SafeWriter* DivEngine::saveCommand(bool binary) {
-  stop();
-  repeatPattern=false;
-  shallStop=false;
-  setOrder(0);
-  BUSY_BEGIN_SOFT;
-  // determine loop point
+SafeWriter* DivEngine::saveCommand(bool binary, const DivExportPass* pass, bool compress) {
   int loopOrder=0;
   int loopRow=0;
   int loopEnd=0;
-  walkSong(loopOrder,loopRow,loopEnd);
-  logI("loop point: %d %d",loopOrder,loopRow);
+  if (pass==NULL) {
+    stop();
+    repeatPattern=false;
+    shallStop=false;
+    setOrder(0);
+    BUSY_BEGIN_SOFT;
+    // determine loop point
+    walkSong(loopOrder,loopRow,loopEnd);
+    logI("loop point: %d %d",loopOrder,loopRow);
+  } else {
+    loopOrder=pass->loopOrder;
+    loopRow=pass->loopRow;
+  }
 
   int cmdPopularity[256];
   int delayPopularity[256];
@@ -505,6 +937,11 @@ SafeWriter* DivEngine::saveCommand(bool binary) {
     for (int i=0; i<32; i++) {
       w->writeC(0);
     }
+    // extension (filled in later)
+    w->write(DIV_CS_EXT_MAGIC,4);
+    for (int i=4; i<DIV_CS_EXT_SIZE; i++) {
+      w->writeC(0);
+    }
   } else {
     w->writeText("# Furnace Command Stream\n\n");
 
@@ -530,27 +967,57 @@ SafeWriter* DivEngine::saveCommand(bool binary) {
 
   // play the song ourselves
   bool done=false;
-  playSub(false);
+  if (pass==NULL) playSub(false);
   
   if (!binary) {
     w->writeText("[Stream]\n");
   }
   int tick=0;
   bool oldCmdStreamEnabled=cmdStreamEnabled;
-  cmdStreamEnabled=true;
   double curDivider=divider;
+  if (pass==NULL) {
+    cmdStreamEnabled=true;
+  } else if (!pass->ticks.empty()) {
+    curDivider=pass->ticks[0].divider;
+  }
+  double initDivider=curDivider;
   int lastTick[DIV_MAX_CHANS];
+  bool endPlaying=false;
+  size_t passPos=0;
+  // first tick of every row (for the seek index)
+  std::vector<DivCSRowPos> rowPos;
+  std::vector<bool> rowSeen;
 
   memset(lastTick,0,DIV_MAX_CHANS*sizeof(int));
   while (!done) {
-    if (nextTick(false,true) || !playing) {
+    DivExportTick t;
+    if (pass==NULL) {
+      runExportTick(t);
+    } else {
+      if (passPos>=pass->ticks.size()) break;
+      t=pass->ticks[passPos++];
+    }
+    if (t.songEnd) {
       done=true;
     }
+    endPlaying=t.playing;
+    if (binary && t.prevOrder>=0 && t.prevRow>=0) {
+      size_t rowIndex=(t.prevOrder<<8)|(t.prevRow&0xff);
+      if (rowIndex>=rowSeen.size()) rowSeen.resize(rowIndex+1,false);
+      if (!rowSeen[rowIndex]) {
+        rowSeen[rowIndex]=true;
+        DivCSRowPos p;
+        p.order=t.prevOrder;
+        p.row=t.prevRow;
+        p.tick=tick;
+        rowPos.push_back(p);
+      }
+    }
     // get command stream
     bool wroteTickGlobal=false;
     memset(wroteTick,0,DIV_MAX_CHANS*sizeof(bool));
-    if (curDivider!=divider) {
-      curDivider=divider;
+    if (curDivider!=t.divider) {
+      curDivider=t.divider;
       WRITE_TICK(0);
       if (binary) {
         chanStream[0]->writeC(0xfb);
@@ -559,22 +1026,27 @@ SafeWriter* DivEngine::saveCommand(bool binary) {
         w->writeText(fmt::sprintf(">> SET_RATE %f\n",curDivider));
       }
     }
-    for (DivCommand& i: cmdStream) {
+    const DivCommand* tickCmds=(pass==NULL)?cmdStream.data():pass->cmds.data()+t.cmdStart;
+    size_t tickCmdCount=(pass==NULL)?cmdStream.size():(t.cmdEnd-t.cmdStart);
+    for (size_t k=0; k<tickCmdCount; k++) {
+      const DivCommand& i=tickCmds[k];
       switch (i.cmd) {
-        // strip away hinted/useless commands
+        // strip away queries
         case DIV_ALWAYS_SET_VOLUME:
           break;
         case DIV_CMD_GET_VOLUME:
           break;
         case DIV_CMD_VOLUME:
-          break;
         case DIV_CMD_NOTE_PORTA:
-          break;
         case DIV_CMD_LEGATO:
-          break;
         case DIV_CMD_PITCH:
-          break;
-        case DIV_CMD_PRE_NOTE:
+          // the effects are kept as sent, so players don't have to emulate
+          // them from the hints. the text stream still omits them.
+          if (binary) {
+            WRITE_TICK(i.chan);
+            cmdPopularity[i.cmd]++;
+            writePackedCommandValues(chanStream[i.chan],i);
+          }
           break;
         default:
           WRITE_TICK(i.chan);
@@ -587,17 +1059,27 @@ SafeWriter* DivEngine::saveCommand(bool binary) {
           break;
       }
     }
-    cmdStream.clear();
+    if (pass==NULL) cmdStream.clear();
     tick++;
   }
-  cmdStreamEnabled=oldCmdStreamEnabled;
+  if (pass==NULL) cmdStreamEnabled=oldCmdStreamEnabled;
 
   if (binary) {
+    // wait until the end of the song so that players know its length
+    bool wroteTickGlobal=false;
+    memset(wroteTick,0,DIV_MAX_CHANS*sizeof(bool));
+    for (int i=0; i<chans; i++) {
+      WRITE_TICK(i);
+    }
+
     int sortCand=-1;
     int sortPos=0;
     while (sortPos<16) {
       sortCand=-1;
-      for (int i=DIV_CMD_SAMPLE_MODE; i<256; i++) {
+      for (int i=0; i<256; i++) {
+        // commands below DIV_CMD_SAMPLE_MODE have their own codes, except
+        // for these
+        if (i<DIV_CMD_SAMPLE_MODE && i!=DIV_CMD_VOLUME && i!=DIV_CMD_NOTE_PORTA && i!=DIV_CMD_PITCH && i!=DIV_CMD_LEGATO && i!=DIV_CMD_PRE_NOTE) continue;
         if (cmdPopularity[i]) {
           if (sortCand==-1) {
             sortCand=i;
@@ -772,19 +1254,60 @@ SafeWriter* DivEngine::saveCommand(bool binary) {
       w->writeC(sortedCmd[i]);
       if (sortedCmdPopularity[i]) logD("- %s: %d",cmdName[sortedCmd[i]],sortedCmdPopularity[i]);
     }
+
+    // extension
+    size_t extOff=w->tell();
+    w->seek(extOff+4,SEEK_SET);
+    w->writeI(0); // flags
+    w->writeI(DIV_CS_BLOCK_SIZE);
+    w->writeI((int)(initDivider*65536));
+    w->writeI(curSubSong->arpLen);
+    w->writeI(endPlaying?loopOrder:-1);
+    w->writeI(endPlaying?loopRow:-1);
+    w->writeI(0); // index offset
+    w->seek(0,SEEK_END);
+
+    // seek index
+    SafeWriter* index=buildCSIndex(this,w,rowPos);
+    if (index==NULL) {
+      logW("could not build command stream index!");
+    }
+
+    if (compress) {
+      SafeWriter* compressed=compressCS(w);
+      if (compressed!=NULL) {
+        w->finish();
+        delete w;
+        w=compressed;
+      } else {
+        logW("could not compress command stream!");
+      }
+    }
+
+    if (index!=NULL) {
+      size_t indexOff=w->tell();
+      w->write(index->getFinalBuf(),index->size());
+      index->finish();
+      delete index;
+      w->seek(extOff+28,SEEK_SET);
+      w->writeI(indexOff);
+      w->seek(0,SEEK_END);
+    }
   } else {
-    if (!playing) {
+    if (!endPlaying) {
       w->writeText(">> END\n");
     } else {
       w->writeText(">> LOOP 0\n");
     }
   }
 
-  remainingLoops=-1;
-  playing=false;
-  freelance=false;
-  extValuePresent=false;
-  BUSY_END;
+  if (pass==NULL) {
+    remainingLoops=-1;
+    playing=false;
+    freelance=false;
+    extValuePresent=false;
+    BUSY_END;
+  }
 
   return w;
 }
@@ -797,31 +1320,146 @@ bool DivEngine::isExporting() {
   return exporting;
 }
 
+const char* DivEngine::getExportFormatExt(DivAudioExportFormats format) {
+  switch (format) {
+    case DIV_EXPORT_FORMAT_WAV:
+    case DIV_EXPORT_FORMAT_WAV_24:
+    case DIV_EXPORT_FORMAT_WAV_FLOAT:
+      return ".wav";
+    case DIV_EXPORT_FORMAT_FLAC:
+      return ".flac";
+    case DIV_EXPORT_FORMAT_OGG:
+      return ".ogg";
+    case DIV_EXPORT_FORMAT_RAW_S16:
+    case DIV_EXPORT_FORMAT_RAW_S24:
+    case DIV_EXPORT_FORMAT_RAW_F32:
+      return ".raw";
+  }
+  return ".wav";
+}
+
+void DivEngine::setExportChunkCallback(DivExportChunkCallback what) {
+  exportChunkCallback=what;
+}
+
 #ifdef HAVE_SNDFILE
+// returns 0 for raw formats (which do not go through libsndfile)
+static int exportSndfileFormat(DivAudioExportFormats format) {
+  switch (format) {
+    case DIV_EXPORT_FORMAT_WAV:
+      return SF_FORMAT_WAV|SF_FORMAT_PCM_16;
+    case DIV_EXPORT_FORMAT_WAV_24:
+      return SF_FORMAT_WAV|SF_FORMAT_PCM_24;
+    case DIV_EXPORT_FORMAT_WAV_FLOAT:
+      return SF_FORMAT_WAV|SF_FORMAT_FLOAT;
+    case DIV_EXPORT_FORMAT_FLAC:
+      return SF_FORMAT_FLAC|SF_FORMAT_PCM_16;
+    case DIV_EXPORT_FORMAT_OGG:
+      return SF_FORMAT_OGG|SF_FORMAT_VORBIS;
+    default:
+      break;
+  }
+  return 0;
+}
+
+// bytes per sample of a raw format, or 0 if not raw
+static int exportRawSampleSize(DivAudioExportFormats format) {
+  switch (format) {
+    case DIV_EXPORT_FORMAT_RAW_S16:
+      return 2;
+    case DIV_EXPORT_FORMAT_RAW_S24:
+      return 3;
+    case DIV_EXPORT_FORMAT_RAW_F32:
+      return 4;
+    default:
+      break;
+  }
+  return 0;
+}
+
+// convert clamped float samples to little-endian raw samples. returns the length in bytes.
+static size_t exportRawConvert(unsigned char* out, const float* in, size_t len, DivAudioExportFormats format) {
+  unsigned char* o=out;
+  switch (format) {
+    case DIV_EXPORT_FORMAT_RAW_S16:
+      for (size_t i=0; i<len; i++) {
+        int val=(int)lrintf(in[i]*32767.0f);
+        *o++=val&0xff;
+        *o++=(val>>8)&0xff;
+      }
+      break;
+    case DIV_EXPORT_FORMAT_RAW_S24:
+      for (size_t i=0; i<len; i++) {
+        int val=(int)lrintf(in[i]*8388607.0f);
+        *o++=val&0xff;
+        *o++=(val>>8)&0xff;
+        *o++=(val>>16)&0xff;
+      }
+      break;
+    case DIV_EXPORT_FORMAT_RAW_F32:
+      for (size_t i=0; i<len; i++) {
+        unsigned int val;
+        memcpy(&val,&in[i],4);
+        *o++=val&0xff;
+        *o++=(val>>8)&0xff;
+        *o++=(val>>16)&0xff;
+        *o++=(val>>24)&0xff;
+      }
+      break;
+    default:
+      break;
+  }
+  return o-out;
+}
+
 void DivEngine::runExportThread() {
   size_t fadeOutSamples=got.rate*exportFadeOut;
   size_t curFadeOutSample=0;
   bool isFadingOut=false;
   switch (exportMode) {
     case DIV_EXPORT_MODE_ONE: {
-      SNDFILE* sf;
+      SNDFILE* sf=NULL;
       SF_INFO si;
       SFWrapper sfWrap;
-      si.samplerate=got.rate;
-      si.channels=2;
-      si.format=SF_FORMAT_WAV|SF_FORMAT_PCM_16;
-
-      sf=sfWrap.doOpen(exportPath.c_str(),SFM_WRITE,&si);
-      if (sf==NULL) {
-        logE("could not open file for writing! (%s)",sf_strerror(NULL));
-        exporting=false;
-        return;
+      FILE* rawOut=NULL;
+      unsigned char* rawBuf=NULL;
+      int rawSampleSize=exportRawSampleSize(exportFormat);
+      bool complete=true;
+
+      if (rawSampleSize>0) {
+        if (exportPath=="-") {
+#ifdef _WIN32
+          _setmode(_fileno(stdout),_O_BINARY);
+#endif
+          rawOut=stdout;
+        } else if (!exportPath.empty()) {
+          rawOut=ps_fopen(exportPath.c_str(),"wb");
+          if (rawOut==NULL) {
+            logE("could not open file for writing! (%s)",strerror(errno));
+            exporting=false;
+            return;
+          }
+        }
+      } else if (!exportPath.empty()) {
+        si.samplerate=got.rate;
+        si.channels=2;
+        si.format=exportSndfileFormat(exportFormat);
+
+        sf=sfWrap.doOpen(exportPath.c_str(),SFM_WRITE,&si);
+        if (sf==NULL) {
+          logE("could not open file for writing! (%s)",sf_strerror(NULL));
+          exporting=false;
+          return;
+        }
       }
 
       float* outBuf[3];
       outBuf[0]=new float[EXPORT_BUFSIZE];
       outBuf[1]=new float[EXPORT_BUFSIZE];
       outBuf[2]=new float[EXPORT_BUFSIZE*2];
+      if (rawOut!=NULL) {
+        rawBuf=new unsigned char[EXPORT_BUFSIZE*2*rawSampleSize];
+      }
 
       // take control of audio output
       deinitAudioBackend();
@@ -856,19 +1494,55 @@ void DivEngine::runExportThread() {
           }
         }
         
-        if (sf_writef_float(sf,outBuf[2],total)!=(int)total) {
-          logE("error: failed to write entire buffer!");
-          break;
+        if (sf!=NULL) {
+          if (sf_writef_float(sf,outBuf[2],total)!=(int)total) {
+            logE("error: failed to write entire buffer!");
+            complete=false;
+            break;
+          }
+        }
+        if (rawOut!=NULL) {
+          size_t rawLen=exportRawConvert(rawBuf,outBuf[2],total*2,exportFormat);
+          if (fwrite(rawBuf,1,rawLen,rawOut)!=rawLen) {
+            logE("error: failed to write entire buffer! (%s)",strerror(errno));
+            complete=false;
+            break;
+          }
+        }
+        if (exportChunkCallback!=NULL) {
+          if (!exportChunkCallback(outBuf[2],total)) {
+            logI("export stopped by callback.");
+            playing=false;
+            break;
+          }
         }
       }
 
       delete[] outBuf[0];
       delete[] outBuf[1];
       delete[] outBuf[2];
+      if (rawBuf!=NULL) {
+        delete[] rawBuf;
+      }
 
-      if (sfWrap.doClose()!=0) {
-        logE("could not close audio file!");
+      if (sf!=NULL) {
+        if (sfWrap.doClose()!=0) {
+          logE("could not close audio file!");
+          complete=false;
+        }
+      }
+      if (rawOut==stdout) {
+        fflush(rawOut);
+      } else if (rawOut!=NULL) {
+        if (fclose(rawOut)!=0) {
+          logE("could not close audio file!");
+          complete=false;
+        }
+      }
+      if (complete && !stopExport) {
+        renderCachePutFile(exportCacheKey,exportPath);
       }
+      exportCacheKey="";
       exporting=false;
 
       if (initAudioBackend()) {
@@ -896,11 +1570,11 @@ void DivEngine::runExportThread() {
         } else {
           si[i].channels=1;
         }
-        si[i].format=SF_FORMAT_WAV|SF_FORMAT_PCM_16;
+        si[i].format=exportSndfileFormat(exportFormat);
       }
 
       for (int i=0; i<song.systemLen; i++) {
-        fname[i]=fmt::sprintf("%s_s%02d.wav",exportPath,i+1);
+        fname[i]=fmt::sprintf("%s_s%02d%s",exportPath,i+1,getExportFormatExt(exportFormat));
         logI("- %s",fname[i].c_str());
         sf[i]=sfWrap[i].doOpen(fname[i].c_str(),SFM_WRITE,&si[i]);
         if (sf[i]==NULL) {
@@ -1011,11 +1685,11 @@ void DivEngine::runExportThread() {
         SNDFILE* sf;
         SF_INFO si;
         SFWrapper sfWrap;
-        String fname=fmt::sprintf("%s_c%02d.wav",exportPath,i+1);
+        String fname=fmt::sprintf("%s_c%02d%s",exportPath,i+1,getExportFormatExt(exportFormat));
         logI("- %s",fname.c_str());
         si.samplerate=got.rate;
         si.channels=2;
-        si.format=SF_FORMAT_WAV|SF_FORMAT_PCM_16;
+        si.format=exportSndfileFormat(exportFormat);
 
         sf=sfWrap.doOpen(fname.c_str(),SFM_WRITE,&si);
         if (sf==NULL) {
@@ -1133,13 +1807,56 @@ void DivEngine::runExportThread() {
 }
 #endif
 
-bool DivEngine::saveAudio(const char* path, int loops, DivAudioExportModes mode, double fadeOutTime) {
+bool DivEngine::saveAudio(const char* path, int loops, DivAudioExportModes mode, double fadeOutTime, DivAudioExportFormats format) {
 #ifndef HAVE_SNDFILE
   logE("Furnace was not compiled with libsndfile. cannot export!");
   return false;
 #else
+  bool isRaw=(exportRawSampleSize(format)>0);
+  if (mode!=DIV_EXPORT_MODE_ONE) {
+    if (isRaw) {
+      logE("raw formats can only be exported to a single file!");
+      return false;
+    }
+    if (path[0]==0 || strcmp(path,"-")==0) {
+      logE("multiple file export requires a file name!");
+      return false;
+    }
+  }
+  if (strcmp(path,"-")==0 && !isRaw) {
+    logE("only raw formats can be streamed to standard output!");
+    return false;
+  }
+  if (path[0]==0 && exportChunkCallback==NULL) {
+    logE("no export target!");
+    return false;
+  }
+  if (!isRaw) {
+    SF_INFO si;
+    memset(&si,0,sizeof(SF_INFO));
+    si.samplerate=got.rate;
+    si.channels=2;
+    si.format=exportSndfileFormat(format);
+    if (!sf_format_check(&si)) {
+      logE("this build of libsndfile does not support the selected format!");
+      return false;
+    }
+  }
+  // the previous export thread may not have been collected.
+  // it still reads exportCacheKey and exportPath until it finishes.
+  waitAudioFile();
+  // only complete single files are cached
+  exportCacheKey="";
+  if (mode==DIV_EXPORT_MODE_ONE && path[0]!=0 && strcmp(path,"-")!=0 && exportChunkCallback==NULL) {
+    exportCacheKey=renderCacheKey("audio",fmt::sprintf("%d %d %d %g %g",loops,(int)mode,(int)format,fadeOutTime,got.rate));
+    if (renderCacheGetFile(exportCacheKey,path)) {
+      exportCacheKey="";
+      return true;
+    }
+  }
   exportPath=path;
   exportMode=mode;
+  exportFormat=format;
   exportFadeOut=fadeOutTime;
   if (exportMode!=DIV_EXPORT_MODE_ONE) {
     // remove extension
@@ -1147,7 +1864,7 @@ bool DivEngine::saveAudio(const char* path, int loops, DivAudioExportModes mode,
     for (char& i: lowerCase) {
       if (i>='A' && i<='Z') i+='a'-'A';
     }
-    size_t extPos=lowerCase.rfind(".wav");
+    size_t extPos=lowerCase.rfind(getExportFormatExt(exportFormat));
     if (extPos!=String::npos) {
       exportPath=exportPath.substr(0,extPos);
     }
@@ -1171,6 +1888,8 @@ bool DivEngine::saveAudio(const char* path, int loops, DivAudioExportModes mode,
 void DivEngine::waitAudioFile() {
   if (exportThread!=NULL) {
     exportThread->join();
+    delete exportThread;
+    exportThread=NULL;
   }
 }
 
@@ -1286,6 +2005,35 @@ int DivEngine::loadSampleROMs() {
   return error;
 }
 
+void DivEngine::runParallel(size_t count, const std::function<void(size_t)>& job) {
+  size_t threads=std::thread::hardware_concurrency();
+  if (threads>DIV_MAX_WORKERS) threads=DIV_MAX_WORKERS;
+  if (threads>count) threads=count;
+  if (threads<2) {
+    for (size_t i=0; i<count; i++) job(i);
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  auto worker=[&next,&job,count]() {
+    while (true) {
+      size_t i=next++;
+      if (i>=count) break;
+      job(i);
+    }
+  };
+  std::vector<std::thread*> pool;
+  for (size_t i=1; i<threads; i++) {
+    pool.push_back(new std::thread(worker));
+  }
+  // this thread works too
+  worker();
+  for (std::thread* i: pool) {
+    i->join();
+    delete i;
+  }
+}
+
 void DivEngine::renderSamplesP() {
   BUSY_BEGIN;
   renderSamples();
@@ -1308,9 +2056,9 @@ void DivEngine::renderSamples() {
   }
 
   // step 1: render samples
-  for (int i=0; i<song.sampleLen; i++) {
+  runParallel(song.sampleLen,[this,formatMask](size_t i) {
     song.sample[i]->render(formatMask);
-  }
+  });
 
   // step 2: render samples to dispatch
   for (int i=0; i<song.systemLen; i++) {
@@ -1981,6 +2729,102 @@ DivDispatchOscBuffer* DivEngine::getOscBuffer(int chan) {
   return disCont[dispatchOfChan[chan]].dispatch->getOscBuffer(dispatchChanOfChan[chan]);
 }
 
+bool DivEngine::getOscTap(DivOscTap& tap) {
+  for (int i=0; i<DIV_OSC_TAP_RETRIES; i++) {
+    unsigned int seq=oscTapSeq.load(std::memory_order_acquire);
+    if (!(seq&1)) {
+      tap=oscTap;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (oscTapSeq.load(std::memory_order_relaxed)==seq) {
+        tap.seq=seq;
+        return tap.block>0;
+      }
+    }
+    std::this_thread::yield();
+  }
+  return false;
+}
+
+void DivEngine::getOscPeak(unsigned int& since, float* peak, float* rms) {
+  for (int i=0; i<DIV_OSC_TAP_RETRIES; i++) {
+    unsigned int seq=oscTapSeq.load(std::memory_order_acquire);
+    if (!(seq&1)) {
+      unsigned int block=oscTap.block;
+      peak[0]=0.0f;
+      peak[1]=0.0f;
+      rms[0]=0.0f;
+      rms[1]=0.0f;
+      // don't look further back than the ring
+      unsigned int first=since;
+      if (block-first>DIV_OSC_TAP_BLOCKS) first=block-DIV_OSC_TAP_BLOCKS;
+      for (unsigned int j=first; j!=block; j++) {
+        unsigned int pos=(j+1)%DIV_OSC_TAP_BLOCKS;
+        for (int k=0; k<2; k++) {
+          if (oscTapPeak[pos][k]>peak[k]) peak[k]=oscTapPeak[pos][k];
+          if (oscTapRMS[pos][k]>rms[k]) rms[k]=oscTapRMS[pos][k];
+        }
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (oscTapSeq.load(std::memory_order_relaxed)==seq) {
+        since=block;
+        return;
+      }
+    }
+    std::this_thread::yield();
+  }
+  // try again next time
+  peak[0]=0.0f;
+  peak[1]=0.0f;
+  rms[0]=0.0f;
+  rms[1]=0.0f;
+}
+
+bool DivEngine::readOscWindow(DivOscTap& tap, int len, float* outL, float* outR) {
+  if (oscBuf[0]==NULL || oscBuf[1]==NULL) return false;
+  if (len<0) len=0;
+  if (len>32768) len=32768;
+  // the audio thread writes the ring while the sequence is odd
+  for (int i=0; i<DIV_OSC_TAP_RETRIES; i++) {
+    unsigned int seq=oscTapSeq.load(std::memory_order_acquire);
+    if (!(seq&1)) {
+      tap=oscTap;
+      int pos=(tap.writePos-len)&0x7fff;
+      for (int j=0; j<len; j++) {
+        outL[j]=oscBuf[0][pos];
+        outR[j]=oscBuf[1][pos];
+        pos=(pos+1)&0x7fff;
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (oscTapSeq.load(std::memory_order_relaxed)==seq) {
+        tap.seq=seq;
+        return tap.block>0;
+      }
+    }
+    std::this_thread::yield();
+  }
+  return false;
+}
+
+bool DivEngine::readChanOscWindow(const DivOscTap& tap, int chan, int len, short* out) {
+  DivDispatchOscBuffer* buf=getOscBuffer(chan);
+  if (buf==NULL) return false;
+  if (len<0) len=0;
+  if (len>65535) len=65535;
+  unsigned short needle=tap.chanNeedle[chan];
+  unsigned short pos=needle-len;
+  for (int i=0; i<len; i++) {
+    out[pos]=buf->data[pos];
+    pos++;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  // channels are written while rendering, outside of the sequence.
+  // the copy is intact if the channel didn't get past its start since the snapshot,
+  // which can only be told if at most one more buffer was published.
+  if (oscTapSeq.load(std::memory_order_relaxed)-tap.seq>2) return false;
+  unsigned short advance=buf->needle-needle;
+  return (int)advance+len<65536;
+}
+
 void DivEngine::enableCommandStream(bool enable) {
   cmdStreamEnabled=enable;
 }
@@ -1998,6 +2842,10 @@ void DivEngine::getCommandStream(std::vector<DivCommand>& where) {
 void DivEngine::playSub(bool preserveDrift, int goalRow) {
   logV("playSub() called");
   std::chrono::high_resolution_clock::time_point timeStart=std::chrono::high_resolution_clock::now();
+  if (cmdStreamInt!=NULL) {
+    delete cmdStreamInt;
+    cmdStreamInt=NULL;
+  }
   for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->setSkipRegisterWrites(false);
   reset();
   if (preserveDrift && curOrder==0) {
@@ -2257,6 +3105,10 @@ void DivEngine::stepOne(int row) {
 
 void DivEngine::stop() {
   BUSY_BEGIN;
+  if (cmdStreamInt!=NULL) {
+    delete cmdStreamInt;
+    cmdStreamInt=NULL;
+  }
   freelance=false;
   playing=false;
   extValuePresent=false;
@@ -2283,6 +3135,81 @@ void DivEngine::stop() {
   BUSY_END;
 }
 
+bool DivEngine::playStream(unsigned char* f, size_t length) {
+  DivCSPlayer* player=new DivCSPlayer(this,f,length);
+  BUSY_BEGIN;
+  if (!player->init()) {
+    delete player;
+    lastError="invalid command stream or channel count mismatch";
+    BUSY_END;
+    return false;
+  }
+  if (cmdStreamInt!=NULL) delete cmdStreamInt;
+  reset();
+  cmdStreamInt=player;
+  sPreview.sample=-1;
+  sPreview.wave=-1;
+  sPreview.pos=0;
+  sPreview.dir=false;
+  freelance=false;
+  shallStop=false;
+  shallStopSched=false;
+  endOfSong=false;
+  stepPlay=0;
+  ticks=1;
+  subticks=1;
+  tempoAccum=0;
+  clockDrift=0;
+  cycles=0;
+  totalTicks=0;
+  totalSeconds=0;
+  totalTicksR=0;
+  divider=player->getDivider();
+  playing=true;
+  BUSY_END;
+  return true;
+}
+
+bool DivEngine::seekStream(int order, int row) {
+  BUSY_BEGIN;
+  if (cmdStreamInt==NULL) {
+    lastError="not playing a command stream";
+    BUSY_END;
+    return false;
+  }
+  int tick=cmdStreamInt->getRowTick(order,row);
+  if (tick<0) {
+    lastError=cmdStreamInt->hasIndex()?"position not reached by the command stream":"command stream has no seek index";
+    BUSY_END;
+    return false;
+  }
+  reset();
+  for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->setSkipRegisterWrites(true);
+  bool ret=cmdStreamInt->seek(tick,false);
+  for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->setSkipRegisterWrites(false);
+  // like playSub(), which does not force instruments at the very start
+  if (tick>0) {
+    for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->forceIns();
+  }
+  divider=cmdStreamInt->getDivider();
+  BUSY_END;
+  return ret;
+}
+
+void DivEngine::killStream() {
+  BUSY_BEGIN;
+  if (cmdStreamInt!=NULL) {
+    delete cmdStreamInt;
+    cmdStreamInt=NULL;
+    playing=false;
+  }
+  BUSY_END;
+}
+
+DivCSPlayer* DivEngine::getStreamPlayer() {
+  return cmdStreamInt;
+}
+
 void DivEngine::halt() {
   BUSY_BEGIN;
   halted=true;
@@ -3939,6 +4866,56 @@ bool DivEngine::switchMaster(bool full) {
   return true;
 }
 
+void DivEngine::setQualityTier(DivQualityTier tier) {
+  if (tier==qualityTier) return;
+  if (exporting) {
+    logW("can't change quality tier while exporting!");
+    return;
+  }
+  logI("switching quality tier to %d...",(int)tier);
+  BUSY_BEGIN;
+  bool wasPlaying=playing && !freelance;
+  int lastOrder=prevOrder;
+  int lastRow=prevRow;
+  qualityTier=tier;
+  lowQuality=getConfInt("audioQuality",0) || tier==DIV_QUALITY_DRAFT;
+
+  // re-create the chips with the cores of the new tier.
+  // the song and the command stream player (if any) are kept.
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].quit();
+    disCont[i].init(song.system[i],this,getChannelCount(song.system[i]),got.rate,song.systemFlags[i]);
+    disCont[i].setRates(got.rate);
+    disCont[i].setQuality(lowQuality);
+  }
+  recalcChans();
+  renderSamples();
+  for (int i=0; i<chans; i++) {
+    disCont[dispatchOfChan[i]].dispatch->muteChannel(dispatchChanOfChan[i],isMuted[i]);
+  }
+
+  // bring the new chips to where the old ones were
+  if (cmdStreamInt!=NULL) {
+    int tick=cmdStreamInt->getTick();
+    reset();
+    for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->setSkipRegisterWrites(true);
+    cmdStreamInt->seek(tick,false);
+    for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->setSkipRegisterWrites(false);
+    for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->forceIns();
+    divider=cmdStreamInt->getDivider();
+  } else if (wasPlaying) {
+    curOrder=lastOrder;
+    playSub(false,lastRow);
+  } else {
+    reset();
+  }
+  BUSY_END;
+}
+
+DivQualityTier DivEngine::getQualityTier() {
+  return qualityTier;
+}
+
 void DivEngine::setMidiBaseChan(int chan) {
   if (chan<0 || chan>=chans) chan=0;
   midiBaseChan=chan;
@@ -4034,6 +5011,10 @@ void DivEngine::initDispatch() {
 
 void DivEngine::quitDispatch() {
   BUSY_BEGIN;
+  if (cmdStreamInt!=NULL) {
+    delete cmdStreamInt;
+    cmdStreamInt=NULL;
+  }
   for (int i=0; i<song.systemLen; i++) {
     disCont[i].quit();
   }
@@ -4075,7 +5056,7 @@ bool DivEngine::initAudioBackend() {
     }
   }
 
-  lowQuality=getConfInt("audioQuality",0);
+  lowQuality=getConfInt("audioQuality",0) || qualityTier==DIV_QUALITY_DRAFT;
   forceMono=getConfInt("forceMono",0);
   clampSamples=getConfInt("clampSamples",0);
   lowLatency=getConfInt("lowLatency",0);
@@ -4202,7 +5183,7 @@ bool DivEngine::deinitAudioBackend(bool dueToSwitchMaster) {
 
 bool DivEngine::init() {
   // register systems
-  if (!systemsRegistered) registerSystems();
+  registerSystems();
 
   // init config
   initConfDir();
@@ -4210,6 +5191,13 @@ bool DivEngine::init() {
 
   loadConf();
 
+  if (getConfBool("renderCache",false)) renderCacheEnabled=true;
+  renderCacheMaxSize=(size_t)MAX(1,getConfInt("renderCacheSize",256))<<20;
+
+  int tier=getConfInt("qualityTier",DIV_QUALITY_NORMAL);
+  if (tier<DIV_QUALITY_DRAFT || tier>DIV_QUALITY_ACCURATE) tier=DIV_QUALITY_NORMAL;
+  qualityTier=(DivQualityTier)tier;
+
   loadSampleROMs();
 
   // set default system preset
@@ -25,6 +25,7 @@
 #include "dispatch.h"
 #include "dataErrors.h"
 #include "safeWriter.h"
+#include "cmdStream.h"
 #include "../audio/taAudio.h"
 #include "blip_buf.h"
 #include <atomic>
@@ -70,12 +71,54 @@ enum DivAudioEngines {
   DIV_AUDIO_DUMMY=127
 };
 
+enum DivQualityTier {
+  DIV_QUALITY_DRAFT=0,
+  DIV_QUALITY_NORMAL,
+  DIV_QUALITY_ACCURATE
+};
+
 enum DivAudioExportModes {
   DIV_EXPORT_MODE_ONE=0,
   DIV_EXPORT_MODE_MANY_SYS,
   DIV_EXPORT_MODE_MANY_CHAN
 };
 
+enum DivAudioExportFormats {
+  // written through libsndfile
+  DIV_EXPORT_FORMAT_WAV=0,
+  DIV_EXPORT_FORMAT_WAV_24,
+  DIV_EXPORT_FORMAT_WAV_FLOAT,
+  DIV_EXPORT_FORMAT_FLAC,
+  DIV_EXPORT_FORMAT_OGG,
+  // headerless interleaved little-endian samples (single file mode only)
+  DIV_EXPORT_FORMAT_RAW_S16,
+  DIV_EXPORT_FORMAT_RAW_S24,
+  DIV_EXPORT_FORMAT_RAW_F32
+};
+
+// receives interleaved stereo float samples during audio export.
+// return false to stop exporting.
+typedef std::function<bool(const float* buf, size_t frames)> DivExportChunkCallback;
+
+enum DivInsFormats {
+  DIV_INSFORMAT_DMP,
+  DIV_INSFORMAT_TFI,
+  DIV_INSFORMAT_VGI,
+  DIV_INSFORMAT_FTI,
+  DIV_INSFORMAT_BTI,
+  DIV_INSFORMAT_S3I,
+  DIV_INSFORMAT_SBI,
+  DIV_INSFORMAT_Y12,
+  DIV_INSFORMAT_OPLI,
+  DIV_INSFORMAT_OPNI,
+  DIV_INSFORMAT_BNK,
+  DIV_INSFORMAT_GYB,
+  DIV_INSFORMAT_OPM,
+  DIV_INSFORMAT_WOPL,
+  DIV_INSFORMAT_WOPN,
+  DIV_INSFORMAT_FF,
+};
+
 enum DivHaltPositions {
   DIV_HALT_NONE=0,
   DIV_HALT_TICK,
@@ -175,13 +218,15 @@ struct DivDispatchContainer {
   int temp[2], prevSample[2];
   short* bbIn[2];
   short* bbOut[2];
-  bool lowQuality, dcOffCompensation;
+  bool lowQuality, dcOffCompensation, edgeOutput;
+  std::vector<DivDispatchEdge> edges;
 
   void setRates(double gotRate);
   void setQuality(bool lowQual);
   void acquire(size_t offset, size_t count);
   void flush(size_t count);
   void fillBuf(size_t runtotal, size_t offset, size_t size);
+  void fillBufEdges(size_t runtotal, size_t offset, size_t size);
   void clear();
   void init(DivSystem sys, DivEngine* eng, int chanCount, double gotRate, const DivConfig& flags);
   void quit();
@@ -198,11 +243,172 @@ struct DivDispatchContainer {
     bbIn{NULL,NULL},
     bbOut{NULL,NULL},
     lowQuality(false),
-    dcOffCompensation(false) {}
+    dcOffCompensation(false),
+    edgeOutput(false) {}
+};
+
+#define DIV_OSC_TAP_BLOCKS 256
+// readers give up after this many attempts at a consistent snapshot
+#define DIV_OSC_TAP_RETRIES 16
+
+// maximum number of threads used by runParallel()
+#define DIV_MAX_WORKERS 16
+
+// a snapshot of the master oscilloscope ring, published by the audio thread
+// after every buffer. use DivEngine::getOscTap() to read it.
+struct DivOscTap {
+  // sequence number the snapshot was taken at
+  unsigned int seq;
+  // number of buffers published so far
+  unsigned int block;
+  // position in oscBuf where the next sample will be written
+  int writePos;
+  unsigned int size;
+  // total samples written to oscBuf
+  size_t written;
+  // peak/RMS of the last buffer
+  float peak[2];
+  float rms[2];
+  // per-channel oscilloscope needle at the end of the last buffer
+  unsigned short chanNeedle[DIV_MAX_CHANS];
+
+  DivOscTap():
+    seq(0),
+    block(0),
+    writePos(0),
+    size(0),
+    written(0),
+    peak{0.0f,0.0f},
+    rms{0.0f,0.0f} {
+    memset(chanNeedle,0,DIV_MAX_CHANS*sizeof(unsigned short));
+  }
+};
+
+// a tick of playback as seen by the exporters.
+struct DivExportTick {
+  // position before the tick (used to find the loop point)
+  int order, row, ticks;
+  // position after the tick
+  int prevOrder, prevRow;
+  // whether this was the last tick (nextTick() returned true or playback stopped)
+  bool songEnd;
+  bool playing;
+  // length of the tick in samples (shifted by MASTER_CLOCK_PREC)
+  int cycles;
+  double divider;
+  // ranges in DivExportPass::writes and DivExportPass::cmds
+  unsigned int writeStart, writeEnd;
+  unsigned int cmdStart, cmdEnd;
+  DivExportTick():
+    order(0),
+    row(0),
+    ticks(0),
+    prevOrder(0),
+    prevRow(0),
+    songEnd(false),
+    playing(false),
+    cycles(0),
+    divider(60.0),
+    writeStart(0),
+    writeEnd(0),
+    cmdStart(0),
+    cmdEnd(0) {}
+};
+
+// the song played once for several exporters. see DivEngine::recordExportPass().
+// exporters given a pass read from it instead of running playback, so they do
+// not lock the engine and may run at the same time.
+struct DivExportPass {
+  std::vector<DivExportTick> ticks;
+  std::vector<DivRegWrite> writes;
+  std::vector<int> writeChip;
+  std::vector<DivCommand> cmds;
+  // writes before this index were made while resetting the chips
+  unsigned int resetWrites;
+  int loopOrder, loopRow, loopEnd;
+  // sample rate the pass was recorded at
+  int rate;
+  DivExportPass():
+    resetWrites(0),
+    loopOrder(0),
+    loopRow(0),
+    loopEnd(0),
+    rate(44100) {}
+};
+
+// targets of DivEngine::saveMulti().
+struct DivMultiExport {
+  bool vgm, zsm, cmd;
+  // VGM options
+  bool* vgmSysToExport;
+  bool vgmLoop;
+  int vgmVersion;
+  bool vgmPatternHints;
+  bool vgmOptimize;
+  // ZSM options
+  unsigned int zsmRate;
+  bool zsmLoop;
+  // command stream options
+  bool cmdBinary;
+  bool cmdCompress;
+  // results. NULL if not requested or failed.
+  SafeWriter* vgmOut;
+  SafeWriter* zsmOut;
+  SafeWriter* cmdOut;
+  DivMultiExport():
+    vgm(false),
+    zsm(false),
+    cmd(false),
+    vgmSysToExport(NULL),
+    vgmLoop(true),
+    vgmVersion(0x171),
+    vgmPatternHints(false),
+    vgmOptimize(false),
+    zsmRate(60),
+    zsmLoop(true),
+    cmdBinary(false),
+    cmdCompress(false),
+    vgmOut(NULL),
+    zsmOut(NULL),
+    cmdOut(NULL) {}
 };
 
 typedef int EffectValConversion(unsigned char,unsigned char);
 
+// an instrument in an indexed bank.
+struct DivInsBankEntry {
+  String name;
+  DivInstrumentType type;
+  // position of the patch data in the bank
+  size_t offset;
+  // format-specific (GYB: patch has PAN/PMS/AMS; WOPL: half of a pseudo 4-op patch)
+  int param;
+  DivInsBankEntry():
+    type(DIV_INS_FM),
+    offset(0),
+    param(0) {}
+};
+
+// an instrument bank of which only the directory has been read.
+// instruments are decoded on demand using DivEngine::instrumentFromBank().
+struct DivInsBank {
+  String stripPath;
+  DivInsFormats format;
+  int version;
+  // file contents (owned)
+  unsigned char* data;
+  size_t len;
+  std::vector<DivInsBankEntry> entries;
+  DivInsBank():
+    format(DIV_INSFORMAT_BNK),
+    version(0),
+    data(NULL),
+    len(0) {}
+  ~DivInsBank() {
+    if (data!=NULL) delete[] data;
+  }
+};
+
 struct EffectHandler {
   DivDispatchCmds dispatchCmd;
   const char* description;
@@ -317,12 +523,34 @@ enum DivChanTypes {
 
 extern const char* cmdName[];
 
+// several engines may live in one process and run on different threads
+// (e.g. the render server's instances). the rules are:
+// - system definitions (sysDefs and the file maps) and the filter tables are
+//   built once per process, the first time an engine needs them, and are
+//   read-only afterwards.
+// - everything else (song, dispatches, configuration, buffers and playback
+//   state) belongs to one engine. each engine may only be used by one thread
+//   at a time, as before.
+// - engines may be created, loaded, initialized and rendered concurrently.
+//   quit() writes the configuration file, so engines should be quit one at a
+//   time.
+// - logging may be called from any thread.
+// - the nsfplay NES core seeds its noise and triangle from rand() on reset,
+//   so its output depends on what other engines did before. the default NES
+//   core doesn't.
+// testEngines() checks that concurrent engines render the same as one.
 class DivEngine {
+  friend class DivCSPlayer;
   DivDispatchContainer disCont[DIV_MAX_CHIPS];
   TAAudio* output;
   TAAudioDesc want, got;
   String exportPath;
   std::thread* exportThread;
+  // targets of saveMultiAsync()
+  DivMultiExport* multiExport;
+  // command stream player (NULL if the song is being played)
+  DivCSPlayer* cmdStreamInt;
+  DivQualityTier qualityTier;
   int chans;
   bool active;
   bool lowQuality;
@@ -346,7 +574,6 @@ class DivEngine {
   bool skipping;
   bool midiIsDirect;
   bool lowLatency;
-  bool systemsRegistered;
   bool hasLoadedSomething;
   bool midiOutClock;
   int midiOutMode;
@@ -366,7 +593,13 @@ class DivEngine {
   DivChannelState chan[DIV_MAX_CHANS];
   DivAudioEngines audioEngine;
   DivAudioExportModes exportMode;
+  DivAudioExportFormats exportFormat;
+  DivExportChunkCallback exportChunkCallback;
   double exportFadeOut;
+  // render cache key of the audio export in progress
+  String exportCacheKey;
+  bool renderCacheEnabled;
+  size_t renderCacheMaxSize;
   DivConfig conf;
   std::deque<DivNoteEvent> pendingNotes;
   // bitfield
@@ -424,6 +657,12 @@ class DivEngine {
 
   size_t totalProcessed;
 
+  // oscilloscope tap (seqlock: odd while the audio thread is writing)
+  std::atomic<unsigned int> oscTapSeq;
+  DivOscTap oscTap;
+  float oscTapPeak[DIV_OSC_TAP_BLOCKS][2];
+  float oscTapRMS[DIV_OSC_TAP_BLOCKS][2];
+
   // MIDI stuff
   std::function<int(const TAMidiMessage&)> midiCallback=[](const TAMidiMessage&) -> int {return -2;};
 
@@ -431,14 +670,20 @@ class DivEngine {
   void processRow(int i, bool afterDelay);
   void nextOrder();
   void nextRow();
-  void performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write, int streamOff, double* loopTimer, double* loopFreq, int* loopSample, bool* sampleDir, bool isSecond, bool directStream);
+  void publishOscTap(float** out, unsigned int size);
+  void performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write, int streamOff, double* loopTimer, double* loopFreq, int* loopSample, bool* sampleDir, bool isSecond, bool directStream, const int* sampleBlock);
   // returns true if end of song.
   bool nextTick(bool noAccum=false, bool inhibitLowLat=false);
+  // run a tick for an exporter and record the position before and after it.
+  void runExportTick(DivExportTick& t, bool inhibitLowLat=true);
   bool perSystemEffect(int ch, unsigned char effect, unsigned char effectVal);
   bool perSystemPostEffect(int ch, unsigned char effect, unsigned char effectVal);
   void recalcChans();
   void reset();
   void playSub(bool preserveDrift, int goalRow=0);
+  // call job with every index below count, spread across worker threads.
+  // returns when all jobs are done. jobs must not throw.
+  static void runParallel(size_t count, const std::function<void(size_t)>& job);
 
   bool loadDMF(unsigned char* file, size_t len);
   bool loadFur(unsigned char* file, size_t len);
@@ -454,19 +699,34 @@ class DivEngine {
   void loadOPLI(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
   void loadOPNI(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
   void loadY12(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
-  void loadBNK(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
-  void loadGYB(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
-  void loadOPM(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
   void loadFF(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
-  void loadWOPL(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
-  void loadWOPN(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath);
+
+  // banks are indexed first, then decoded
+  void indexBNK(SafeReader& reader, DivInsBank& bank);
+  void indexGYB(SafeReader& reader, DivInsBank& bank);
+  void indexOPM(SafeReader& reader, DivInsBank& bank);
+  void indexWOPL(SafeReader& reader, DivInsBank& bank);
+  void indexWOPN(SafeReader& reader, DivInsBank& bank);
+  bool indexInsBankData(SafeReader& reader, DivInsBank& bank);
+  void loadInsBank(SafeReader& reader, DivInsFormats format, std::vector<DivInstrument*>& ret, String& stripPath);
 
   int loadSampleROM(String path, ssize_t expectedSize, unsigned char*& ret);
 
+  // render cache. the key is empty if the cache is disabled.
+  String renderCacheKey(const char* kind, const String& params);
+  String vgmCacheKey(bool* sysToExport, bool loop, int version, bool patternHints, bool directStream, bool optimize);
+  SafeWriter* renderCacheGet(const String& key);
+  bool renderCacheGetFile(const String& key, const String& path);
+  void renderCachePut(const String& key, const unsigned char* data, size_t len);
+  void renderCachePutFile(const String& key, const String& path);
+  void renderCacheEvict();
+
   bool initAudioBackend();
   bool deinitAudioBackend(bool dueToSwitchMaster=false);
 
-  void registerSystems();
+  // system definitions are shared by all engines. they are registered once per process.
+  static void registerSystems();
+  static void registerSystemsOnce();
   void initSongWithDesc(const char* description, bool inBase64=true);
 
   void exchangeIns(int one, int two);
@@ -488,11 +748,13 @@ class DivEngine {
     bool keyHit[DIV_MAX_CHANS];
     float* oscBuf[2];
     float oscSize;
-    int oscReadPos, oscWritePos;
+    int oscWritePos;
     int tickMult;
     std::atomic<size_t> processTime;
 
     void runExportThread();
+    void runMultiExportThread();
+    bool doSaveMulti(DivMultiExport& ex, bool ownsAudio);
     void nextBuf(float** in, float** out, int inChans, int outChans, unsigned int size);
     DivInstrument* getIns(int index, DivInstrumentType fallbackType=DIV_INS_FM);
     DivWavetable* getWave(int index);
@@ -513,13 +775,38 @@ class DivEngine {
     // specify system to build ROM for.
     SafeWriter* buildROM(int sys);
     // dump to VGM.
-    SafeWriter* saveVGM(bool* sysToExport=NULL, bool loop=true, int version=0x171, bool patternHints=false, bool directStream=false);
+    // if optimize is true, redundant register writes are removed, waits are merged
+    // and identical samples share a data block.
+    // if pass is not NULL, the song is read from it (direct stream mode is not available then).
+    SafeWriter* saveVGM(bool* sysToExport=NULL, bool loop=true, int version=0x171, bool patternHints=false, bool directStream=false, bool optimize=false, const DivExportPass* pass=NULL);
+    // write a VGM file to f as .vgz (gzip).
+    bool writeVGZ(SafeWriter* w, FILE* f);
     // dump to ZSM.
-    SafeWriter* saveZSM(unsigned int zsmrate=60, bool loop=true);
+    SafeWriter* saveZSM(unsigned int zsmrate=60, bool loop=true, const DivExportPass* pass=NULL);
     // dump command stream.
-    SafeWriter* saveCommand(bool binary=false);
+    // binary streams carry a seek index. if compress is true, their channel
+    // streams are split into compressed blocks.
+    SafeWriter* saveCommand(bool binary=false, const DivExportPass* pass=NULL, bool compress=false);
+    // play the song once, recording register writes of all chips and the command stream.
+    // if ownsAudio is true, the caller has taken over audio output and the engine is
+    // only locked for each tick. the pass may then be aborted with haltAudioFile().
+    bool recordExportPass(DivExportPass& pass, bool ownsAudio=false);
+    // export to several formats from a single pass over the song.
+    // the engine is only locked while recording the pass; the files are then
+    // written in parallel.
+    bool saveMulti(DivMultiExport& ex);
+    // same as saveMulti(), but on the export thread, which takes over audio output.
+    // ex must stay valid until isExporting() returns false; the results are in ex then.
+    // getOrder() reports progress while the pass is recorded.
+    bool saveMultiAsync(DivMultiExport* ex);
     // export to an audio file
-    bool saveAudio(const char* path, int loops, DivAudioExportModes mode, double fadeOutTime=0.0);
+    // path may be "-" to stream a raw format to stdout, or empty to only feed the chunk callback.
+    bool saveAudio(const char* path, int loops, DivAudioExportModes mode, double fadeOutTime=0.0, DivAudioExportFormats format=DIV_EXPORT_FORMAT_WAV);
+    // set a callback which receives audio while exporting in single file mode (may be NULL).
+    // it runs on the export thread.
+    void setExportChunkCallback(DivExportChunkCallback what);
+    // get the file extension for an export format
+    static const char* getExportFormatExt(DivAudioExportFormats format);
     // wait for audio export to finish
     void waitAudioFile();
     // stop audio file export
@@ -542,6 +829,17 @@ class DivEngine {
     // benchmark (returns time in seconds)
     double benchmarkPlayback();
     double benchmarkSeek();
+    // per-chip acquire throughput (returns time spent in acquire)
+    double benchmarkChips();
+
+    // self-tests (return true on success)
+    // renders the song on one engine, then on several new engines at once
+    // (each on its own thread), and compares the output.
+    bool testEngines(int instances);
+    // exports a binary command stream (plain and compressed), plays it back
+    // from the start and after seeking to the middle of the song, and
+    // compares the register writes against the engine's own playback.
+    bool testCommandStream();
 
     // returns the minimum VGM version which may carry the specified system, or 0 if none.
     int minVGMVersion(DivSystem which);
@@ -602,6 +900,20 @@ class DivEngine {
     // stop
     void stop();
 
+    // play a binary command stream instead of the song.
+    // the song it was exported from must be loaded.
+    // the engine takes ownership of f.
+    bool playStream(unsigned char* f, size_t length);
+
+    // seek the command stream being played
+    bool seekStream(int order, int row);
+
+    // stop playing the command stream
+    void killStream();
+
+    // get the command stream player (NULL if not playing a stream)
+    DivCSPlayer* getStreamPlayer();
+
     // reset playback state
     void syncReset();
 
@@ -629,6 +941,12 @@ class DivEngine {
     // get config path
     String getConfigPath();
 
+    // enable or disable caching of finished exports. maxSize is in MB (-1 to keep).
+    void setRenderCache(bool enable, int maxSize=-1);
+    // delete all cached exports
+    void clearRenderCache();
+    String getRenderCachePath();
+
     // get sys channel count
     int getChannelCount(DivSystem sys);
 
@@ -768,6 +1086,14 @@ class DivEngine {
     // if the returned vector is empty then there was an error.
     std::vector<DivInstrument*> instrumentFromFile(const char* path, bool loadAssets=true);
 
+    // index an instrument bank (BNK, GYB, OPM, WOPL or WOPN) without decoding its instruments.
+    // returns NULL if the file is not a bank or could not be read.
+    // the caller owns the returned bank.
+    DivInsBank* indexInsBank(const char* path);
+
+    // decode an instrument from an indexed bank. returns NULL on error.
+    DivInstrument* instrumentFromBank(DivInsBank* bank, int index);
+
     // load temporary instrument
     void loadTempIns(DivInstrument* which);
 
@@ -866,6 +1192,24 @@ class DivEngine {
     // get osc buffer
     DivDispatchOscBuffer* getOscBuffer(int chan);
 
+    // get the last published oscilloscope snapshot.
+    // returns false if nothing has been published yet, or if no consistent
+    // snapshot could be taken after a few attempts.
+    bool getOscTap(DivOscTap& tap);
+
+    // get the highest peak and RMS of all buffers published after block `since`.
+    // `since` is updated to the last published block.
+    void getOscPeak(unsigned int& since, float* peak, float* rms);
+
+    // take a snapshot and copy the last `len` samples of the master ring along with it.
+    // returns false under the same conditions as getOscTap().
+    bool readOscWindow(DivOscTap& tap, int len, float* outL, float* outR);
+
+    // copy the last `len` samples of a channel's oscilloscope buffer as of the given
+    // snapshot. they are placed at the same positions in `out` (65536 entries).
+    // returns false if the channel wrote over part of them while copying.
+    bool readChanOscWindow(const DivOscTap& tap, int chan, int len, short* out);
+
     // enable command stream dumping
     void enableCommandStream(bool enable);
 
@@ -978,6 +1322,14 @@ class DivEngine {
     // switch master
     bool switchMaster(bool full=false);
 
+    // set the quality tier.
+    // this re-initializes the chips with the cores of the new tier and
+    // resumes playback from the current position. the song is not reloaded.
+    void setQualityTier(DivQualityTier tier);
+
+    // get the quality tier
+    DivQualityTier getQualityTier();
+
     // set MIDI base channel
     void setMidiBaseChan(int chan);
 
@@ -1025,6 +1377,9 @@ class DivEngine {
     DivEngine():
       output(NULL),
       exportThread(NULL),
+      multiExport(NULL),
+      cmdStreamInt(NULL),
+      qualityTier(DIV_QUALITY_NORMAL),
       chans(0),
       active(false),
       lowQuality(false),
@@ -1048,7 +1403,6 @@ class DivEngine {
       skipping(false),
       midiIsDirect(false),
       lowLatency(false),
-      systemsRegistered(false),
       hasLoadedSomething(false),
       midiOutClock(false),
       midiOutMode(DIV_MIDI_MODE_NOTE),
@@ -1089,7 +1443,11 @@ class DivEngine {
       haltOn(DIV_HALT_NONE),
       audioEngine(DIV_AUDIO_NULL),
       exportMode(DIV_EXPORT_MODE_ONE),
+      exportFormat(DIV_EXPORT_FORMAT_WAV),
+      exportChunkCallback(NULL),
       exportFadeOut(0.0),
+      renderCacheEnabled(false),
+      renderCacheMaxSize(256<<20),
       midiBaseChan(0),
       midiPoly(true),
       midiAgeCounter(0),
@@ -1106,12 +1464,12 @@ class DivEngine {
       metroAmp(0.0f),
       metroVol(1.0f),
       totalProcessed(0),
+      oscTapSeq(0),
       curOrders(NULL),
       curPat(NULL),
       tempIns(NULL),
       oscBuf{NULL,NULL},
       oscSize(1),
-      oscReadPos(0),
       oscWritePos(0),
       tickMult(1),
       processTime(0),
@@ -1126,13 +1484,9 @@ class DivEngine {
       memset(vibTable,0,64*sizeof(short));
       memset(reversePitchTable,0,4096*sizeof(int));
       memset(pitchTable,0,4096*sizeof(int));
-      memset(sysDefs,0,256*sizeof(void*));
       memset(walked,0,8192);
-
-      for (int i=0; i<256; i++) {
-        sysFileMapFur[i]=DIV_SYSTEM_NULL;
-        sysFileMapDMF[i]=DIV_SYSTEM_NULL;
-      }
+      memset(oscTapPeak,0,DIV_OSC_TAP_BLOCKS*2*sizeof(float));
+      memset(oscTapRMS,0,DIV_OSC_TAP_BLOCKS*2*sizeof(float));
 
       changeSong(0);
     }
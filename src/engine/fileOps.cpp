@@ -1576,6 +1576,20 @@ void DivEngine::convertOldFlags(unsigned int oldFlags, DivConfig& newFlags, DivS
   }
 }
 
+// a pattern located in a .fur file, decoded later.
+struct FurPatternRef {
+  DivPattern* pat;
+  unsigned int offset;
+  int len, effectCols;
+};
+
+enum FurJobResult {
+  FUR_JOB_OK=0,
+  FUR_JOB_SEEK_FAILED,
+  FUR_JOB_INVALID,
+  FUR_JOB_INCOMPLETE
+};
+
 bool DivEngine::loadFur(unsigned char* file, size_t len) {
   unsigned int insPtr[256];
   unsigned int wavePtr[256];
@@ -2305,79 +2319,9 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
       }
     }
 
-    // read instruments
-    for (int i=0; i<ds.insLen; i++) {
-      DivInstrument* ins=new DivInstrument;
-      logD("reading instrument %d at %x...",i,insPtr[i]);
-      if (!reader.seek(insPtr[i],SEEK_SET)) {
-        logE("couldn't seek to instrument %d!",i);
-        lastError=fmt::sprintf("couldn't seek to instrument %d!",i);
-        ds.unload();
-        delete ins;
-        delete[] file;
-        return false;
-      }
-      
-      if (ins->readInsData(reader,ds.version)!=DIV_DATA_SUCCESS) {
-        lastError="invalid instrument header/data!";
-        ds.unload();
-        delete ins;
-        delete[] file;
-        return false;
-      }
-
-      ds.ins.push_back(ins);
-    }
-
-    // read wavetables
-    for (int i=0; i<ds.waveLen; i++) {
-      DivWavetable* wave=new DivWavetable;
-      logD("reading wavetable %d at %x...",i,wavePtr[i]);
-      if (!reader.seek(wavePtr[i],SEEK_SET)) {
-        logE("couldn't seek to wavetable %d!",i);
-        lastError=fmt::sprintf("couldn't seek to wavetable %d!",i);
-        ds.unload();
-        delete wave;
-        delete[] file;
-        return false;
-      }
-
-      if (wave->readWaveData(reader,ds.version)!=DIV_DATA_SUCCESS) {
-        lastError="invalid wavetable header/data!";
-        ds.unload();
-        delete wave;
-        delete[] file;
-        return false;
-      }
-
-      ds.wave.push_back(wave);
-    }
-
-    // read samples
-    for (int i=0; i<ds.sampleLen; i++) {
-      DivSample* sample=new DivSample;
-
-      if (!reader.seek(samplePtr[i],SEEK_SET)) {
-        logE("couldn't seek to sample %d!",i);
-        lastError=fmt::sprintf("couldn't seek to sample %d!",i);
-        ds.unload();
-        delete sample;
-        delete[] file;
-        return false;
-      }
-
-      if (sample->readSampleData(reader,ds.version)!=DIV_DATA_SUCCESS) {
-        lastError="invalid sample header/data!";
-        ds.unload();
-        delete sample;
-        delete[] file;
-        return false;
-      }
-
-      ds.sample.push_back(sample);
-    }
-
-    // read patterns
+    // locate patterns first. they are allocated here as the pattern list of a channel is shared.
+    std::vector<FurPatternRef> patRefs;
+    std::unordered_map<DivPattern*,size_t> patRefIndex;
     for (int i: patPtr) {
       if (!reader.seek(i,SEEK_SET)) {
         logE("couldn't seek to pattern in %x!",i);
@@ -2431,22 +2375,155 @@ bool DivEngine::loadFur(unsigned char* file, size_t len) {
         return false;
       }
 
-      DivPattern* pat=ds.subsong[subs]->pat[chan].getPattern(index,true);
-      for (int j=0; j<ds.subsong[subs]->patLen; j++) {
-        pat->data[j][0]=reader.readS();
-        pat->data[j][1]=reader.readS();
-        pat->data[j][2]=reader.readS();
-        pat->data[j][3]=reader.readS();
-        for (int k=0; k<ds.subsong[subs]->pat[chan].effectCols; k++) {
-          pat->data[j][4+(k<<1)]=reader.readS();
-          pat->data[j][5+(k<<1)]=reader.readS();
+      FurPatternRef ref;
+      ref.pat=ds.subsong[subs]->pat[chan].getPattern(index,true);
+      ref.offset=reader.tell();
+      ref.len=ds.subsong[subs]->patLen;
+      ref.effectCols=ds.subsong[subs]->pat[chan].effectCols;
+
+      // if a pattern is stored twice, the last one wins
+      auto prev=patRefIndex.find(ref.pat);
+      if (prev!=patRefIndex.end()) {
+        patRefs[prev->second]=ref;
+      } else {
+        patRefIndex[ref.pat]=patRefs.size();
+        patRefs.push_back(ref);
+      }
+    }
+
+    // read samples, instruments, wavetables and pattern data in parallel.
+    // every job has its own reader and writes to its own slot, so the song is
+    // assembled in file order regardless of which thread finishes first.
+    std::vector<DivSample*> newSample(ds.sampleLen,NULL);
+    std::vector<DivInstrument*> newIns(ds.insLen,NULL);
+    std::vector<DivWavetable*> newWave(ds.waveLen,NULL);
+    size_t insJobStart=ds.sampleLen;
+    size_t waveJobStart=insJobStart+ds.insLen;
+    size_t patJobStart=waveJobStart+ds.waveLen;
+    std::vector<FurJobResult> jobResult(patJobStart+patRefs.size(),FUR_JOB_OK);
+    std::vector<size_t> jobEnd(jobResult.size(),0);
+    unsigned short version=ds.version;
+
+    runParallel(jobResult.size(),[&](size_t job) {
+      SafeReader jobReader=SafeReader(file,len);
+      try {
+        if (job<insJobStart) {
+          int i=job;
+          DivSample* sample=new DivSample;
+          newSample[i]=sample;
+          if (!jobReader.seek(samplePtr[i],SEEK_SET)) {
+            jobResult[job]=FUR_JOB_SEEK_FAILED;
+            return;
+          }
+          if (sample->readSampleData(jobReader,version)!=DIV_DATA_SUCCESS) {
+            jobResult[job]=FUR_JOB_INVALID;
+          }
+        } else if (job<waveJobStart) {
+          int i=job-insJobStart;
+          DivInstrument* ins=new DivInstrument;
+          newIns[i]=ins;
+          logD("reading instrument %d at %x...",i,insPtr[i]);
+          if (!jobReader.seek(insPtr[i],SEEK_SET)) {
+            jobResult[job]=FUR_JOB_SEEK_FAILED;
+            return;
+          }
+          if (ins->readInsData(jobReader,version)!=DIV_DATA_SUCCESS) {
+            jobResult[job]=FUR_JOB_INVALID;
+          }
+        } else if (job<patJobStart) {
+          int i=job-waveJobStart;
+          DivWavetable* wave=new DivWavetable;
+          newWave[i]=wave;
+          logD("reading wavetable %d at %x...",i,wavePtr[i]);
+          if (!jobReader.seek(wavePtr[i],SEEK_SET)) {
+            jobResult[job]=FUR_JOB_SEEK_FAILED;
+            return;
+          }
+          if (wave->readWaveData(jobReader,version)!=DIV_DATA_SUCCESS) {
+            jobResult[job]=FUR_JOB_INVALID;
+          }
+        } else {
+          FurPatternRef& ref=patRefs[job-patJobStart];
+          DivPattern* pat=ref.pat;
+          if (!jobReader.seek(ref.offset,SEEK_SET)) {
+            jobResult[job]=FUR_JOB_SEEK_FAILED;
+            return;
+          }
+          for (int j=0; j<ref.len; j++) {
+            pat->data[j][0]=jobReader.readS();
+            pat->data[j][1]=jobReader.readS();
+            pat->data[j][2]=jobReader.readS();
+            pat->data[j][3]=jobReader.readS();
+            for (int k=0; k<ref.effectCols; k++) {
+              pat->data[j][4+(k<<1)]=jobReader.readS();
+              pat->data[j][5+(k<<1)]=jobReader.readS();
+            }
+          }
+
+          if (version>=51) {
+            pat->name=jobReader.readString();
+          }
         }
+        jobEnd[job]=jobReader.tell();
+      } catch (EndOfFileException& e) {
+        jobResult[job]=FUR_JOB_INCOMPLETE;
+      }
+    });
+
+    // report the first failed element
+    String jobError;
+    for (size_t job=0; job<jobResult.size() && jobError.empty(); job++) {
+      switch (jobResult[job]) {
+        case FUR_JOB_OK:
+          break;
+        case FUR_JOB_SEEK_FAILED:
+          if (job<insJobStart) {
+            jobError=fmt::sprintf("couldn't seek to sample %d!",(int)job);
+          } else if (job<waveJobStart) {
+            jobError=fmt::sprintf("couldn't seek to instrument %d!",(int)(job-insJobStart));
+          } else if (job<patJobStart) {
+            jobError=fmt::sprintf("couldn't seek to wavetable %d!",(int)(job-waveJobStart));
+          } else {
+            jobError=fmt::sprintf("couldn't seek to pattern in %x!",patRefs[job-patJobStart].offset);
+          }
+          logE("%s",jobError);
+          break;
+        case FUR_JOB_INVALID:
+          if (job<insJobStart) {
+            jobError="invalid sample header/data!";
+          } else if (job<waveJobStart) {
+            jobError="invalid instrument header/data!";
+          } else {
+            jobError="invalid wavetable header/data!";
+          }
+          break;
+        case FUR_JOB_INCOMPLETE:
+          logE("premature end of file!");
+          jobError="incomplete file";
+          break;
       }
+    }
 
-      if (ds.version>=51) {
-        pat->name=reader.readString();
-      }
+    if (!jobError.empty()) {
+      lastError=jobError;
+      for (DivSample* i: newSample) delete i;
+      for (DivInstrument* i: newIns) delete i;
+      for (DivWavetable* i: newWave) delete i;
+      ds.unload();
+      delete[] file;
+      return false;
+    }
+
+    ds.ins=newIns;
+    ds.wave=newWave;
+    ds.sample=newSample;
+
+    // continue after the last element in the file
+    size_t dataEnd=0;
+    for (size_t i: jobEnd) {
+      if (i>dataEnd) dataEnd=i;
     }
+    if (dataEnd>reader.tell()) reader.seek(dataEnd,SEEK_SET);
 
     if (reader.tell()<reader.size()) {
       if ((reader.tell()+1)!=reader.size()) {
@@ -4033,7 +4110,7 @@ bool DivEngine::load(unsigned char* f, size_t slen) {
     return false;
   }
 
-  if (!systemsRegistered) registerSystems();
+  registerSystems();
 
   // step 1: try loading as a zlib-compressed file
   logD("trying zlib...");
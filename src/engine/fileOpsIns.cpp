@@ -23,25 +23,6 @@
 #include <fmt/printf.h>
 #include <limits.h>
 
-enum DivInsFormats {
-  DIV_INSFORMAT_DMP,
-  DIV_INSFORMAT_TFI,
-  DIV_INSFORMAT_VGI,
-  DIV_INSFORMAT_FTI,
-  DIV_INSFORMAT_BTI,
-  DIV_INSFORMAT_S3I,
-  DIV_INSFORMAT_SBI,
-  DIV_INSFORMAT_Y12,
-  DIV_INSFORMAT_OPLI,
-  DIV_INSFORMAT_OPNI,
-  DIV_INSFORMAT_BNK,
-  DIV_INSFORMAT_GYB,
-  DIV_INSFORMAT_OPM,
-  DIV_INSFORMAT_WOPL,
-  DIV_INSFORMAT_WOPN,
-  DIV_INSFORMAT_FF,
-};
-
 // Reused patch data structures
 
 // SBI and some other OPL containers
@@ -907,106 +888,86 @@ void DivEngine::loadY12(SafeReader& reader, std::vector<DivInstrument*>& ret, St
   }
 }
 
-void DivEngine::loadBNK(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath) {
-  std::vector<DivInstrument*> insList;
-  std::vector<String*> instNames;
+static void readBnkPatch(SafeReader& reader, DivInstrumentFM& fm) {
+  fm.ops = 2;
+
+  uint8_t timbreMode = reader.readC();
+  reader.readC();  // skip timbre perc voice
+  if (timbreMode == 1) {
+    fm.opllPreset = (uint8_t)(1<<4);
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    fm.op[i].ksl = reader.readC();
+    fm.op[i].mult = reader.readC();
+    uint8_t fb = reader.readC();
+    if (i==0) {
+      fm.fb = fb;
+    }
+    fm.op[i].ar = reader.readC();
+    fm.op[i].sl = reader.readC();
+    fm.op[i].sus = (reader.readC() != 0) ? 1 : 0;
+    fm.op[i].dr = reader.readC();
+    fm.op[i].rr = reader.readC();
+    fm.op[i].tl = reader.readC();
+    fm.op[i].am = reader.readC();
+    fm.op[i].vib = reader.readC();
+    fm.op[i].ksr = reader.readC();
+    uint8_t alg = (reader.readC() == 0) ? 1 : 0;
+    if (i==0) {
+      fm.alg = alg;
+    }
+  }
+  fm.op[0].ws = reader.readC();
+  fm.op[1].ws = reader.readC();
+}
+
+void DivEngine::indexBNK(SafeReader& reader, DivInsBank& bank) {
   reader.seek(0, SEEK_SET);
 
   // First distinguish between GEMS BNK and Adlib BNK
   uint64_t header = reader.readL();
   bool is_adlib = ((header>>8) == 0x2d42494c444100L);
-  bool is_failed = false;
-  int readCount = 0;
-  int insCount = 0;
-
-  if (is_adlib) {
-    try {
-      reader.seek(0x0c, SEEK_SET);
-      uint32_t name_offset = reader.readI();
-      reader.seek(0x10, SEEK_SET);
-      uint32_t data_offset = reader.readI();
-
-      // Seek to BNK patch names
-      reader.seek(name_offset, SEEK_SET);
-      while (reader.tell() < data_offset) {
-        reader.seek(3, SEEK_CUR);
-        instNames.push_back(new String(reader.readString(9)));
-        ++insCount;
-      }
-
-      // Seek to BNK data
-      if (!reader.seek(data_offset, SEEK_SET)) {
-        throw EndOfFileException(&reader, data_offset);
-      };
-
-      // Read until all patches have been accounted for.
-      for (int i = 0; i < insCount; ++i) {
-        DivInstrument *ins = new DivInstrument;
-
-        ins->type = DIV_INS_OPL;
-        ins->fm.ops = 2;
-
-        uint8_t timbreMode = reader.readC();
-        reader.readC();  // skip timbre perc voice
-        if (timbreMode == 1) {
-          ins->fm.opllPreset = (uint8_t)(1<<4);
-        }
-
-        for (int i = 0; i < 2; ++i) {
-          ins->fm.op[i].ksl = reader.readC();
-          ins->fm.op[i].mult = reader.readC();
-          uint8_t fb = reader.readC();
-          if (i==0) {
-            ins->fm.fb = fb;
-          }
-          ins->fm.op[i].ar = reader.readC();
-          ins->fm.op[i].sl = reader.readC();
-          ins->fm.op[i].sus = (reader.readC() != 0) ? 1 : 0;
-          ins->fm.op[i].dr = reader.readC();
-          ins->fm.op[i].rr = reader.readC();
-          ins->fm.op[i].tl = reader.readC();
-          ins->fm.op[i].am = reader.readC();
-          ins->fm.op[i].vib = reader.readC();
-          ins->fm.op[i].ksr = reader.readC();
-          uint8_t alg = (reader.readC() == 0) ? 1 : 0;
-          if (i==0) {
-            ins->fm.alg = alg;
-          }
-        }
-        ins->fm.op[0].ws = reader.readC();
-        ins->fm.op[1].ws = reader.readC();
-        ins->name = stringNotBlank(*instNames[i]) ? (*instNames[i]) : fmt::sprintf("%s[%d]", stripPath, i);
-
-        insList.push_back(ins);
-        ++readCount;
-      }
-      // All data read, don't care about the rest.
-      reader.seek(0, SEEK_END);
-
-    } catch (EndOfFileException& e) {
-      lastError="premature end of file";
-      logE("premature end of file");
-      for (int i = 0; i < readCount; ++i) {
-        delete insList[i];
-      }
-      is_failed = true;
-    }
 
-  } else {
+  if (!is_adlib) {
     // assume GEMS BNK for now.
     lastError="GEMS BNK currently not supported.";
     logE("GEMS BNK currently not supported.");
+    return;
   }
 
-  if (!is_failed) {
-    for (int i = 0; i < readCount; ++i) {
-      ret.push_back(insList[i]);
-    }
+  reader.seek(0x0c, SEEK_SET);
+  uint32_t name_offset = reader.readI();
+  reader.seek(0x10, SEEK_SET);
+  uint32_t data_offset = reader.readI();
+
+  // Seek to BNK patch names
+  reader.seek(name_offset, SEEK_SET);
+  while (reader.tell() < data_offset) {
+    reader.seek(3, SEEK_CUR);
+    DivInsBankEntry entry;
+    entry.type = DIV_INS_OPL;
+    entry.name = reader.readString(9);
+    bank.entries.push_back(entry);
   }
 
-  for (String* name : instNames) {
-    delete name;
+  // Seek to BNK data
+  if (!reader.seek(data_offset, SEEK_SET)) {
+    throw EndOfFileException(&reader, data_offset);
+  };
+
+  // Make sure all patches have been accounted for.
+  DivInstrumentFM fm;
+  for (size_t i = 0; i < bank.entries.size(); ++i) {
+    DivInsBankEntry& entry = bank.entries[i];
+    entry.offset = reader.tell();
+    readBnkPatch(reader, fm);
+    if (!stringNotBlank(entry.name)) {
+      entry.name = fmt::sprintf("%s[%d]", bank.stripPath, (int)i);
+    }
   }
+  // All data read, don't care about the rest.
+  reader.seek(0, SEEK_END);
 }
 
 void DivEngine::loadFF(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath) {
@@ -1081,203 +1042,202 @@ void DivEngine::loadFF(SafeReader& reader, std::vector<DivInstrument*>& ret, Str
   }
 }
 
-void DivEngine::loadGYB(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath) {
-  std::vector<DivInstrument*> insList;
-  int readCount = 0;
-  bool is_failed = false;
+static void readGybPatch(SafeReader& reader, bool readRegB4, DivInstrumentFM& fm) {
+  const int opOrder[] = { 0,1,2,3 };
+  fm.ops = 4;
 
-  auto readInstrument = [&](SafeReader& reader, bool readRegB4) -> DivInstrument* {
-    const int opOrder[] = { 0,1,2,3 };
-    DivInstrument* ins = new DivInstrument;
-    ins->type = DIV_INS_FM;
-    ins->fm.ops = 4;
+  // see https://plutiedev.com/ym2612-registers 
+  // and https://github.com/Wohlstand/OPN2BankEditor/blob/master/Specifications/GYB-file-specification.txt
 
-    // see https://plutiedev.com/ym2612-registers 
-    // and https://github.com/Wohlstand/OPN2BankEditor/blob/master/Specifications/GYB-file-specification.txt
+  uint8_t reg;
+  for (int i : opOrder) {
+    reg = reader.readC(); // MUL/DT
+    fm.op[i].mult = reg & 0xF;
+    fm.op[i].dt = fmDtRegisterToFurnace((reg >> 4) & 0x7);
+  }
+  for (int i : opOrder) {
+    reg = reader.readC(); // TL
+    fm.op[i].tl = reg & 0x7F;
+  }
+  for (int i : opOrder) {
+    reg = reader.readC(); // AR/RS
+    fm.op[i].ar = reg & 0x1F;
+    fm.op[i].rs = ((reg >> 6) & 0x3);
+  }
+  for (int i : opOrder) {
+    reg = reader.readC(); // DR/AM-ENA
+    fm.op[i].dr = reg & 0x1F;
+    fm.op[i].am = ((reg >> 7) & 0x1);
+  }
+  for (int i : opOrder) {
+    reg = reader.readC(); // SR (D2R)
+    fm.op[i].d2r = reg & 0x1F;
+  }
+  for (int i : opOrder) {
+    reg = reader.readC(); // RR/SL
+    fm.op[i].rr = reg & 0xF;
+    fm.op[i].sl = ((reg >> 4) & 0xF);
+  }
+  for (int i : opOrder) {
+    reg = reader.readC(); // SSG-EG
+    fm.op[i].ssgEnv = reg & 0xF;
+  }
+  // ALG/FB
+  reg = reader.readC();
+  fm.alg = reg & 0x7;
+  fm.fb = ((reg >> 3) & 0x7);
+
+  if (readRegB4) { // PAN / PMS / AMS
+    reg = reader.readC();
+    fm.fms = reg & 0x7;
+    fm.ams = ((reg >> 4) & 0x3);
+  }
+}
 
-    try {
-      uint8_t reg;
-      for (int i : opOrder) {
-        reg = reader.readC(); // MUL/DT
-        ins->fm.op[i].mult = reg & 0xF;
-        ins->fm.op[i].dt = fmDtRegisterToFurnace((reg >> 4) & 0x7);
-      }
-      for (int i : opOrder) {
-        reg = reader.readC(); // TL
-        ins->fm.op[i].tl = reg & 0x7F;
-      }
-      for (int i : opOrder) {
-        reg = reader.readC(); // AR/RS
-        ins->fm.op[i].ar = reg & 0x1F;
-        ins->fm.op[i].rs = ((reg >> 6) & 0x3);
-      }
-      for (int i : opOrder) {
-        reg = reader.readC(); // DR/AM-ENA
-        ins->fm.op[i].dr = reg & 0x1F;
-        ins->fm.op[i].am = ((reg >> 7) & 0x1);
-      }
-      for (int i : opOrder) {
-        reg = reader.readC(); // SR (D2R)
-        ins->fm.op[i].d2r = reg & 0x1F;
-      }
-      for (int i : opOrder) {
-        reg = reader.readC(); // RR/SL
-        ins->fm.op[i].rr = reg & 0xF;
-        ins->fm.op[i].sl = ((reg >> 4) & 0xF);
-      }
-      for (int i : opOrder) {
-        reg = reader.readC(); // SSG-EG
-        ins->fm.op[i].ssgEnv = reg & 0xF;
-      }
-      // ALG/FB
-      reg = reader.readC();
-      ins->fm.alg = reg & 0x7;
-      ins->fm.fb = ((reg >> 3) & 0x7);
-
-      if (readRegB4) { // PAN / PMS / AMS
-        reg = reader.readC();
-        ins->fm.fms = reg & 0x7;
-        ins->fm.ams = ((reg >> 4) & 0x3);
-      }
-      insList.push_back(ins);
-      ++readCount;
-      return ins;
+void DivEngine::indexGYB(SafeReader& reader, DivInsBank& bank) {
+  DivInstrumentFM fm;
 
-    } catch (...) {
-      // Deallocate and rethrow to outer handler
-      delete ins;
-      throw;
-    }
+  auto addPatch = [&](SafeReader& reader, bool readRegB4) {
+    DivInsBankEntry entry;
+    entry.type = DIV_INS_FM;
+    entry.offset = reader.tell();
+    entry.param = readRegB4;
+    readGybPatch(reader, readRegB4, fm);
+    bank.entries.push_back(entry);
   };
-  auto readInstrumentName = [&](SafeReader& reader, DivInstrument* ins) {
+  auto readInstrumentName = [&](SafeReader& reader, int index) {
     uint8_t nameLen = reader.readC();
     String insName = (nameLen>0) ? reader.readString(nameLen) : "";
-    ins->name = stringNotBlank(insName) 
+    bank.entries[index].name = stringNotBlank(insName) 
       ? insName 
-      : fmt::sprintf("%s [%d]", stripPath, readCount - 1);
+      : fmt::sprintf("%s [%d]", bank.stripPath, index);
   };
 
-  try {
-    reader.seek(0, SEEK_SET);
-    uint16_t header = reader.readS();
-    uint8_t insMelodyCount, insDrumCount;
+  reader.seek(0, SEEK_SET);
+  uint16_t header = reader.readS();
+  uint8_t insMelodyCount, insDrumCount;
 
-    if (header == 0x0C1A) { // 26 12 in decimal bytes
-      uint8_t version = reader.readC();
+  if (header == 0x0C1A) { // 26 12 in decimal bytes
+    uint8_t version = reader.readC();
+    bank.version = version;
 
-      if ((version ^ 3) > 0) {
-        // GYBv1/2
-        insMelodyCount = reader.readC();
-        insDrumCount = reader.readC();
+    if ((version ^ 3) > 0) {
+      // GYBv1/2
+      insMelodyCount = reader.readC();
+      insDrumCount = reader.readC();
 
-        if (insMelodyCount > 128 || insDrumCount > 128) {
-          throw std::invalid_argument("GYBv1/2 patch count is out of bounds.");
-        }
+      if (insMelodyCount > 128 || insDrumCount > 128) {
+        throw std::invalid_argument("GYBv1/2 patch count is out of bounds.");
+      }
 
-        if (!reader.seek(0x100, SEEK_CUR)) { // skip MIDI instrument mapping
-          throw EndOfFileException(&reader, reader.tell() + 0x100);
-        }
+      if (!reader.seek(0x100, SEEK_CUR)) { // skip MIDI instrument mapping
+        throw EndOfFileException(&reader, reader.tell() + 0x100);
+      }
+
+      if (version == 2) {
+        reader.readC(); // skip LFO speed (chip-global)
+      }
+
+      // Instrument data
+      for (int i = 0; i < (insMelodyCount+insDrumCount); ++i) {
+        addPatch(reader, (version == 2));
 
+        // Additional data
+        reader.readC();  // skip transpose
         if (version == 2) {
-          reader.readC(); // skip LFO speed (chip-global)
+          reader.readC();  // skip padding
         }
+      }
 
-        // Instrument data
-        for (int i = 0; i < (insMelodyCount+insDrumCount); ++i) {
-          readInstrument(reader, (version == 2));
+      // Instrument name
+      for (int i = 0; i < (insMelodyCount+insDrumCount); ++i) {
+        readInstrumentName(reader, i);
+      }
 
-          // Additional data
-          reader.readC();  // skip transpose
-          if (version == 2) {
-            reader.readC();  // skip padding
-          }
-        }
+      // Map to note assignment currently not supported.
 
-        // Instrument name
-        for (int i = 0; i < (insMelodyCount+insDrumCount); ++i) {
-          readInstrumentName(reader, insList[i]);
-        }
+    } else {
+      // GYBv3+
+      reader.readC();  // skip LFO speed (chip-global)
+      uint32_t fileSize = reader.readI();
+      uint32_t bankOffset = reader.readI();
+      uint32_t mapOffset = reader.readI();
 
-        // Map to note assignment currently not supported.
+      if (bankOffset > fileSize || mapOffset > fileSize) {
+        lastError = "GYBv3 file appears to have invalid data offsets.";
+        logE("GYBv3 file appears to have invalid data offsets.");
+      }
 
-      } else {
-        // GYBv3+
-        reader.readC();  // skip LFO speed (chip-global)
-        uint32_t fileSize = reader.readI();
-        uint32_t bankOffset = reader.readI();
-        uint32_t mapOffset = reader.readI();
-
-        if (bankOffset > fileSize || mapOffset > fileSize) {
-          lastError = "GYBv3 file appears to have invalid data offsets.";
-          logE("GYBv3 file appears to have invalid data offsets.");
-        }
+      if (!reader.seek(bankOffset, SEEK_SET)) {
+        throw EndOfFileException(&reader, bankOffset);
+      }
+      uint16_t insCount = reader.readS();
 
-        if (!reader.seek(bankOffset, SEEK_SET)) {
-          throw EndOfFileException(&reader, bankOffset);
-        }
-        uint16_t insCount = reader.readS();
-
-        size_t patchPosOffset = reader.tell();
-        for (int i = 0; i < insCount; ++i) {
-          uint16_t patchSize = reader.readS();
-          readInstrument(reader, true);
-
-          // Additional data
-          reader.readC(); // skip transpose
-          uint8_t additionalDataFlags = reader.readC() & 0x1; // skip additional data bitfield
-          
-          // if chord notes attached, skip this
-          if ((additionalDataFlags&1) > 0) {
-            uint8_t notes = reader.readC();
-            for (int j = 0; j < notes; ++j) {
-              reader.readC();
-            }
+      size_t patchPosOffset = reader.tell();
+      for (int i = 0; i < insCount; ++i) {
+        uint16_t patchSize = reader.readS();
+        addPatch(reader, true);
+
+        // Additional data
+        reader.readC(); // skip transpose
+        uint8_t additionalDataFlags = reader.readC() & 0x1; // skip additional data bitfield
+        
+        // if chord notes attached, skip this
+        if ((additionalDataFlags&1) > 0) {
+          uint8_t notes = reader.readC();
+          for (int j = 0; j < notes; ++j) {
+            reader.readC();
           }
+        }
 
-          // Instrument Name
-          readInstrumentName(reader, insList[i]);
+        // Instrument Name
+        readInstrumentName(reader, i);
 
-          // Retrieve next patch
-          if (!reader.seek(patchPosOffset + patchSize, SEEK_SET)) {
-            throw EndOfFileException(&reader, patchPosOffset + patchSize);
-          }
-          patchPosOffset = reader.tell();
+        // Retrieve next patch
+        if (!reader.seek(patchPosOffset + patchSize, SEEK_SET)) {
+          throw EndOfFileException(&reader, patchPosOffset + patchSize);
         }
+        patchPosOffset = reader.tell();
       }
-      reader.seek(0, SEEK_END);
     }
-    
-  } catch (EndOfFileException& e) {
-    lastError = "premature end of file";
-    logE("premature end of file");
-    is_failed = true;
-
-  } catch (std::invalid_argument& e) {
-    lastError = fmt::sprintf("Invalid value found in patch file. %s", e.what());
-    logE("Invalid value found in patch file.");
-    logE(e.what());
-    is_failed = true;
+    reader.seek(0, SEEK_END);
   }
+}
 
-  if (!is_failed) {
-    for (int i = 0; i < readCount; ++i) {
-      if (insList[i] != NULL) {
-        ret.push_back(insList[i]);
-      }
-    }
-  } else {
-    for (int i = 0; i < readCount; ++i) {
-      delete insList[i];
-    }
+static int readIntStrWithinRange(String&& input, int limitLow = INT_MIN, int limitHigh = INT_MAX) {
+  int x = std::stoi(input.c_str());
+  if (x > limitHigh || x < limitLow) {
+    throw std::invalid_argument(fmt::sprintf("%s is out of bounds of range [%d..%d]", input, limitLow, limitHigh));
   }
+  return x;
 }
 
-void DivEngine::loadOPM(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath) {
-  std::vector<DivInstrument*> insList;
+static void readOpmOperator(SafeReader& reader, DivInstrumentFM::Operator& op) {
+  op.ar = readIntStrWithinRange(reader.readStringToken(), 0, 31);
+  op.dr = readIntStrWithinRange(reader.readStringToken(), 0, 31);
+  op.d2r = readIntStrWithinRange(reader.readStringToken(), 0, 31);
+  op.rr = readIntStrWithinRange(reader.readStringToken(), 0, 31);
+  op.sl = readIntStrWithinRange(reader.readStringToken(), 0, 15);
+  op.tl = readIntStrWithinRange(reader.readStringToken(), 0, 127);
+  op.rs = readIntStrWithinRange(reader.readStringToken(), 0, 3);;
+  op.mult = readIntStrWithinRange(reader.readStringToken(), 0, 15);
+  op.dt = fmDtRegisterToFurnace(readIntStrWithinRange(reader.readStringToken(), 0, 7));
+  op.dt2 = readIntStrWithinRange(reader.readStringToken(), 0, 3);
+  op.am = readIntStrWithinRange(reader.readStringToken(), 0) > 0 ? 1 : 0;
+}
 
-  int readCount = 0;
-  bool is_failed = false;
+static void seekGroupValStart(SafeReader& reader, int pos) {
+  // Seek to position then move to next ':' character
+  if (!reader.seek(pos, SEEK_SET)) {
+    throw EndOfFileException(&reader, pos);
+  }
+  reader.readStringToken(':', false);
+}
 
+// reads lines until a complete OPM patch has been read.
+// returns false if the end of file is reached first. in that case started tells whether an
+// incomplete patch was found.
+static bool readOpmPatch(SafeReader& reader, String& stripPath, String& name, DivInstrumentFM& fm, size_t& start, bool& started) {
   bool patchNameRead = false,
        lfoRead = false,
        characteristicRead = false,
@@ -1286,597 +1246,706 @@ void DivEngine::loadOPM(SafeReader& reader, std::vector<DivInstrument*>& ret, St
        m2Read = false,
        c2Read = false;
 
-  DivInstrument* newPatch = NULL;
-  
-  auto completePatchRead = [&]() -> bool {
-    return patchNameRead && lfoRead && characteristicRead && m1Read && c1Read && m2Read && c2Read;
-  };
-  auto resetPatchRead = [&]() {
-    patchNameRead = lfoRead = characteristicRead = m1Read = c1Read = m2Read = c2Read = false;
-    newPatch = NULL;
-  };
-  auto readIntStrWithinRange = [](String&& input, int limitLow = INT_MIN, int limitHigh = INT_MAX) -> int {
-    int x = std::stoi(input.c_str());
-    if (x > limitHigh || x < limitLow) {
-      throw std::invalid_argument(fmt::sprintf("%s is out of bounds of range [%d..%d]", input, limitLow, limitHigh));
-    }
-    return x;
-  };
-  auto readOpmOperator = [&](SafeReader& reader, DivInstrumentFM::Operator& op) {
-    op.ar = readIntStrWithinRange(reader.readStringToken(), 0, 31);
-    op.dr = readIntStrWithinRange(reader.readStringToken(), 0, 31);
-    op.d2r = readIntStrWithinRange(reader.readStringToken(), 0, 31);
-    op.rr = readIntStrWithinRange(reader.readStringToken(), 0, 31);
-    op.sl = readIntStrWithinRange(reader.readStringToken(), 0, 15);
-    op.tl = readIntStrWithinRange(reader.readStringToken(), 0, 127);
-    op.rs = readIntStrWithinRange(reader.readStringToken(), 0, 3);;
-    op.mult = readIntStrWithinRange(reader.readStringToken(), 0, 15);
-    op.dt = fmDtRegisterToFurnace(readIntStrWithinRange(reader.readStringToken(), 0, 7));
-    op.dt2 = readIntStrWithinRange(reader.readStringToken(), 0, 3);
-    op.am = readIntStrWithinRange(reader.readStringToken(), 0) > 0 ? 1 : 0;
-  };
-  auto seekGroupValStart = [](SafeReader& reader, int pos) {
-    // Seek to position then move to next ':' character
-    if (!reader.seek(pos, SEEK_SET)) {
-      throw EndOfFileException(&reader, pos);
-    }
-    reader.readStringToken(':', false);
-  };
+  started = false;
+  fm.ops = 4;
 
-  try {
-    reader.seek(0, SEEK_SET);
-    while (!reader.isEOF()) {
-      // Checking line prefixes since they sometimes may not have a space after the ':'
-      size_t linePos = reader.tell();
-      String token = reader.readStringToken();
-      if (token.size() == 0) {
-        continue;
-      }
-
-      if (token.compare(0,2,"//") == 0) {
-        if (!reader.isEOF()) {
-          reader.readStringLine();
-        }
-        continue;
-      }
-
-      // At this point we know any other line would be associated with patch params
-      if (newPatch == NULL) {
-        newPatch = new DivInstrument;
-        newPatch->type = DIV_INS_OPM;
-        newPatch->fm.ops = 4;
-      }
-
-      // Read each line for their respective params. They may not be written in the same LINE order but they 
-      // must absolutely be properly grouped per patch! See inline comments indicating line structure examples.
-      
-      if (token.size() >= 2) {
-        if (token[0] == '@') {
-          // @:123 Name of patch
-          seekGroupValStart(reader, linePos);
-          // Note: Fallback to bank filename and current patch number specified by @n
-          String opmPatchNum = reader.readStringToken();
-          String insName = reader.readStringLine();
-          newPatch->name = stringNotBlank(insName) 
-            ? insName 
-            : fmt::sprintf("%s @%s", stripPath, opmPatchNum);
-          patchNameRead = true;
-
-        } else if (token.compare(0,3,"CH:") == 0) {
-          // CH: PAN FL CON AMS PMS SLOT NE
-          seekGroupValStart(reader, linePos);
-          reader.readStringToken(); // skip PAN
-          newPatch->fm.fb = readIntStrWithinRange(reader.readStringToken(), 0, 7);
-          newPatch->fm.alg = readIntStrWithinRange(reader.readStringToken(), 0, 7);
-          newPatch->fm.ams = readIntStrWithinRange(reader.readStringToken(), 0, 4);
-          newPatch->fm.fms = readIntStrWithinRange(reader.readStringToken(), 0, 7);
-          reader.readStringToken(); // skip SLOT (no furnace equivalent...yet?)
-          reader.readStringToken(); // skip NE   (^^^)
-          characteristicRead = true;
-
-        } else if (token.compare(0,3,"C1:") == 0) {
-          // C1: AR D1R D2R RR D1L TL KS MUL DT1 DT2 AMS-EN
-          seekGroupValStart(reader, linePos);
-          readOpmOperator(reader, newPatch->fm.op[2]);
-          c1Read = true;
-
-        } else if (token.compare(0,3,"C2:") == 0) {
-          // C2: AR D1R D2R RR D1L TL KS MUL DT1 DT2 AMS-EN
-          seekGroupValStart(reader, linePos);
-          readOpmOperator(reader, newPatch->fm.op[3]);
-          c2Read = true;
-
-        } else if (token.compare(0,3,"M1:") == 0) {
-          // M1: AR D1R D2R RR D1L TL KS MUL DT1 DT2 AMS-EN
-          seekGroupValStart(reader, linePos);
-          readOpmOperator(reader, newPatch->fm.op[0]);
-          m1Read = true;
-
-        } else if (token.compare(0,3,"M2:") == 0) {
-          // M2: AR D1R D2R RR D1L TL KS MUL DT1 DT2 AMS-EN
-          seekGroupValStart(reader, linePos);
-          readOpmOperator(reader, newPatch->fm.op[1]);
-          m2Read = true;
-
-        } else if (token.compare(0,4,"LFO:") == 0) {
-          // LFO:LFRQ AMD PMD WF NFRQ
-          seekGroupValStart(reader, linePos);
-          // Furnace patches do not store these as they are chip-global.
-          reader.readStringLine();
-          lfoRead = true;
-        } else {
-          // other unsupported lines ignored.
-          reader.readStringLine();
-        }
-      }
+  while (!reader.isEOF()) {
+    // Checking line prefixes since they sometimes may not have a space after the ':'
+    size_t linePos = reader.tell();
+    String token = reader.readStringToken();
+    if (token.size() == 0) {
+      continue;
+    }
 
-      if (completePatchRead()) {
-        insList.push_back(newPatch);
-        resetPatchRead();
-        ++readCount;
+    if (token.compare(0,2,"//") == 0) {
+      if (!reader.isEOF()) {
+        reader.readStringLine();
       }
+      continue;
     }
 
-    if (newPatch != NULL) {
-      addWarning("Last OPM patch read was incomplete and therefore not imported.");
-      logW("Last OPM patch read was incomplete and therefore not imported.");
-      delete newPatch;
-      newPatch = NULL;
+    // At this point we know any other line would be associated with patch params
+    if (!started) {
+      started = true;
+      start = linePos;
     }
 
-    for (int i = 0; i < readCount; ++i) {
-      ret.push_back(insList[i]);
+    // Read each line for their respective params. They may not be written in the same LINE order but they 
+    // must absolutely be properly grouped per patch! See inline comments indicating line structure examples.
+    
+    if (token.size() >= 2) {
+      if (token[0] == '@') {
+        // @:123 Name of patch
+        seekGroupValStart(reader, linePos);
+        // Note: Fallback to bank filename and current patch number specified by @n
+        String opmPatchNum = reader.readStringToken();
+        String insName = reader.readStringLine();
+        name = stringNotBlank(insName) 
+          ? insName 
+          : fmt::sprintf("%s @%s", stripPath, opmPatchNum);
+        patchNameRead = true;
+
+      } else if (token.compare(0,3,"CH:") == 0) {
+        // CH: PAN FL CON AMS PMS SLOT NE
+        seekGroupValStart(reader, linePos);
+        reader.readStringToken(); // skip PAN
+        fm.fb = readIntStrWithinRange(reader.readStringToken(), 0, 7);
+        fm.alg = readIntStrWithinRange(reader.readStringToken(), 0, 7);
+        fm.ams = readIntStrWithinRange(reader.readStringToken(), 0, 4);
+        fm.fms = readIntStrWithinRange(reader.readStringToken(), 0, 7);
+        reader.readStringToken(); // skip SLOT (no furnace equivalent...yet?)
+        reader.readStringToken(); // skip NE   (^^^)
+        characteristicRead = true;
+
+      } else if (token.compare(0,3,"C1:") == 0) {
+        // C1: AR D1R D2R RR D1L TL KS MUL DT1 DT2 AMS-EN
+        seekGroupValStart(reader, linePos);
+        readOpmOperator(reader, fm.op[2]);
+        c1Read = true;
+
+      } else if (token.compare(0,3,"C2:") == 0) {
+        // C2: AR D1R D2R RR D1L TL KS MUL DT1 DT2 AMS-EN
+        seekGroupValStart(reader, linePos);
+        readOpmOperator(reader, fm.op[3]);
+        c2Read = true;
+
+      } else if (token.compare(0,3,"M1:") == 0) {
+        // M1: AR D1R D2R RR D1L TL KS MUL DT1 DT2 AMS-EN
+        seekGroupValStart(reader, linePos);
+        readOpmOperator(reader, fm.op[0]);
+        m1Read = true;
+
+      } else if (token.compare(0,3,"M2:") == 0) {
+        // M2: AR D1R D2R RR D1L TL KS MUL DT1 DT2 AMS-EN
+        seekGroupValStart(reader, linePos);
+        readOpmOperator(reader, fm.op[1]);
+        m2Read = true;
+
+      } else if (token.compare(0,4,"LFO:") == 0) {
+        // LFO:LFRQ AMD PMD WF NFRQ
+        seekGroupValStart(reader, linePos);
+        // Furnace patches do not store these as they are chip-global.
+        reader.readStringLine();
+        lfoRead = true;
+      } else {
+        // other unsupported lines ignored.
+        reader.readStringLine();
+      }
     }
-  } catch (EndOfFileException& e) {
-    lastError="premature end of file";
-    logE("premature end of file");
-    is_failed = true;
-  } catch (std::invalid_argument& e) {
-    lastError=fmt::sprintf("Invalid value found in patch file. %s", e.what());
-    logE("Invalid value found in patch file.");
-    logE(e.what());
-    is_failed = true;
-  }
 
-  if (is_failed) {
-    for (int i = readCount - 1; i >= 0; --i) {
-      delete insList[i];
-    }
-    if (newPatch != NULL) {
-      delete newPatch;
+    if (patchNameRead && lfoRead && characteristicRead && m1Read && c1Read && m2Read && c2Read) {
+      return true;
     }
   }
+  return false;
 }
 
+void DivEngine::indexOPM(SafeReader& reader, DivInsBank& bank) {
+  DivInstrumentFM fm;
+  String name;
+  size_t start = 0;
+  bool started = false;
 
-void DivEngine::loadWOPL(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath) {
-  std::vector<DivInstrument*> insList;
-  bool is_failed = false;
-
-  uint16_t version;
-  uint16_t meloBankCount;
-  uint16_t percBankCount;
-  std::vector<midibank_t*> meloMetadata;
-  std::vector<midibank_t*> percMetadata;
-
-  auto readWoplOp = [](SafeReader& reader, DivInstrumentFM::Operator& op) {
-    uint8_t characteristics = reader.readC();
-    uint8_t keyScaleLevel = reader.readC();
-    uint8_t attackDecay = reader.readC();
-    uint8_t sustainRelease = reader.readC();
-    uint8_t waveSelect = reader.readC();
-    int total = 0;
-
-    total += (op.mult = characteristics & 0xF);
-    total += (op.ksr = ((characteristics >> 4) & 0x1));
-    total += (op.sus = ((characteristics >> 5) & 0x1));
-    total += (op.vib = ((characteristics >> 6) & 0x1));
-    total += (op.am = ((characteristics >> 7) & 0x1));
-    total += (op.tl = keyScaleLevel & 0x3F);
-    total += (op.ksl = ((keyScaleLevel >> 6) & 0x3));
-    total += (op.ar = ((attackDecay >> 4) & 0xF));
-    total += (op.dr = attackDecay & 0xF);
-    total += (op.rr = sustainRelease & 0xF);
-    total += (op.sl = ((sustainRelease >> 4) & 0xF));
-    total += (op.ws = waveSelect);
-    return total;
-  };
-
-  auto doParseWoplInstrument = [&](bool isPerc, midibank_t*& metadata, int patchNum) {
-    DivInstrument* ins = new DivInstrument;
-    try {
-      long patchSum = 0;
-      ins->type = DIV_INS_OPL;
+  reader.seek(0, SEEK_SET);
+  while (readOpmPatch(reader, bank.stripPath, name, fm, start, started)) {
+    DivInsBankEntry entry;
+    entry.name = name;
+    entry.type = DIV_INS_OPM;
+    entry.offset = start;
+    bank.entries.push_back(entry);
+  }
 
-      // Establish if it is a blank instrument.
-      String insName = reader.readString(32);
-      patchSum += insName.size();
-      
-      // TODO adapt MIDI key offset to transpose?
-      reader.seek(7, SEEK_CUR);  // skip MIDI params
-      uint8_t instTypeFlags = reader.readC();  // [0EEEDCBA] - see WOPL/OPLI spec
+  if (started) {
+    addWarning("Last OPM patch read was incomplete and therefore not imported.");
+    logW("Last OPM patch read was incomplete and therefore not imported.");
+  }
+}
 
-      bool is_4op = ((instTypeFlags & 0x1) == 1);
-      bool is_2x2op = (((instTypeFlags>>1) & 0x1) == 1);
-      bool is_rhythm = (((instTypeFlags>>4) & 0x7) > 0);
+// WOPL/WOPN bank metadata
+static void readWoBankMetadata(SafeReader& reader, int version, int count, std::vector<midibank_t>& metadata) {
+  for (int i = 0; i < count; ++i) {
+    midibank_t bank;
+    if (version >= 2) {
+      String bankName = reader.readString(32);
+      bank.bankLsb = reader.readC();
+      bank.bankMsb = reader.readC();
+      bank.name = stringNotBlank(bankName)
+        ? bankName
+        : fmt::sprintf("%d/%d", bank.bankMsb, bank.bankLsb);
+    } else {
+      // TODO do version 1 multibank sets even exist?
+      bank.bankLsb = 0;
+      bank.bankMsb = 0;
+      bank.name = "0/0";
+    }
+    metadata.push_back(bank);
+  }
+}
 
-      uint8_t feedConnect = reader.readC();
-      uint8_t feedConnect2nd = reader.readC();
+static int readWoplOp(SafeReader& reader, DivInstrumentFM::Operator& op) {
+  uint8_t characteristics = reader.readC();
+  uint8_t keyScaleLevel = reader.readC();
+  uint8_t attackDecay = reader.readC();
+  uint8_t sustainRelease = reader.readC();
+  uint8_t waveSelect = reader.readC();
+  int total = 0;
+
+  total += (op.mult = characteristics & 0xF);
+  total += (op.ksr = ((characteristics >> 4) & 0x1));
+  total += (op.sus = ((characteristics >> 5) & 0x1));
+  total += (op.vib = ((characteristics >> 6) & 0x1));
+  total += (op.am = ((characteristics >> 7) & 0x1));
+  total += (op.tl = keyScaleLevel & 0x3F);
+  total += (op.ksl = ((keyScaleLevel >> 6) & 0x3));
+  total += (op.ar = ((attackDecay >> 4) & 0xF));
+  total += (op.dr = attackDecay & 0xF);
+  total += (op.rr = sustainRelease & 0xF);
+  total += (op.sl = ((sustainRelease >> 4) & 0xF));
+  total += (op.ws = waveSelect);
+  return total;
+}
 
-      ins->fm.alg = (feedConnect & 0x1);
-      ins->fm.fb = ((feedConnect>>1) & 0xF);
+// a WOPL patch. pseudo 4-op patches are split into two instruments.
+struct woplpatch_t {
+  String name;
+  DivInstrumentFM fm[2];
+  // used to establish if a part is blank
+  long sum[2];
+  bool split;
+};
 
-      if (is_4op && !is_2x2op) {
-        ins->fm.ops = 4;
-        ins->fm.alg = (feedConnect & 0x1) | ((feedConnect2nd & 0x1) << 1);
-        for (int i : {2,0,3,1}) { // omfg >_<
-          patchSum += readWoplOp(reader, ins->fm.op[i]);
-        }
-      } else {
-        ins->fm.ops = 2;
-        for (int i : {1,0}) {
-          patchSum += readWoplOp(reader, ins->fm.op[i]);
-        }
-        if (is_rhythm) {
-          ins->fm.opllPreset = (uint8_t)(1<<4);
-        } else if (is_2x2op) {
-          // Note: Pair detuning offset not mappable. Use E5xx effect :P
-          ins->name = stringNotBlank(insName)
-            ? fmt::sprintf("%s (1)", insName)
-            : fmt::sprintf("%s[%s] %s Patch %d (1)",
-              stripPath, metadata->name, (isPerc) ? "Drum" : "Melodic", patchNum);
-          insList.push_back(ins);
-          patchSum = 0;
-          ins = new DivInstrument;
-          ins->type = DIV_INS_OPL;
-          ins->name = fmt::sprintf("%s (2)", insName);
-          ins->fm.alg = (feedConnect2nd & 0x1);
-          ins->fm.fb = ((feedConnect2nd >> 1) & 0xF);
-          for (int i : {1,0}) {
-            patchSum += readWoplOp(reader, ins->fm.op[i]);
-          }
-        }
+static void readWoplPatch(SafeReader& reader, int version, woplpatch_t& patch) {
+  patch.sum[0] = 0;
+  patch.sum[1] = 0;
+  patch.split = false;
 
-        if (!is_2x2op) {
-          reader.seek(10, SEEK_CUR); // skip unused operator pair
-        }
+  // Establish if it is a blank instrument.
+  patch.name = reader.readString(32);
+  patch.sum[0] += patch.name.size();
+  
+  // TODO adapt MIDI key offset to transpose?
+  reader.seek(7, SEEK_CUR);  // skip MIDI params
+  uint8_t instTypeFlags = reader.readC();  // [0EEEDCBA] - see WOPL/OPLI spec
+
+  bool is_4op = ((instTypeFlags & 0x1) == 1);
+  bool is_2x2op = (((instTypeFlags>>1) & 0x1) == 1);
+  bool is_rhythm = (((instTypeFlags>>4) & 0x7) > 0);
+
+  uint8_t feedConnect = reader.readC();
+  uint8_t feedConnect2nd = reader.readC();
+
+  DivInstrumentFM& fm = patch.fm[0];
+  fm.alg = (feedConnect & 0x1);
+  fm.fb = ((feedConnect>>1) & 0xF);
+
+  if (is_4op && !is_2x2op) {
+    fm.ops = 4;
+    fm.alg = (feedConnect & 0x1) | ((feedConnect2nd & 0x1) << 1);
+    for (int i : {2,0,3,1}) { // omfg >_<
+      patch.sum[0] += readWoplOp(reader, fm.op[i]);
+    }
+  } else {
+    fm.ops = 2;
+    for (int i : {1,0}) {
+      patch.sum[0] += readWoplOp(reader, fm.op[i]);
+    }
+    if (is_rhythm) {
+      fm.opllPreset = (uint8_t)(1<<4);
+    } else if (is_2x2op) {
+      // Note: Pair detuning offset not mappable. Use E5xx effect :P
+      DivInstrumentFM& fm2 = patch.fm[1];
+      patch.split = true;
+      fm2.alg = (feedConnect2nd & 0x1);
+      fm2.fb = ((feedConnect2nd >> 1) & 0xF);
+      for (int i : {1,0}) {
+        patch.sum[1] += readWoplOp(reader, fm2.op[i]);
       }
+    }
 
-      if (version >= 3) {
-        reader.readS_BE(); // skip keyon delay
-        reader.readS_BE(); // skip keyoff delay
-      }
+    if (!is_2x2op) {
+      reader.seek(10, SEEK_CUR); // skip unused operator pair
+    }
+  }
 
-      if (patchSum > 0) {
-        // Write instrument
-        // TODO: OPL3BankEditor hardcodes GM1 Melodic patch names which are not included in the bank file......
-        if (is_2x2op) {
-          ins->name = stringNotBlank(insName)
-            ? fmt::sprintf("%s (2)", insName)
-            : fmt::sprintf("%s[%s] %s Patch %d (2)",
-              stripPath, metadata->name, (isPerc) ? "Drum" : "Melodic", patchNum);
-        } else {
-          ins->name = stringNotBlank(insName)
-            ? insName
-            : fmt::sprintf("%s[%s] %s Patch %d",
-              stripPath, metadata->name, (isPerc) ? "Drum" : "Melodic", patchNum);
-        }
-        insList.push_back(ins);
-      } else {
-        // Empty instrument
-        delete ins;
-      }
-    } catch (...) {
-      // Deallocate and allow outer handler to do the rest.
-      delete ins;
-      throw;
+  if (version >= 3) {
+    reader.readS_BE(); // skip keyon delay
+    reader.readS_BE(); // skip keyoff delay
+  }
+}
+
+void DivEngine::indexWOPL(SafeReader& reader, DivInsBank& bank) {
+  uint16_t version;
+  uint16_t meloBankCount;
+  uint16_t percBankCount;
+  std::vector<midibank_t> meloMetadata;
+  std::vector<midibank_t> percMetadata;
+  woplpatch_t patch;
+
+  auto addPatch = [&](bool isPerc, midibank_t& metadata, int patchNum) {
+    DivInsBankEntry entry;
+    entry.type = DIV_INS_OPL;
+    entry.offset = reader.tell();
+    readWoplPatch(reader, version, patch);
+
+    // TODO: OPL3BankEditor hardcodes GM1 Melodic patch names which are not included in the bank file......
+    if (patch.split) {
+      // the first half is always imported
+      entry.name = stringNotBlank(patch.name)
+        ? fmt::sprintf("%s (1)", patch.name)
+        : fmt::sprintf("%s[%s] %s Patch %d (1)",
+          bank.stripPath, metadata.name, (isPerc) ? "Drum" : "Melodic", patchNum);
+      bank.entries.push_back(entry);
+      if (patch.sum[1] > 0) {
+        entry.param = 1;
+        entry.name = stringNotBlank(patch.name)
+          ? fmt::sprintf("%s (2)", patch.name)
+          : fmt::sprintf("%s[%s] %s Patch %d (2)",
+            bank.stripPath, metadata.name, (isPerc) ? "Drum" : "Melodic", patchNum);
+        bank.entries.push_back(entry);
+      }
+    } else if (patch.sum[0] > 0) {
+      entry.name = stringNotBlank(patch.name)
+        ? patch.name
+        : fmt::sprintf("%s[%s] %s Patch %d",
+          bank.stripPath, metadata.name, (isPerc) ? "Drum" : "Melodic", patchNum);
+      bank.entries.push_back(entry);
     }
+    // empty instruments are skipped
   };
 
-  try {
-    reader.seek(0, SEEK_SET);
+  reader.seek(0, SEEK_SET);
 
-    String header = reader.readString(11);
-    if (header == "WOPL3-BANK") {
-      version = reader.readS();
-      meloBankCount = reader.readS_BE();
-      percBankCount = reader.readS_BE();
-      reader.readC(); // skip chip-global LFO
-      reader.readC(); // skip additional flags
-
-      if (version >= 2) {
-        for (int i = 0; i < meloBankCount; ++i) {
-          meloMetadata.push_back(new midibank_t);
-          String bankName = reader.readString(32);
-          meloMetadata[i]->bankLsb = reader.readC();
-          meloMetadata[i]->bankMsb = reader.readC();
-          meloMetadata[i]->name = stringNotBlank(bankName)
-            ? bankName
-            : fmt::sprintf("%d/%d", meloMetadata[i]->bankMsb, meloMetadata[i]->bankLsb);
-        }
+  String header = reader.readString(11);
+  if (header == "WOPL3-BANK") {
+    version = reader.readS();
+    bank.version = version;
+    meloBankCount = reader.readS_BE();
+    percBankCount = reader.readS_BE();
+    reader.readC(); // skip chip-global LFO
+    reader.readC(); // skip additional flags
 
-        for (int i = 0; i < percBankCount; ++i) {
-          percMetadata.push_back(new midibank_t);
-          String bankName = reader.readString(32);
-          percMetadata[i]->bankLsb = reader.readC();
-          percMetadata[i]->bankMsb = reader.readC();
-          percMetadata[i]->name = stringNotBlank(bankName)
-            ? bankName
-            : fmt::sprintf("%d/%d", percMetadata[i]->bankMsb, percMetadata[i]->bankLsb);
-        }
-      } else {
-        // TODO do version 1 multibank sets even exist?
-        meloMetadata.push_back(new midibank_t);
-        meloMetadata[0]->bankLsb = 0;
-        meloMetadata[0]->bankMsb = 0;
-        meloMetadata[0]->name = "0/0";
-        percMetadata.push_back(new midibank_t);
-        percMetadata[0]->bankLsb = 0;
-        percMetadata[0]->bankMsb = 0;
-        percMetadata[0]->name = "0/0";
-      }
+    readWoBankMetadata(reader, version, meloBankCount, meloMetadata);
+    readWoBankMetadata(reader, version, percBankCount, percMetadata);
 
-      for (int i = 0; i < meloBankCount; ++i) {
-        for (int j = 0; j < 128; ++j) {
-          doParseWoplInstrument(false, meloMetadata[i], j);
-        }
+    for (int i = 0; i < meloBankCount; ++i) {
+      for (int j = 0; j < 128; ++j) {
+        addPatch(false, meloMetadata[i], j);
       }
-      for (int i = 0; i < percBankCount; ++i) {
-        for (int j = 0; j < 128; ++j) {
-          doParseWoplInstrument(true, percMetadata[i], j);
-        }
+    }
+    for (int i = 0; i < percBankCount; ++i) {
+      for (int j = 0; j < 128; ++j) {
+        addPatch(true, percMetadata[i], j);
       }
     }
-  } catch (EndOfFileException& e) {
-    lastError = "premature end of file";
-    logE("premature end of file");
-    is_failed = true;
   }
+}
+
+static int readWopnOp(SafeReader& reader, DivInstrumentFM::Operator& op) {
+  uint8_t dtMul = reader.readC();
+  uint8_t totalLevel = reader.readC();
+  uint8_t arRateScale = reader.readC();
+  uint8_t drAmpEnable = reader.readC();
+  uint8_t d2r = reader.readC();
+  uint8_t susRelease = reader.readC();
+  uint8_t ssgEg = reader.readC();
+  int total = 0;
+
+  total += (op.mult = dtMul & 0xF);
+  total += (op.dt = ((dtMul >> 4) & 0x7));
+  total += (op.tl = totalLevel & 0x7F);
+  total += (op.rs = ((arRateScale >> 6) & 0x3));
+  total += (op.ar = arRateScale & 0x1F);
+  total += (op.dr = drAmpEnable & 0x1F);
+  total += (op.am = ((drAmpEnable >> 7) & 0x1));
+  total += (op.d2r = d2r & 0x1F);
+  total += (op.rr = susRelease & 0xF);
+  total += (op.sl = ((susRelease >> 4) & 0xF));
+  total += (op.ssgEnv = ssgEg);
+  return total;
+}
+
+// returns 0 if the patch is blank.
+static long readWopnPatch(SafeReader& reader, int version, DivInstrumentFM& fm, String& insName) {
+  fm.ops = 4;
 
-  for (midibank_t* m : meloMetadata) {
-    delete m;
+  // Establish if it is a blank instrument.
+  insName = reader.readString(32);
+  long patchSum = insName.size();
+
+  // TODO adapt MIDI key offset to transpose?
+  if (!reader.seek(3, SEEK_CUR)) {  // skip MIDI params
+    throw EndOfFileException(&reader, reader.tell() + 3);
   }
-  for (midibank_t* m : percMetadata) {
-    delete m;
+  uint8_t feedAlgo = reader.readC();
+  patchSum += feedAlgo;
+  fm.alg = (feedAlgo & 0x7);
+  fm.fb = ((feedAlgo >> 3) & 0x7);
+  patchSum += reader.readC();  // Skip global bank flags - see WOPN/OPNI spec
+
+  for (int i = 0; i < 4; ++i) {
+    patchSum += readWopnOp(reader, fm.op[i]);
   }
 
-  if (is_failed) {
-    for (DivInstrument* p : insList) {
-      delete p;
-    }
-  } else {
-    for (DivInstrument* p : insList) {
-      ret.push_back(p);
-    }
+  if (version >= 2) {
+    reader.readS_BE(); // skip keyon delay
+    reader.readS_BE(); // skip keyoff delay
   }
+  return patchSum;
 }
 
-void DivEngine::loadWOPN(SafeReader& reader, std::vector<DivInstrument*>& ret, String& stripPath) {
-  std::vector<DivInstrument*> insList;
-  bool is_failed = false;
-
+void DivEngine::indexWOPN(SafeReader& reader, DivInsBank& bank) {
   uint16_t version;
   uint16_t meloBankCount;
   uint16_t percBankCount;
-  std::vector<midibank_t*> meloMetadata;
-  std::vector<midibank_t*> percMetadata;
-
-  auto readWopnOp = [](SafeReader& reader, DivInstrumentFM::Operator& op) {
-    uint8_t dtMul = reader.readC();
-    uint8_t totalLevel = reader.readC();
-    uint8_t arRateScale = reader.readC();
-    uint8_t drAmpEnable = reader.readC();
-    uint8_t d2r = reader.readC();
-    uint8_t susRelease = reader.readC();
-    uint8_t ssgEg = reader.readC();
-    int total = 0;
-
-    total += (op.mult = dtMul & 0xF);
-    total += (op.dt = ((dtMul >> 4) & 0x7));
-    total += (op.tl = totalLevel & 0x7F);
-    total += (op.rs = ((arRateScale >> 6) & 0x3));
-    total += (op.ar = arRateScale & 0x1F);
-    total += (op.dr = drAmpEnable & 0x1F);
-    total += (op.am = ((drAmpEnable >> 7) & 0x1));
-    total += (op.d2r = d2r & 0x1F);
-    total += (op.rr = susRelease & 0xF);
-    total += (op.sl = ((susRelease >> 4) & 0xF));
-    total += (op.ssgEnv = ssgEg);
-    return total;
+  std::vector<midibank_t> meloMetadata;
+  std::vector<midibank_t> percMetadata;
+  DivInstrumentFM fm;
+  String insName;
+
+  auto addPatch = [&](bool isPerc, midibank_t& metadata, int patchNum) {
+    DivInsBankEntry entry;
+    entry.type = DIV_INS_FM;
+    entry.offset = reader.tell();
+    if (readWopnPatch(reader, version, fm, insName) > 0) {
+      // TODO: OPN2BankEditor hardcodes GM1 Melodic patch names which are not included in the bank file......
+      entry.name = stringNotBlank(insName) 
+        ? insName 
+        : fmt::sprintf("%s[%s] %s Patch %d", 
+          bank.stripPath, metadata.name, (isPerc) ? "Drum" : "Melodic", patchNum);
+      bank.entries.push_back(entry);
+    }
+    // empty instruments are skipped
   };
-  auto doParseWopnInstrument = [&](bool isPerc, midibank_t*& metadata, int patchNum) {
-    DivInstrument* ins = new DivInstrument;
-    try {
-      long patchSum = 0;
-      ins->type = DIV_INS_FM;
-      ins->fm.ops = 4;
 
-      // Establish if it is a blank instrument.
-      String insName = reader.readString(32);
-      patchSum += insName.size();
+  reader.seek(0, SEEK_SET);
 
-      // TODO adapt MIDI key offset to transpose?
-      if (!reader.seek(3, SEEK_CUR)) {  // skip MIDI params
-        throw EndOfFileException(&reader, reader.tell() + 3);
-      }
-      uint8_t feedAlgo = reader.readC();
-      patchSum += feedAlgo;
-      ins->fm.alg = (feedAlgo & 0x7);
-      ins->fm.fb = ((feedAlgo >> 3) & 0x7);
-      patchSum += reader.readC();  // Skip global bank flags - see WOPN/OPNI spec
+  String header = reader.readString(11);
+  if (header == "WOPN2-BANK" || header == "WOPN2-B2NK") {  // omfg >_<
+    version = reader.readS();
+    if (!(version >= 2) || version > 0xF) {
+      // version 1 doesn't have a version field........
+      reader.seek(-2, SEEK_CUR);
+      version = 1;
+    }
+    bank.version = version;
 
-      for (int i = 0; i < 4; ++i) {
-        patchSum += readWopnOp(reader, ins->fm.op[i]);
-      }
+    meloBankCount = reader.readS_BE();
+    percBankCount = reader.readS_BE();
+    reader.readC(); // skip chip-global LFO
 
-      if (version >= 2) {
-        reader.readS_BE(); // skip keyon delay
-        reader.readS_BE(); // skip keyoff delay
-      }
+    readWoBankMetadata(reader, version, meloBankCount, meloMetadata);
+    readWoBankMetadata(reader, version, percBankCount, percMetadata);
 
-      if (patchSum > 0) {
-        // Write instrument
-        // TODO: OPN2BankEditor hardcodes GM1 Melodic patch names which are not included in the bank file......
-        ins->name = stringNotBlank(insName) 
-          ? insName 
-          : fmt::sprintf("%s[%s] %s Patch %d", 
-            stripPath, metadata->name, (isPerc) ? "Drum" : "Melodic", patchNum);
-        insList.push_back(ins);
-      } else {
-        // Empty instrument
-        delete ins;
+    for (int i = 0; i < meloBankCount; ++i) {
+      for (int j = 0; j < 128; ++j) {
+        addPatch(false, meloMetadata[i], j);
       }
-    } catch (...) {
-      // Deallocate and allow outer handler to do the rest.
-      delete ins;
-      throw;
     }
-  };
-
-  try {
-    reader.seek(0, SEEK_SET);
-
-    String header = reader.readString(11);
-    if (header == "WOPN2-BANK" || header == "WOPN2-B2NK") {  // omfg >_<
-      version = reader.readS();
-      if (!(version >= 2) || version > 0xF) {
-        // version 1 doesn't have a version field........
-        reader.seek(-2, SEEK_CUR);
-        version = 1;
+    for (int i = 0; i < percBankCount; ++i) {
+      for (int j = 0; j < 128; ++j) {
+        addPatch(true, percMetadata[i], j);
       }
+    }
+  }
+}
 
-      meloBankCount = reader.readS_BE();
-      percBankCount = reader.readS_BE();
-      reader.readC(); // skip chip-global LFO
-
-      if (version >= 2) {
-        for (int i = 0; i < meloBankCount; ++i) {
-          meloMetadata.push_back(new midibank_t);
-          String bankName = reader.readString(32);
-          meloMetadata[i]->bankLsb = reader.readC();
-          meloMetadata[i]->bankMsb = reader.readC();
-          meloMetadata[i]->name = stringNotBlank(bankName)
-            ? bankName
-            : fmt::sprintf("%d/%d", meloMetadata[i]->bankMsb, meloMetadata[i]->bankLsb);
-        }
-
-        for (int i = 0; i < percBankCount; ++i) {
-          percMetadata.push_back(new midibank_t);
-          String bankName = reader.readString(32);
-          percMetadata[i]->bankLsb = reader.readC();
-          percMetadata[i]->bankMsb = reader.readC();
-          percMetadata[i]->name = stringNotBlank(bankName)
-            ? bankName
-            : fmt::sprintf("%d/%d", percMetadata[i]->bankMsb, percMetadata[i]->bankLsb);
+// decodes an instrument from an indexed bank. throws on error.
+static DivInstrument* decodeBankEntry(SafeReader& reader, DivInsBank& bank, DivInsBankEntry& entry) {
+  if (!reader.seek(entry.offset, SEEK_SET)) {
+    throw EndOfFileException(&reader, entry.offset);
+  }
+  DivInstrument* ins=new DivInstrument;
+  ins->type=entry.type;
+  ins->name=entry.name;
+  try {
+    switch (bank.format) {
+      case DIV_INSFORMAT_BNK:
+        readBnkPatch(reader,ins->fm);
+        break;
+      case DIV_INSFORMAT_GYB:
+        readGybPatch(reader,entry.param!=0,ins->fm);
+        break;
+      case DIV_INSFORMAT_OPM: {
+        String name;
+        size_t start=0;
+        bool started=false;
+        if (!readOpmPatch(reader,bank.stripPath,name,ins->fm,start,started)) {
+          throw EndOfFileException(&reader,reader.size());
         }
-      } else {
-        // TODO do version 1 multibank sets even exist?
-        meloMetadata.push_back(new midibank_t);
-        meloMetadata[0]->bankLsb = 0;
-        meloMetadata[0]->bankMsb = 0;
-        meloMetadata[0]->name = "0/0";
-        percMetadata.push_back(new midibank_t);
-        percMetadata[0]->bankLsb = 0;
-        percMetadata[0]->bankMsb = 0;
-        percMetadata[0]->name = "0/0";
+        break;
       }
-
-      for (int i = 0; i < meloBankCount; ++i) {
-        for (int j = 0; j < 128; ++j) {
-          doParseWopnInstrument(false, meloMetadata[i], j);
-        }
+      case DIV_INSFORMAT_WOPL: {
+        woplpatch_t patch;
+        readWoplPatch(reader,bank.version,patch);
+        ins->fm=patch.fm[entry.param&1];
+        break;
       }
-      for (int i = 0; i < percBankCount; ++i) {
-        for (int j = 0; j < 128; ++j) {
-          doParseWopnInstrument(true, percMetadata[i], j);
-        }
+      case DIV_INSFORMAT_WOPN: {
+        String name;
+        readWopnPatch(reader,bank.version,ins->fm,name);
+        break;
       }
+      default:
+        break;
+    }
+  } catch (...) {
+    delete ins;
+    throw;
+  }
+  return ins;
+}
+
+bool DivEngine::indexInsBankData(SafeReader& reader, DivInsBank& bank) {
+  try {
+    switch (bank.format) {
+      case DIV_INSFORMAT_BNK:
+        indexBNK(reader,bank);
+        break;
+      case DIV_INSFORMAT_GYB:
+        indexGYB(reader,bank);
+        break;
+      case DIV_INSFORMAT_OPM:
+        indexOPM(reader,bank);
+        break;
+      case DIV_INSFORMAT_WOPL:
+        indexWOPL(reader,bank);
+        break;
+      case DIV_INSFORMAT_WOPN:
+        indexWOPN(reader,bank);
+        break;
+      default:
+        lastError="not an instrument bank";
+        return false;
     }
   } catch (EndOfFileException& e) {
-    lastError = "premature end of file";
+    lastError="premature end of file";
     logE("premature end of file");
-    is_failed = true;
+    bank.entries.clear();
+    return false;
+  } catch (std::invalid_argument& e) {
+    lastError=fmt::sprintf("Invalid value found in patch file. %s",e.what());
+    logE("Invalid value found in patch file.");
+    logE(e.what());
+    bank.entries.clear();
+    return false;
   }
+  return true;
+}
 
-  for (midibank_t* m : meloMetadata) {
-    delete m;
-  }
-  for (midibank_t* m : percMetadata) {
-    delete m;
-  }
+void DivEngine::loadInsBank(SafeReader& reader, DivInsFormats format, std::vector<DivInstrument*>& ret, String& stripPath) {
+  DivInsBank bank;
+  bank.format=format;
+  bank.stripPath=stripPath;
+  if (!indexInsBankData(reader,bank)) return;
 
-  if (is_failed) {
-    for (DivInstrument* p : insList) {
-      delete p;
+  // decoding moves the reader around, so put it back where indexing stopped afterwards
+  size_t endPos=reader.tell();
+  std::vector<DivInstrument*> insList;
+  try {
+    for (DivInsBankEntry& i: bank.entries) {
+      insList.push_back(decodeBankEntry(reader,bank,i));
     }
-  } else {
-    for (DivInstrument* p : insList) {
-      ret.push_back(p);
+  } catch (EndOfFileException& e) {
+    lastError="premature end of file";
+    logE("premature end of file");
+    for (DivInstrument* i: insList) {
+      delete i;
     }
+    return;
   }
-}
-
-std::vector<DivInstrument*> DivEngine::instrumentFromFile(const char* path, bool loadAssets) {
-  std::vector<DivInstrument*> ret;
-  warnings="";
+  reader.seek(endPos,SEEK_SET);
 
-  const char* pathRedux=strrchr(path,DIR_SEPARATOR);
-  if (pathRedux==NULL) {
-    pathRedux=path;
-  } else {
-    pathRedux++;
-  }
-  String stripPath;
-  const char* pathReduxEnd=strrchr(pathRedux,'.');
-  if (pathReduxEnd==NULL) {
-    stripPath=pathRedux;
-  } else {
-    for (const char* i=pathRedux; i!=pathReduxEnd && (*i); i++) {
-      stripPath+=*i;
-    }
+  for (DivInstrument* i: insList) {
+    ret.push_back(i);
   }
+}
 
+// reads an entire instrument file into a new buffer.
+static unsigned char* readInsFile(const char* path, ssize_t& len, String& error) {
   FILE* f=ps_fopen(path,"rb");
   if (f==NULL) {
-    lastError=strerror(errno);
-    return ret;
+    error=strerror(errno);
+    return NULL;
   }
   unsigned char* buf;
-  ssize_t len;
   if (fseek(f,0,SEEK_END)!=0) {
-    lastError=strerror(errno);
+    error=strerror(errno);
     fclose(f);
-    return ret;
+    return NULL;
   }
   len=ftell(f);
   if (len<0) {
-    lastError=strerror(errno);
+    error=strerror(errno);
     fclose(f);
-    return ret;
+    return NULL;
   }
   if (len==(SIZE_MAX>>1)) {
-    lastError=strerror(errno);
+    error=strerror(errno);
     fclose(f);
-    return ret;
+    return NULL;
   }
   if (len==0) {
-    lastError=strerror(errno);
+    error=strerror(errno);
     fclose(f);
-    return ret;
+    return NULL;
   }
   if (fseek(f,0,SEEK_SET)!=0) {
-    lastError=strerror(errno);
+    error=strerror(errno);
     fclose(f);
-    return ret;
+    return NULL;
   }
   buf=new unsigned char[len];
   if (fread(buf,1,len,f)!=(size_t)len) {
     logW("did not read entire instrument file buffer!");
-    lastError="did not read entire instrument file!";
+    error="did not read entire instrument file!";
     delete[] buf;
-    return ret;
+    fclose(f);
+    return NULL;
   }
   fclose(f);
+  return buf;
+}
+
+// file name without directory and extension
+static String insStripPath(const char* path) {
+  const char* pathRedux=strrchr(path,DIR_SEPARATOR);
+  if (pathRedux==NULL) {
+    pathRedux=path;
+  } else {
+    pathRedux++;
+  }
+  String stripPath;
+  const char* pathReduxEnd=strrchr(pathRedux,'.');
+  if (pathReduxEnd==NULL) {
+    stripPath=pathRedux;
+  } else {
+    for (const char* i=pathRedux; i!=pathReduxEnd && (*i); i++) {
+      stripPath+=*i;
+    }
+  }
+  return stripPath;
+}
+
+// guess the instrument format from the extension.
+// returns false if unknown. files without extension are assumed to be DMP.
+static bool insFormatFromPath(const char* path, DivInsFormats& format) {
+  const char* ext=strrchr(path,'.');
+  format=DIV_INSFORMAT_DMP;
+  if (ext==NULL) return true;
+
+  String extS;
+  for (; *ext; ext++) {
+    char i=*ext;
+    if (i>='A' && i<='Z') {
+      i+='a'-'A';
+    }
+    extS+=i;
+  }
+  if (extS==".dmp") {
+    format=DIV_INSFORMAT_DMP;
+  } else if (extS==".tfi") {
+    format=DIV_INSFORMAT_TFI;
+  } else if (extS==".vgi") {
+    format=DIV_INSFORMAT_VGI;
+  } else if (extS==".fti") {
+    format=DIV_INSFORMAT_FTI;
+  } else if (extS==".bti") {
+    format=DIV_INSFORMAT_BTI;
+  } else if (extS==".s3i") {
+    format=DIV_INSFORMAT_S3I;
+  } else if (extS==".sbi") {
+    format=DIV_INSFORMAT_SBI;
+  } else if (extS==".opli") {
+    format=DIV_INSFORMAT_OPLI;
+  } else if (extS==".opni") {
+    format=DIV_INSFORMAT_OPNI;
+  } else if (extS==".y12") {
+    format=DIV_INSFORMAT_Y12;
+  } else if (extS==".bnk") {
+    format=DIV_INSFORMAT_BNK;
+  } else if (extS==".gyb") {
+    format=DIV_INSFORMAT_GYB;
+  } else if (extS==".opm") {
+    format=DIV_INSFORMAT_OPM;
+  } else if (extS==".ff") {
+    format=DIV_INSFORMAT_FF;
+  } else if (extS==".wopl") {
+    format=DIV_INSFORMAT_WOPL;
+  } else if (extS==".wopn") {
+    format=DIV_INSFORMAT_WOPN;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+DivInsBank* DivEngine::indexInsBank(const char* path) {
+  DivInsFormats format;
+  if (!insFormatFromPath(path,format)) {
+    lastError="unknown instrument format";
+    return NULL;
+  }
+  switch (format) {
+    case DIV_INSFORMAT_BNK:
+    case DIV_INSFORMAT_GYB:
+    case DIV_INSFORMAT_OPM:
+    case DIV_INSFORMAT_WOPL:
+    case DIV_INSFORMAT_WOPN:
+      break;
+    default:
+      lastError="not an instrument bank";
+      return NULL;
+  }
+
+  ssize_t len=0;
+  unsigned char* buf=readInsFile(path,len,lastError);
+  if (buf==NULL) return NULL;
+
+  DivInsBank* bank=new DivInsBank;
+  bank->stripPath=insStripPath(path);
+  bank->format=format;
+  bank->data=buf;
+  bank->len=len;
+
+  warnings="";
+  SafeReader reader=SafeReader(buf,len);
+  if (!indexInsBankData(reader,*bank)) {
+    delete bank;
+    return NULL;
+  }
+  return bank;
+}
+
+DivInstrument* DivEngine::instrumentFromBank(DivInsBank* bank, int index) {
+  if (bank==NULL || bank->data==NULL) {
+    lastError="invalid bank";
+    return NULL;
+  }
+  if (index<0 || index>=(int)bank->entries.size()) {
+    lastError="invalid bank entry";
+    return NULL;
+  }
+  SafeReader reader=SafeReader(bank->data,bank->len);
+  try {
+    return decodeBankEntry(reader,*bank,bank->entries[index]);
+  } catch (EndOfFileException& e) {
+    lastError="premature end of file";
+    logE("premature end of file");
+  }
+  return NULL;
+}
+
+std::vector<DivInstrument*> DivEngine::instrumentFromFile(const char* path, bool loadAssets) {
+  std::vector<DivInstrument*> ret;
+  warnings="";
+
+  String stripPath=insStripPath(path);
+
+  ssize_t len=0;
+  unsigned char* buf=readInsFile(path,len,lastError);
+  if (buf==NULL) {
+    return ret;
+  }
 
   SafeReader reader=SafeReader(buf,len);
 
@@ -1937,55 +2006,12 @@ std::vector<DivInstrument*> DivEngine::instrumentFromFile(const char* path, bool
       return ret;
     }
   } else { // read as a different format
-    const char* ext=strrchr(path,'.');
     DivInsFormats format=DIV_INSFORMAT_DMP;
-    if (ext!=NULL) {
-      String extS;
-      for (; *ext; ext++) {
-        char i=*ext;
-        if (i>='A' && i<='Z') {
-          i+='a'-'A';
-        }
-        extS+=i;
-      }
-      if (extS==".dmp") {
-        format=DIV_INSFORMAT_DMP;
-      } else if (extS==".tfi") {
-        format=DIV_INSFORMAT_TFI;
-      } else if (extS==".vgi") {
-        format=DIV_INSFORMAT_VGI;
-      } else if (extS==".fti") {
-        format=DIV_INSFORMAT_FTI;
-      } else if (extS==".bti") {
-        format=DIV_INSFORMAT_BTI;
-      } else if (extS==".s3i") {
-        format=DIV_INSFORMAT_S3I;
-      } else if (extS==".sbi") {
-        format=DIV_INSFORMAT_SBI;
-      } else if (extS==".opli") {
-        format=DIV_INSFORMAT_OPLI;
-      } else if (extS==".opni") {
-        format=DIV_INSFORMAT_OPNI;
-      } else if (extS==".y12") {
-        format=DIV_INSFORMAT_Y12;
-      } else if (extS==".bnk") {
-        format=DIV_INSFORMAT_BNK;
-      } else if (extS==".gyb") {
-        format=DIV_INSFORMAT_GYB;
-      } else if (extS==".opm") {
-        format=DIV_INSFORMAT_OPM;
-      } else if (extS==".ff") {
-        format=DIV_INSFORMAT_FF;
-      } else if (extS==".wopl") {
-        format=DIV_INSFORMAT_WOPL;
-      } else if (extS==".wopn") {
-        format=DIV_INSFORMAT_WOPN;
-      } else {
-        // unknown format
-        lastError="unknown instrument format";
-        delete[] buf;
-        return ret;
-      }
+    if (!insFormatFromPath(path,format)) {
+      // unknown format
+      lastError="unknown instrument format";
+      delete[] buf;
+      return ret;
     }
 
     switch (format) {
@@ -2018,22 +2044,22 @@ std::vector<DivInstrument*> DivEngine::instrumentFromFile(const char* path, bool
         loadY12(reader,ret,stripPath);
         break;
       case DIV_INSFORMAT_BNK:
-        loadBNK(reader,ret,stripPath);
+        loadInsBank(reader,DIV_INSFORMAT_BNK,ret,stripPath);
         break;
       case DIV_INSFORMAT_FF:
         loadFF(reader,ret,stripPath);
         break;
       case DIV_INSFORMAT_GYB:
-        loadGYB(reader,ret,stripPath);
+        loadInsBank(reader,DIV_INSFORMAT_GYB,ret,stripPath);
         break;
       case DIV_INSFORMAT_OPM:
-        loadOPM(reader,ret,stripPath);
+        loadInsBank(reader,DIV_INSFORMAT_OPM,ret,stripPath);
         break;
       case DIV_INSFORMAT_WOPL:
-        loadWOPL(reader,ret,stripPath);
+        loadInsBank(reader,DIV_INSFORMAT_WOPL,ret,stripPath);
         break;
       case DIV_INSFORMAT_WOPN:
-        loadWOPN(reader,ret,stripPath);
+        loadInsBank(reader,DIV_INSFORMAT_WOPN,ret,stripPath);
         break;
     }
 
@@ -21,15 +21,21 @@
 #include <math.h>
 #include "filter.h"
 #include "../ta-log.h"
+#include <mutex>
 
 float* DivFilterTables::cubicTable=NULL;
 float* DivFilterTables::sincTable=NULL;
 float* DivFilterTables::sincIntegralTable=NULL;
 
+// tables are shared by all engines and may be requested from several threads.
+static std::once_flag cubicTableOnce;
+static std::once_flag sincTableOnce;
+static std::once_flag sincIntegralTableOnce;
+
 // portions from Schism Tracker (scripts/lutgen.c)
 // licensed under same license as this program.
 float* DivFilterTables::getCubicTable() {
-  if (cubicTable==NULL) {
+  std::call_once(cubicTableOnce,[]() {
     logD("initializing cubic spline table.");
     cubicTable=new float[4096];
 
@@ -40,12 +46,12 @@ float* DivFilterTables::getCubicTable() {
       cubicTable[2+(i<<2)]=-1.5*pow(x,3)+2.0*pow(x,2)+0.5*x;
       cubicTable[3+(i<<2)]=0.5*pow(x,3)-0.5*pow(x,2);
     }
-  }
+  });
   return cubicTable;
 }
 
 float* DivFilterTables:: getSincTable() {
-  if (sincTable==NULL) {
+  std::call_once(sincTableOnce,[]() {
     logD("initializing sinc table.");
     sincTable=new float[65536];
 
@@ -60,12 +66,12 @@ float* DivFilterTables:: getSincTable() {
       int mapped=((i&8191)<<3)|(i>>13);
       sincTable[mapped]*=pow(cos(M_PI*(double)i/131072.0),2.0);
     }
-  }
+  });
   return sincTable;
 }
 
 float* DivFilterTables::getSincIntegralTable() {
-  if (sincIntegralTable==NULL) {
+  std::call_once(sincIntegralTableOnce,[]() {
     logD("initializing sinc integral table.");
     sincIntegralTable=new float[65536];
 
@@ -82,6 +88,6 @@ float* DivFilterTables::getSincIntegralTable() {
       int mapped=((i&8191)<<3)|(i>>13);
       sincIntegralTable[mapped]*=pow(cos(M_PI*(double)i/131072.0),2.0);
     }
-  }
+  });
   return sincIntegralTable;
 }
@@ -0,0 +1,229 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "engine.h"
+#include "../ta-log.h"
+
+bool DivEngine::recordExportPass(DivExportPass& pass, bool ownsAudio) {
+  stop();
+  repeatPattern=false;
+  shallStop=false;
+  setOrder(0);
+  BUSY_BEGIN_SOFT;
+  double origRate=got.rate;
+  got.rate=pass.rate;
+
+  // determine loop point
+  walkSong(pass.loopOrder,pass.loopRow,pass.loopEnd);
+  logI("loop point: %d %d",pass.loopOrder,pass.loopRow);
+  warnings="";
+
+  pass.ticks.clear();
+  pass.writes.clear();
+  pass.writeChip.clear();
+  pass.cmds.clear();
+
+  curOrder=0;
+  freelance=false;
+  playing=false;
+  extValuePresent=false;
+  remainingLoops=-1;
+
+  // the exporters pick the chips they want
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].dispatch->toggleRegisterDump(true);
+  }
+  playSub(false);
+
+  // writes made while resetting the chips
+  for (int i=0; i<song.systemLen; i++) {
+    std::vector<DivRegWrite>& writes=disCont[i].dispatch->getRegisterWrites();
+    for (DivRegWrite& j: writes) {
+      pass.writes.push_back(j);
+      pass.writeChip.push_back(i);
+    }
+    writes.clear();
+  }
+  pass.resetWrites=pass.writes.size();
+
+  bool oldCmdStreamEnabled=cmdStreamEnabled;
+  cmdStream.clear();
+  cmdStreamEnabled=true;
+
+  bool done=false;
+  bool aborted=false;
+  while (!done) {
+    if (ownsAudio) {
+      // nothing else plays, so only let edits and haltAudioFile() in between ticks
+      BUSY_END;
+      BUSY_BEGIN_SOFT;
+      if (stopExport) {
+        aborted=true;
+        break;
+      }
+    }
+    DivExportTick t;
+    // the reset writes belong to the first tick
+    t.writeStart=pass.ticks.empty()?0:pass.writes.size();
+    runExportTick(t);
+    if (t.songEnd) done=true;
+
+    for (int i=0; i<song.systemLen; i++) {
+      std::vector<DivRegWrite>& writes=disCont[i].dispatch->getRegisterWrites();
+      for (DivRegWrite& j: writes) {
+        pass.writes.push_back(j);
+        pass.writeChip.push_back(i);
+      }
+      writes.clear();
+    }
+    t.writeEnd=pass.writes.size();
+
+    t.cmdStart=pass.cmds.size();
+    for (DivCommand& j: cmdStream) {
+      pass.cmds.push_back(j);
+    }
+    cmdStream.clear();
+    t.cmdEnd=pass.cmds.size();
+
+    pass.ticks.push_back(t);
+  }
+  cmdStreamEnabled=oldCmdStreamEnabled;
+
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].dispatch->toggleRegisterDump(false);
+  }
+  got.rate=origRate;
+
+  remainingLoops=-1;
+  playing=false;
+  freelance=false;
+  extValuePresent=false;
+  BUSY_END;
+
+  if (aborted) {
+    logI("export pass aborted.");
+    lastError="export aborted";
+    return false;
+  }
+
+  logI("export pass: %d ticks, %d register writes, %d commands",(int)pass.ticks.size(),(int)pass.writes.size(),(int)pass.cmds.size());
+  return true;
+}
+
+bool DivEngine::saveMulti(DivMultiExport& ex) {
+  return doSaveMulti(ex,false);
+}
+
+void DivEngine::runMultiExportThread() {
+  // take control of audio output
+  deinitAudioBackend();
+
+  doSaveMulti(*multiExport,true);
+  multiExport=NULL;
+  exporting=false;
+
+  if (initAudioBackend()) {
+    for (int i=0; i<song.systemLen; i++) {
+      disCont[i].setRates(got.rate);
+      disCont[i].setQuality(lowQuality);
+    }
+    if (!output->setRun(true)) {
+      logE("error while activating audio!");
+    }
+  }
+  logI("done!");
+}
+
+bool DivEngine::saveMultiAsync(DivMultiExport* ex) {
+  if (ex==NULL) return false;
+  // the previous export thread may not have been collected
+  waitAudioFile();
+  multiExport=ex;
+  exporting=true;
+  stopExport=false;
+  exportThread=new std::thread([this]() {
+    runMultiExportThread();
+  });
+  return true;
+}
+
+bool DivEngine::doSaveMulti(DivMultiExport& ex, bool ownsAudio) {
+  ex.vgmOut=NULL;
+  ex.zsmOut=NULL;
+  ex.cmdOut=NULL;
+  if (ex.vgm && ex.vgmVersion<0x150) {
+    lastError="VGM version is too low";
+    return false;
+  }
+
+  // VGM output may be cached already
+  String vgmKey;
+  bool vgmCached=false;
+  if (ex.vgm) {
+    vgmKey=vgmCacheKey(ex.vgmSysToExport,ex.vgmLoop,ex.vgmVersion,ex.vgmPatternHints,false,ex.vgmOptimize);
+    ex.vgmOut=renderCacheGet(vgmKey);
+    vgmCached=(ex.vgmOut!=NULL);
+  }
+  if (vgmCached && !ex.zsm && !ex.cmd) return true;
+
+  DivExportPass pass;
+  if (!recordExportPass(pass,ownsAudio)) return false;
+
+  // the pass is only read from now on, and the engine is free again
+  std::thread* vgmThread=NULL;
+  std::thread* zsmThread=NULL;
+  std::thread* cmdThread=NULL;
+  if (ex.vgm && !vgmCached) {
+    vgmThread=new std::thread([this,&ex,&pass]() {
+      ex.vgmOut=saveVGM(ex.vgmSysToExport,ex.vgmLoop,ex.vgmVersion,ex.vgmPatternHints,false,ex.vgmOptimize,&pass);
+    });
+  }
+  if (ex.zsm) {
+    zsmThread=new std::thread([this,&ex,&pass]() {
+      ex.zsmOut=saveZSM(ex.zsmRate,ex.zsmLoop,&pass);
+    });
+  }
+  if (ex.cmd) {
+    cmdThread=new std::thread([this,&ex,&pass]() {
+      ex.cmdOut=saveCommand(ex.cmdBinary,&pass,ex.cmdCompress);
+    });
+  }
+
+  if (vgmThread!=NULL) {
+    vgmThread->join();
+    delete vgmThread;
+    if (ex.vgmOut!=NULL) {
+      renderCachePut(vgmKey,ex.vgmOut->getFinalBuf(),ex.vgmOut->size());
+    }
+  }
+  if (zsmThread!=NULL) {
+    zsmThread->join();
+    delete zsmThread;
+  }
+  if (cmdThread!=NULL) {
+    cmdThread->join();
+    delete cmdThread;
+  }
+
+  bool ret=true;
+  if (ex.vgm && ex.vgmOut==NULL) ret=false;
+  if (ex.zsm && ex.zsmOut==NULL) ret=false;
+  if (ex.cmd && ex.cmdOut==NULL) ret=false;
+  return ret;
+}
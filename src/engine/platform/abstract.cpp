@@ -22,6 +22,31 @@
 void DivDispatch::acquire(short* bufL, short* bufR, size_t start, size_t len) {
 }
 
+void DivDispatch::acquireRun(short* bufL, short* bufR, size_t start, size_t len) {
+}
+
+size_t DivDispatch::applyDueWrites() {
+  return 0;
+}
+
+void DivDispatch::acquireBlocks(short* bufL, short* bufR, size_t start, size_t len) {
+  size_t pos=start;
+  size_t end=start+len;
+  while (pos<end) {
+    size_t run=applyDueWrites();
+    if (run==0 || run>end-pos) run=end-pos;
+    acquireRun(bufL,bufR,pos,run);
+    pos+=run;
+  }
+}
+
+bool DivDispatch::hasEdgeOutput() {
+  return false;
+}
+
+void DivDispatch::acquireEdges(std::vector<DivDispatchEdge>& edges, size_t start, size_t len) {
+}
+
 void DivDispatch::fillStream(std::vector<DivDelayedWrite>& stream, int sRate, size_t len) {
 }
 
@@ -112,6 +137,10 @@ void DivDispatch::setSkipRegisterWrites(bool value) {
   skipRegisterWrites=value;
 }
 
+void DivDispatch::setCaptureOsc(bool value) {
+  captureOsc=value;
+}
+
 void DivDispatch::notifyInsChange(int ins) {
 
 }
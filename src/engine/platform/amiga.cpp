@@ -20,6 +20,7 @@
 #define _USE_MATH_DEFINES
 #include "amiga.h"
 #include "../engine.h"
+#include "pcmVoice.h"
 #include <math.h>
 
 #define AMIGA_DIVIDER 8
@@ -75,55 +76,131 @@ const char** DivPlatformAmiga::getRegisterSheet() {
     if (chan[i+1].freq<AMIGA_DIVIDER) chan[i+1].freq=AMIGA_DIVIDER; \
   }
 
+// advances a channel by one sample, fetching the next sample if it's due.
+void DivPlatformAmiga::stepVoice(int i) {
+  if (chan[i].useWave || (chan[i].sample>=0 && chan[i].sample<parent->song.sampleLen)) {
+    chan[i].audSub-=AMIGA_DIVIDER;
+    if (chan[i].audSub<0) {
+      if (chan[i].useWave) {
+        writeAudDat(chan[i].ws.output[chan[i].audPos++]^0x80);
+        if (chan[i].audPos>=(unsigned int)(chan[i].audLen<<1)) {
+          chan[i].audPos=0;
+        }
+      } else {
+        DivSample* s=parent->getSample(chan[i].sample);
+        if (s->samples>0) {
+          if (chan[i].audPos<s->samples) {
+            writeAudDat(s->data8[chan[i].audPos++]);
+          }
+          if (s->isLoopable() && chan[i].audPos>=MIN(131071,(unsigned int)s->loopEnd)) {
+            chan[i].audPos=s->loopStart;
+          } else if (chan[i].audPos>=MIN(131071,s->samples)) {
+            chan[i].sample=-1;
+          }
+        } else {
+          chan[i].sample=-1;
+        }
+      }
+      /*if (chan[i].freq<124) {
+        if (++chan[i].busClock>=512) {
+          unsigned int rAmount=(124-chan[i].freq)*2;
+          if (chan[i].audPos>=rAmount) {
+            chan[i].audPos-=rAmount;
+          }
+          chan[i].busClock=0;
+        }
+      }*/
+      if (bypassLimits) {
+        chan[i].audSub+=MAX(AMIGA_DIVIDER,chan[i].freq);
+      } else {
+        chan[i].audSub+=MAX(114,chan[i].freq);
+      }
+    }
+  }
+}
+
+#define AMIGA_RUN 256
+
 void DivPlatformAmiga::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int outL, outR, output;
-  for (size_t h=start; h<start+len; h++) {
-    outL=0;
-    outR=0;
+  int mixL[AMIGA_RUN];
+  int mixR[AMIGA_RUN];
+  int output;
+
+  // the volume/period modulation makes channels depend on each other every
+  // sample, so they are rendered together in that case.
+  for (int i=0; i<3; i++) {
+    if (chan[i].useV || chan[i].useP) {
+      acquireModulated(bufL,bufR,start,len);
+      return;
+    }
+  }
+
+  for (size_t h=start; h<start+len; h+=AMIGA_RUN) {
+    size_t runLen=MIN((size_t)AMIGA_RUN,start+len-h);
+    memset(mixL,0,runLen*sizeof(int));
+    memset(mixR,0,runLen*sizeof(int));
+
     for (int i=0; i<4; i++) {
       if (!chan[i].active) {
-        oscBuf[i]->data[oscBuf[i]->needle++]=0;
+        for (size_t j=0; j<runLen; j++) {
+          oscBuf[i]->data[oscBuf[i]->needle++]=0;
+        }
         continue;
       }
-      if (chan[i].useWave || (chan[i].sample>=0 && chan[i].sample<parent->song.sampleLen)) {
-        chan[i].audSub-=AMIGA_DIVIDER;
-        if (chan[i].audSub<0) {
-          if (chan[i].useWave) {
-            writeAudDat(chan[i].ws.output[chan[i].audPos++]^0x80);
-            if (chan[i].audPos>=(unsigned int)(chan[i].audLen<<1)) {
-              chan[i].audPos=0;
-            }
+      const int sepL=(i==0 || i==3)?sep1:sep2;
+      const int sepR=(i==0 || i==3)?sep2:sep1;
+      for (size_t j=0; j<runLen;) {
+        // the output holds until the next sample is fetched
+        size_t n=runLen-j;
+        if (chan[i].useWave || (chan[i].sample>=0 && chan[i].sample<parent->song.sampleLen)) {
+          n=pcmHoldSteps(chan[i].audSub,AMIGA_DIVIDER,n);
+          if (n>0) {
+            chan[i].audSub-=n*AMIGA_DIVIDER;
           } else {
-            DivSample* s=parent->getSample(chan[i].sample);
-            if (s->samples>0) {
-              if (chan[i].audPos<s->samples) {
-                writeAudDat(s->data8[chan[i].audPos++]);
-              }
-              if (s->isLoopable() && chan[i].audPos>=MIN(131071,(unsigned int)s->loopEnd)) {
-                chan[i].audPos=s->loopStart;
-              } else if (chan[i].audPos>=MIN(131071,s->samples)) {
-                chan[i].sample=-1;
-              }
-            } else {
-              chan[i].sample=-1;
-            }
+            stepVoice(i);
+            n=1;
           }
-          /*if (chan[i].freq<124) {
-            if (++chan[i].busClock>=512) {
-              unsigned int rAmount=(124-chan[i].freq)*2;
-              if (chan[i].audPos>=rAmount) {
-                chan[i].audPos-=rAmount;
-              }
-              chan[i].busClock=0;
-            }
-          }*/
-          if (bypassLimits) {
-            chan[i].audSub+=MAX(AMIGA_DIVIDER,chan[i].freq);
-          } else {
-            chan[i].audSub+=MAX(114,chan[i].freq);
+        }
+        if (isMuted[i]) {
+          for (size_t k=j; k<j+n; k++) {
+            oscBuf[i]->data[oscBuf[i]->needle++]=0;
+          }
+        } else {
+          output=chan[i].audDat*chan[i].outVol;
+          const int outL=(output*sepL)>>7;
+          const int outR=(output*sepR)>>7;
+          for (size_t k=j; k<j+n; k++) {
+            mixL[k]+=outL;
+            mixR[k]+=outR;
+            oscBuf[i]->data[oscBuf[i]->needle++]=output<<2;
           }
         }
+        j+=n;
+      }
+    }
+
+    for (size_t j=0; j<runLen; j++) {
+      filter[0][0]+=(filtConst*(mixL[j]-filter[0][0]))>>12;
+      filter[0][1]+=(filtConst*(filter[0][0]-filter[0][1]))>>12;
+      filter[1][0]+=(filtConst*(mixR[j]-filter[1][0]))>>12;
+      filter[1][1]+=(filtConst*(filter[1][0]-filter[1][1]))>>12;
+      bufL[h+j]=filter[0][1];
+      bufR[h+j]=filter[1][1];
+    }
+  }
+}
+
+void DivPlatformAmiga::acquireModulated(short* bufL, short* bufR, size_t start, size_t len) {
+  int outL, outR, output;
+  for (size_t h=start; h<start+len; h++) {
+    outL=0;
+    outR=0;
+    for (int i=0; i<4; i++) {
+      if (!chan[i].active) {
+        oscBuf[i]->data[oscBuf[i]->needle++]=0;
+        continue;
       }
+      stepVoice(i);
       if (!isMuted[i]) {
         output=chan[i].audDat*chan[i].outVol;
         if (i==0 || i==3) {
@@ -25,6 +25,7 @@
 #include "../waveSynth.h"
 
 class DivPlatformAmiga: public DivDispatch {
+  protected:
   struct Channel: public SharedChannel<signed char> {
     unsigned int audLoc;
     unsigned short audLen;
@@ -63,6 +64,9 @@ class DivPlatformAmiga: public DivDispatch {
 
   int sep1, sep2;
 
+  void stepVoice(int i);
+  void acquireModulated(short* bufL, short* bufR, size_t start, size_t len);
+
   friend void putDispatchChip(void*,int);
   friend void putDispatchChan(void*,int,int);
 
@@ -50,18 +50,33 @@ const char** DivPlatformArcade::getRegisterSheet() {
   return regCheatSheetOPM;
 }
 
+// after a data write the OPM is busy for 32 clocks (see OPM_DoIO()), so the
+// next 8 groups of 4 clocks are skipped. an address write doesn't make it
+// busy. the groups are counted instead of polling the busy flag.
+#define OPM_WRITE_WAIT 8
+
 void DivPlatformArcade::acquire_nuked(short* bufL, short* bufR, size_t start, size_t len) {
-  static int o[2];
+  int o[2];
 
   for (size_t h=start; h<start+len; h++) {
-    for (int i=0; i<8; i++) {
-      if (!writes.empty() && !fm.write_busy) {
+    if (writes.empty() || writeWait>=8) {
+      // no write lands in this sample
+      for (int i=0; i<31; i++) {
+        OPM_Clock(&fm,NULL,NULL,NULL,NULL);
+      }
+      OPM_Clock(&fm,o,NULL,NULL,NULL);
+      writeWait=MAX(0,writeWait-8);
+    } else for (int i=0; i<8; i++) {
+      if (writeWait>0) {
+        writeWait--;
+      } else if (!writes.empty()) {
         QueuedWrite& w=writes.front();
         if (w.addrOrVal) {
           OPM_Write(&fm,1,w.val);
           regPool[w.addr&0xff]=w.val;
           //printf("write: %x = %.2x\n",w.addr,w.val);
           writes.pop_front();
+          writeWait=OPM_WRITE_WAIT;
         } else {
           OPM_Write(&fm,0,w.addr);
           w.addrOrVal=true;
@@ -74,7 +89,7 @@ void DivPlatformArcade::acquire_nuked(short* bufL, short* bufR, size_t start, si
       OPM_Clock(&fm,o,NULL,NULL,NULL);
     }
 
-    for (int i=0; i<8; i++) {
+    for (int i=0; i<8 && captureOsc; i++) {
       oscBuf[i]->data[oscBuf[i]->needle++]=fm.ch_out[i];
     }
 
@@ -90,7 +105,7 @@ void DivPlatformArcade::acquire_nuked(short* bufL, short* bufR, size_t start, si
 }
 
 void DivPlatformArcade::acquire_ymfm(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   ymfm::ym2151::fm_engine* fme=fm_ymfm->debug_engine();
 
@@ -109,7 +124,7 @@ void DivPlatformArcade::acquire_ymfm(short* bufL, short* bufR, size_t start, siz
 
     fm_ymfm->generate(&out_ymfm);
 
-    for (int i=0; i<8; i++) {
+    for (int i=0; i<8 && captureOsc; i++) {
       oscBuf[i]->data[oscBuf[i]->needle++]=(fme->debug_channel(i)->debug_output(0)+fme->debug_channel(i)->debug_output(1));
     }
 
@@ -821,6 +836,7 @@ void DivPlatformArcade::reset() {
     memset(&fm,0,sizeof(opm_t));
     OPM_Reset(&fm);
   }
+  writeWait=0;
   if (dumpWrites) {
     addWrite(0xffffffff,0);
   }
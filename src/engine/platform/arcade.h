@@ -52,6 +52,8 @@ class DivPlatformArcade: public DivPlatformOPM {
     DivArcadeInterface iface;
 
     bool useYMFM;
+    // groups of 4 clocks to run before Nuked-OPM accepts the next write
+    int writeWait;
 
     bool isMuted[8];
 
@@ -64,35 +64,53 @@ const char** DivPlatformC64::getRegisterSheet() {
 }
 
 void DivPlatformC64::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  int dcOff=isFP?0:sid.get_dc(0);
+  acquireBlocks(bufL,bufR,start,len);
+}
+
+size_t DivPlatformC64::applyDueWrites() {
+  // one write per sample
+  if (writes.empty()) return 0;
+  QueuedWrite w=writes.front();
+  if (isFP) {
+    sid_fp.write(w.addr,w.val);
+  } else {
+    sid.write(w.addr,w.val);
+  }
+  regPool[w.addr&0x1f]=w.val;
+  writes.pop();
+  return writes.empty()?0:1;
+}
+
+void DivPlatformC64::acquireRun(short* bufL, short* bufR, size_t start, size_t len) {
+  if (isFP) {
+    acquire_fp(bufL,bufR,start,len);
+  } else {
+    acquire_classic(bufL,bufR,start,len);
+  }
+}
+
+void DivPlatformC64::acquire_classic(short* bufL, short* bufR, size_t start, size_t len) {
+  int dcOff=sid.get_dc(0);
   for (size_t i=start; i<start+len; i++) {
-    if (!writes.empty()) {
-      QueuedWrite w=writes.front();
-      if (isFP) {
-        sid_fp.write(w.addr,w.val);
-      } else {
-        sid.write(w.addr,w.val);
-      };
-      regPool[w.addr&0x1f]=w.val;
-      writes.pop();
+    sid.clock();
+    bufL[i]=sid.output();
+    if (captureOsc && ++writeOscBuf>=16) {
+      writeOscBuf=0;
+      oscBuf[0]->data[oscBuf[0]->needle++]=(sid.last_chan_out[0]-dcOff)>>5;
+      oscBuf[1]->data[oscBuf[1]->needle++]=(sid.last_chan_out[1]-dcOff)>>5;
+      oscBuf[2]->data[oscBuf[2]->needle++]=(sid.last_chan_out[2]-dcOff)>>5;
     }
-    if (isFP) {
-      sid_fp.clock(4,&bufL[i]);
-      if (++writeOscBuf>=4) {
-        writeOscBuf=0;
-        oscBuf[0]->data[oscBuf[0]->needle++]=(sid_fp.lastChanOut[0]-dcOff)>>5;
-        oscBuf[1]->data[oscBuf[1]->needle++]=(sid_fp.lastChanOut[1]-dcOff)>>5;
-        oscBuf[2]->data[oscBuf[2]->needle++]=(sid_fp.lastChanOut[2]-dcOff)>>5;
-      }
-    } else {
-      sid.clock();
-      bufL[i]=sid.output();
-      if (++writeOscBuf>=16) {
-        writeOscBuf=0;
-        oscBuf[0]->data[oscBuf[0]->needle++]=(sid.last_chan_out[0]-dcOff)>>5;
-        oscBuf[1]->data[oscBuf[1]->needle++]=(sid.last_chan_out[1]-dcOff)>>5;
-        oscBuf[2]->data[oscBuf[2]->needle++]=(sid.last_chan_out[2]-dcOff)>>5;
-      }
+  }
+}
+
+void DivPlatformC64::acquire_fp(short* bufL, short* bufR, size_t start, size_t len) {
+  for (size_t i=start; i<start+len; i++) {
+    sid_fp.clock(4,&bufL[i]);
+    if (captureOsc && ++writeOscBuf>=4) {
+      writeOscBuf=0;
+      oscBuf[0]->data[oscBuf[0]->needle++]=sid_fp.lastChanOut[0]>>5;
+      oscBuf[1]->data[oscBuf[1]->needle++]=sid_fp.lastChanOut[1]>>5;
+      oscBuf[2]->data[oscBuf[2]->needle++]=sid_fp.lastChanOut[2]>>5;
     }
   }
 }
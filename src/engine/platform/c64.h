@@ -80,6 +80,8 @@ class DivPlatformC64: public DivDispatch {
   void updateFilter();
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
+    void acquireRun(short* bufL, short* bufR, size_t start, size_t len);
+    size_t applyDueWrites();
     int dispatch(DivCommand c);
     void* getChanState(int chan);
     DivDispatchOscBuffer* getOscBuffer(int chan);
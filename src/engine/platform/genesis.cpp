@@ -132,17 +132,24 @@ void DivPlatformGenesis::processDAC(int iRate) {
   }
 }
 
+// after a data write the OPN2 is busy for 32 clocks (see OPN2_DoIO()), so
+// the next write is held back for 32 clocks. an address write doesn't make
+// it busy. the clocks are counted instead of polling the busy flag.
+#define OPN2_WRITE_WAIT 32
+
 void DivPlatformGenesis::acquire_nuked(short* bufL, short* bufR, size_t start, size_t len) {
-  static short o[2];
-  static int os[2];
+  short o[2];
+  int os[2];
 
   for (size_t h=start; h<start+len; h++) {
     processDAC(rate);
 
     os[0]=0; os[1]=0;
     for (int i=0; i<6; i++) {
-      if (!writes.empty() && --delay<0) {
-        delay=0;
+      if (writeWait>0) {
+        writeWait--;
+        if (!writes.empty()) lastBusy++;
+      } else if (!writes.empty()) {
         QueuedWrite& w=writes.front();
         if (w.addrOrVal) {
           OPN2_Write(&fm,0x1+((w.addr>>8)<<1),w.val);
@@ -150,18 +157,17 @@ void DivPlatformGenesis::acquire_nuked(short* bufL, short* bufR, size_t start, s
           lastBusy=0;
           regPool[w.addr&0x1ff]=w.val;
           writes.pop_front();
+          writeWait=OPN2_WRITE_WAIT;
         } else {
           lastBusy++;
-          if (fm.write_busy==0) {
-            //printf("busycounter: %d\n",lastBusy);
-            OPN2_Write(&fm,0x0+((w.addr>>8)<<1),w.addr);
-            w.addrOrVal=true;
-          }
+          OPN2_Write(&fm,0x0+((w.addr>>8)<<1),w.addr);
+          w.addrOrVal=true;
         }
       }
       
       OPN2_Clock(&fm,o); os[0]+=o[0]; os[1]+=o[1];
       //OPN2_Write(&fm,0,0);
+      if (!captureOsc) continue;
       if (i==5) {
         if (fm.dacen) {
           if (softPCM) {
@@ -192,7 +198,7 @@ void DivPlatformGenesis::acquire_nuked(short* bufL, short* bufR, size_t start, s
 }
 
 void DivPlatformGenesis::acquire_ymfm(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   ymfm::ym2612::fm_engine* fme=fm_ymfm->debug_engine();
 
@@ -219,7 +225,7 @@ void DivPlatformGenesis::acquire_ymfm(short* bufL, short* bufR, size_t start, si
     os[1]=out_ymfm.data[1];
     //OPN2_Write(&fm,0,0);
 
-    for (int i=0; i<6; i++) {
+    for (int i=0; i<6 && captureOsc; i++) {
       if (i==5) {
         if (fm_ymfm->debug_dac_enable()) {
           if (softPCM) {
@@ -1172,7 +1178,7 @@ void DivPlatformGenesis::reset() {
   // LFO
   immWrite(0x22,lfoValue);
   
-  delay=0;
+  writeWait=0;
 }
 
 bool DivPlatformGenesis::isStereo() {
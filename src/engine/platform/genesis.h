@@ -88,6 +88,8 @@ class DivPlatformGenesis: public DivPlatformOPN {
 
     bool extMode, softPCM, noExtMacros, useYMFM;
     bool ladder;
+    // clocks to run before Nuked-OPN2 accepts the next write
+    int writeWait;
   
     unsigned char dacVolTable[128];
   
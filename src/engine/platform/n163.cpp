@@ -109,23 +109,43 @@ const char** DivPlatformN163::getRegisterSheet() {
 }
 
 void DivPlatformN163::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  for (size_t i=start; i<start+len; i++) {
-    n163.tick();
-    int out=(n163.out()<<6)*2; // scale to 16 bit
-    if (out>32767) out=32767;
-    if (out<-32768) out=-32768;
-    bufL[i]=bufR[i]=out;
-
-    if (n163.voice_cycle()==0x78) for (int i=0; i<8; i++) {
-      oscBuf[i]->data[oscBuf[i]->needle++]=n163.voice_out(i)<<7;
+  if (len==0) return;
+  // queued writes land after the first sample of the call, as they always did
+  acquireRun(bufL,bufR,start,1);
+  applyDueWrites();
+  acquireRun(bufL,bufR,start+1,len-1);
+}
+
+size_t DivPlatformN163::applyDueWrites() {
+  // command queue
+  while (!writes.empty()) {
+    QueuedWrite w=writes.front();
+    n163.addr_w(w.addr);
+    n163.data_w((n163.data_r()&~w.mask)|(w.val&w.mask));
+    writes.pop();
+  }
+  return 0;
+}
+
+#define N163_RUN 1024
+
+void DivPlatformN163::acquireRun(short* bufL, short* bufR, size_t start, size_t len) {
+  short out[N163_RUN];
+  short voiceSnap[N163_RUN*8];
+  for (size_t h=start; h<start+len; h+=N163_RUN) {
+    unsigned int runLen=(unsigned int)MIN((size_t)N163_RUN,start+len-h);
+    unsigned int cycles=n163.tick_run(out,captureOsc?voiceSnap:NULL,runLen);
+    for (unsigned int i=0; i<runLen; i++) {
+      int o=(out[i]<<6)*2; // scale to 16 bit
+      if (o>32767) o=32767;
+      if (o<-32768) o=-32768;
+      bufL[h+i]=bufR[h+i]=o;
     }
 
-    // command queue
-    while (!writes.empty()) {
-      QueuedWrite w=writes.front();
-      n163.addr_w(w.addr);
-      n163.data_w((n163.data_r()&~w.mask)|(w.val&w.mask));
-      writes.pop();
+    if (captureOsc) for (unsigned int i=0; i<cycles; i++) {
+      for (int j=0; j<8; j++) {
+        oscBuf[j]->data[oscBuf[j]->needle++]=voiceSnap[i*8+j]<<7;
+      }
     }
   }
 }
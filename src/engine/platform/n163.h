@@ -75,6 +75,8 @@ class DivPlatformN163: public DivDispatch {
 
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
+    void acquireRun(short* bufL, short* bufR, size_t start, size_t len);
+    size_t applyDueWrites();
     int dispatch(DivCommand c);
     void* getChanState(int chan);
     DivMacroInt* getChanMacroInt(int ch);
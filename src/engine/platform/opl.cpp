@@ -159,46 +159,62 @@ const int orderedOpsL[4]={
 #define ADDR_FREQH 0xb0
 #define ADDR_LR_FB_ALG 0xc0
 
+size_t DivPlatformOPL::applyDueWrites() {
+  // one write every two samples
+  if (writes.empty()) return 0;
+  if (delay>0) {
+    size_t run=delay;
+    delay=0;
+    return run;
+  }
+  delay=1;
+  QueuedWrite& w=writes.front();
+  switch (w.addr) {
+    case 8:
+      if (adpcmChan>=0) {
+        adpcmB->write(w.addr-7,(w.val&15)|0x80);
+        OPL3_WriteReg(&fm,w.addr,w.val&0xc0);
+      } else {
+        OPL3_WriteReg(&fm,w.addr,w.val);
+      }
+      break;
+    case 7: case 9: case 10: case 11: case 12: case 13: case 14: case 15: case 16: case 17: case 18: case 21: case 22: case 23:
+      if (adpcmChan>=0) {
+        adpcmB->write(w.addr-7,w.val);
+      } else {
+        OPL3_WriteReg(&fm,w.addr,w.val);
+      }
+      break;
+    default:
+      OPL3_WriteReg(&fm,w.addr,w.val);
+      break;
+  }
+  regPool[w.addr&511]=w.val;
+  writes.pop();
+  return writes.empty()?0:1;
+}
+
+void DivPlatformOPL::acquireRun(short* bufL, short* bufR, size_t start, size_t len) {
+  //if (useYMFM) {
+  //  acquire_ymfm(bufL,bufR,start,len);
+  //} else {
+    acquire_nuked(bufL,bufR,start,len);
+  //}
+}
+
 void DivPlatformOPL::acquire_nuked(short* bufL, short* bufR, size_t start, size_t len) {
-  static short o[2];
-  static int os[2];
-  static ymfm::ymfm_output<2> aOut;
+  short o[2];
+  int os[2];
+  ymfm::ymfm_output<2> aOut;
+  bool stereo=(oplType==3 || oplType==759);
 
   for (size_t h=start; h<start+len; h++) {
-    os[0]=0; os[1]=0;
-    if (!writes.empty() && --delay<0) {
-      delay=1;
-      QueuedWrite& w=writes.front();
-      switch (w.addr) {
-        case 8:
-          if (adpcmChan>=0) {
-            adpcmB->write(w.addr-7,(w.val&15)|0x80);
-            OPL3_WriteReg(&fm,w.addr,w.val&0xc0);
-          } else {
-            OPL3_WriteReg(&fm,w.addr,w.val);
-          }
-          break;
-        case 7: case 9: case 10: case 11: case 12: case 13: case 14: case 15: case 16: case 17: case 18: case 21: case 22: case 23:
-          if (adpcmChan>=0) {
-            adpcmB->write(w.addr-7,w.val);
-          } else {
-            OPL3_WriteReg(&fm,w.addr,w.val);
-          }
-          break;
-        default:
-          OPL3_WriteReg(&fm,w.addr,w.val);
-          break;
-      }
-      regPool[w.addr&511]=w.val;
-      writes.pop();
-    }
-
     if (downsample) {
       OPL3_GenerateResampled(&fm,o);
     } else {
       OPL3_Generate(&fm,o);
     }
-    os[0]+=o[0]; os[1]+=o[1];
+    os[0]=o[0]; os[1]=o[1];
 
     if (adpcmChan>=0) {
       adpcmB->clock();
@@ -208,44 +224,46 @@ void DivPlatformOPL::acquire_nuked(short* bufL, short* bufR, size_t start, size_
       if (!isMuted[adpcmChan]) {
         os[0]-=aOut.data[0]>>3;
         os[1]-=aOut.data[0]>>3;
-        oscBuf[adpcmChan]->data[oscBuf[adpcmChan]->needle++]=aOut.data[0];
+        if (captureOsc) oscBuf[adpcmChan]->data[oscBuf[adpcmChan]->needle++]=aOut.data[0];
       } else {
-        oscBuf[adpcmChan]->data[oscBuf[adpcmChan]->needle++]=0;
+        if (captureOsc) oscBuf[adpcmChan]->data[oscBuf[adpcmChan]->needle++]=0;
       }
     }
 
-    if (fm.rhy&0x20) {
-      for (int i=0; i<melodicChans+1; i++) {
-        unsigned char ch=outChanMap[i];
-        if (ch==255) continue;
-        oscBuf[i]->data[oscBuf[i]->needle]=0;
-        if (fm.channel[i].out[0]!=NULL) {
-          oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[0];
-        }
-        if (fm.channel[i].out[1]!=NULL) {
-          oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[1];
-        }
-        oscBuf[i]->data[oscBuf[i]->needle]<<=1;
-        oscBuf[i]->needle++;
-      }
-      // special
-      oscBuf[melodicChans+1]->data[oscBuf[melodicChans+1]->needle++]=fm.slot[16].out*6;
-      oscBuf[melodicChans+2]->data[oscBuf[melodicChans+2]->needle++]=fm.slot[14].out*6;
-      oscBuf[melodicChans+3]->data[oscBuf[melodicChans+3]->needle++]=fm.slot[17].out*6;
-      oscBuf[melodicChans+4]->data[oscBuf[melodicChans+4]->needle++]=fm.slot[13].out*6;
-    } else {
-      for (int i=0; i<chans; i++) {
-        unsigned char ch=outChanMap[i];
-        if (ch==255) continue;
-        oscBuf[i]->data[oscBuf[i]->needle]=0;
-        if (fm.channel[i].out[0]!=NULL) {
-          oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[0];
+    if (captureOsc) {
+      if (fm.rhy&0x20) {
+        for (int i=0; i<melodicChans+1; i++) {
+          unsigned char ch=outChanMap[i];
+          if (ch==255) continue;
+          oscBuf[i]->data[oscBuf[i]->needle]=0;
+          if (fm.channel[i].out[0]!=NULL) {
+            oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[0];
+          }
+          if (fm.channel[i].out[1]!=NULL) {
+            oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[1];
+          }
+          oscBuf[i]->data[oscBuf[i]->needle]<<=1;
+          oscBuf[i]->needle++;
         }
-        if (fm.channel[i].out[1]!=NULL) {
-          oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[1];
+        // special
+        oscBuf[melodicChans+1]->data[oscBuf[melodicChans+1]->needle++]=fm.slot[16].out*6;
+        oscBuf[melodicChans+2]->data[oscBuf[melodicChans+2]->needle++]=fm.slot[14].out*6;
+        oscBuf[melodicChans+3]->data[oscBuf[melodicChans+3]->needle++]=fm.slot[17].out*6;
+        oscBuf[melodicChans+4]->data[oscBuf[melodicChans+4]->needle++]=fm.slot[13].out*6;
+      } else {
+        for (int i=0; i<chans; i++) {
+          unsigned char ch=outChanMap[i];
+          if (ch==255) continue;
+          oscBuf[i]->data[oscBuf[i]->needle]=0;
+          if (fm.channel[i].out[0]!=NULL) {
+            oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[0];
+          }
+          if (fm.channel[i].out[1]!=NULL) {
+            oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[1];
+          }
+          oscBuf[i]->data[oscBuf[i]->needle]<<=1;
+          oscBuf[i]->needle++;
         }
-        oscBuf[i]->data[oscBuf[i]->needle]<<=1;
-        oscBuf[i]->needle++;
       }
     }
     
@@ -256,18 +274,14 @@ void DivPlatformOPL::acquire_nuked(short* bufL, short* bufR, size_t start, size_
     if (os[1]>32767) os[1]=32767;
   
     bufL[h]=os[0];
-    if (oplType==3 || oplType==759) {
+    if (stereo) {
       bufR[h]=os[1];
     }
   }
 }
 
 void DivPlatformOPL::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  //if (useYMFM) {
-  //  acquire_ymfm(bufL,bufR,start,len);
-  //} else {
-    acquire_nuked(bufL,bufR,start,len);
-  //}
+  acquireBlocks(bufL,bufR,start,len);
 }
 
 double DivPlatformOPL::NOTE_ADPCMB(int note) {
@@ -40,8 +40,8 @@ const unsigned char visMapOPLL[9]={
 };
 
 void DivPlatformOPLL::acquire_nuked(short* bufL, short* bufR, size_t start, size_t len) {
-  static int o[2];
-  static int os;
+  int o[2];
+  int os;
 
   for (size_t h=start; h<start+len; h++) {
     os=0;
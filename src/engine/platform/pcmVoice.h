@@ -0,0 +1,63 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef _PCM_VOICE_H
+#define _PCM_VOICE_H
+
+#include <stddef.h>
+
+// helpers for software-mixed PCM voices.
+// voices are rendered one at a time over a block, in runs which can't reach
+// a loop point or the sample end. the inner loops have no boundary checks and
+// no branches, so they can be vectorized. the boundary itself is handled by
+// the chip, which keeps its own loop/end semantics that way.
+
+// returns the number of steps a position moving forward by freq takes to
+// reach end (the step which reaches it included), capped to max.
+// a position which is already past end takes one step.
+template<typename P> static inline size_t pcmStepsUntil(P pos, P freq, P end, size_t max) {
+  if (pos>=end) return 1;
+  if (freq==0) return max;
+  P steps=(end-pos+freq-1)/freq;
+  return ((size_t)steps<max)?(size_t)steps:max;
+}
+
+// runs n steps of a voice without boundary checks.
+// for every step, mix(index,value) is called with the sample at pos>>FRAC,
+// after which pos moves forward by freq.
+template<int FRAC, typename P, typename S, typename F> static inline void pcmRun(const S* data, P& pos, P freq, size_t n, F mix) {
+  P p=pos;
+  for (size_t i=0; i<n; i++) {
+    mix(i,data[p>>FRAC]);
+    p+=freq;
+  }
+  pos=p;
+}
+
+// returns the number of samples a sample-and-hold voice keeps its output for,
+// capped to max. the voice counts down by div every sample and fetches a new
+// value once the counter goes below zero.
+static inline size_t pcmHoldSteps(int counter, int div, size_t max) {
+  if (counter<0) return 0;
+  size_t steps=counter/div;
+  return (steps<max)?steps:max;
+}
+
+#endif
@@ -20,6 +20,7 @@
 #define _USE_MATH_DEFINES
 #include "pcmdac.h"
 #include "../engine.h"
+#include "pcmVoice.h"
 #include <math.h>
 
 // to ease the driver, freqency register is a 8.16 counter relative to output sample rate
@@ -35,6 +36,40 @@ void DivPlatformPCMDAC::acquire(short* bufL, short* bufR, size_t start, size_t l
       oscBuf->data[oscBuf->needle++]=0;
       continue;
     }
+    // a sample playing forwards is rendered in one go up to the sample where
+    // it reaches the loop end or the sample end, which is handled below.
+    if (!chan.useWave && !chan.audDir && chan.sample>=0 && chan.sample<parent->song.sampleLen && chan.freq>=0 && chan.audPos>=0 && chan.audSub>=0 && chan.audSub<0x10000) {
+      DivSample* s=parent->getSample(chan.sample);
+      int end=s->samples;
+      if (s->isLoopable() && s->loopEnd<end) end=s->loopEnd;
+      if (end>0) {
+        const unsigned long long freq=chan.freq;
+        const int vol=chan.vol*chan.envVol;
+        unsigned long long pos=((unsigned long long)chan.audPos<<16)|chan.audSub;
+        size_t n=pcmStepsUntil<unsigned long long>(pos,freq,(unsigned long long)end<<16,start+len-h+1)-1;
+        if (n>0) {
+          // samples are fetched after stepping
+          pos+=freq;
+          pcmRun<16>(s->data16,pos,freq,n,[&](size_t k, short val) {
+            output=val*vol/16384;
+            oscBuf->data[oscBuf->needle++]=output;
+            if (outStereo) {
+              bufL[h+k]=((output*chan.panL)>>(depthScale+8))<<depthScale;
+              bufR[h+k]=((output*chan.panR)>>(depthScale+8))<<depthScale;
+            } else {
+              output=(output>>depthScale)<<depthScale;
+              bufL[h+k]=output;
+              bufR[h+k]=output;
+            }
+          });
+          pos-=freq;
+          chan.audPos=pos>>16;
+          chan.audSub=pos&0xffff;
+          h+=n;
+          if (h>=start+len) break;
+        }
+      }
+    }
     if (chan.useWave || (chan.sample>=0 && chan.sample<parent->song.sampleLen)) {
       chan.audPos+=((!chan.useWave) && chan.audDir)?-(chan.freq>>16):(chan.freq>>16);
       chan.audSub+=(chan.freq&0xffff);
@@ -25,6 +25,7 @@
 #include "../waveSynth.h"
 
 class DivPlatformPCMDAC: public DivDispatch {
+  protected:
   struct Channel: public SharedChannel<int> {
     bool audDir;
     unsigned int audLoc;
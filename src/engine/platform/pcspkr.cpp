@@ -338,6 +338,53 @@ void DivPlatformPCSpeaker::acquire(short* bufL, short* bufR, size_t start, size_
   }
 }
 
+bool DivPlatformPCSpeaker::hasEdgeOutput() {
+  // the filtered speaker types change their output on every sample
+  return (speakerType==0);
+}
+
+// same as acquire_unfilt(), but skips the samples in which the output can't
+// change (the counter neither crosses the middle nor wraps around).
+void DivPlatformPCSpeaker::acquireEdges(std::vector<DivDispatchEdge>& edges, size_t start, size_t len) {
+  size_t end=start+len;
+  if (!on) {
+    edges.push_back(DivDispatchEdge(start,0,0));
+    if (captureOsc) for (size_t i=start; i<end; i++) {
+      oscBuf->data[oscBuf->needle++]=0;
+    }
+    return;
+  }
+  int prevOut=-1;
+  for (size_t i=start; i<end;) {
+    pos-=PCSPKR_DIVIDER;
+    if (pos>freq) pos=freq;
+    while (pos<0) {
+      if (freq<1) {
+        pos=1;
+      } else {
+        pos+=freq;
+      }
+    }
+    short out=(pos>(freq>>1) && !isMuted[0])?32767:0;
+    if (out!=prevOut) {
+      edges.push_back(DivDispatchEdge(i,out,0));
+      prevOut=out;
+    }
+    if (captureOsc) oscBuf->data[oscBuf->needle++]=out;
+    i++;
+
+    if (freq>=PCSPKR_DIVIDER) {
+      size_t skip=(pos>(freq>>1))?((pos-(freq>>1)-1)/PCSPKR_DIVIDER):(pos/PCSPKR_DIVIDER);
+      if (skip>end-i) skip=end-i;
+      pos-=skip*PCSPKR_DIVIDER;
+      if (captureOsc) for (size_t j=0; j<skip; j++) {
+        oscBuf->data[oscBuf->needle++]=out;
+      }
+      i+=skip;
+    }
+  }
+}
+
 void DivPlatformPCSpeaker::tick(bool sysTick) {
   for (int i=0; i<1; i++) {
     chan[i].std.next();
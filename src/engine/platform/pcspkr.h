@@ -69,6 +69,8 @@ class DivPlatformPCSpeaker: public DivDispatch {
   public:
     void pcSpeakerThread();
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
+    bool hasEdgeOutput();
+    void acquireEdges(std::vector<DivDispatchEdge>& edges, size_t start, size_t len);
     int dispatch(DivCommand c);
     void* getChanState(int chan);
     DivMacroInt* getChanMacroInt(int ch);
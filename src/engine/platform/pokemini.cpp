@@ -67,6 +67,58 @@ void DivPlatformPokeMini::acquire(short* bufL, short* bufR, size_t start, size_t
   }
 }
 
+bool DivPlatformPokeMini::hasEdgeOutput() {
+  return true;
+}
+
+// same as acquire(), but skips the samples in which the output can't change.
+// the timer decrements once every (mask+1) clocks, so the amount of
+// decrements within a run of samples can be calculated directly.
+void DivPlatformPokeMini::acquireEdges(std::vector<DivDispatchEdge>& edges, size_t start, size_t len) {
+  size_t end=start+len;
+  if (!on) {
+    elapsedMain+=len*PCSPKR_DIVIDER;
+    edges.push_back(DivDispatchEdge(start,0,0));
+    if (captureOsc) for (size_t i=start; i<end; i++) {
+      oscBuf->data[oscBuf->needle++]=0;
+    }
+    return;
+  }
+  const int mask=scaleTable[timerScale&7];
+  int prevOut=-1;
+  for (size_t i=start; i<end;) {
+    for (int j=0; j<PCSPKR_DIVIDER; j++) {
+      elapsedMain++;
+      if ((elapsedMain&mask)==0) {
+        pos--;
+        if (pos<0) {
+          pos=preset;
+        }
+      }
+    }
+    short out=(pos>=pivot && !isMuted[0])?volTable[vol&3]:0;
+    if (out!=prevOut) {
+      edges.push_back(DivDispatchEdge(i,out,0));
+      prevOut=out;
+    }
+    if (captureOsc) oscBuf->data[oscBuf->needle++]=out;
+    i++;
+
+    // decrements left until pos crosses the pivot or wraps around
+    int left=(pos>=pivot)?(pos-pivot):pos;
+    size_t skip=((size_t)(left+1)*(mask+1)-(elapsedMain&mask)-1)/PCSPKR_DIVIDER;
+    if (skip>end-i) skip=end-i;
+    if (skip>0) {
+      pos-=((elapsedMain&mask)+skip*PCSPKR_DIVIDER)/(mask+1);
+      elapsedMain+=skip*PCSPKR_DIVIDER;
+      if (captureOsc) for (size_t j=0; j<skip; j++) {
+        oscBuf->data[oscBuf->needle++]=out;
+      }
+      i+=skip;
+    }
+  }
+}
+
 void DivPlatformPokeMini::tick(bool sysTick) {
   for (int i=0; i<1; i++) {
     chan[i].std.next();
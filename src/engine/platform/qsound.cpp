@@ -266,16 +266,24 @@ const char** DivPlatformQSound::getRegisterSheet() {
 }
 
 void DivPlatformQSound::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  for (size_t h=start; h<start+len; h++) {
-    qsound_update(&chip);
-    bufL[h]=chip.out[0];
-    bufR[h]=chip.out[1];
+  short voiceBuf[19][QSOUND_BLOCK_SIZE];
+  short* voiceOut[19];
+  for (int i=0; i<19; i++) {
+    voiceOut[i]=voiceBuf[i];
+  }
 
+  for (size_t h=start; h<start+len; h+=QSOUND_BLOCK_SIZE) {
+    int runLen=(int)MIN((size_t)QSOUND_BLOCK_SIZE,start+len-h);
+    qsound_update_block(&chip,&bufL[h],&bufR[h],captureOsc?voiceOut:NULL,runLen);
+
+    if (!captureOsc) continue;
     for (int i=0; i<19; i++) {
-      int data=chip.voice_output[i]<<2;
-      if (data<-32768) data=-32768;
-      if (data>32767) data=32767;
-      oscBuf[i]->data[oscBuf[i]->needle++]=data;
+      for (int j=0; j<runLen; j++) {
+        int data=voiceBuf[i][j]<<2;
+        if (data<-32768) data=-32768;
+        if (data>32767) data=32767;
+        oscBuf[i]->data[oscBuf[i]->needle++]=data;
+      }
     }
   }
 }
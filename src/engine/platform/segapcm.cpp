@@ -20,53 +20,83 @@
 #include "segapcm.h"
 #include "../engine.h"
 #include "../../ta-log.h"
+#include "pcmVoice.h"
 #include <string.h>
 #include <math.h>
 
 //#define rWrite(a,v) if (!skipRegisterWrites) {pendingWrites[a]=v;}
 //#define immWrite(a,v) if (!skipRegisterWrites) {writes.emplace(a,v); if (dumpWrites) {addWrite(a,v);} }
 
+#define SEGAPCM_RUN 256
+
 void DivPlatformSegaPCM::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int mixL[SEGAPCM_RUN];
+  int mixR[SEGAPCM_RUN];
+
+  for (size_t h=start; h<start+len; h+=SEGAPCM_RUN) {
+    size_t runLen=MIN((size_t)SEGAPCM_RUN,start+len-h);
+    memset(mixL,0,runLen*sizeof(int));
+    memset(mixR,0,runLen*sizeof(int));
 
-  for (size_t h=start; h<start+len; h++) {
-    os[0]=0; os[1]=0;
-    // do a PCM cycle
-    pcmL=0; pcmR=0;
+    // do the PCM cycles, one channel at a time
     for (int i=0; i<16; i++) {
-      if (chan[i].pcm.sample>=0 && chan[i].pcm.sample<parent->song.sampleLen) {
+      size_t j=0;
+      while (j<runLen) {
+        if (chan[i].pcm.sample<0 || chan[i].pcm.sample>=parent->song.sampleLen) {
+          for (; j<runLen; j++) {
+            oscBuf[i]->data[oscBuf[i]->needle++]=0;
+          }
+          break;
+        }
         DivSample* s=parent->getSample(chan[i].pcm.sample);
         if (s->samples<=0) {
           chan[i].pcm.sample=-1;
           oscBuf[i]->data[oscBuf[i]->needle++]=0;
+          j++;
           continue;
         }
-        if (!isMuted[i]) {
-          oscBuf[i]->data[oscBuf[i]->needle++]=s->data8[chan[i].pcm.pos>>8]*(chan[i].chVolL+chan[i].chVolR)>>1;
-          pcmL+=(s->data8[chan[i].pcm.pos>>8]*chan[i].chVolL);
-          pcmR+=(s->data8[chan[i].pcm.pos>>8]*chan[i].chVolR);
+        unsigned int end=s->samples<<8;
+        if (s->isLoopable() && ((unsigned int)s->loopEnd<<8)<end) end=(unsigned int)s->loopEnd<<8;
+        size_t n=pcmStepsUntil<unsigned int>(chan[i].pcm.pos,chan[i].pcm.freq,end,runLen-j);
+
+        if (isMuted[i]) {
+          chan[i].pcm.pos+=n*chan[i].pcm.freq;
+        } else {
+          const int volL=chan[i].chVolL;
+          const int volR=chan[i].chVolR;
+          DivDispatchOscBuffer* osc=oscBuf[i];
+          int* outL=&mixL[j];
+          int* outR=&mixR[j];
+          pcmRun<8,unsigned int>(s->data8,chan[i].pcm.pos,(unsigned int)chan[i].pcm.freq,n,[=](size_t k, signed char val) {
+            osc->data[osc->needle++]=val*(volL+volR)>>1;
+            outL[k]+=val*volL;
+            outR[k]+=val*volR;
+          });
         }
-        chan[i].pcm.pos+=chan[i].pcm.freq;
+        j+=n;
+
         if (s->isLoopable() && chan[i].pcm.pos>=((unsigned int)s->loopEnd<<8)) {
           chan[i].pcm.pos=s->loopStart<<8;
         } else if (chan[i].pcm.pos>=(s->samples<<8)) {
           chan[i].pcm.sample=-1;
         }
-      } else {
-        oscBuf[i]->data[oscBuf[i]->needle++]=0;
       }
     }
 
-    os[0]=pcmL;
-    if (os[0]<-32768) os[0]=-32768;
-    if (os[0]>32767) os[0]=32767;
+    for (size_t j=0; j<runLen; j++) {
+      int outL=mixL[j];
+      if (outL<-32768) outL=-32768;
+      if (outL>32767) outL=32767;
 
-    os[1]=pcmR;
-    if (os[1]<-32768) os[1]=-32768;
-    if (os[1]>32767) os[1]=32767;
-  
-    bufL[h]=os[0];
-    bufR[h]=os[1];
+      int outR=mixR[j];
+      if (outR<-32768) outR=-32768;
+      if (outR>32767) outR=32767;
+
+      bufL[h+j]=outL;
+      bufR[h+j]=outR;
+    }
+    pcmL=mixL[runLen-1];
+    pcmR=mixR[runLen-1];
   }
 }
 
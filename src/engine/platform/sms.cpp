@@ -75,7 +75,7 @@ void DivPlatformSMS::acquire_nuked(short* bufL, short* bufR, size_t start, size_
     if (oR>32767) oR=32767;
     bufL[h]=oL;
     bufR[h]=oR;
-    for (int i=0; i<4; i++) {
+    for (int i=0; i<4 && captureOsc; i++) {
       if (isMuted[i]) {
         oscBuf[i]->data[oscBuf[i]->needle++]=0;
       } else {
@@ -101,7 +101,7 @@ void DivPlatformSMS::acquire_mame(short* bufL, short* bufR, size_t start, size_t
       &bufR[h]
     };
     sn->sound_stream_update(outs,1);
-    for (int i=0; i<4; i++) {
+    for (int i=0; i<4 && captureOsc; i++) {
       if (isMuted[i]) {
         oscBuf[i]->data[oscBuf[i]->needle++]=0;
       } else {
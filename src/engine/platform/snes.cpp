@@ -66,34 +66,56 @@ const char** DivPlatformSNES::getRegisterSheet() {
 }
 
 void DivPlatformSNES::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  short out[2];
-  short chOut[16];
-  for (size_t h=start; h<start+len; h++) {
-    if (--delay<=0) {
-      delay=0;
-      if (!writes.empty()) {
-        QueuedWrite w=writes.front();
-        dsp.write(w.addr,w.val);
-        regPool[w.addr&0x7f]=w.val;
-        writes.pop();
-        delay=(w.addr==0x5c)?8:1;
-      }
-    }
-    dsp.set_output(out,1);
-    dsp.run(32);
-    dsp.get_voice_outputs(chOut);
-    bufL[h]=out[0];
-    bufR[h]=out[1];
+  acquireBlocks(bufL,bufR,start,len);
+}
+
+size_t DivPlatformSNES::applyDueWrites() {
+  // delay is the number of samples to render before the next write.
+  // KON/KOFF take 8 samples to be processed.
+  if (delay<=0 && !writes.empty()) {
+    QueuedWrite w=writes.front();
+    dsp.write(w.addr,w.val);
+    regPool[w.addr&0x7f]=w.val;
+    writes.pop();
+    delay=(w.addr==0x5c)?8:1;
+  }
+  if (writes.empty()) return 0;
+  return delay;
+}
+
+#define SNES_RUN 256
+
+void DivPlatformSNES::acquireRun(short* bufL, short* bufR, size_t start, size_t len) {
+  short out[SNES_RUN*2];
+  short chOut[SNES_RUN*16];
+  if (delay>(int)len) {
+    delay-=len;
+  } else {
+    delay=0;
+  }
+  for (size_t h=start; h<start+len; h+=SNES_RUN) {
+    int runLen=(int)MIN((size_t)SNES_RUN,start+len-h);
+    dsp.set_output(out,runLen*2);
+    dsp.set_voice_output(captureOsc?chOut:NULL);
+    dsp.run(32*runLen);
+    for (int i=0; i<runLen; i++) {
+      bufL[h+i]=out[i*2];
+      bufR[h+i]=out[i*2+1];
+    }
+    if (!captureOsc) continue;
     for (int i=0; i<8; i++) {
-      int next=(3*(chOut[i*2]+chOut[i*2+1]))>>2;
-      if (next<-32768) next=-32768;
-      if (next>32767) next=32767;
-      next=(next*254)/MAX(1,globalVolL+globalVolR);
-      if (next<-32768) next=-32768;
-      if (next>32767) next=32767;
-      oscBuf[i]->data[oscBuf[i]->needle++]=next;
+      for (int j=0; j<runLen; j++) {
+        int next=(3*(chOut[j*16+i*2]+chOut[j*16+i*2+1]))>>2;
+        if (next<-32768) next=-32768;
+        if (next>32767) next=32767;
+        next=(next*254)/MAX(1,globalVolL+globalVolR);
+        if (next<-32768) next=-32768;
+        if (next>32767) next=32767;
+        oscBuf[i]->data[oscBuf[i]->needle++]=next;
+      }
     }
   }
+  dsp.set_voice_output(NULL);
 }
 
 void DivPlatformSNES::tick(bool sysTick) {
@@ -23,6 +23,7 @@
 #define WAVEFORMCALCULATOR_h
 
 #include <map>
+#include <mutex>
 
 #include "array.h"
 #include "sidcxx11.h"
@@ -106,6 +107,9 @@ private:
 private:
     cw_cache_t CACHE;
 
+    // shared by all SID instances
+    std::mutex CACHE_Lock;
+
     WaveformCalculator() DEFAULT;
 
 public:
@@ -139,6 +139,7 @@ static inline int16_t pcm_update(struct qsound_chip *chip, int voice_no, int32_t
 static inline void adpcm_update(struct qsound_chip *chip, int voice_no, int nibble);
 static inline int16_t echo(struct qsound_echo *r,int32_t input);
 static inline int32_t fir(struct qsound_fir *f, int16_t input);
+static void fir_block(struct qsound_fir *f, const int32_t *input, int32_t *output, int samples);
 static inline int32_t delay(struct qsound_delay *d, int32_t input);
 static inline void delay_update(struct qsound_delay *d);
 
@@ -342,6 +343,149 @@ void qsound_update(struct qsound_chip *chip)
 	}
 }
 
+// updates several DSP samples.
+// the result is identical to calling qsound_update() for every sample, but
+// while the DSP is in a steady state the voices, the mixer and the filters
+// are processed over QSOUND_BLOCK_SIZE samples at a time.
+// voice_out may be NULL or point to 19 buffers receiving voice_output for
+// each sample.
+void qsound_update_block(struct qsound_chip *chip, int16_t *out_l, int16_t *out_r, int16_t **voice_out, int samples)
+{
+	int32_t echo_input[QSOUND_BLOCK_SIZE];
+	int16_t echo_output[QSOUND_BLOCK_SIZE];
+	int16_t voice[16+3][QSOUND_BLOCK_SIZE];
+	int32_t wet[QSOUND_BLOCK_SIZE];
+	int32_t dry[QSOUND_BLOCK_SIZE];
+	int pos = 0;
+
+	while(pos < samples)
+	{
+		int len = samples-pos;
+		int i, v, ch;
+
+		// state changes, pending delay updates and unusual filters go through
+		// the per-sample path.
+		if((chip->state != STATE_NORMAL1 && chip->state != STATE_NORMAL2)
+			|| chip->next_state != chip->state
+			|| chip->delay_update
+			|| chip->filter[0].tap_count < 2 || chip->filter[1].tap_count < 2
+			|| (chip->state == STATE_NORMAL2 && (chip->alt_filter[0].tap_count < 2 || chip->alt_filter[1].tap_count < 2)))
+		{
+			qsound_update(chip);
+			out_l[pos] = chip->out[0];
+			out_r[pos] = chip->out[1];
+			if(voice_out)
+			{
+				for(v=0; v<19; v++)
+					voice_out[v][pos] = chip->voice_output[v];
+			}
+			pos++;
+			continue;
+		}
+
+		if(len > QSOUND_BLOCK_SIZE)
+			len = QSOUND_BLOCK_SIZE;
+
+		chip->ready_flag = 0x80;
+
+		// recalculate echo length
+		if(chip->state == STATE_NORMAL2)
+			chip->echo.length = chip->echo.end_pos - 0x53c;
+		else
+			chip->echo.length = chip->echo.end_pos - 0x554;
+
+		chip->echo.length = CLAMP(chip->echo.length, 0, 1024);
+
+		// update PCM voices. each voice only depends on itself, so run them one
+		// after another.
+		memset(echo_input, 0, len*sizeof(int32_t));
+		for(v=0; v<16; v++)
+		{
+			for(i=0; i<len; i++)
+				voice[v][i] = pcm_update(chip, v, &echo_input[i]);
+			chip->voice_output[v] = voice[v][len-1];
+		}
+
+		// update ADPCM voices (one every third sample) and the echo
+		for(i=0; i<len; i++)
+		{
+			adpcm_update(chip, chip->state_counter % 3, chip->state_counter / 3);
+			voice[16][i] = chip->voice_output[16];
+			voice[17][i] = chip->voice_output[17];
+			voice[18][i] = chip->voice_output[18];
+
+			echo_output[i] = echo(&chip->echo,echo_input[i]);
+
+			chip->state_counter++;
+			if(chip->state_counter > 5)
+				chip->state_counter = 0;
+		}
+
+		for(ch=0; ch<2; ch++)
+		{
+			int16_t *out = (ch == 0) ? out_l : out_r;
+
+			// Echo is output on the unfiltered component of the left channel and
+			// the filtered component of the right channel.
+			for(i=0; i<len; i++)
+			{
+				wet[i] = (ch == 1) ? echo_output[i]<<14 : 0;
+				dry[i] = (ch == 0) ? echo_output[i]<<14 : 0;
+			}
+
+			for(v=0; v<19; v++)
+			{
+				uint16_t pan_index = chip->voice_pan[v]-0x110;
+				int32_t dry_vol, wet_vol;
+				if(pan_index > 97)
+					pan_index = 97;
+
+				// Apply different volume tables on the dry and wet inputs.
+				dry_vol = chip->pan_tables[ch][PANTBL_DRY][pan_index];
+				wet_vol = chip->pan_tables[ch][PANTBL_WET][pan_index];
+				for(i=0; i<len; i++)
+				{
+					dry[i] -= voice[v][i] * dry_vol;
+					wet[i] -= voice[v][i] * wet_vol;
+				}
+			}
+
+			// Saturate accumulated voices
+			for(i=0; i<len; i++)
+			{
+				dry[i] = CLAMP(dry[i], -0x1fffffff, 0x1fffffff) << 2;
+				wet[i] = CLAMP(wet[i], -0x1fffffff, 0x1fffffff) << 2;
+			}
+
+			// Apply FIR filter on 'wet' input
+			fir_block(&chip->filter[ch], wet, wet, len);
+
+			// in mode 2, we do this on the 'dry' input too
+			if(chip->state == STATE_NORMAL2)
+				fir_block(&chip->alt_filter[ch], dry, dry, len);
+
+			// output goes through a delay line and attenuation
+			for(i=0; i<len; i++)
+			{
+				int32_t output = (delay(&chip->wet[ch], wet[i]) + delay(&chip->dry[ch], dry[i]));
+
+				// DSP round function
+				output = (output + 0x2000) >> 14;
+				out[pos+i] = CLAMP(output, -0x7fff, 0x7fff);
+			}
+			chip->out[ch] = out[pos+len-1];
+		}
+
+		if(voice_out)
+		{
+			for(v=0; v<19; v++)
+				memcpy(&voice_out[v][pos], voice[v], len*sizeof(int16_t));
+		}
+
+		pos += len;
+	}
+}
+
 // Initialization routine
 static void state_init(struct qsound_chip *chip)
 {
@@ -674,6 +818,44 @@ static inline int32_t fir(struct qsound_fir *f, int16_t input)
 	return output;
 }
 
+// Apply the FIR filter on a block of samples.
+// the delay line is unrolled into a linear history so that every output
+// sample is a plain dot product, which the compiler can vectorize.
+// input is taken >>16 like in fir(). input and output may be the same.
+static void fir_block(struct qsound_fir *f, const int32_t *input, int32_t *output, int samples)
+{
+	int16_t history[95+QSOUND_BLOCK_SIZE];
+	int line = f->tap_count-1;
+	int i, tap;
+
+	// oldest sample first
+	for(i=0; i<line; i++)
+	{
+		history[i] = f->delay_line[f->delay_pos++];
+		if(f->delay_pos >= line)
+			f->delay_pos = 0;
+	}
+	for(i=0; i<samples; i++)
+		history[line+i] = input[i]>>16;
+
+	for(i=0; i<samples; i++)
+	{
+		// unsigned to keep the wrap-around of the original accumulator
+		uint32_t acc = 0;
+		const int16_t *h = &history[i];
+		for(tap=0; tap<=line; tap++)
+			acc += (uint32_t)(f->taps[tap] * h[tap]);
+		output[i] = (int32_t)(0u-(acc<<2));
+	}
+
+	// store the newest samples where fir() would have put them
+	for(i=(samples>line)?(samples-line):0; i<samples; i++)
+	{
+		f->delay_line[(f->delay_pos+i)%line] = history[line+i];
+	}
+	f->delay_pos = (f->delay_pos+samples)%line;
+}
+
 // Apply delay line and component volume
 static inline int32_t delay(struct qsound_delay *d, int32_t input)
 {
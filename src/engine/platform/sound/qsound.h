@@ -18,6 +18,9 @@ extern "C" {
 
 #include <stdint.h>
 
+// maximum number of samples qsound_update_block() processes at once
+#define QSOUND_BLOCK_SIZE 64
+
 struct qsound_voice {
 	uint16_t bank;
 	int16_t addr; // top word is the sample address
@@ -108,6 +111,7 @@ struct qsound_chip {
 long qsound_start(struct qsound_chip *chip, int clock);
 void qsound_reset(struct qsound_chip *chip);
 void qsound_update(struct qsound_chip *chip);
+void qsound_update_block(struct qsound_chip *chip, int16_t *out_l, int16_t *out_r, int16_t **voice_out, int samples);
 
 void qsound_stream_update(struct qsound_chip *chip, int16_t **outputs, int samples);
 void qsound_w(struct qsound_chip *chip, uint8_t offset, uint8_t data);
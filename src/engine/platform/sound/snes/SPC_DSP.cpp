@@ -810,6 +810,13 @@ void SPC_DSP::run( int clocks_remain )
 #endif
 		GEN_DSP_TIMING
 		#undef PHASE
+		
+		// Furnace addition
+		if ( m.voice_out )
+		{
+			get_voice_outputs( m.voice_out );
+			m.voice_out += voice_count * 2;
+		}
 	
 		if ( --clocks_remain )
 			goto loop;
@@ -827,6 +834,7 @@ void SPC_DSP::init( void* ram_64k )
 	mute_voices( 0 );
 	disable_surround( false );
 	set_output( 0, 0 );
+	set_voice_output( 0 );
 	reset();
 	
 	#ifndef NDEBUG
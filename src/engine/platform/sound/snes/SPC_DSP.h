@@ -67,6 +67,10 @@ public:
 
 	// Furnace addition, gets all current voice outputs to an array of samples
 	void get_voice_outputs( sample_t* outs );
+
+	// Furnace addition, stores all voice outputs (voice_count*2 samples) to
+	// outs after every sample, advancing it. NULL disables this.
+	void set_voice_output( sample_t* outs );
 	
 // DSP register addresses
 
@@ -188,6 +192,7 @@ private:
 		sample_t* out_end;
 		sample_t* out_begin;
 		sample_t extra [extra_size];
+		sample_t* voice_out; // Furnace addition
 	};
 	state_t m;
 	
@@ -287,6 +292,8 @@ inline bool SPC_DSP::check_kon()
 	return old;
 }
 
+inline void SPC_DSP::set_voice_output( sample_t* outs ) { m.voice_out = outs; }
+
 inline void SPC_DSP::get_voice_outputs( sample_t* outs )
 {
 	int i;
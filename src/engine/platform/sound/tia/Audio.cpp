@@ -80,6 +80,34 @@ void Audio::tick()
   if (++myCounter == 228) myCounter = 0;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+unsigned int Audio::run(unsigned int ticks)
+{
+  unsigned int ran = 0;
+
+  while (ran < ticks) {
+    // only counters 9, 37, 81 and 149 do anything
+    unsigned char next;
+    if (myCounter <= 9) next = 9;
+    else if (myCounter <= 37) next = 37;
+    else if (myCounter <= 81) next = 81;
+    else if (myCounter <= 149) next = 149;
+    else next = 9;
+
+    unsigned int idle = (next + 228 - myCounter) % 228;
+    if (idle >= ticks - ran) {
+      myCounter = (myCounter + ticks - ran) % 228;
+      return ticks;
+    }
+    myCounter = next;
+    ran += idle + 1;
+    tick();
+    if (next == 37 || next == 149) break;
+  }
+
+  return ran;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Audio::write(unsigned char addr, unsigned char val) {
   switch (addr&0x3f) {
@@ -31,6 +31,10 @@ namespace TIA {
 
       void tick();
 
+      // runs up to the given number of ticks, stopping right after the first
+      // one which produces a sample. returns the number of ticks run.
+      unsigned int run(unsigned int ticks);
+
       void write(unsigned char addr, unsigned char val);
 
       AudioChannel& channel0();
@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#include <mutex>
 
 #define MAX_SAMPLE_CHUNK    10000
 
@@ -42,8 +43,9 @@ static constexpr s32      FRAC_ONE = 1 << FRAC_BITS;
 /* step size index shift table */
 static constexpr int index_scale[8] = { 0x0e6, 0x0e6, 0x0e6, 0x0e6, 0x133, 0x199, 0x200, 0x266 };
 
-/* lookup table for the precomputed difference */
+/* lookup table for the precomputed difference (shared by every instance) */
 static int diff_lookup[16];
+static std::once_flag tables_computed;
 
 
 void ymz280b_device::update_step(struct YMZ280BVoice *voice)
@@ -489,7 +491,7 @@ void ymz280b_device::device_start(u8 *ext_mem)
 	m_ext_mem = ext_mem;
 
 	/* compute ADPCM tables */
-	compute_tables();
+	std::call_once(tables_computed, compute_tables);
 
 	/* allocate memory */
 	assert(MAX_SAMPLE_CHUNK < 0x10000);
@@ -41,14 +41,22 @@ double DivPlatformSoundUnit::NOTE_SU(int ch, int note) {
 }
 
 void DivPlatformSoundUnit::acquire(short* bufL, short* bufR, size_t start, size_t len) {
+  acquireBlocks(bufL,bufR,start,len);
+}
+
+size_t DivPlatformSoundUnit::applyDueWrites() {
+  while (!writes.empty()) {
+    QueuedWrite w=writes.front();
+    su->Write(w.addr,w.val);
+    writes.pop();
+  }
+  return 0;
+}
+
+void DivPlatformSoundUnit::acquireRun(short* bufL, short* bufR, size_t start, size_t len) {
   for (size_t h=start; h<start+len; h++) {
-    while (!writes.empty()) {
-      QueuedWrite w=writes.front();
-      su->Write(w.addr,w.val);
-      writes.pop();
-    }
     su->NextSample(&bufL[h],&bufR[h]);
-    for (int i=0; i<8; i++) {
+    for (int i=0; i<8 && captureOsc; i++) {
       oscBuf[i]->data[oscBuf[i]->needle++]=su->GetSample(i);
     }
   }
@@ -99,6 +99,8 @@ class DivPlatformSoundUnit: public DivDispatch {
   friend void putDispatchChan(void*,int,int);
   public:
     void acquire(short* bufL, short* bufR, size_t start, size_t len);
+    void acquireRun(short* bufL, short* bufR, size_t start, size_t len);
+    size_t applyDueWrites();
     int dispatch(DivCommand c);
     void* getChanState(int chan);
     DivMacroInt* getChanMacroInt(int ch);
@@ -57,6 +57,53 @@ void DivPlatformTIA::acquire(short* bufL, short* bufR, size_t start, size_t len)
   }
 }
 
+bool DivPlatformTIA::hasEdgeOutput() {
+  return true;
+}
+
+// the output only changes twice per scanline (228 clocks), so we skip from
+// one change to the next instead of ticking every clock.
+void DivPlatformTIA::acquireEdges(std::vector<DivDispatchEdge>& edges, size_t start, size_t len) {
+  short prevL=0;
+  short prevR=0;
+  size_t h=start;
+  size_t end=start+len;
+  bool first=true;
+  while (h<end) {
+    // the first clock is run alone to get the level at start.
+    // runs stop at every oscilloscope sample as well.
+    size_t run=first?1:MIN(end-h,(size_t)(114-chanOscCounter));
+    run=tia.run(run);
+    h+=run;
+
+    short outL, outR;
+    if (mixingType==2) {
+      outL=tia.myCurrentSample[0];
+      outR=tia.myCurrentSample[1];
+    } else if (mixingType==1) {
+      outL=(tia.myCurrentSample[0]+tia.myCurrentSample[1])>>1;
+      outR=0;
+    } else {
+      outL=tia.myCurrentSample[0];
+      outR=0;
+    }
+    if (first) {
+      edges.push_back(DivDispatchEdge(start,prevL=outL,prevR=outR));
+      first=false;
+    } else if (outL!=prevL || outR!=prevR) {
+      // the last tick of the run produced the new level
+      edges.push_back(DivDispatchEdge(h-1,prevL=outL,prevR=outR));
+    }
+
+    chanOscCounter+=run;
+    if (chanOscCounter>=114) {
+      chanOscCounter=0;
+      oscBuf[0]->data[oscBuf[0]->needle++]=tia.myChannelOut[0];
+      oscBuf[1]->data[oscBuf[1]->needle++]=tia.myChannelOut[1];
+    }
+  }
+}
+
 unsigned char DivPlatformTIA::dealWithFreq(unsigned char shape, int base, int pitch) {
   if (base&0x80000000 && ((base&0x7fffffff)<32)) {
     return base&0x1f;
@@ -56,7 +56,7 @@ const char** DivPlatformTX81Z::getRegisterSheet() {
 }
 
 void DivPlatformTX81Z::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   ymfm::ym2414::fm_engine* fme=fm_ymfm->debug_engine();
 
@@ -157,7 +157,7 @@ const char** DivPlatformYM2203::getRegisterSheet() {
 }
 
 void DivPlatformYM2203::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os;
+  int os;
 
   ymfm::ym2203::fm_engine* fme=fm->debug_fm_engine();
 
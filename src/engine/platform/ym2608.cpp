@@ -298,7 +298,7 @@ double DivPlatformYM2608::NOTE_ADPCMB(int note) {
 }
 
 void DivPlatformYM2608::acquire(short* bufL, short* bufR, size_t start, size_t len) {
-  static int os[2];
+  int os[2];
 
   ymfm::ym2608::fm_engine* fme=fm->debug_fm_engine();
   ymfm::ssg_engine* ssge=fm->debug_ssg_engine();
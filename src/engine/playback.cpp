@@ -216,7 +216,8 @@ const char* cmdName[]={
 static_assert((sizeof(cmdName)/sizeof(void*))==DIV_CMD_MAX,"update cmdName!");
 
 const char* formatNote(unsigned char note, unsigned char octave) {
-  static char ret[4];
+  // each thread (engine) gets its own buffer
+  static thread_local char ret[4];
   if (note==100) {
     return "OFF";
   } else if (note==101) {
@@ -918,11 +919,11 @@ void DivEngine::processRow(int i, bool afterDelay) {
 }
 
 void DivEngine::nextRow() {
-  static char pb[4096];
-  static char pb1[4096];
-  static char pb2[4096];
-  static char pb3[4096];
   if (view==DIV_STATUS_PATTERN && !skipping) {
+    char pb[4096];
+    char pb1[4096];
+    char pb2[4096];
+    char pb3[4096];
     strcpy(pb1,"");
     strcpy(pb3,"");
     for (int i=0; i<chans; i++) {
@@ -1077,6 +1078,18 @@ void DivEngine::nextRow() {
   firstTick=true;
 }
 
+void DivEngine::runExportTick(DivExportTick& t, bool inhibitLowLat) {
+  t.order=curOrder;
+  t.row=curRow;
+  t.ticks=ticks;
+  t.songEnd=(nextTick(false,inhibitLowLat) || !playing);
+  t.playing=playing;
+  t.prevOrder=prevOrder;
+  t.prevRow=prevRow;
+  t.cycles=cycles;
+  t.divider=divider;
+}
+
 bool DivEngine::nextTick(bool noAccum, bool inhibitLowLat) {
   bool ret=false;
   if (divider<1) divider=1;
@@ -1138,7 +1151,15 @@ bool DivEngine::nextTick(bool noAccum, bool inhibitLowLat) {
     pendingNotes.pop_front();
   }
 
-  if (!freelance) {
+  if (cmdStreamInt!=NULL) {
+    if (--subticks<=0) {
+      subticks=tickMult;
+      if (cmdStreamInt->tick()) {
+        ret=true;
+        if (cmdStreamInt->getLoopTick()<0) shallStop=true;
+      }
+    }
+  } else if (!freelance) {
     if (--subticks<=0) {
       subticks=tickMult;
 
@@ -1350,6 +1371,46 @@ bool DivEngine::nextTick(bool noAccum, bool inhibitLowLat) {
   return ret;
 }
 
+void DivEngine::publishOscTap(float** out, unsigned int size) {
+  float newPeak[2]={0.0f,0.0f};
+  double sum[2]={0.0,0.0};
+
+  // begin write (sequence becomes odd). readers copy the ring under the same sequence.
+  unsigned int seq=oscTapSeq.load(std::memory_order_relaxed);
+  oscTapSeq.store(seq+1,std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (unsigned int i=0; i<size; i++) {
+    for (int j=0; j<2; j++) {
+      float val=out[j][i];
+      oscBuf[j][oscWritePos]=val;
+      if (fabs(val)>newPeak[j]) newPeak[j]=fabs(val);
+      sum[j]+=val*val;
+    }
+    if (++oscWritePos>=32768) oscWritePos=0;
+  }
+  oscSize=size;
+
+  unsigned int block=(oscTap.block+1)%DIV_OSC_TAP_BLOCKS;
+  for (int j=0; j<2; j++) {
+    oscTapPeak[block][j]=newPeak[j];
+    oscTapRMS[block][j]=(size>0)?sqrt(sum[j]/(double)size):0.0f;
+    oscTap.peak[j]=oscTapPeak[block][j];
+    oscTap.rms[j]=oscTapRMS[block][j];
+  }
+  oscTap.block++;
+  oscTap.writePos=oscWritePos;
+  oscTap.size=size;
+  oscTap.written+=size;
+  for (int i=0; i<chans; i++) {
+    DivDispatchOscBuffer* buf=getOscBuffer(i);
+    oscTap.chanNeedle[i]=(buf==NULL)?0:buf->needle;
+  }
+
+  // end write
+  oscTapSeq.store(seq+2,std::memory_order_release);
+}
+
 void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsigned int size) {
   lastLoopPos=-1;
 
@@ -1564,12 +1625,7 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
 
   if (!playing) {
     if (out!=NULL) {
-      for (unsigned int i=0; i<size; i++) {
-        oscBuf[0][oscWritePos]=out[0][i];
-        oscBuf[1][oscWritePos]=out[1][i];
-        if (++oscWritePos>=32768) oscWritePos=0;
-      }
-      oscSize=size;
+      publishOscTap(out,size);
     }
     isBusy.unlock();
     return;
@@ -1717,12 +1773,7 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
     while (metroPos>=1) metroPos--;
   }
 
-  for (unsigned int i=0; i<size; i++) {
-    oscBuf[0][oscWritePos]=out[0][i];
-    oscBuf[1][oscWritePos]=out[1][i];
-    if (++oscWritePos>=32768) oscWritePos=0;
-  }
-  oscSize=size;
+  publishOscTap(out,size);
 
   if (forceMono) {
     for (size_t i=0; i<size; i++) {
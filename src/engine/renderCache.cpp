@@ -0,0 +1,217 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "engine.h"
+#include "../ta-log.h"
+#include "../fileutils.h"
+#include <zlib.h>
+#include <fmt/printf.h>
+#include <algorithm>
+
+// the cache stores finished exports (audio files and VGM data) in the config
+// directory, named after a hash of the song and every export parameter.
+// old entries are evicted once the cache grows beyond its size limit.
+
+#define RENDER_CACHE_DIR "renderCache"
+
+String DivEngine::getRenderCachePath() {
+  return configPath+DIR_SEPARATOR_STR+RENDER_CACHE_DIR;
+}
+
+void DivEngine::setRenderCache(bool enable, int maxSize) {
+  renderCacheEnabled=enable;
+  if (maxSize>=0) renderCacheMaxSize=(size_t)maxSize<<20;
+  if (enable) renderCacheEvict();
+}
+
+void DivEngine::clearRenderCache() {
+  String dir=getRenderCachePath();
+  std::vector<String> files, dirs;
+  if (!ps_listDir(dir.c_str(),files,dirs)) return;
+  for (String& i: files) {
+    ps_remove((dir+DIR_SEPARATOR_STR+i).c_str());
+  }
+  logI("render cache cleared.");
+}
+
+String DivEngine::renderCacheKey(const char* kind, const String& params) {
+  if (!renderCacheEnabled) return "";
+
+  SafeWriter* w=saveFur(true);
+  if (w==NULL) return "";
+
+  // everything besides the song which changes the output
+  String extra=fmt::sprintf("%s %d %s sub%d q%d m%d c%d",kind,DIV_ENGINE_VERSION,params,(int)curSubSongIndex,lowQuality?1:0,forceMono?1:0,clampSamples?1:0);
+  extra+=fmt::sprintf(" tier%d cores%d,%d,%d,%d,%d,%d",
+    (int)qualityTier,
+    getConfInt("ym2612Core",0),
+    getConfInt("snCore",0),
+    getConfInt("nesCore",0),
+    getConfInt("fdsCore",0),
+    getConfInt("c64Core",1),
+    getConfInt("arcadeCore",0)
+  );
+  extra+=" mute";
+  for (int i=0; i<chans; i++) {
+    extra+=isMuted[i]?'1':'0';
+  }
+
+  // FNV-1a and CRC-32 over song and parameters
+  uint64_t hash=0xcbf29ce484222325ULL;
+  unsigned char* buf=w->getFinalBuf();
+  size_t len=w->size();
+  for (size_t i=0; i<len; i++) {
+    hash^=buf[i];
+    hash*=0x100000001b3ULL;
+  }
+  for (char i: extra) {
+    hash^=(unsigned char)i;
+    hash*=0x100000001b3ULL;
+  }
+  uLong crc=crc32(0L,Z_NULL,0);
+  crc=crc32(crc,buf,len);
+  crc=crc32(crc,(const Bytef*)extra.c_str(),extra.size());
+
+  w->finish();
+  delete w;
+
+  return fmt::sprintf("%s-%.16x%.8x",kind,hash,(unsigned int)crc);
+}
+
+SafeWriter* DivEngine::renderCacheGet(const String& key) {
+  if (key.empty()) return NULL;
+  String path=getRenderCachePath()+DIR_SEPARATOR_STR+key;
+  FILE* f=ps_fopen(path.c_str(),"rb");
+  if (f==NULL) return NULL;
+
+  SafeWriter* w=new SafeWriter;
+  w->init();
+  unsigned char buf[8192];
+  size_t got;
+  while ((got=fread(buf,1,8192,f))>0) {
+    w->write(buf,got);
+  }
+  bool failed=ferror(f);
+  fclose(f);
+  if (failed) {
+    logW("could not read cached render %s!",key);
+    w->finish();
+    delete w;
+    return NULL;
+  }
+  ps_touch(path.c_str());
+  logI("using cached render %s.",key);
+  return w;
+}
+
+bool DivEngine::renderCacheGetFile(const String& key, const String& path) {
+  SafeWriter* w=renderCacheGet(key);
+  if (w==NULL) return false;
+
+  bool ret=true;
+  FILE* f=ps_fopen(path.c_str(),"wb");
+  if (f==NULL) {
+    ret=false;
+  } else {
+    if (fwrite(w->getFinalBuf(),1,w->size(),f)!=w->size()) ret=false;
+    if (fclose(f)!=0) ret=false;
+  }
+  if (!ret) logW("could not write cached render to %s! (%s)",path,strerror(errno));
+  w->finish();
+  delete w;
+  return ret;
+}
+
+void DivEngine::renderCachePut(const String& key, const unsigned char* data, size_t len) {
+  if (key.empty()) return;
+  if (len>renderCacheMaxSize) return;
+  String dir=getRenderCachePath();
+  if (!ps_mkdir(dir.c_str())) {
+    logW("could not create render cache directory! (%s)",strerror(errno));
+    return;
+  }
+
+  // write to a temporary file first so that other instances never see a partial entry
+  String path=dir+DIR_SEPARATOR_STR+key;
+  String tempPath=path+".tmp";
+  FILE* f=ps_fopen(tempPath.c_str(),"wb");
+  if (f==NULL) {
+    logW("could not write to render cache! (%s)",strerror(errno));
+    return;
+  }
+  bool failed=(fwrite(data,1,len,f)!=len);
+  if (fclose(f)!=0) failed=true;
+  if (failed || !ps_rename(tempPath.c_str(),path.c_str())) {
+    logW("could not write to render cache! (%s)",strerror(errno));
+    ps_remove(tempPath.c_str());
+    return;
+  }
+  logD("stored render %s (%d bytes).",key,(int)len);
+  renderCacheEvict();
+}
+
+void DivEngine::renderCachePutFile(const String& key, const String& path) {
+  if (key.empty()) return;
+  FILE* f=ps_fopen(path.c_str(),"rb");
+  if (f==NULL) return;
+  std::vector<unsigned char> data;
+  unsigned char buf[8192];
+  size_t got;
+  while ((got=fread(buf,1,8192,f))>0) {
+    data.insert(data.end(),buf,buf+got);
+    if (data.size()>renderCacheMaxSize) break;
+  }
+  bool failed=ferror(f);
+  fclose(f);
+  if (failed || data.size()>renderCacheMaxSize) return;
+  renderCachePut(key,data.data(),data.size());
+}
+
+void DivEngine::renderCacheEvict() {
+  String dir=getRenderCachePath();
+  std::vector<String> files, dirs;
+  if (!ps_listDir(dir.c_str(),files,dirs)) return;
+
+  struct CacheFile {
+    String path;
+    int64_t mtime, size;
+  };
+  std::vector<CacheFile> entries;
+  int64_t total=0;
+  for (String& i: files) {
+    CacheFile entry;
+    entry.path=dir+DIR_SEPARATOR_STR+i;
+    if (!ps_fileInfo(entry.path.c_str(),&entry.mtime,&entry.size)) continue;
+    total+=entry.size;
+    entries.push_back(entry);
+  }
+  if (total<=(int64_t)renderCacheMaxSize) return;
+
+  // least recently used first (hits update the modification time)
+  std::sort(entries.begin(),entries.end(),[](const CacheFile& a, const CacheFile& b) {
+    return a.mtime<b.mtime;
+  });
+  for (CacheFile& i: entries) {
+    if (total<=(int64_t)renderCacheMaxSize) break;
+    if (ps_remove(i.path.c_str())) {
+      total-=i.size;
+      logD("evicted %s from render cache.",i.path);
+    }
+  }
+}
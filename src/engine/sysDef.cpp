@@ -22,11 +22,14 @@
 #include "instrument.h"
 #include "song.h"
 #include "../ta-log.h"
+#include <mutex>
 
 DivSysDef* DivEngine::sysDefs[256];
 DivSystem DivEngine::sysFileMapFur[256];
 DivSystem DivEngine::sysFileMapDMF[256];
 
+static std::once_flag sysDefsOnce;
+
 DivSystem DivEngine::systemFromFileFur(unsigned char val) {
   return sysFileMapFur[val];
 }
@@ -422,6 +425,10 @@ template<const int bits> int effectValLong(unsigned char cmd, unsigned char val)
 };
 
 void DivEngine::registerSystems() {
+  std::call_once(sysDefsOnce,registerSystemsOnce);
+}
+
+void DivEngine::registerSystemsOnce() {
   logD("registering systems...");
 
   // Common effect handler maps
@@ -1722,6 +1729,11 @@ void DivEngine::registerSystems() {
     {DIV_INS_STD, DIV_INS_STD, DIV_INS_STD, DIV_INS_STD, DIV_INS_STD, DIV_INS_STD, DIV_INS_STD, DIV_INS_STD}
   );
 
+  for (int i=0; i<256; i++) {
+    sysFileMapFur[i]=DIV_SYSTEM_NULL;
+    sysFileMapDMF[i]=DIV_SYSTEM_NULL;
+  }
+
   for (int i=0; i<256; i++) {
     if (sysDefs[i]==NULL) continue;
     if (sysDefs[i]->id!=0) {
@@ -1731,6 +1743,4 @@ void DivEngine::registerSystems() {
       sysFileMapDMF[sysDefs[i]->id_DMF]=(DivSystem)i;
     }
   }
-
-  systemsRegistered=true;
 }
@@ -21,10 +21,144 @@
 #include "../ta-log.h"
 #include "../utfutils.h"
 #include "song.h"
+#include <zlib.h>
 
 constexpr int MASTER_CLOCK_PREC=(sizeof(void*)==8)?8:0;
 
-void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write, int streamOff, double* loopTimer, double* loopFreq, int* loopSample, bool* sampleDir, bool isSecond, bool directStream) {
+#define VGM_SHADOW_SIZE 512
+
+// whether a register write may be skipped if the register already holds that
+// value, or if it is written again later in the same tick.
+// registers with side effects (key on/off, data ports, envelope restart, shared
+// latches and address/data pairs) are excluded.
+static bool vgmRegIsPlain(DivSystem sys, unsigned int addr) {
+  if (addr>=VGM_SHADOW_SIZE) return false;
+  switch (sys) {
+    case DIV_SYSTEM_YM2612:
+    case DIV_SYSTEM_YM2612_EXT:
+    case DIV_SYSTEM_YM2612_FRAC:
+    case DIV_SYSTEM_YM2612_FRAC_EXT:
+    case DIV_SYSTEM_YM2610:
+    case DIV_SYSTEM_YM2610_FULL:
+    case DIV_SYSTEM_YM2610B:
+    case DIV_SYSTEM_YM2610_EXT:
+    case DIV_SYSTEM_YM2610_FULL_EXT:
+    case DIV_SYSTEM_YM2610B_EXT:
+    case DIV_SYSTEM_PC98:
+    case DIV_SYSTEM_PC98_EXT:
+    case DIV_SYSTEM_OPN:
+    case DIV_SYSTEM_OPN_EXT: {
+      // FM operator/channel registers. A4-AE are latched and only take effect on
+      // a write to A0-AA, so none of A0-AE may be dropped.
+      unsigned int reg=addr&0xff;
+      if (sys==DIV_SYSTEM_OPN || sys==DIV_SYSTEM_OPN_EXT) {
+        if (addr>0xff) return false;
+      }
+      return (reg>=0x30 && reg<=0xb6 && !(reg>=0xa0 && reg<=0xae));
+    }
+    case DIV_SYSTEM_YM2151:
+      // 0x19 holds both AMD and PMD
+      return (addr>=0x20 && addr<=0xff);
+    case DIV_SYSTEM_OPL:
+    case DIV_SYSTEM_OPL_DRUMS:
+    case DIV_SYSTEM_OPL2:
+    case DIV_SYSTEM_OPL2_DRUMS:
+    case DIV_SYSTEM_Y8950:
+    case DIV_SYSTEM_Y8950_DRUMS:
+    case DIV_SYSTEM_OPL3:
+    case DIV_SYSTEM_OPL3_DRUMS: {
+      // B0-BD hold key on and drum triggers
+      unsigned int reg=addr&0xff;
+      if (addr>0xff && sys!=DIV_SYSTEM_OPL3 && sys!=DIV_SYSTEM_OPL3_DRUMS) return false;
+      return (reg>=0x20 && reg<=0xf5 && !(reg>=0xb0 && reg<=0xbd));
+    }
+    case DIV_SYSTEM_OPLL:
+    case DIV_SYSTEM_OPLL_DRUMS:
+    case DIV_SYSTEM_VRC7:
+      // 0x0e and 0x20-0x28 hold key on
+      return (addr<=0x07 || (addr>=0x10 && addr<=0x18) || (addr>=0x30 && addr<=0x38));
+    case DIV_SYSTEM_AY8910:
+      // writing to 13 restarts the envelope
+      return (addr<13);
+    default:
+      break;
+  }
+  return false;
+}
+
+// remove writes which are overwritten later in the same tick, as well as writes
+// which set a register to the value it already holds.
+// shadow holds the last value written to each register (-1 if unknown).
+// returns the number of removed writes.
+static int vgmOptimizeWrites(DivSystem sys, std::vector<DivRegWrite>& writes, int* shadow) {
+  if (writes.empty()) return 0;
+  bool seen[VGM_SHADOW_SIZE];
+  memset(seen,0,VGM_SHADOW_SIZE*sizeof(bool));
+  // walk backwards to find overwritten writes. other writes act as a barrier.
+  std::vector<bool> drop(writes.size(),false);
+  for (int i=(int)writes.size()-1; i>=0; i--) {
+    unsigned int addr=writes[i].addr;
+    if (!vgmRegIsPlain(sys,addr)) {
+      memset(seen,0,VGM_SHADOW_SIZE*sizeof(bool));
+      continue;
+    }
+    if (seen[addr]) {
+      drop[i]=true;
+    } else {
+      seen[addr]=true;
+    }
+  }
+  // now compare against the register shadow
+  size_t outPos=0;
+  int removed=0;
+  for (size_t i=0; i<writes.size(); i++) {
+    DivRegWrite& write=writes[i];
+    if (write.addr==0xffffffff) {
+      // chip reset. we don't know what it does to the registers.
+      for (int j=0; j<VGM_SHADOW_SIZE; j++) shadow[j]=-1;
+    } else if (vgmRegIsPlain(sys,write.addr)) {
+      if (drop[i] || shadow[write.addr]==(int)(write.val&0xff)) {
+        removed++;
+        continue;
+      }
+      shadow[write.addr]=write.val&0xff;
+    }
+    if (outPos!=i) writes[outPos]=write;
+    outPos++;
+  }
+  writes.erase(writes.begin()+outPos,writes.end());
+  return removed;
+}
+
+// write a wait command, using the shortest encoding.
+// returns the number of commands written.
+static int vgmWriteWait(SafeWriter* w, int wait) {
+  int ret=0;
+  while (wait>0) {
+    if (wait==735) {
+      w->writeC(0x62);
+      wait=0;
+    } else if (wait==882) {
+      w->writeC(0x63);
+      wait=0;
+    } else if (wait<=16) {
+      w->writeC(0x70+wait-1);
+      wait=0;
+    } else if (wait<=65535) {
+      w->writeC(0x61);
+      w->writeS(wait);
+      wait=0;
+    } else {
+      w->writeC(0x61);
+      w->writeS(65535);
+      wait-=65535;
+    }
+    ret++;
+  }
+  return ret;
+}
+
+void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write, int streamOff, double* loopTimer, double* loopFreq, int* loopSample, bool* sampleDir, bool isSecond, bool directStream, const int* sampleBlock) {
   unsigned char baseAddr1=isSecond?0xa0:0x50;
   unsigned char baseAddr2=isSecond?0x80:0;
   unsigned short baseAddr2S=isSecond?0x8000:0;
@@ -537,7 +671,7 @@ void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write
             DivSample* sample=song.sample[write.val];
             w->writeC(0x95);
             w->writeC(streamID);
-            w->writeS(write.val); // sample number
+            w->writeS(sampleBlock[write.val]); // block number
             w->writeC((sample->getLoopStartPosition(DIV_SAMPLE_DEPTH_8BIT)==0)|(sampleDir[streamID]?0x10:0)); // flags
             if (sample->isLoopable() && !sampleDir[streamID]) {
               loopTimer[streamID]=sample->length8;
@@ -864,30 +998,47 @@ void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write
   chipVol.push_back((_id)|(0x80000100)|(((unsigned int)_vol)<<16)); \
 }
 
-SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool patternHints, bool directStream) {
+SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool patternHints, bool directStream, bool optimize, const DivExportPass* pass) {
   if (version<0x150) {
     lastError="VGM version is too low";
     return NULL;
   }
-  stop();
-  repeatPattern=false;
-  setOrder(0);
-  BUSY_BEGIN_SOFT;
+  if (pass!=NULL && directStream) {
+    logW("direct stream mode is not available when exporting from a pass");
+    directStream=false;
+  }
+  // a pass is only taken from saveMulti(), which looks up the cache itself
+  String cacheKey;
+  if (pass==NULL) {
+    cacheKey=vgmCacheKey(sysToExport,loop,version,patternHints,directStream,optimize);
+    SafeWriter* cached=renderCacheGet(cacheKey);
+    if (cached!=NULL) return cached;
+  }
   double origRate=got.rate;
-  got.rate=44100;
-  // determine loop point
   int loopOrder=0;
   int loopRow=0;
   int loopEnd=0;
-  walkSong(loopOrder,loopRow,loopEnd);
+  if (pass==NULL) {
+    stop();
+    repeatPattern=false;
+    setOrder(0);
+    BUSY_BEGIN_SOFT;
+    got.rate=44100;
+    // determine loop point
+    walkSong(loopOrder,loopRow,loopEnd);
+    warnings="";
+
+    curOrder=0;
+    freelance=false;
+    playing=false;
+    extValuePresent=false;
+    remainingLoops=-1;
+  } else {
+    loopOrder=pass->loopOrder;
+    loopRow=pass->loopRow;
+    loopEnd=pass->loopEnd;
+  }
   logI("loop point: %d %d",loopOrder,loopRow);
-  warnings="";
-
-  curOrder=0;
-  freelance=false;
-  playing=false;
-  extValuePresent=false;
-  remainingLoops=-1;
 
   // play the song ourselves
   bool done=false;
@@ -951,6 +1102,16 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
 
   unsigned int sampleOff8[256];
   unsigned int sampleOffSegaPCM[256];
+  int sampleBlock[256];
+
+  // optimizer state
+  int* regShadow=NULL;
+  int pendingWait=0;
+  int removedWrites=0;
+  int waitsIn=0;
+  int waitsOut=0;
+  int dupSamples=0;
+  size_t dupBytes=0;
 
   SafeWriter* w=new SafeWriter;
   w->init();
@@ -1435,7 +1596,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
       default:
         break;
     }
-    if (willExport[i]) {
+    if (willExport[i] && pass==NULL) {
       disCont[i].dispatch->toggleRegisterDump(true);
     }
   }
@@ -1616,16 +1777,40 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
   memset(sampleOffSegaPCM,0,256*sizeof(unsigned int));
 
   // write samples
+  // if optimizing, identical samples share a data block.
   unsigned int sampleSeek=0;
+  bool sampleIsDup[256];
+  int blockCount=0;
   for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
+    sampleIsDup[i]=false;
+    if (optimize) {
+      for (int j=0; j<i; j++) {
+        if (sampleIsDup[j]) continue;
+        DivSample* other=song.sample[j];
+        if (other->length8!=sample->length8) continue;
+        if (sample->length8>0 && memcmp(other->data8,sample->data8,sample->length8)!=0) continue;
+        sampleIsDup[i]=true;
+        sampleOff8[i]=sampleOff8[j];
+        sampleBlock[i]=sampleBlock[j];
+        dupSamples++;
+        logV("sample %d is a duplicate of %d",i,j);
+        break;
+      }
+      if (sampleIsDup[i]) continue;
+    }
     logI("setting seek to %d",sampleSeek);
     sampleOff8[i]=sampleSeek;
+    sampleBlock[i]=blockCount++;
     sampleSeek+=sample->length8;
   }
 
   if (writeDACSamples && !directStream) for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
+    if (sampleIsDup[i]) {
+      dupBytes+=sample->length8+7;
+      continue;
+    }
     w->writeC(0x67);
     w->writeC(0x66);
     w->writeC(0);
@@ -1637,6 +1822,10 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
 
   if (writeNESSamples && !directStream) for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
+    if (sampleIsDup[i]) {
+      dupBytes+=sample->length8+7;
+      continue;
+    }
     w->writeC(0x67);
     w->writeC(0x66);
     w->writeC(7);
@@ -1648,6 +1837,10 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
 
   if (writePCESamples && !directStream) for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
+    if (sampleIsDup[i]) {
+      dupBytes+=sample->length8+7;
+      continue;
+    }
     w->writeC(0x67);
     w->writeC(0x66);
     w->writeC(5);
@@ -1907,7 +2100,17 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
   }
 
   // write song data
-  playSub(false);
+  if (optimize) {
+    regShadow=new int[DIV_MAX_CHIPS*VGM_SHADOW_SIZE];
+    for (int i=0; i<DIV_MAX_CHIPS*VGM_SHADOW_SIZE; i++) regShadow[i]=-1;
+  }
+#define FLUSH_WAIT \
+  if (pendingWait>0) { \
+    waitsOut+=vgmWriteWait(w,pendingWait); \
+    pendingWait=0; \
+  }
+
+  if (pass==NULL) playSub(false);
   size_t tickCount=0;
   bool writeLoop=false;
   int ord=-1;
@@ -1916,22 +2119,43 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
     if (!willExport[dispatchOfChan[i]]) continue;
     exportChans++;
   }
+  // writes of the current tick when reading from a pass
+  std::vector<DivRegWrite> passWrites[DIV_MAX_CHIPS];
+  size_t passPos=0;
   while (!done) {
+    DivExportTick t;
+    if (pass==NULL) {
+      runExportTick(t);
+    } else {
+      if (passPos>=pass->ticks.size()) break;
+      t=pass->ticks[passPos++];
+      for (int i=0; i<song.systemLen; i++) {
+        passWrites[i].clear();
+      }
+      for (unsigned int i=t.writeStart; i<t.writeEnd; i++) {
+        // the pass has writes of every chip
+        if (!willExport[pass->writeChip[i]]) continue;
+        passWrites[pass->writeChip[i]].push_back(pass->writes[i]);
+      }
+    }
     if (loopPos==-1) {
-      if (loopOrder==curOrder && loopRow==curRow && ticks==1) {
+      if (loopOrder==t.order && loopRow==t.row && t.ticks==1) {
         writeLoop=true;
       }
     }
-    if (nextTick(false,true) || !playing) {
+    if (t.songEnd) {
       done=true;
       if (!loop) {
-        for (int i=0; i<song.systemLen; i++) {
-          disCont[i].dispatch->getRegisterWrites().clear();
+        if (pass==NULL) {
+          for (int i=0; i<song.systemLen; i++) {
+            disCont[i].dispatch->getRegisterWrites().clear();
+          }
         }
         break;
       }
       // stop all streams
       if (!directStream) {
+        FLUSH_WAIT;
         for (int i=0; i<streamID; i++) {
           w->writeC(0x94);
           w->writeC(i);
@@ -1939,42 +2163,49 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
         }
       }
 
-      if (!playing) {
+      if (!t.playing) {
         writeLoop=false;
         loopPos=-1;
       }
     } else {
       // check for pattern change
-      if (prevOrder!=ord) {
-        logI("registering order change %d on %d",prevOrder, prevRow);
-        ord=prevOrder;
+      if (t.prevOrder!=ord) {
+        logI("registering order change %d on %d",t.prevOrder,t.prevRow);
+        ord=t.prevOrder;
 
         if (patternHints) {
+          FLUSH_WAIT;
           w->writeC(0x67);
           w->writeC(0x66);
           w->writeC(0xfe);
           w->writeI(3+exportChans);
           w->writeC(0x01);
-          w->writeC(prevOrder);
-          w->writeC(prevRow);
+          w->writeC(t.prevOrder);
+          w->writeC(t.prevRow);
           for (int i=0; i<chans; i++) {
             if (!willExport[dispatchOfChan[i]]) continue;
-            w->writeC(curSubSong->orders.ord[i][prevOrder]);
+            w->writeC(curSubSong->orders.ord[i][t.prevOrder]);
           }
         }
       }
     }
     // get register dumps
     for (int i=0; i<song.systemLen; i++) {
-      std::vector<DivRegWrite>& writes=disCont[i].dispatch->getRegisterWrites();
+      std::vector<DivRegWrite>& writes=(pass==NULL)?disCont[i].dispatch->getRegisterWrites():passWrites[i];
+      if (optimize) {
+        removedWrites+=vgmOptimizeWrites(song.system[i],writes,&regShadow[i*VGM_SHADOW_SIZE]);
+      }
+      if (!writes.empty()) {
+        FLUSH_WAIT;
+      }
       for (DivRegWrite& j: writes) {
-        performVGMWrite(w,song.system[i],j,streamIDs[i],loopTimer,loopFreq,loopSample,sampleDir,isSecond[i],directStream);
+        performVGMWrite(w,song.system[i],j,streamIDs[i],loopTimer,loopFreq,loopSample,sampleDir,isSecond[i],directStream,sampleBlock);
         writeCount++;
       }
       writes.clear();
     }
     // check whether we need to loop
-    int totalWait=cycles>>MASTER_CLOCK_PREC;
+    int totalWait=t.cycles>>MASTER_CLOCK_PREC;
     if (directStream) {
       // render stream of all chips
       for (int i=0; i<song.systemLen; i++) {
@@ -1998,17 +2229,17 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
         for (std::pair<int,DivDelayedWrite>& i: sortedWrites) {
           if (i.second.time>lastOne) {
             // write delay
-            int delay=i.second.time-lastOne;
-            if (delay>16) {
-              w->writeC(0x61);
-              w->writeS(totalWait);
-            } else if (delay>0) {
-              w->writeC(0x70+delay-1);
-            }
+            pendingWait+=i.second.time-lastOne;
+            waitsIn++;
             lastOne=i.second.time;
           }
+          // these bypass the register shadow
+          if (optimize && i.second.write.addr<VGM_SHADOW_SIZE) {
+            regShadow[i.first*VGM_SHADOW_SIZE+i.second.write.addr]=-1;
+          }
           // write write
-          performVGMWrite(w,song.system[i.first],i.second.write,streamIDs[i.first],loopTimer,loopFreq,loopSample,sampleDir,isSecond[i.first],directStream);
+          FLUSH_WAIT;
+          performVGMWrite(w,song.system[i.first],i.second.write,streamIDs[i.first],loopTimer,loopFreq,loopSample,sampleDir,isSecond[i.first],directStream,sampleBlock);
           writeCount++;
         }
         sortedWrites.clear();
@@ -2046,9 +2277,9 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
         if (nextToTouch>=0) {
           double waitTime=totalWait+(loopTimer[nextToTouch]*(44100.0/MAX(1,loopFreq[nextToTouch])));
           if (waitTime>0) {
-            w->writeC(0x61);
-            w->writeS(waitTime);
             logV("wait is: %f",waitTime);
+            pendingWait+=(int)waitTime;
+            waitsIn++;
             totalWait-=waitTime;
             tickCount+=waitTime;
           }
@@ -2056,6 +2287,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
             DivSample* sample=song.sample[loopSample[nextToTouch]];
             // insert loop
             if (sample->getLoopStartPosition(DIV_SAMPLE_DEPTH_8BIT)<sample->getLoopEndPosition(DIV_SAMPLE_DEPTH_8BIT)) {
+              FLUSH_WAIT;
               w->writeC(0x93);
               w->writeC(nextToTouch);
               w->writeI(sampleOff8[loopSample[nextToTouch]]+sample->getLoopStartPosition(DIV_SAMPLE_DEPTH_8BIT));
@@ -2070,30 +2302,42 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
       }
     }
     // write wait
+    // if optimizing, waits are merged until the next command.
     if (totalWait>0) {
-      if (totalWait==735) {
-        w->writeC(0x62);
-      } else if (totalWait==882) {
-        w->writeC(0x63);
-      } else {
-        w->writeC(0x61);
-        w->writeS(totalWait);
-      }
+      pendingWait+=totalWait;
+      waitsIn++;
       tickCount+=totalWait;
     }
+    if (!optimize) {
+      FLUSH_WAIT;
+    }
     if (writeLoop) {
       writeLoop=false;
+      FLUSH_WAIT;
       loopPos=w->tell();
       loopTick=tickCount;
+      // the player may jump here with a different register state
+      if (optimize) {
+        for (int i=0; i<DIV_MAX_CHIPS*VGM_SHADOW_SIZE; i++) regShadow[i]=-1;
+      }
     }
   }
+  FLUSH_WAIT;
+#undef FLUSH_WAIT
   // end of song
   w->writeC(0x66);
 
-  got.rate=origRate;
+  if (regShadow!=NULL) {
+    delete[] regShadow;
+    regShadow=NULL;
+  }
+
+  if (pass==NULL) {
+    got.rate=origRate;
 
-  for (int i=0; i<song.systemLen; i++) {
-    disCont[i].dispatch->toggleRegisterDump(false);
+    for (int i=0; i<song.systemLen; i++) {
+      disCont[i].dispatch->toggleRegisterDump(false);
+    }
   }
 
   // write GD3 tag
@@ -2154,13 +2398,74 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
     w->writeI(exHeaderOff-0xbc);
   }
 
-  remainingLoops=-1;
-  playing=false;
-  freelance=false;
-  extValuePresent=false;
+  if (pass==NULL) {
+    remainingLoops=-1;
+    playing=false;
+    freelance=false;
+    extValuePresent=false;
+  }
 
   logI("%d register writes total.",writeCount);
+  if (optimize) {
+    // removed writes are 3 bytes long (address and value) in all chips with a shadow
+    logI("optimizer: removed %d of %d register writes (%d%%)",removedWrites,writeCount+removedWrites,(removedWrites*100)/MAX(1,writeCount+removedWrites));
+    logI("optimizer: merged %d waits into %d commands",waitsIn,waitsOut);
+    logI("optimizer: %d duplicate samples",dupSamples);
+    logI("optimizer: saved approximately %d bytes (file is %d bytes)",(int)(removedWrites*3+dupBytes+(waitsIn-waitsOut)*3),(int)w->size());
+  }
 
-  BUSY_END;
+  if (pass==NULL) {
+    BUSY_END;
+  }
+  renderCachePut(cacheKey,w->getFinalBuf(),w->size());
   return w;
 }
+
+String DivEngine::vgmCacheKey(bool* sysToExport, bool loop, int version, bool patternHints, bool directStream, bool optimize) {
+  String params=fmt::sprintf("%d %x %d %d %d ",loop?1:0,version,patternHints?1:0,directStream?1:0,optimize?1:0);
+  for (int i=0; i<song.systemLen; i++) {
+    params+=(sysToExport==NULL || sysToExport[i])?'1':'0';
+  }
+  return renderCacheKey("vgm",params);
+}
+
+bool DivEngine::writeVGZ(SafeWriter* w, FILE* f) {
+  unsigned char zbuf[131072];
+  int ret;
+  z_stream zl;
+  memset(&zl,0,sizeof(z_stream));
+  // 15+16: gzip header
+  ret=deflateInit2(&zl,Z_BEST_COMPRESSION,Z_DEFLATED,15+16,8,Z_DEFAULT_STRATEGY);
+  if (ret!=Z_OK) {
+    logE("zlib error!");
+    lastError="compression error";
+    return false;
+  }
+  zl.avail_in=w->size();
+  zl.next_in=w->getFinalBuf();
+  int flush=Z_NO_FLUSH;
+  while (true) {
+    if (zl.avail_in==0) flush=Z_FINISH;
+    zl.avail_out=131072;
+    zl.next_out=zbuf;
+    if ((ret=deflate(&zl,flush))==Z_STREAM_ERROR) {
+      logE("zlib stream error!");
+      lastError="zlib stream error";
+      deflateEnd(&zl);
+      return false;
+    }
+    size_t amount=131072-zl.avail_out;
+    if (amount>0) {
+      if (fwrite(zbuf,1,amount,f)!=amount) {
+        logE("did not write entirely: %s!",strerror(errno));
+        lastError=strerror(errno);
+        deflateEnd(&zl);
+        return false;
+      }
+    }
+    if (ret==Z_STREAM_END) break;
+  }
+  logI("compressed VGM: %d -> %d bytes",(int)w->size(),(int)zl.total_out);
+  deflateEnd(&zl);
+  return true;
+}
@@ -26,7 +26,7 @@
 constexpr int MASTER_CLOCK_PREC=(sizeof(void*)==8)?8:0;
 constexpr int MASTER_CLOCK_MASK=(sizeof(void*)==8)?0xff:0;
 
-SafeWriter* DivEngine::saveZSM(unsigned int zsmrate, bool loop) {
+SafeWriter* DivEngine::saveZSM(unsigned int zsmrate, bool loop, const DivExportPass* pass) {
 
   int VERA = -1;
   int YM = -1;
@@ -58,42 +58,50 @@ SafeWriter* DivEngine::saveZSM(unsigned int zsmrate, bool loop) {
   if (IGNORED > 0)
     logW("ZSM export ignoring %d unsupported system%c",IGNORED,IGNORED>1?'s':' ');
 
-  stop();
-  repeatPattern=false;
-  setOrder(0);
-  BUSY_BEGIN_SOFT;
-
   double origRate=got.rate;
-  got.rate=zsmrate & 0xffff;
-
-  // determine loop point
   int loopOrder=0;
   int loopRow=0;
   int loopEnd=0;
-  walkSong(loopOrder,loopRow,loopEnd);
+  if (pass==NULL) {
+    stop();
+    repeatPattern=false;
+    setOrder(0);
+    BUSY_BEGIN_SOFT;
+
+    got.rate=zsmrate & 0xffff;
+
+    // determine loop point
+    walkSong(loopOrder,loopRow,loopEnd);
+    warnings="";
+  } else {
+    loopOrder=pass->loopOrder;
+    loopRow=pass->loopRow;
+    loopEnd=pass->loopEnd;
+  }
   logI("loop point: %d %d",loopOrder,loopRow);
-  warnings="";
 
   DivZSM zsm;
   zsm.init(zsmrate);
 
-  // reset the playback state
-  curOrder=0;
-  freelance=false;
-  playing=false;
-  extValuePresent=false;
-  remainingLoops=-1;
+  if (pass==NULL) {
+    // reset the playback state
+    curOrder=0;
+    freelance=false;
+    playing=false;
+    extValuePresent=false;
+    remainingLoops=-1;
 
-  // Prepare to write song data
-  playSub(false);
+    // Prepare to write song data
+    playSub(false);
+  }
   //size_t tickCount=0;
   bool done=false;
   int loopPos=-1;
   int writeCount=0;
   int fracWait=0; // accumulates fractional ticks
-  if (VERA >= 0) disCont[VERA].dispatch->toggleRegisterDump(true);
+  if (VERA >= 0 && pass==NULL) disCont[VERA].dispatch->toggleRegisterDump(true);
   if (YM >= 0) {
-    disCont[YM].dispatch->toggleRegisterDump(true);
+    if (pass==NULL) disCont[YM].dispatch->toggleRegisterDump(true);
     // emit LFO initialization commands
     zsm.writeYM(0x18,0);    // freq = 0
     zsm.writeYM(0x19,0x7F); // AMD  = 7F
@@ -102,22 +110,47 @@ SafeWriter* DivEngine::saveZSM(unsigned int zsmrate, bool loop) {
     //       out writes to otherwise-unused channels.
   }
 
+  // writes of the current tick when reading from a pass
+  std::vector<DivRegWrite> passWrites[2];
+  size_t passPos=0;
+  int64_t passFrac=0;
   while (!done) {
+    DivExportTick t;
+    if (pass==NULL) {
+      runExportTick(t,false);
+    } else {
+      if (passPos>=pass->ticks.size()) break;
+      t=pass->ticks[passPos++];
+      passWrites[0].clear();
+      passWrites[1].clear();
+      // skip the writes made while resetting the chips. we do our own init.
+      unsigned int start=MAX(t.writeStart,pass->resetWrites);
+      for (unsigned int i=start; i<t.writeEnd; i++) {
+        if (pass->writeChip[i]==YM) passWrites[0].push_back(pass->writes[i]);
+        if (pass->writeChip[i]==VERA) passWrites[1].push_back(pass->writes[i]);
+      }
+      // convert the tick length to our rate
+      passFrac+=(int64_t)t.cycles*(zsmrate&0xffff);
+      t.cycles=passFrac/pass->rate;
+      passFrac%=pass->rate;
+    }
     if (loopPos==-1) {
-      if (loopOrder==curOrder && loopRow==curRow && ticks==1 && loop) {
+      if (loopOrder==t.order && loopRow==t.row && t.ticks==1 && loop) {
         loopPos=zsm.getoffset();
         zsm.setLoopPoint();
       }
     }
-    if (nextTick() || !playing) {
+    if (t.songEnd) {
       done=true;
       if (!loop) {
-        for (int i=0; i<song.systemLen; i++) {
-          disCont[i].dispatch->getRegisterWrites().clear();
+        if (pass==NULL) {
+          for (int i=0; i<song.systemLen; i++) {
+            disCont[i].dispatch->getRegisterWrites().clear();
+          }
         }
         break;
       }
-      if (!playing) {
+      if (!t.playing) {
         loopPos=-1;
       }
     }
@@ -139,7 +172,7 @@ SafeWriter* DivEngine::saveZSM(unsigned int zsmrate, bool loop) {
           i=VERA;
         }
       }
-      std::vector<DivRegWrite>& writes=disCont[i].dispatch->getRegisterWrites();
+      std::vector<DivRegWrite>& writes=(pass==NULL)?disCont[i].dispatch->getRegisterWrites():passWrites[j];
       if (writes.size() > 0)
         logD("zsmOps: Writing %d messages to chip %d",writes.size(), i);
       for (DivRegWrite& write: writes) {
@@ -151,8 +184,8 @@ SafeWriter* DivEngine::saveZSM(unsigned int zsmrate, bool loop) {
     }
 
     // write wait
-    int totalWait=cycles>>MASTER_CLOCK_PREC;
-    fracWait += cycles & MASTER_CLOCK_MASK;
+    int totalWait=t.cycles>>MASTER_CLOCK_PREC;
+    fracWait += t.cycles & MASTER_CLOCK_MASK;
     totalWait += fracWait>>MASTER_CLOCK_PREC;
     fracWait &= MASTER_CLOCK_MASK;
     if (totalWait>0) {
@@ -163,15 +196,19 @@ SafeWriter* DivEngine::saveZSM(unsigned int zsmrate, bool loop) {
   // end of song
 
   // done - close out.
-  got.rate = origRate;
-  if (VERA >= 0) disCont[VERA].dispatch->toggleRegisterDump(false);
-  if (YM >= 0) disCont[YM].dispatch->toggleRegisterDump(false);
+  if (pass==NULL) {
+    got.rate = origRate;
+    if (VERA >= 0) disCont[VERA].dispatch->toggleRegisterDump(false);
+    if (YM >= 0) disCont[YM].dispatch->toggleRegisterDump(false);
+  }
 
-  remainingLoops=-1;
-  playing=false;
-  freelance=false;
-  extValuePresent=false;
+  if (pass==NULL) {
+    remainingLoops=-1;
+    playing=false;
+    freelance=false;
+    extValuePresent=false;
 
-  BUSY_END;
+    BUSY_END;
+  }
   return zsm.finish();
 }
@@ -20,7 +20,16 @@
 #include "fileutils.h"
 #ifdef _WIN32
 #include "utfutils.h"
+#include <windows.h>
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <utime.h>
 #endif
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 FILE* ps_fopen(const char* path, const char* mode) {
 #ifdef _WIN32
@@ -29,3 +38,86 @@ FILE* ps_fopen(const char* path, const char* mode) {
   return fopen(path,mode);
 #endif
 }
+
+bool ps_listDir(const char* path, std::vector<std::string>& files, std::vector<std::string>& dirs) {
+#ifdef _WIN32
+  WIN32_FIND_DATAW entry;
+  HANDLE h=FindFirstFileW((utf8To16(path)+L"\\*").c_str(),&entry);
+  if (h==INVALID_HANDLE_VALUE) return false;
+  do {
+    std::string name=utf16To8(entry.cFileName);
+    if (name=="." || name=="..") continue;
+    if (entry.dwFileAttributes&FILE_ATTRIBUTE_DIRECTORY) {
+      dirs.push_back(name);
+    } else {
+      files.push_back(name);
+    }
+  } while (FindNextFileW(h,&entry));
+  FindClose(h);
+  return true;
+#else
+  DIR* d=opendir(path);
+  if (d==NULL) return false;
+  struct dirent* entry;
+  while ((entry=readdir(d))!=NULL) {
+    std::string name=entry->d_name;
+    if (name=="." || name=="..") continue;
+    struct stat st;
+    if (stat((std::string(path)+"/"+name).c_str(),&st)!=0) continue;
+    if (S_ISDIR(st.st_mode)) {
+      dirs.push_back(name);
+    } else if (S_ISREG(st.st_mode)) {
+      files.push_back(name);
+    }
+  }
+  closedir(d);
+  return true;
+#endif
+}
+
+bool ps_fileInfo(const char* path, int64_t* mtime, int64_t* size) {
+#ifdef _WIN32
+  struct _stat64 st;
+  if (_wstat64(utf8To16(path).c_str(),&st)!=0) return false;
+#else
+  struct stat st;
+  if (stat(path,&st)!=0) return false;
+#endif
+  if (mtime!=NULL) *mtime=st.st_mtime;
+  if (size!=NULL) *size=st.st_size;
+  return true;
+}
+
+bool ps_mkdir(const char* path) {
+#ifdef _WIN32
+  if (_wmkdir(utf8To16(path).c_str())==0) return true;
+#else
+  if (mkdir(path,0755)==0) return true;
+#endif
+  return errno==EEXIST;
+}
+
+bool ps_remove(const char* path) {
+#ifdef _WIN32
+  return _wremove(utf8To16(path).c_str())==0;
+#else
+  return remove(path)==0;
+#endif
+}
+
+bool ps_rename(const char* from, const char* to) {
+#ifdef _WIN32
+  // _wrename does not replace existing files
+  return MoveFileExW(utf8To16(from).c_str(),utf8To16(to).c_str(),MOVEFILE_REPLACE_EXISTING)!=0;
+#else
+  return rename(from,to)==0;
+#endif
+}
+
+bool ps_touch(const char* path) {
+#ifdef _WIN32
+  return _wutime(utf8To16(path).c_str(),NULL)==0;
+#else
+  return utime(path,NULL)==0;
+#endif
+}
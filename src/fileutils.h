@@ -20,7 +20,20 @@
 #ifndef _FILEUTILS_H
 #define _FILEUTILS_H
 #include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
 
 FILE* ps_fopen(const char* path, const char* mode);
+// list the files and directories inside a directory (excluding . and ..).
+bool ps_listDir(const char* path, std::vector<std::string>& files, std::vector<std::string>& dirs);
+// get the modification time and size of a file.
+bool ps_fileInfo(const char* path, int64_t* mtime, int64_t* size);
+// create a directory. succeeds if it already exists.
+bool ps_mkdir(const char* path);
+bool ps_remove(const char* path);
+bool ps_rename(const char* from, const char* to);
+// set the modification time of a file to now.
+bool ps_touch(const char* path);
 
 #endif
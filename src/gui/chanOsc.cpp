@@ -301,6 +301,9 @@ void FurnaceGUI::drawChanOsc() {
 
       ImGuiStyle& style=ImGui::GetStyle();
 
+      DivOscTap tap;
+      bool haveTap=e->getOscTap(tap);
+
       for (int i=0; i<chans; i++) {
         DivDispatchOscBuffer* buf=e->getOscBuffer(i);
         if (buf!=NULL && e->curSubSong->chanShow[i]) {
@@ -351,7 +354,18 @@ void FurnaceGUI::drawChanOsc() {
           inRect.Max.y-=dpiScale;
           ImGui::ItemSize(size,style.FramePadding.y);
           if (ImGui::ItemAdd(rect,ImGui::GetID("chOscDisplay"))) {
-            if (!e->isRunning()) {
+            // copy what will be drawn (up to 3 windows back) along with the last published buffer
+            bool haveData=false;
+            if (e->isRunning()) {
+              if (chanOscData.size()<65536) chanOscData.resize(65536);
+              haveData=haveTap && e->readChanOscWindow(tap,ch,displaySize*3,chanOscData.data());
+              if (!haveData) {
+                // the snapshot got too old; take a new one
+                haveTap=e->getOscTap(tap);
+                haveData=haveTap && e->readChanOscWindow(tap,ch,displaySize*3,chanOscData.data());
+              }
+            }
+            if (!haveData) {
               for (unsigned short i=0; i<512; i++) {
                 float x=(float)i/512.0f;
                 waveform[i]=ImLerp(inRect.Min,inRect.Max,ImVec2(x,0.5f));
@@ -360,9 +374,10 @@ void FurnaceGUI::drawChanOsc() {
               float minLevel=1.0f;
               float maxLevel=-1.0f;
               float dcOff=0.0f;
-              unsigned short needlePos=buf->needle;
+              // use the needle published along with the last complete buffer
+              unsigned short needlePos=tap.chanNeedle[ch];
               for (int i=0; i<FURNACE_FFT_SIZE; i++) {
-                fft->inBuf[i]=(double)buf->data[(unsigned short)(needlePos-displaySize*2+((i*displaySize*2)/FURNACE_FFT_SIZE))]/32768.0;
+                fft->inBuf[i]=(double)chanOscData[(unsigned short)(needlePos-displaySize*2+((i*displaySize*2)/FURNACE_FFT_SIZE))]/32768.0;
               }
               fftw_execute(fft->plan);
               
@@ -395,14 +410,14 @@ void FurnaceGUI::drawChanOsc() {
 
               needlePos-=displaySize;
               for (unsigned short i=0; i<512; i++) {
-                float y=(float)buf->data[(unsigned short)(needlePos+(i*displaySize/512))]/65536.0f;
+                float y=(float)chanOscData[(unsigned short)(needlePos+(i*displaySize/512))]/65536.0f;
                 if (minLevel>y) minLevel=y;
                 if (maxLevel<y) maxLevel=y;
               }
               dcOff=(minLevel+maxLevel)*0.5f;
               for (unsigned short i=0; i<512; i++) {
                 float x=(float)i/512.0f;
-                float y=(float)buf->data[(unsigned short)(needlePos+(i*displaySize/512))]/65536.0f;
+                float y=(float)chanOscData[(unsigned short)(needlePos+(i*displaySize/512))]/65536.0f;
                 if (y<-0.5f) y=-0.5f;
                 if (y>0.5f) y=0.5f;
                 waveform[i]=ImLerp(inRect.Min,inRect.Max,ImVec2(x,0.5f-(y-dcOff)));
@@ -209,6 +209,14 @@ void FurnaceGUI::drawDebug() {
       ImGui::TreePop();
     }
     if (ImGui::TreeNode("Oscilloscope Debug")) {
+      DivOscTap tap;
+      if (e->getOscTap(tap)) {
+        ImGui::Text("tap block: %u (write pos %d, size %u)",tap.block,tap.writePos,tap.size);
+        ImGui::Text("peak: %.3f, %.3f",tap.peak[0],tap.peak[1]);
+        ImGui::Text("RMS: %.3f, %.3f (GUI: %.3f, %.3f)",tap.rms[0],tap.rms[1],oscRMS[0],oscRMS[1]);
+      } else {
+        ImGui::Text("tap: nothing published yet");
+      }
       int c=0;
       for (int i=0; i<e->song.systemLen; i++) {
         DivSystem system=e->song.system[i];
@@ -531,8 +539,14 @@ void FurnaceGUI::drawDebug() {
     if (ImGui::TreeNode("Performance")) {
       double perfFreq=SDL_GetPerformanceFrequency()/1000000.0;
       ImGui::Text("render: %.0fµs",(double)renderTimeDelta/perfFreq);
+      ImGui::Text("draw: %.0fµs",(double)drawTimeDelta/perfFreq);
       ImGui::Text("layout: %.0fµs",(double)layoutTimeDelta/perfFreq);
       ImGui::Text("event: %.0fµs",(double)eventTimeDelta/perfFreq);
+      ImGui::Text("frame rate: %d fps (%d skipped)",frameRate,frameSkipRate);
+      ImGui::Text("busy time: %.1f%%",frameBusyRatio*100.0);
+      ImGui::Text("CPU time (GUI thread): %.1f%%",frameCPU*100.0);
+      ImGui::Text("pattern: %.0fµs",(double)patternTimeDelta/perfFreq);
+      ImGui::Text("- row labels: %d cached, %d formatted (gen %u)",patRowCacheHits,patRowCacheMisses,patRowCacheGen);
       ImGui::TreePop();
     }
     if (ImGui::TreeNode("Settings")) {
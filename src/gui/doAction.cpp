@@ -262,6 +262,9 @@ void FurnaceGUI::doAction(int what) {
     case GUI_ACTION_WINDOW_FIND:
       nextWindow=GUI_WINDOW_FIND;
       break;
+    case GUI_ACTION_WINDOW_INS_LIBRARY:
+      nextWindow=GUI_WINDOW_INS_LIBRARY;
+      break;
     
     case GUI_ACTION_COLLAPSE_WINDOW:
       collapseWindow=true;
@@ -352,6 +355,9 @@ void FurnaceGUI::doAction(int what) {
         case GUI_WINDOW_FIND:
           findOpen=false;
           break;
+        case GUI_WINDOW_INS_LIBRARY:
+          insLibOpen=false;
+          break;
         default:
           break;
       }
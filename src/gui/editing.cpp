@@ -41,6 +41,66 @@ const char* FurnaceGUI::noteNameNormal(short note, short octave) {
   return noteNames[seek];
 }
 
+bool UndoPatternBlock::build(int s, int c, int p, DivPattern* oldPat, DivPattern* newPat, int rows) {
+  subSong=s;
+  chan=c;
+  pat=p;
+  runs.clear();
+
+  // find bounding rectangle
+  rowStart=DIV_MAX_ROWS;
+  rowEnd=-1;
+  colStart=DIV_MAX_COLS;
+  colEnd=-1;
+  for (int i=0; i<rows; i++) {
+    for (int j=0; j<DIV_MAX_COLS; j++) {
+      if (oldPat->data[i][j]!=newPat->data[i][j]) {
+        if (i<rowStart) rowStart=i;
+        if (i>rowEnd) rowEnd=i;
+        if (j<colStart) colStart=j;
+        if (j>colEnd) colEnd=j;
+      }
+    }
+  }
+  if (rowEnd<0) return false;
+
+  // encode
+  for (int i=rowStart; i<=rowEnd; i++) {
+    for (int j=colStart; j<=colEnd; j++) {
+      short oldVal=oldPat->data[i][j];
+      short newVal=newPat->data[i][j];
+      if (!runs.empty()) {
+        UndoPatternRun& last=runs.back();
+        bool lastChanged=(last.oldVal!=last.newVal);
+        if (lastChanged?(last.oldVal==oldVal && last.newVal==newVal):(oldVal==newVal)) {
+          last.len++;
+          continue;
+        }
+      }
+      if (oldVal==newVal) {
+        runs.push_back(UndoPatternRun(0,0,1));
+      } else {
+        runs.push_back(UndoPatternRun(oldVal,newVal,1));
+      }
+    }
+  }
+  return true;
+}
+
+void UndoPatternBlock::apply(DivPattern* p, bool redo) const {
+  int cols=colEnd-colStart+1;
+  int pos=0;
+  for (const UndoPatternRun& i: runs) {
+    if (i.oldVal!=i.newVal) {
+      short val=redo?i.newVal:i.oldVal;
+      for (int j=pos; j<pos+i.len; j++) {
+        p->data[rowStart+j/cols][colStart+j%cols]=val;
+      }
+    }
+    pos+=i.len;
+  }
+}
+
 void FurnaceGUI::prepareUndo(ActionType action) {
   switch (action) {
     case GUI_UNDO_CHANGE_ORDER:
@@ -88,6 +148,8 @@ void FurnaceGUI::makeUndo(ActionType action) {
         for (int j=0; j<128; j++) {
           if (oldOrders.ord[i][j]!=e->curOrders->ord[i][j]) {
             s.ord.push_back(UndoOrderData(subSong,i,j,oldOrders.ord[i][j],e->curOrders->ord[i][j]));
+            // the pattern may have been filled in (e.g. deep clone)
+            findIndex.dropPattern(subSong,i,e->curOrders->ord[i][j]);
           }
         }
       }
@@ -117,13 +179,14 @@ void FurnaceGUI::makeUndo(ActionType action) {
     case GUI_UNDO_PATTERN_EXPAND:
     case GUI_UNDO_PATTERN_DRAG:
       for (int i=0; i<e->getTotalChannelCount(); i++) {
-        DivPattern* p=e->curPat[i].getPattern(e->curOrders->ord[i][curOrder],false);
-        for (int j=0; j<e->curSubSong->patLen; j++) {
-          for (int k=0; k<DIV_MAX_COLS; k++) {
-            if (p->data[j][k]!=oldPat[i]->data[j][k]) {
-              s.pat.push_back(UndoPatternData(subSong,i,e->curOrders->ord[i][curOrder],j,k,oldPat[i]->data[j][k],p->data[j][k]));
-            }
+        int patIndex=e->curOrders->ord[i][curOrder];
+        DivPattern* p=e->curPat[i].getPattern(patIndex,false);
+        UndoPatternBlock block;
+        if (block.build(subSong,i,patIndex,oldPat[i],p,e->curSubSong->patLen)) {
+          for (int j=block.rowStart; j<=block.rowEnd; j++) {
+            findIndexTouch(subSong,i,patIndex,j);
           }
+          s.pat.push_back(std::move(block));
         }
       }
       if (!s.pat.empty()) {
@@ -135,7 +198,7 @@ void FurnaceGUI::makeUndo(ActionType action) {
   }
   if (doPush) {
     MARK_MODIFIED;
-    undoHist.push_back(s);
+    undoHist.push_back(std::move(s));
     redoHist.clear();
     if (undoHist.size()>settings.maxUndoSteps) undoHist.pop_front();
   }
@@ -997,8 +1060,9 @@ void FurnaceGUI::doDrag() {
 
 void FurnaceGUI::doUndo() {
   if (undoHist.empty()) return;
-  UndoStep& us=undoHist.back();
-  redoHist.push_back(us);
+  redoHist.push_back(std::move(undoHist.back()));
+  undoHist.pop_back();
+  UndoStep& us=redoHist.back();
   MARK_MODIFIED;
 
   switch (us.type) {
@@ -1007,6 +1071,7 @@ void FurnaceGUI::doUndo() {
       for (UndoOrderData& i: us.ord) {
         e->changeSongP(i.subSong);
         e->curOrders->ord[i.chan][i.ord]=i.oldVal;
+        findIndex.dropPattern(i.subSong,i.chan,i.oldVal);
       }
       break;
     case GUI_UNDO_PATTERN_EDIT:
@@ -1026,10 +1091,13 @@ void FurnaceGUI::doUndo() {
     case GUI_UNDO_PATTERN_EXPAND:
     case GUI_UNDO_PATTERN_DRAG:
     case GUI_UNDO_REPLACE:
-      for (UndoPatternData& i: us.pat) {
+      for (UndoPatternBlock& i: us.pat) {
         e->changeSongP(i.subSong);
         DivPattern* p=e->curPat[i.chan].getPattern(i.pat,true);
-        p->data[i.row][i.col]=i.oldVal;
+        i.apply(p,false);
+        for (int j=i.rowStart; j<=i.rowEnd; j++) {
+          findIndexTouch(i.subSong,i.chan,i.pat,j);
+        }
       }
       if (us.type!=GUI_UNDO_REPLACE) {
         if (!e->isPlaying() || !followPattern) {
@@ -1043,14 +1111,13 @@ void FurnaceGUI::doUndo() {
       }
       break;
   }
-
-  undoHist.pop_back();
 }
 
 void FurnaceGUI::doRedo() {
   if (redoHist.empty()) return;
-  UndoStep& us=redoHist.back();
-  undoHist.push_back(us);
+  undoHist.push_back(std::move(redoHist.back()));
+  redoHist.pop_back();
+  UndoStep& us=undoHist.back();
   MARK_MODIFIED;
 
   switch (us.type) {
@@ -1059,6 +1126,7 @@ void FurnaceGUI::doRedo() {
       for (UndoOrderData& i: us.ord) {
         e->changeSongP(i.subSong);
         e->curOrders->ord[i.chan][i.ord]=i.newVal;
+        findIndex.dropPattern(i.subSong,i.chan,i.newVal);
       }
       break;
     case GUI_UNDO_PATTERN_EDIT:
@@ -1078,10 +1146,13 @@ void FurnaceGUI::doRedo() {
     case GUI_UNDO_PATTERN_EXPAND:
     case GUI_UNDO_PATTERN_DRAG:
     case GUI_UNDO_REPLACE:
-      for (UndoPatternData& i: us.pat) {
+      for (UndoPatternBlock& i: us.pat) {
         e->changeSongP(i.subSong);
         DivPattern* p=e->curPat[i.chan].getPattern(i.pat,true);
-        p->data[i.row][i.col]=i.newVal;
+        i.apply(p,true);
+        for (int j=i.rowStart; j<=i.rowEnd; j++) {
+          findIndexTouch(i.subSong,i.chan,i.pat,j);
+        }
       }
       if (us.type!=GUI_UNDO_REPLACE) {
         if (!e->isPlaying() || !followPattern) {
@@ -1096,6 +1167,4 @@ void FurnaceGUI::doRedo() {
 
       break;
   }
-
-  redoHist.pop_back();
 }
@@ -24,6 +24,7 @@
 #include "guiConst.h"
 #include "intConst.h"
 #include "../ta-log.h"
+#include <algorithm>
 
 const char* queryModes[GUI_QUERY_MAX]={
   "ignore",
@@ -90,6 +91,215 @@ bool checkCondition(int mode, int arg, int argMax, int val, bool noteMode=false)
   return false;
 }
 
+static void findIndexValues(DivPattern* p, int row, short* vals) {
+  vals[0]=queryNote(p->data[row][0],p->data[row][1]);
+  vals[1]=p->data[row][2];
+  vals[2]=p->data[row][3];
+  for (int i=0; i<DIV_MAX_EFFECTS; i++) {
+    vals[3+i]=p->data[row][4+i*2];
+    vals[3+DIV_MAX_EFFECTS+i]=p->data[row][5+i*2];
+  }
+}
+
+static int findIndexColumn(int i) {
+  if (i<3) return i;
+  if (i<3+DIV_MAX_EFFECTS) return GUI_FIND_INDEX_EFFECT;
+  return GUI_FIND_INDEX_EFFECT_VAL;
+}
+
+bool FurnaceGUIFindIndex::isIndexed(int subsong, int chan, int pat) {
+  return patterns.find(packPat(subsong,chan,pat))!=patterns.end();
+}
+
+bool FurnaceGUIFindIndex::isIndexed(int subsong, int chan, int pat, DivPattern* p) {
+  auto i=patterns.find(packPat(subsong,chan,pat));
+  if (i==patterns.end()) return false;
+  return i->second==p;
+}
+
+void FurnaceGUIFindIndex::indexPattern(DivEngine* e, int subsong, int chan, int pat) {
+  dropPattern(subsong,chan,pat);
+  patterns[packPat(subsong,chan,pat)]=e->song.subsong[subsong]->pat[chan].getPattern(pat,false);
+  for (int i=0; i<DIV_MAX_ROWS; i++) {
+    updateRow(e,subsong,chan,pat,i);
+  }
+}
+
+void FurnaceGUIFindIndex::removeRow(unsigned int loc) {
+  auto old=rows.find(loc);
+  if (old==rows.end()) return;
+  for (size_t j=0; j<old->second.size(); j++) {
+    int col=findIndexColumn(j);
+    short emptyVal=(col==GUI_FIND_INDEX_NOTE)?-61:-1;
+    if (old->second[j]==emptyVal) continue;
+    auto posting=postings[col].find(old->second[j]);
+    if (posting==postings[col].end()) continue;
+    posting->second.erase(loc);
+    if (posting->second.empty()) postings[col].erase(posting);
+  }
+  rows.erase(old);
+}
+
+void FurnaceGUIFindIndex::dropPattern(int subsong, int chan, int pat) {
+  if (patterns.erase(packPat(subsong,chan,pat))==0) return;
+  for (int i=0; i<DIV_MAX_ROWS; i++) {
+    removeRow(pack(subsong,chan,pat,i));
+  }
+}
+
+void FurnaceGUIFindIndex::updateRow(DivEngine* e, int subsong, int chan, int pat, int row) {
+  if (!isIndexed(subsong,chan,pat)) return;
+  unsigned int loc=pack(subsong,chan,pat,row);
+
+  removeRow(loc);
+
+  if (subsong<0 || subsong>=(int)e->song.subsong.size()) return;
+  DivPattern* p=e->song.subsong[subsong]->pat[chan].getPattern(pat,false);
+  short vals[3+DIV_MAX_EFFECTS*2];
+  findIndexValues(p,row,vals);
+  bool empty=true;
+  for (int j=0; j<3+DIV_MAX_EFFECTS*2; j++) {
+    int col=findIndexColumn(j);
+    short emptyVal=(col==GUI_FIND_INDEX_NOTE)?-61:-1;
+    if (vals[j]==emptyVal) continue;
+    postings[col][vals[j]].insert(loc);
+    empty=false;
+  }
+  if (!empty) {
+    rows[loc]=std::vector<short>(vals,vals+3+DIV_MAX_EFFECTS*2);
+  }
+}
+
+size_t FurnaceGUIFindIndex::count(int col, int min, int max) {
+  size_t ret=0;
+  if (min>max) return 0;
+  for (auto i=postings[col].lower_bound(min); i!=postings[col].end() && i->first<=max; i++) {
+    ret+=i->second.size();
+  }
+  return ret;
+}
+
+void FurnaceGUIFindIndex::collect(int col, int min, int max, std::vector<unsigned int>& ret) {
+  if (min>max) return;
+  for (auto i=postings[col].lower_bound(min); i!=postings[col].end() && i->first<=max; i++) {
+    ret.insert(ret.end(),i->second.begin(),i->second.end());
+  }
+}
+
+void FurnaceGUIFindIndex::clear() {
+  for (int i=0; i<GUI_FIND_INDEX_MAX; i++) {
+    postings[i].clear();
+  }
+  rows.clear();
+  patterns.clear();
+}
+
+void FurnaceGUI::findIndexTouch(int subSong, int chan, int pat, int row) {
+  findIndex.updateRow(e,subSong,chan,pat,row);
+}
+
+bool FurnaceGUI::queryMatches(FurnaceGUIFindQuery& l, DivPattern* p, int j, int effectCols) {
+  if (!checkCondition(l.noteMode,l.note,l.noteMax,queryNote(p->data[j][0],p->data[j][1]),true)) return false;
+  if (!checkCondition(l.insMode,l.ins,l.insMax,p->data[j][2])) return false;
+  if (!checkCondition(l.volMode,l.vol,l.volMax,p->data[j][3])) return false;
+
+  if (l.effectCount>0) {
+    bool notMatched=false;
+    switch (curQueryEffectPos) {
+      case 0: // no
+        for (int m=0; m<l.effectCount; m++) {
+          bool allGood=false;
+          for (int n=0; n<effectCols; n++) {
+            if (!checkCondition(l.effectMode[m],l.effect[m],l.effectMax[m],p->data[j][4+n*2])) continue;
+            if (!checkCondition(l.effectValMode[m],l.effectVal[m],l.effectValMax[m],p->data[j][5+n*2])) continue;
+            allGood=true;
+            break;
+          }
+          if (!allGood) {
+            notMatched=true;
+            break;
+          }
+        }
+        break;
+      case 1: { // lax
+        // locate first effect
+        int posOfFirst=-1;
+        for (int m=0; m<effectCols; m++) {
+          if (!checkCondition(l.effectMode[0],l.effect[0],l.effectMax[0],p->data[j][4+m*2])) continue;
+          if (!checkCondition(l.effectValMode[0],l.effectVal[0],l.effectValMax[0],p->data[j][5+m*2])) continue;
+          posOfFirst=m;
+          break;
+        }
+        if (posOfFirst<0) {
+          notMatched=true;
+          break;
+        }
+        // make sure we aren't too far to the right
+        if ((posOfFirst+l.effectCount)>effectCols) {
+          notMatched=true;
+          break;
+        }
+        // search from first effect location
+        for (int m=0; m<l.effectCount; m++) {
+          if (!checkCondition(l.effectMode[m],l.effect[m],l.effectMax[m],p->data[j][4+(m+posOfFirst)*2])) {
+            notMatched=true;
+            break;
+          }
+          if (!checkCondition(l.effectValMode[m],l.effectVal[m],l.effectValMax[m],p->data[j][5+(m+posOfFirst)*2])) {
+            notMatched=true;
+            break;
+          }
+        }
+        break;
+      }
+      case 2: // strict
+        int effectMax=l.effectCount;
+        if (effectMax>effectCols) {
+          notMatched=true;
+        } else {
+          for (int m=0; m<effectMax; m++) {
+            if (!checkCondition(l.effectMode[m],l.effect[m],l.effectMax[m],p->data[j][4+m*2])) {
+              notMatched=true;
+              break;
+            }
+            if (!checkCondition(l.effectValMode[m],l.effectVal[m],l.effectValMax[m],p->data[j][5+m*2])) {
+              notMatched=true;
+              break;
+            }
+          }
+        }
+        break;
+    }
+    if (notMatched) return false;
+  }
+
+  return true;
+}
+
+// returns whether a condition can be looked up in the index, and its value range.
+static bool findIndexRange(int mode, int arg, int argMax, bool noteMode, int& min, int& max) {
+  const int emptyVal=noteMode?-61:-1;
+  switch (mode) {
+    case GUI_QUERY_MATCH:
+      min=arg;
+      max=arg;
+      break;
+    case GUI_QUERY_RANGE:
+      min=arg;
+      max=argMax;
+      break;
+    case GUI_QUERY_ANY:
+      min=-32768;
+      max=32767;
+      return true;
+    default:
+      return false;
+  }
+  // empty cells are not indexed
+  if (emptyVal>=min && emptyVal<=max) return false;
+  return true;
+}
+
 void FurnaceGUI::doFind() {
   int firstOrder=0;
   int lastOrder=e->curSubSong->ordersLen-1;
@@ -117,95 +327,104 @@ void FurnaceGUI::doFind() {
 
   curQueryResults.clear();
 
-  for (int i=firstOrder; i<=lastOrder; i++) {
-    for (int j=firstRow; j<=lastRow; j++) {
-      for (int k=firstChan; k<=lastChan; k++) {
-        DivPattern* p=e->curPat[k].getPattern(e->curOrders->ord[k][i],false);
-        bool matched=false;
-        for (FurnaceGUIFindQuery& l: curQuery) {
-          if (matched) break;
-
-          if (!checkCondition(l.noteMode,l.note,l.noteMax,queryNote(p->data[j][0],p->data[j][1]),true)) continue;
-          if (!checkCondition(l.insMode,l.ins,l.insMax,p->data[j][2])) continue;
-          if (!checkCondition(l.volMode,l.vol,l.volMax,p->data[j][3])) continue;
-
-          if (l.effectCount>0) {
-            bool notMatched=false;
-            switch (curQueryEffectPos) {
-              case 0: // no
-                for (int m=0; m<l.effectCount; m++) {
-                  bool allGood=false;
-                  for (int n=0; n<e->curPat[k].effectCols; n++) {
-                    if (!checkCondition(l.effectMode[m],l.effect[m],l.effectMax[m],p->data[j][4+n*2])) continue;
-                    if (!checkCondition(l.effectValMode[m],l.effectVal[m],l.effectValMax[m],p->data[j][5+n*2])) continue;
-                    allGood=true;
-                    break;
-                  }
-                  if (!allGood) {
-                    notMatched=true;
-                    break;
-                  }
-                }
-                break;
-              case 1: { // lax
-                // locate first effect
-                int posOfFirst=-1;
-                for (int m=0; m<e->curPat[k].effectCols; m++) {
-                  if (!checkCondition(l.effectMode[0],l.effect[0],l.effectMax[0],p->data[j][4+m*2])) continue;
-                  if (!checkCondition(l.effectValMode[0],l.effectVal[0],l.effectValMax[0],p->data[j][5+m*2])) continue;
-                  posOfFirst=m;
-                  break;
-                }
-                if (posOfFirst<0) {
-                  notMatched=true;
-                  break;
-                }
-                // make sure we aren't too far to the right
-                if ((posOfFirst+l.effectCount)>e->curPat[k].effectCols) {
-                  notMatched=true;
-                  break;
-                }
-                // search from first effect location
-                for (int m=0; m<l.effectCount; m++) {
-                  if (!checkCondition(l.effectMode[m],l.effect[m],l.effectMax[m],p->data[j][4+(m+posOfFirst)*2])) {
-                    notMatched=true;
-                    break;
-                  }
-                  if (!checkCondition(l.effectValMode[m],l.effectVal[m],l.effectValMax[m],p->data[j][5+(m+posOfFirst)*2])) {
-                    notMatched=true;
-                    break;
-                  }
-                }
-                break;
-              }
-              case 2: // strict
-                int effectMax=l.effectCount;
-                if (effectMax>e->curPat[k].effectCols) {
-                  notMatched=true;
-                } else {
-                  for (int m=0; m<effectMax; m++) {
-                    if (!checkCondition(l.effectMode[m],l.effect[m],l.effectMax[m],p->data[j][4+m*2])) {
-                      notMatched=true;
-                      break;
-                    }
-                    if (!checkCondition(l.effectValMode[m],l.effectVal[m],l.effectValMax[m],p->data[j][5+m*2])) {
-                      notMatched=true;
-                      break;
-                    }
-                  }
-                }
-                break;
+  // index whatever hasn't been indexed yet, and map patterns to orders
+  int subSong=e->getCurrentSubSong();
+  std::unordered_map<unsigned int,std::vector<int>> patOrders;
+  for (int k=firstChan; k<=lastChan; k++) {
+    for (int i=firstOrder; i<=lastOrder; i++) {
+      int pat=e->curOrders->ord[k][i];
+      if (!findIndex.isIndexed(subSong,k,pat,e->curPat[k].getPattern(pat,false))) {
+        findIndex.indexPattern(e,subSong,k,pat);
+      }
+      patOrders[FurnaceGUIFindIndex::packPat(subSong,k,pat)].push_back(i);
+    }
+  }
+
+  // pick the most selective condition of each query.
+  // if one of them has nothing to look up, scan everything instead.
+  std::vector<unsigned int> candidates;
+  bool fullScan=false;
+  for (FurnaceGUIFindQuery& l: curQuery) {
+    int bestCol=-1;
+    int bestMin=0, bestMax=0;
+    size_t bestCount=0;
+    int min, max;
+
+    auto consider=[&](int col, int mode, int arg, int argMax, bool noteMode) {
+      if (!findIndexRange(mode,arg,argMax,noteMode,min,max)) return;
+      size_t count=findIndex.count(col,min,max);
+      if (bestCol<0 || count<bestCount) {
+        bestCol=col;
+        bestMin=min;
+        bestMax=max;
+        bestCount=count;
+      }
+    };
+
+    consider(GUI_FIND_INDEX_NOTE,l.noteMode,l.note,l.noteMax,true);
+    consider(GUI_FIND_INDEX_INS,l.insMode,l.ins,l.insMax,false);
+    consider(GUI_FIND_INDEX_VOL,l.volMode,l.vol,l.volMax,false);
+    for (int m=0; m<l.effectCount; m++) {
+      consider(GUI_FIND_INDEX_EFFECT,l.effectMode[m],l.effect[m],l.effectMax[m],false);
+      consider(GUI_FIND_INDEX_EFFECT_VAL,l.effectValMode[m],l.effectVal[m],l.effectValMax[m],false);
+    }
+
+    if (bestCol<0) {
+      fullScan=true;
+      break;
+    }
+    findIndex.collect(bestCol,bestMin,bestMax,candidates);
+  }
+
+  if (fullScan) {
+    for (int i=firstOrder; i<=lastOrder; i++) {
+      for (int j=firstRow; j<=lastRow; j++) {
+        for (int k=firstChan; k<=lastChan; k++) {
+          DivPattern* p=e->curPat[k].getPattern(e->curOrders->ord[k][i],false);
+          bool matched=false;
+          for (FurnaceGUIFindQuery& l: curQuery) {
+            if (queryMatches(l,p,j,e->curPat[k].effectCols)) {
+              matched=true;
+              break;
             }
-            if (notMatched) continue;
           }
+          if (matched) {
+            curQueryResults.push_back(FurnaceGUIQueryResult(subSong,i,k,j));
+          }
+        }
+      }
+    }
+  } else {
+    std::sort(candidates.begin(),candidates.end());
+    candidates.erase(std::unique(candidates.begin(),candidates.end()),candidates.end());
+    for (unsigned int loc: candidates) {
+      if (FurnaceGUIFindIndex::locSubSong(loc)!=subSong) continue;
+      int k=FurnaceGUIFindIndex::locChan(loc);
+      int j=FurnaceGUIFindIndex::locRow(loc);
+      if (k<firstChan || k>lastChan) continue;
+      if (j<firstRow || j>lastRow) continue;
+      auto orders=patOrders.find(loc&~0xff);
+      if (orders==patOrders.end()) continue;
 
+      DivPattern* p=e->curPat[k].getPattern(FurnaceGUIFindIndex::locPat(loc),false);
+      bool matched=false;
+      for (FurnaceGUIFindQuery& l: curQuery) {
+        if (queryMatches(l,p,j,e->curPat[k].effectCols)) {
           matched=true;
-        }
-        if (matched) {
-          curQueryResults.push_back(FurnaceGUIQueryResult(e->getCurrentSubSong(),i,k,j));
+          break;
         }
       }
+      if (!matched) continue;
+      for (int i: orders->second) {
+        curQueryResults.push_back(FurnaceGUIQueryResult(subSong,i,k,j));
+      }
     }
+    // sort results in pattern order
+    std::sort(curQueryResults.begin(),curQueryResults.end(),[](const FurnaceGUIQueryResult& a, const FurnaceGUIQueryResult& b) -> bool {
+      if (a.order!=b.order) return a.order<b.order;
+      if (a.y!=b.y) return a.y<b.y;
+      return a.x<b.x;
+    });
   }
   queryViewingResults=true;
 }
@@ -223,9 +442,17 @@ void FurnaceGUI::doReplace() {
   short prevVal[DIV_MAX_COLS];
   memset(prevVal,0,DIV_MAX_COLS*sizeof(short));
 
+  // copy of every pattern as it was before replacing
+  std::map<unsigned int,DivPattern*> oldPats;
+
   for (FurnaceGUIQueryResult& i: curQueryResults) {
     int patIndex=e->song.subsong[i.subsong]->orders.ord[i.x][i.order];
     DivPattern* p=e->song.subsong[i.subsong]->pat[i.x].getPattern(patIndex,true);
+    DivPattern*& oldPat=oldPats[FurnaceGUIFindIndex::packPat(i.subsong,i.x,patIndex)];
+    if (oldPat==NULL) {
+      oldPat=new DivPattern;
+      p->copyOn(oldPat);
+    }
     if (touched[i.x]==NULL) {
       touched[i.x]=new bool[DIV_MAX_PATTERNS*DIV_MAX_ROWS];
       memset(touched[i.x],0,DIV_MAX_PATTERNS*DIV_MAX_ROWS*sizeof(bool));
@@ -461,11 +688,8 @@ void FurnaceGUI::doReplace() {
       }
     }
 
-    // issue undo step
-    for (int j=0; j<DIV_MAX_COLS; j++) {
-      if (p->data[i.y][j]!=prevVal[j]) {
-        us.pat.push_back(UndoPatternData(i.subsong,i.x,patIndex,i.y,j,prevVal[j],p->data[i.y][j]));
-      }
+    if (memcmp(prevVal,p->data[i.y],DIV_MAX_COLS*sizeof(short))!=0) {
+      findIndexTouch(i.subsong,i.x,patIndex,i.y);
     }
   }
 
@@ -473,12 +697,25 @@ void FurnaceGUI::doReplace() {
     if (touched[i]!=NULL) delete[] touched[i];
   }
 
+  // issue undo step
+  for (auto& i: oldPats) {
+    int subSong=FurnaceGUIFindIndex::locSubSong(i.first);
+    int chan=FurnaceGUIFindIndex::locChan(i.first);
+    int patIndex=FurnaceGUIFindIndex::locPat(i.first);
+    DivPattern* p=e->song.subsong[subSong]->pat[chan].getPattern(patIndex,true);
+    UndoPatternBlock block;
+    if (block.build(subSong,chan,patIndex,i.second,p,DIV_MAX_ROWS)) {
+      us.pat.push_back(std::move(block));
+    }
+    delete i.second;
+  }
+
   if (!curQueryResults.empty()) {
     MARK_MODIFIED;
   }
 
   if (!us.pat.empty()) {
-    undoHist.push_back(us);
+    undoHist.push_back(std::move(us));
     redoHist.clear();
     if (undoHist.size()>settings.maxUndoSteps) undoHist.pop_front();
   }
@@ -55,6 +55,7 @@
 #include <unistd.h>
 #include <pwd.h>
 #include <sys/stat.h>
+#include <time.h>
 #define LAYOUT_INI "/layout.ini"
 #define BACKUP_FUR "/backup.fur"
 #endif
@@ -67,6 +68,21 @@
 
 #include "actionUtil.h"
 
+// CPU time used by the calling thread, in microseconds
+static uint64_t getThreadCPUTime() {
+#ifdef _WIN32
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if (!GetThreadTimes(GetCurrentThread(),&creationTime,&exitTime,&kernelTime,&userTime)) return 0;
+  uint64_t kernel=((uint64_t)kernelTime.dwHighDateTime<<32)|kernelTime.dwLowDateTime;
+  uint64_t user=((uint64_t)userTime.dwHighDateTime<<32)|userTime.dwLowDateTime;
+  return (kernel+user)/10;
+#else
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID,&ts)!=0) return 0;
+  return (uint64_t)ts.tv_sec*1000000+ts.tv_nsec/1000;
+#endif
+}
+
 bool Particle::update(float frameTime) {
   pos.x+=speed.x*frameTime;
   pos.y+=speed.y*frameTime;
@@ -1643,8 +1659,8 @@ void FurnaceGUI::openFileDialog(FurnaceGUIFileDialogs type) {
       if (!dirExists(workingDirVGMExport)) workingDirVGMExport=getHomeDir();
       hasOpened=fileDialog->openSave(
         "Export VGM",
-        {"VGM file", "*.vgm"},
-        "VGM file{.vgm}",
+        {vgmExportCompress?"compressed VGM file":"VGM file", vgmExportCompress?"*.vgz":"*.vgm"},
+        vgmExportCompress?"compressed VGM file{.vgz}":"VGM file{.vgm}",
         workingDirVGMExport,
         dpiScale
       );
@@ -1670,6 +1686,16 @@ void FurnaceGUI::openFileDialog(FurnaceGUIFileDialogs type) {
         dpiScale
       );
       break;
+    case GUI_FILE_EXPORT_MULTI:
+      if (!dirExists(workingDirVGMExport)) workingDirVGMExport=getHomeDir();
+      hasOpened=fileDialog->openSave(
+        "Export VGM/ZSM/Command Stream",
+        {"all files", ".*"},
+        ".*",
+        workingDirVGMExport,
+        dpiScale
+      );
+      break;
     case GUI_FILE_EXPORT_ROM:
       showError("Coming soon!");
       break;
@@ -1990,6 +2016,7 @@ int FurnaceGUI::load(String path) {
   lastError="everything OK";
   undoHist.clear();
   redoHist.clear();
+  findIndex.clear();
   updateWindowTitle();
   updateScroll(0);
   if (!e->getWarnings().empty()) {
@@ -2020,6 +2047,95 @@ void FurnaceGUI::exportAudio(String path, DivAudioExportModes mode) {
   displayExporting=true;
 }
 
+void FurnaceGUI::startMultiExport(const String& vgmPath, const String& zsmPath, const String& cmdPath, bool cmdBinary) {
+  multiExport=DivMultiExport();
+  multiExport.vgm=!vgmPath.empty();
+  multiExport.zsm=!zsmPath.empty();
+  multiExport.cmd=!cmdPath.empty();
+  multiExport.vgmSysToExport=willExport;
+  multiExport.vgmLoop=vgmExportLoop;
+  multiExport.vgmVersion=vgmExportVersion;
+  multiExport.vgmPatternHints=vgmExportPatternHints;
+  multiExport.vgmOptimize=vgmExportOptimize;
+  multiExport.zsmRate=zsmExportTickRate;
+  multiExport.zsmLoop=zsmExportLoop;
+  multiExport.cmdBinary=cmdBinary;
+  multiExport.cmdCompress=cmdStreamExportCompress;
+  multiExportPath[0]=vgmPath;
+  multiExportPath[1]=zsmPath;
+  multiExportPath[2]=cmdPath;
+  multiExportAborted=false;
+  if (!e->saveMultiAsync(&multiExport)) {
+    showError("could not start export!");
+    return;
+  }
+  multiExportPending=true;
+  displayExporting=true;
+}
+
+// writes the results of startMultiExport() once the export thread is done.
+void FurnaceGUI::finishMultiExport() {
+  SafeWriter* out[3]={multiExport.vgmOut, multiExport.zsmOut, multiExport.cmdOut};
+  const char* formatNames[3]={"VGM", "ZSM", "command stream"};
+  String errors;
+  multiExportPending=false;
+  for (int i=0; i<3; i++) {
+    if (multiExportPath[i].empty()) continue;
+    if (out[i]==NULL) {
+      if (!multiExportAborted) {
+        errors+=fmt::sprintf("could not write %s! (%s)\n",formatNames[i],e->getLastError());
+      }
+      continue;
+    }
+    FILE* f=ps_fopen(multiExportPath[i].c_str(),"wb");
+    if (f!=NULL) {
+      if (i==0 && vgmExportCompress) {
+        if (!e->writeVGZ(out[i],f)) {
+          errors+=fmt::sprintf("could not compress VGM! (%s)\n",e->getLastError());
+        }
+      } else {
+        fwrite(out[i]->getFinalBuf(),1,out[i]->size(),f);
+      }
+      fclose(f);
+    } else {
+      errors+=fmt::sprintf("could not open %s!\n",multiExportPath[i]);
+    }
+    out[i]->finish();
+    delete out[i];
+  }
+  multiExport.vgmOut=NULL;
+  multiExport.zsmOut=NULL;
+  multiExport.cmdOut=NULL;
+  if (!errors.empty()) {
+    showError(errors);
+  } else if (!multiExportAborted && !e->getWarnings().empty()) {
+    showWarning(e->getWarnings(),GUI_WARN_GENERIC);
+  }
+}
+
+bool FurnaceGUI::openInsBank(const String& path, bool single) {
+  DivInsBank* bank=e->indexInsBank(path.c_str());
+  if (bank==NULL) return false;
+  // let the regular path deal with banks holding a single instrument
+  if (bank->entries.size()<2) {
+    delete bank;
+    return false;
+  }
+  if (!e->getWarnings().empty()) {
+    showWarning(e->getWarnings(),GUI_WARN_GENERIC);
+  }
+  if (pendingInsBank!=NULL) {
+    delete pendingInsBank;
+  }
+  pendingInsBank=bank;
+  for (size_t i=0; i<bank->entries.size(); i++) {
+    pendingIns.push_back(std::make_pair((DivInstrument*)NULL,false));
+  }
+  displayPendingIns=true;
+  pendingInsSingle=single;
+  return true;
+}
+
 void FurnaceGUI::showWarning(String what, FurnaceGUIWarnings type) {
   warnString=what;
   warnAction=type;
@@ -3012,6 +3128,67 @@ bool FurnaceGUI::detectOutOfBoundsWindow() {
   return false;
 }
 
+bool FurnaceGUI::checkDamage() {
+  bool ret=false;
+  bool playing=e->isPlaying();
+  if (playing!=damagePlaying) {
+    damagePlaying=playing;
+    ret=true;
+  }
+  if (playing) {
+    int ord=e->getOrder();
+    int row=e->getRow();
+    if (ord!=damageOrder) {
+      // order list and pattern change
+      ret=true;
+    } else if (row!=damageRow) {
+      // only redraw if the play head enters or leaves the visible rows
+      if (followPattern) {
+        ret=true;
+      } else if (ord==damageVisOrder) {
+        if (row>=damageVisRowMin && row<=damageVisRowMax) ret=true;
+        if (damageRow>=damageVisRowMin && damageRow<=damageVisRowMax) ret=true;
+      }
+    }
+    damageOrder=ord;
+    damageRow=row;
+  }
+
+  // visualizers are throttled to settings.visualizerRate
+  if (oscOpen || chanOscOpen || volMeterOpen || pianoOpen || regViewOpen || clockOpen || e->isExporting()) {
+    uint64_t now=SDL_GetPerformanceCounter();
+    if (now>=damageNextVis) {
+      float tapPeak[2], rms[2];
+      e->getOscPeak(damageOscBlock,tapPeak,rms);
+      if (playing || e->isExporting() || tapPeak[0]>0.0f || tapPeak[1]>0.0f) {
+        ret=true;
+      }
+      // let the peak meters decay
+      if (peak[0]>0.0f || peak[1]>0.0f) ret=true;
+      damageNextVis=now+SDL_GetPerformanceFrequency()/settings.visualizerRate;
+    }
+  }
+  return ret;
+}
+
+int FurnaceGUI::damageTimeout() {
+  int ret=500;
+  if (e->isPlaying()) {
+    // poll the play head often enough to not miss rows
+    ret=8;
+  }
+  if (oscOpen || chanOscOpen || volMeterOpen || pianoOpen || regViewOpen || clockOpen || e->isExporting()) {
+    uint64_t now=SDL_GetPerformanceCounter();
+    int visWait=0;
+    if (damageNextVis>now) {
+      visWait=((damageNextVis-now)*1000)/SDL_GetPerformanceFrequency();
+    }
+    if (visWait<1) visWait=1;
+    if (visWait<ret) ret=visWait;
+  }
+  return ret;
+}
+
 bool FurnaceGUI::loop() {
 #ifdef IS_MOBILE
   bool doThreadedInput=true;
@@ -3027,12 +3204,19 @@ bool FurnaceGUI::loop() {
 
   while (!quit) {
     SDL_Event ev;
-    if (e->isPlaying()) {
+    bool damaged=false;
+    if (settings.damageRedraw) {
+      damaged=checkDamage();
+    } else if (e->isPlaying()) {
       WAKE_UP;
     }
     if (--drawHalt<=0) {
       drawHalt=0;
-      if (settings.powerSave) SDL_WaitEventTimeout(NULL,500);
+      if (settings.damageRedraw) {
+        if (!damaged) SDL_WaitEventTimeout(NULL,damageTimeout());
+      } else if (settings.powerSave) {
+        SDL_WaitEventTimeout(NULL,500);
+      }
     }
     eventTimeBegin=SDL_GetPerformanceCounter();
     bool updateWindow=false;
@@ -3207,6 +3391,7 @@ bool FurnaceGUI::loop() {
       }
       TAMidiMessage msg=midiQueue.front();
       midiLock.unlock();
+      WAKE_UP;
 
       if (msg.type==TA_MIDI_SYSEX) {
         unsigned char* data=msg.sysExData.get();
@@ -3353,6 +3538,15 @@ bool FurnaceGUI::loop() {
 
     eventTimeEnd=SDL_GetPerformanceCounter();
 
+    // skip the frame if nothing changed since the last one
+    if (settings.damageRedraw && drawHalt<=0 && !damaged) {
+      if (!checkDamage()) {
+        frameSkipCount++;
+        frameBusy+=eventTimeEnd-eventTimeBegin;
+        continue;
+      }
+    }
+
     layoutTimeBegin=SDL_GetPerformanceCounter();
 
     ImGui_ImplSDLRenderer_NewFrame();
@@ -3479,6 +3673,15 @@ bool FurnaceGUI::loop() {
               "at the cost of a massive increase in file size."
             );
           }
+          ImGui::Checkbox("optimize",&vgmExportOptimize);
+          if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip(
+              "removes register writes which don't change anything,\n"
+              "merges waits and stores identical samples only once.\n"
+              "see the log for the size reduction."
+            );
+          }
+          ImGui::Checkbox("compress (.vgz)",&vgmExportCompress);
           ImGui::Text("chips to export:");
           bool hasOneAtLeast=false;
           for (int i=0; i<e->song.systemLen; i++) {
@@ -3537,11 +3740,46 @@ bool FurnaceGUI::loop() {
 
             "technical/development use only!"
           );
+          ImGui::Checkbox("compress (binary only)",&cmdStreamExportCompress);
           if (ImGui::Button("export")) {
             openFileDialog(GUI_FILE_EXPORT_CMDSTREAM);
           }
           ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("export several formats...")) {
+          ImGui::Text(
+            "plays the song once and writes each selected format\n"
+            "using the settings from its own export menu.\n"
+            "the extension is added to the file name."
+          );
+          ImGui::BeginDisabled(vgmExportDirectStream);
+          ImGui::Checkbox("VGM",&multiExportVGM);
+          ImGui::EndDisabled();
+          if (vgmExportDirectStream && ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+            ImGui::SetTooltip("not available in direct stream mode.");
+          }
+          ImGui::BeginDisabled(numZSMCompat==0);
+          ImGui::Checkbox("ZSM",&multiExportZSM);
+          ImGui::EndDisabled();
+          ImGui::Checkbox("command stream",&multiExportCmd);
+          ImGui::Indent();
+          ImGui::BeginDisabled(!multiExportCmd);
+          ImGui::Checkbox("binary",&multiExportCmdBinary);
+          ImGui::EndDisabled();
+          ImGui::Unindent();
+          bool multiVGM=multiExportVGM && !vgmExportDirectStream;
+          bool multiZSM=multiExportZSM && numZSMCompat>0;
+          if (multiVGM || multiZSM || multiExportCmd) {
+            if (ImGui::Button("export")) {
+              multiExportVGM=multiVGM;
+              multiExportZSM=multiZSM;
+              openFileDialog(GUI_FILE_EXPORT_MULTI);
+            }
+          } else {
+            ImGui::Text("nothing to export");
+          }
+          ImGui::EndMenu();
+        }
         ImGui::Separator();
         if (ImGui::BeginMenu("add chip...")) {
           DivSystem picked=systemPicker();
@@ -3689,6 +3927,7 @@ bool FurnaceGUI::loop() {
         if (ImGui::MenuItem("oscilloscope (per-channel)",BIND_FOR(GUI_ACTION_WINDOW_CHAN_OSC),chanOscOpen)) chanOscOpen=!chanOscOpen;
         if (ImGui::MenuItem("volume meter",BIND_FOR(GUI_ACTION_WINDOW_VOL_METER),volMeterOpen)) volMeterOpen=!volMeterOpen;
         if (ImGui::MenuItem("clock",BIND_FOR(GUI_ACTION_WINDOW_CLOCK),clockOpen)) clockOpen=!clockOpen;
+        if (ImGui::MenuItem("instrument library",BIND_FOR(GUI_ACTION_WINDOW_INS_LIBRARY),insLibOpen)) insLibOpen=!insLibOpen;
         if (ImGui::MenuItem("register view",BIND_FOR(GUI_ACTION_WINDOW_REGISTER_VIEW),regViewOpen)) regViewOpen=!regViewOpen;
         if (ImGui::MenuItem("log viewer",BIND_FOR(GUI_ACTION_WINDOW_LOG),logOpen)) logOpen=!logOpen;
         if (ImGui::MenuItem("statistics",BIND_FOR(GUI_ACTION_WINDOW_STATS),statsOpen)) statsOpen=!statsOpen;
@@ -3868,6 +4107,7 @@ bool FurnaceGUI::loop() {
       drawPatManager();
       drawSysManager();
       drawClock();
+      drawInsLibrary();
       drawRegView();
       drawLog();
       drawEffectList();
@@ -3955,6 +4195,7 @@ bool FurnaceGUI::loop() {
           workingDirAudioExport=fileDialog->getPath()+DIR_SEPARATOR_STR;
           break;
         case GUI_FILE_EXPORT_VGM:
+        case GUI_FILE_EXPORT_MULTI:
           workingDirVGMExport=fileDialog->getPath()+DIR_SEPARATOR_STR;
           break;
         case GUI_FILE_EXPORT_ZSM:
@@ -4043,7 +4284,7 @@ bool FurnaceGUI::loop() {
             checkExtension(".raw");
           }
           if (curFileDialog==GUI_FILE_EXPORT_VGM) {
-            checkExtension(".vgm");
+            checkExtension(vgmExportCompress?".vgz":".vgm");
           }
           if (curFileDialog==GUI_FILE_EXPORT_ZSM) {
             checkExtension(".zsm");
@@ -4227,6 +4468,10 @@ bool FurnaceGUI::loop() {
               bool warn=false;
               String warns="there were some warnings/errors while loading instruments:\n";
               int sampleCountBefore=e->song.sampleLen;
+              if (fileDialog->getFileName().size()==1) {
+                // only decode the instruments which get picked
+                if (openInsBank(copyOfName,false)) break;
+              }
               for (String i: fileDialog->getFileName()) {
                 std::vector<DivInstrument*> insTemp=e->instrumentFromFile(i.c_str());
                 if (insTemp.empty()) {
@@ -4273,6 +4518,7 @@ bool FurnaceGUI::loop() {
               break;
             }
             case GUI_FILE_INS_OPEN_REPLACE: {
+              if (openInsBank(copyOfName,true)) break;
               int sampleCountBefore=e->song.sampleLen;
               std::vector<DivInstrument*> instruments=e->instrumentFromFile(copyOfName.c_str());
               if (!instruments.empty()) {
@@ -4352,11 +4598,23 @@ bool FurnaceGUI::loop() {
               break;
             }
             case GUI_FILE_EXPORT_VGM: {
-              SafeWriter* w=e->saveVGM(willExport,vgmExportLoop,vgmExportVersion,vgmExportPatternHints,vgmExportDirectStream);
+              if (!vgmExportDirectStream) {
+                // recorded on the export thread
+                startMultiExport(copyOfName,"","",false);
+                break;
+              }
+              // direct stream mode needs its own pass
+              SafeWriter* w=e->saveVGM(willExport,vgmExportLoop,vgmExportVersion,vgmExportPatternHints,vgmExportDirectStream,vgmExportOptimize);
               if (w!=NULL) {
                 FILE* f=ps_fopen(copyOfName.c_str(),"wb");
                 if (f!=NULL) {
-                  fwrite(w->getFinalBuf(),1,w->size(),f);
+                  if (vgmExportCompress) {
+                    if (!e->writeVGZ(w,f)) {
+                      showError(fmt::sprintf("could not compress VGM! (%s)",e->getLastError()));
+                    }
+                  } else {
+                    fwrite(w->getFinalBuf(),1,w->size(),f);
+                  }
                   fclose(f);
                 } else {
                   showError("could not open file!");
@@ -4371,26 +4629,9 @@ bool FurnaceGUI::loop() {
               }
               break;
             }
-            case GUI_FILE_EXPORT_ZSM: {
-              SafeWriter* w=e->saveZSM(zsmExportTickRate,zsmExportLoop);
-              if (w!=NULL) {
-                FILE* f=ps_fopen(copyOfName.c_str(),"wb");
-                if (f!=NULL) {
-                  fwrite(w->getFinalBuf(),1,w->size(),f);
-                  fclose(f);
-                } else {
-                  showError("could not open file!");
-                }
-                w->finish();
-                delete w;
-                if (!e->getWarnings().empty()) {
-                  showWarning(e->getWarnings(),GUI_WARN_GENERIC);
-                }
-              } else {
-                showError(fmt::sprintf("Could not write ZSM! (%s)",e->getLastError()));
-              }
+            case GUI_FILE_EXPORT_ZSM:
+              startMultiExport("",copyOfName,"",false);
               break;
-            }
             case GUI_FILE_EXPORT_ROM:
               showError("Coming soon!");
               break;
@@ -4403,24 +4644,23 @@ bool FurnaceGUI::loop() {
               if ((lowerCase.size()<4 || lowerCase.rfind(".bin")!=lowerCase.size()-4)) {
                 isBinary=false;
               }
-
-              SafeWriter* w=e->saveCommand(isBinary);
-              if (w!=NULL) {
-                FILE* f=ps_fopen(copyOfName.c_str(),"wb");
-                if (f!=NULL) {
-                  fwrite(w->getFinalBuf(),1,w->size(),f);
-                  fclose(f);
-                } else {
-                  showError("could not open file!");
-                }
-                w->finish();
-                delete w;
-                if (!e->getWarnings().empty()) {
-                  showWarning(e->getWarnings(),GUI_WARN_GENERIC);
-                }
-              } else {
-                showError(fmt::sprintf("could not write command stream! (%s)",e->getLastError()));
+              startMultiExport("","",copyOfName,isBinary);
+              break;
+            }
+            case GUI_FILE_EXPORT_MULTI: {
+              // the name is a base for each file
+              String baseName=copyOfName;
+              size_t extPos=baseName.rfind('.');
+              size_t sepPos=baseName.rfind(DIR_SEPARATOR);
+              if (extPos!=String::npos && (sepPos==String::npos || extPos>sepPos)) {
+                baseName=baseName.substr(0,extPos);
               }
+              startMultiExport(
+                multiExportVGM?(baseName+(vgmExportCompress?".vgz":".vgm")):"",
+                multiExportZSM?(baseName+".zsm"):"",
+                multiExportCmd?(baseName+(multiExportCmdBinary?".bin":".txt")):"",
+                multiExportCmdBinary
+              );
               break;
             }
             case GUI_FILE_LOAD_MAIN_FONT:
@@ -4512,6 +4752,10 @@ bool FurnaceGUI::loop() {
       ImGui::OpenPopup("Rendering...");
     }
 
+    if (multiExportPending && !e->isExporting()) {
+      finishMultiExport();
+    }
+
     if (displayNew) {
       displayNew=false;
       ImGui::OpenPopup("New Song");
@@ -4525,7 +4769,12 @@ bool FurnaceGUI::loop() {
 
     if (ImGui::BeginPopupModal("Rendering...",NULL,ImGuiWindowFlags_AlwaysAutoResize)) {
       ImGui::Text("Please wait...");
+      if (e->isExporting()) {
+        ImGui::Text("order %d/%d",(int)e->getOrder()+1,(int)e->curSubSong->ordersLen);
+        WAKE_UP;
+      }
       if (ImGui::Button("Abort")) {
+        if (multiExportPending) multiExportAborted=true;
         if (e->haltAudioFile()) {
           ImGui::CloseCurrentPopup();
         }
@@ -4746,6 +4995,7 @@ bool FurnaceGUI::loop() {
           if (ImGui::Button("All subsongs")) {
             stop();
             e->clearSubSongs();
+            findIndex.clear();
             curOrder=0;
             oldOrder=0;
             oldOrder1=0;
@@ -4834,6 +5084,7 @@ bool FurnaceGUI::loop() {
             if (e->removeSubSong(e->getCurrentSubSong())) {
               undoHist.clear();
               redoHist.clear();
+              findIndex.clear();
               updateScroll(0);
               oldOrder=0;
               oldOrder1=0;
@@ -4940,20 +5191,34 @@ bool FurnaceGUI::loop() {
         sizeY=canvasH-180.0*dpiScale;
         if (sizeY<60.0*dpiScale) sizeY=60.0*dpiScale;
       }
+      for (std::pair<DivInstrument*,bool>& i: pendingIns) {
+        if (i.second) {
+          anySelected=true;
+          break;
+        }
+      }
       if (ImGui::BeginTable("PendingInsList",1,ImGuiTableFlags_ScrollY,ImVec2(0.0f,sizeY))) {
-        for (size_t i=0; i<pendingIns.size(); i++) {
-          ImGui::TableNextRow();
-          ImGui::TableNextColumn();
-          String id=fmt::sprintf("%d: %s",(int)i,pendingIns[i].first->name);
-          if (pendingInsSingle) {
-            if (ImGui::Selectable(id.c_str())) {
-              pendingIns[i].second=true;
-              quitPlease=true;
+        // banks may be huge
+        ImGuiListClipper clipper;
+        clipper.Begin(pendingIns.size());
+        while (clipper.Step()) {
+          for (int i=clipper.DisplayStart; i<clipper.DisplayEnd; i++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            // entries of an indexed bank are not decoded yet
+            const String& name=(pendingIns[i].first==NULL && pendingInsBank!=NULL)?pendingInsBank->entries[i].name:pendingIns[i].first->name;
+            String id=fmt::sprintf("%d: %s",i,name);
+            if (pendingInsSingle) {
+              if (ImGui::Selectable(id.c_str())) {
+                pendingIns[i].second=true;
+                quitPlease=true;
+              }
+            } else {
+              if (ImGui::Checkbox(id.c_str(),&pendingIns[i].second)) {
+                if (pendingIns[i].second) anySelected=true;
+              }
             }
-          } else {
-            ImGui::Checkbox(id.c_str(),&pendingIns[i].second);
           }
-          if (pendingIns[i].second) anySelected=true;
         }
         ImGui::EndTable();
       }
@@ -4973,7 +5238,17 @@ bool FurnaceGUI::loop() {
       }
       if (quitPlease) {
         ImGui::CloseCurrentPopup();
-        for (std::pair<DivInstrument*,bool>& i: pendingIns) {
+        for (size_t j=0; j<pendingIns.size(); j++) {
+          std::pair<DivInstrument*,bool>& i=pendingIns[j];
+          if (i.first==NULL) {
+            // decode selected bank entries
+            if (!i.second || pendingInsBank==NULL) continue;
+            i.first=e->instrumentFromBank(pendingInsBank,j);
+            if (i.first==NULL) {
+              showError("cannot load instrument! ("+e->getLastError()+")");
+              continue;
+            }
+          }
           if (!i.second || pendingInsSingle) {
             if (i.second) {
               if (curIns>=0 && curIns<(int)e->song.ins.size()) {
@@ -4988,6 +5263,10 @@ bool FurnaceGUI::loop() {
           }
         }
         pendingIns.clear();
+        if (pendingInsBank!=NULL) {
+          delete pendingInsBank;
+          pendingInsBank=NULL;
+        }
       }
       ImGui::EndPopup();
     }
@@ -5084,13 +5363,39 @@ bool FurnaceGUI::loop() {
     renderTimeBegin=SDL_GetPerformanceCounter();
     ImGui::Render();
     renderTimeEnd=SDL_GetPerformanceCounter();
+    drawTimeBegin=SDL_GetPerformanceCounter();
     ImGui_ImplSDLRenderer_RenderDrawData(ImGui::GetDrawData());
+    drawTimeEnd=SDL_GetPerformanceCounter();
     SDL_RenderPresent(sdlRend);
 
     layoutTimeDelta=layoutTimeEnd-layoutTimeBegin;
     renderTimeDelta=renderTimeEnd-renderTimeBegin;
+    drawTimeDelta=drawTimeEnd-drawTimeBegin;
     eventTimeDelta=eventTimeEnd-eventTimeBegin;
 
+    // frame statistics
+    // presenting is left out of the busy time since it may wait for vsync
+    frameCount++;
+    frameBusy+=layoutTimeDelta+renderTimeDelta+drawTimeDelta+eventTimeDelta;
+    uint64_t frameStatNow=SDL_GetPerformanceCounter();
+    if (frameStatBegin==0) {
+      frameStatBegin=frameStatNow;
+      frameCPUBegin=getThreadCPUTime();
+    }
+    if (frameStatNow-frameStatBegin>=SDL_GetPerformanceFrequency()) {
+      double elapsed=(double)(frameStatNow-frameStatBegin)/(double)SDL_GetPerformanceFrequency();
+      uint64_t cpuNow=getThreadCPUTime();
+      frameRate=round((double)frameCount/elapsed);
+      frameSkipRate=round((double)frameSkipCount/elapsed);
+      frameBusyRatio=(double)frameBusy/(double)(frameStatNow-frameStatBegin);
+      frameCPU=(double)(cpuNow-frameCPUBegin)/(elapsed*1000000.0);
+      frameCount=0;
+      frameSkipCount=0;
+      frameBusy=0;
+      frameStatBegin=frameStatNow;
+      frameCPUBegin=cpuNow;
+    }
+
     if (--soloTimeout<0) soloTimeout=0;
 
     wheelX=0;
@@ -5163,6 +5468,8 @@ bool FurnaceGUI::init() {
   patManagerOpen=e->getConfBool("patManagerOpen",false);
   sysManagerOpen=e->getConfBool("sysManagerOpen",false);
   clockOpen=e->getConfBool("clockOpen",false);
+  insLibOpen=e->getConfBool("insLibOpen",false);
+  insLibPath=e->getConfString("insLibPath","");
   regViewOpen=e->getConfBool("regViewOpen",false);
   logOpen=e->getConfBool("logOpen",false);
   effectListOpen=e->getConfBool("effectListOpen",false);
@@ -5439,6 +5746,13 @@ bool FurnaceGUI::init() {
     midiLock.lock();
     midiQueue.push(msg);
     midiLock.unlock();
+    if (settings.damageRedraw) {
+      // wake the GUI thread up
+      SDL_Event wakeEv;
+      memset(&wakeEv,0,sizeof(SDL_Event));
+      wakeEv.type=SDL_USEREVENT;
+      SDL_PushEvent(&wakeEv);
+    }
     e->setMidiBaseChan(cursor.xCoarse);
     if (msg.type==TA_MIDI_SYSEX) return -2;
     if (midiMap.valueInputStyle!=0 && cursor.xFine!=0 && edit) return -2;
@@ -5533,6 +5847,8 @@ void FurnaceGUI::commitState() {
   e->setConf("patManagerOpen",patManagerOpen);
   e->setConf("sysManagerOpen",sysManagerOpen);
   e->setConf("clockOpen",clockOpen);
+  e->setConf("insLibOpen",insLibOpen);
+  e->setConf("insLibPath",insLibPath);
   e->setConf("regViewOpen",regViewOpen);
   e->setConf("logOpen",logOpen);
   e->setConf("effectListOpen",effectListOpen);
@@ -5608,6 +5924,15 @@ void FurnaceGUI::commitState() {
 
 bool FurnaceGUI::finish() {
   commitState();
+  stopInsLibScan();
+  if (insLibParser!=NULL) {
+    delete insLibParser;
+    insLibParser=NULL;
+  }
+  if (insLibBank!=NULL) {
+    delete insLibBank;
+    insLibBank=NULL;
+  }
   ImGui_ImplSDLRenderer_Shutdown();
   ImGui_ImplSDL2_Shutdown();
   ImGui::DestroyContext();
@@ -5650,6 +5975,9 @@ FurnaceGUI::FurnaceGUI():
   zsmExportLoop(true),
   vgmExportPatternHints(false),
   vgmExportDirectStream(false),
+  vgmExportOptimize(true),
+  vgmExportCompress(false),
+  cmdStreamExportCompress(false),
   displayInsTypeList(false),
   portrait(false),
   injectBackUp(false),
@@ -5668,7 +5996,30 @@ FurnaceGUI::FurnaceGUI():
   snesFilterHex(false),
   mobileEdit(false),
   vgmExportVersion(0x171),
+  multiExportPending(false),
+  multiExportAborted(false),
+  multiExportVGM(true),
+  multiExportZSM(false),
+  multiExportCmd(false),
+  multiExportCmdBinary(true),
   drawHalt(10),
+  damageOrder(-1),
+  damageRow(-1),
+  damageVisOrder(-1),
+  damageVisRowMin(0),
+  damageVisRowMax(-1),
+  damagePlaying(false),
+  damageOscBlock(0),
+  damageNextVis(0),
+  frameCount(0),
+  frameSkipCount(0),
+  frameRate(0),
+  frameSkipRate(0),
+  frameStatBegin(0),
+  frameBusy(0),
+  frameCPUBegin(0),
+  frameBusyRatio(0.0),
+  frameCPU(0.0),
   zsmExportTickRate(60),
   macroPointSize(16),
   waveEditStyle(0),
@@ -5778,6 +6129,7 @@ FurnaceGUI::FurnaceGUI():
   patManagerOpen(false),
   sysManagerOpen(false),
   clockOpen(false),
+  insLibOpen(false),
   clockShowReal(true),
   clockShowRow(true),
   clockShowBeat(true),
@@ -5845,6 +6197,7 @@ FurnaceGUI::FurnaceGUI():
   queryReplaceInsDo(false),
   queryReplaceVolDo(false),
   queryViewingResults(false),
+  pendingInsBank(NULL),
   wavePreviewOn(false),
   wavePreviewKey((SDL_Scancode)0),
   wavePreviewNote(0),
@@ -5910,13 +6263,34 @@ FurnaceGUI::FurnaceGUI():
   renderTimeBegin(0),
   renderTimeEnd(0),
   renderTimeDelta(0),
+  drawTimeBegin(0),
+  drawTimeEnd(0),
+  drawTimeDelta(0),
   eventTimeBegin(0),
   eventTimeEnd(0),
   eventTimeDelta(0),
+  patternTimeBegin(0),
+  patternTimeEnd(0),
+  patternTimeDelta(0),
   chanToMove(-1),
   sysToMove(-1),
   sysToDelete(-1),
   opToMove(-1),
+  patRowCacheUse(0),
+  patRowCacheGen(1),
+  patRowCacheHits(0),
+  patRowCacheMisses(0),
+  insLibThread(NULL),
+  insLibQuit(false),
+  insLibScanning(false),
+  insLibChanged(false),
+  insLibScanned(0),
+  insLibParser(NULL),
+  insLibBank(NULL),
+  insLibSel(-1),
+  insLibPrevIns(-3),
+  insLibShowDups(true),
+  insLibFilterDirty(true),
   transposeAmount(0),
   randomizeMin(0),
   randomizeMax(255),
@@ -5963,7 +6337,7 @@ FurnaceGUI::FurnaceGUI():
   openSampleAmplifyOpt(false),
   openSampleSilenceOpt(false),
   openSampleFilterOpt(false),
-  oscTotal(0),
+  oscTapBlock(0),
   oscZoom(0.5f),
   oscWindowSize(20.0f),
   oscZoomSlider(false),
@@ -6063,6 +6437,7 @@ FurnaceGUI::FurnaceGUI():
   memset(patChanSlideY,0,sizeof(float)*(DIV_MAX_CHANS+1));
   memset(lastIns,-1,sizeof(int)*DIV_MAX_CHANS);
   memset(oscValues,0,sizeof(float)*512);
+  memset(oscRMS,0,sizeof(float)*2);
 
   memset(chanOscLP0,0,sizeof(float)*DIV_MAX_CHANS);
   memset(chanOscLP1,0,sizeof(float)*DIV_MAX_CHANS);
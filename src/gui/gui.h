@@ -33,7 +33,10 @@
 #include <future>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include "fileDialog.h"
@@ -313,7 +316,8 @@ enum FurnaceGUIWindows {
   GUI_WINDOW_SUBSONGS,
   GUI_WINDOW_FIND,
   GUI_WINDOW_CLOCK,
-  GUI_WINDOW_SPOILER
+  GUI_WINDOW_SPOILER,
+  GUI_WINDOW_INS_LIBRARY
 };
 
 enum FurnaceGUIMobileScenes {
@@ -354,6 +358,7 @@ enum FurnaceGUIFileDialogs {
   GUI_FILE_EXPORT_VGM,
   GUI_FILE_EXPORT_ZSM,
   GUI_FILE_EXPORT_CMDSTREAM,
+  GUI_FILE_EXPORT_MULTI,
   GUI_FILE_EXPORT_ROM,
   GUI_FILE_LOAD_MAIN_FONT,
   GUI_FILE_LOAD_PAT_FONT,
@@ -456,6 +461,7 @@ enum FurnaceGUIActions {
   GUI_ACTION_WINDOW_SUBSONGS,
   GUI_ACTION_WINDOW_FIND,
   GUI_ACTION_WINDOW_CLOCK,
+  GUI_ACTION_WINDOW_INS_LIBRARY,
 
   GUI_ACTION_COLLAPSE_WINDOW,
   GUI_ACTION_CLOSE_WINDOW,
@@ -705,17 +711,37 @@ enum ActionType {
   GUI_UNDO_REPLACE
 };
 
-struct UndoPatternData {
-  int subSong, chan, pat, row, col;
+// a run of cells in an UndoPatternBlock.
+// runs where oldVal==newVal are cells that weren't changed, and are skipped.
+struct UndoPatternRun {
   short oldVal, newVal;
-  UndoPatternData(int s, int c, int p, int r, int co, short v1, short v2):
-    subSong(s),
-    chan(c),
-    pat(p),
-    row(r),
-    col(co),
+  unsigned short len;
+  UndoPatternRun(short v1, short v2, unsigned short l):
     oldVal(v1),
-    newVal(v2) {}
+    newVal(v2),
+    len(l) {}
+};
+
+// all changes an action made to one pattern: the bounding rectangle of the
+// changed cells, run-length encoded in row-major order.
+struct UndoPatternBlock {
+  int subSong, chan, pat;
+  int rowStart, rowEnd, colStart, colEnd;
+  std::vector<UndoPatternRun> runs;
+
+  // compare a pattern before and after an action.
+  // returns false if nothing changed.
+  bool build(int s, int c, int p, DivPattern* oldPat, DivPattern* newPat, int rows);
+  // write the old (undo) or new (redo) values back.
+  void apply(DivPattern* p, bool redo) const;
+  UndoPatternBlock():
+    subSong(0),
+    chan(0),
+    pat(0),
+    rowStart(0),
+    rowEnd(-1),
+    colStart(0),
+    colEnd(-1) {}
 };
 
 struct UndoOrderData {
@@ -737,7 +763,7 @@ struct UndoStep {
   int oldOrdersLen, newOrdersLen;
   int oldPatLen, newPatLen;
   std::vector<UndoOrderData> ord;
-  std::vector<UndoPatternData> pat;
+  std::vector<UndoPatternBlock> pat;
 };
 
 // -1 = any
@@ -1069,6 +1095,116 @@ struct FurnaceGUIQueryResult {
     y(yPos) {}
 };
 
+enum FurnaceGUIFindIndexColumns {
+  GUI_FIND_INDEX_NOTE=0,
+  GUI_FIND_INDEX_INS,
+  GUI_FIND_INDEX_VOL,
+  GUI_FIND_INDEX_EFFECT,
+  GUI_FIND_INDEX_EFFECT_VAL,
+
+  GUI_FIND_INDEX_MAX
+};
+
+// an instrument in the instrument library.
+// the library is built by a scanner thread and cached in the config directory, so that
+// browsing it does not require loading any file.
+struct FurnaceGUIInsLibEntry {
+  // relative to the library directory
+  String path;
+  // file extension
+  String format;
+  String name;
+  DivInstrumentType type;
+  // hash of the instrument data (excluding the name), used to find duplicates
+  uint64_t hash;
+  int64_t mtime, size;
+  // position of the instrument in the file, or -1 if the file could not be loaded
+  int index;
+  bool dup;
+  FurnaceGUIInsLibEntry():
+    type(DIV_INS_FM),
+    hash(0),
+    mtime(0),
+    size(0),
+    index(-1),
+    dup(false) {}
+};
+
+// formatted labels of a pattern cell row, as drawn by patternRow().
+// an entry is rebuilt only when the cell data or the label generation
+// (bumped by applyUISettings()) no longer match.
+// labels of a pattern row. they point to a note name, a label setting or a
+// hex digit pair, so an entry holds no text of its own.
+struct FurnaceGUIPatRowCache {
+  short data[DIV_MAX_COLS];
+  unsigned int gen;
+  int fxCols;
+  const char* note;
+  const char* ins;
+  const char* vol;
+  const char* fx[DIV_MAX_EFFECTS];
+  const char* fxVal[DIV_MAX_EFFECTS];
+  FurnaceGUIPatRowCache():
+    gen(0),
+    fxCols(0),
+    note(""),
+    ins(""),
+    vol("") {
+    memset(data,0,DIV_MAX_COLS*sizeof(short));
+  }
+};
+
+// previous, current and next pattern may be visible at the same time
+#define GUI_PAT_ROW_CACHE_SLOTS 3
+
+// row label cache of one pattern in a channel, indexed by row.
+// it grows up to the pattern length.
+struct FurnaceGUIPatRowCacheSlot {
+  // pattern index, or -1 if unused
+  int pat;
+  unsigned int lastUse;
+  std::vector<FurnaceGUIPatRowCache> rows;
+  FurnaceGUIPatRowCacheSlot():
+    pat(-1),
+    lastUse(0) {}
+};
+
+// inverted index over pattern contents, used by find/replace.
+// locations are packed (subsong, channel, pattern, row) tuples.
+// patterns are indexed lazily the first time a query needs them, and kept
+// up to date by the edit/undo paths through updateRow().
+struct FurnaceGUIFindIndex {
+  // value -> locations holding that value (empty values are not indexed)
+  std::map<int,std::set<unsigned int>> postings[GUI_FIND_INDEX_MAX];
+  // indexed values of each location, so that they can be removed later
+  std::unordered_map<unsigned int,std::vector<short>> rows;
+  // indexed (subsong, channel, pattern) tuples, along with the pattern they
+  // were read from (to notice channel swaps and the like)
+  std::unordered_map<unsigned int,DivPattern*> patterns;
+
+  static unsigned int packPat(int subsong, int chan, int pat) {
+    return ((subsong&0xff)<<24)|((chan&0x7f)<<16)|((pat&0xff)<<8);
+  }
+  static unsigned int pack(int subsong, int chan, int pat, int row) {
+    return packPat(subsong,chan,pat)|(row&0xff);
+  }
+  static int locSubSong(unsigned int loc) { return loc>>24; }
+  static int locChan(unsigned int loc) { return (loc>>16)&0x7f; }
+  static int locPat(unsigned int loc) { return (loc>>8)&0xff; }
+  static int locRow(unsigned int loc) { return loc&0xff; }
+
+  bool isIndexed(int subsong, int chan, int pat);
+  bool isIndexed(int subsong, int chan, int pat, DivPattern* p);
+  void indexPattern(DivEngine* e, int subsong, int chan, int pat);
+  void dropPattern(int subsong, int chan, int pat);
+  void removeRow(unsigned int loc);
+  void updateRow(DivEngine* e, int subsong, int chan, int pat, int row);
+  // count/collect all locations with a value of column `col` between `min` and `max`.
+  size_t count(int col, int min, int max);
+  void collect(int col, int min, int max, std::vector<unsigned int>& ret);
+  void clear();
+};
+
 class FurnaceGUI {
   DivEngine* e;
 
@@ -1095,7 +1231,7 @@ class FurnaceGUI {
 
 
   bool quit, warnQuit, willCommit, edit, modified, displayError, displayExporting, vgmExportLoop, zsmExportLoop, vgmExportPatternHints;
-  bool vgmExportDirectStream, displayInsTypeList;
+  bool vgmExportDirectStream, vgmExportOptimize, vgmExportCompress, cmdStreamExportCompress, displayInsTypeList;
   bool portrait, injectBackUp, mobileMenuOpen;
   bool wantCaptureKeyboard, oldWantCaptureKeyboard, displayMacroMenu;
   bool displayNew, fullScreen, preserveChanPos, wantScrollList, noteInputPoly;
@@ -1103,7 +1239,29 @@ class FurnaceGUI {
   bool mobileEdit;
   bool willExport[DIV_MAX_CHIPS];
   int vgmExportVersion;
+  // VGM, ZSM and command stream export on the export thread (see startMultiExport()).
+  // an empty path means the format isn't exported.
+  DivMultiExport multiExport;
+  String multiExportPath[3];
+  bool multiExportPending, multiExportAborted;
+  bool multiExportVGM, multiExportZSM, multiExportCmd, multiExportCmdBinary;
   int drawHalt;
+
+  // damage tracking (settings.damageRedraw)
+  // the loop only draws a frame when input arrives, the playback position moves
+  // within sight or a visualizer is due for a frame.
+  int damageOrder, damageRow;
+  int damageVisOrder, damageVisRowMin, damageVisRowMax;
+  bool damagePlaying;
+  unsigned int damageOscBlock;
+  uint64_t damageNextVis;
+
+  // frame statistics (shown in the debug window)
+  // busy time is the wall time spent on events, layout, render and draw.
+  // CPU time is measured on the GUI thread, so it also counts presenting.
+  int frameCount, frameSkipCount, frameRate, frameSkipRate;
+  uint64_t frameStatBegin, frameBusy, frameCPUBegin;
+  double frameBusyRatio, frameCPU;
   int zsmExportTickRate;
   int macroPointSize;
   int waveEditStyle;
@@ -1171,6 +1329,7 @@ class FurnaceGUI {
     int mainFontSize, patFontSize, iconSize;
     int audioEngine;
     int audioQuality;
+    int qualityTier;
     int arcadeCore;
     int ym2612Core;
     int snCore;
@@ -1245,6 +1404,8 @@ class FurnaceGUI {
     int lowLatency;
     int notePreviewBehavior;
     int powerSave;
+    int damageRedraw;
+    int visualizerRate;
     int absorbInsInput;
     int eventDelay;
     int moveWindowTitle;
@@ -1281,6 +1442,8 @@ class FurnaceGUI {
     int persistFadeOut;
     int exportLoops;
     double exportFadeOut;
+    int renderCache;
+    int renderCacheSize;
     int macroLayout;
     unsigned int maxUndoSteps;
     String mainFontPath;
@@ -1303,6 +1466,7 @@ class FurnaceGUI {
       iconSize(16),
       audioEngine(DIV_AUDIO_SDL),
       audioQuality(0),
+      qualityTier(1),
       arcadeCore(0),
       ym2612Core(0),
       snCore(0),
@@ -1377,6 +1541,8 @@ class FurnaceGUI {
       lowLatency(0),
       notePreviewBehavior(1),
       powerSave(1),
+      damageRedraw(0),
+      visualizerRate(30),
       absorbInsInput(0),
       eventDelay(0),
       moveWindowTitle(1),
@@ -1412,6 +1578,8 @@ class FurnaceGUI {
       persistFadeOut(1),
       exportLoops(0),
       exportFadeOut(0.0),
+      renderCache(0),
+      renderCacheSize(256),
       macroLayout(0),
       maxUndoSteps(100),
       mainFontPath(""),
@@ -1443,6 +1611,7 @@ class FurnaceGUI {
   bool mixerOpen, debugOpen, inspectorOpen, oscOpen, volMeterOpen, statsOpen, compatFlagsOpen;
   bool pianoOpen, notesOpen, channelsOpen, regViewOpen, logOpen, effectListOpen, chanOscOpen;
   bool subSongsOpen, findOpen, spoilerOpen, patManagerOpen, sysManagerOpen, clockOpen;
+  bool insLibOpen;
 
   bool clockShowReal, clockShowRow, clockShowBeat, clockShowMetro, clockShowTime;
   float clockMetroTick[16];
@@ -1491,6 +1660,7 @@ class FurnaceGUI {
 
   std::vector<FurnaceGUIFindQuery> curQuery;
   std::vector<FurnaceGUIQueryResult> curQueryResults;
+  FurnaceGUIFindIndex findIndex;
   bool curQueryRangeX, curQueryBackwards;
   int curQueryRangeXMin, curQueryRangeXMax;
   int curQueryRangeY;
@@ -1526,6 +1696,8 @@ class FurnaceGUI {
   std::vector<DivCommand> cmdStream;
   std::vector<Particle> particles;
   std::vector<std::pair<DivInstrument*,bool>> pendingIns;
+  // when set, pendingIns entries with a NULL instrument are decoded from this bank on selection
+  DivInsBank* pendingInsBank;
 
   std::vector<FurnaceGUISysCategory> sysCategories;
 
@@ -1601,7 +1773,9 @@ class FurnaceGUI {
 
   int layoutTimeBegin, layoutTimeEnd, layoutTimeDelta;
   int renderTimeBegin, renderTimeEnd, renderTimeDelta;
+  int drawTimeBegin, drawTimeEnd, drawTimeDelta;
   int eventTimeBegin, eventTimeEnd, eventTimeDelta;
+  int patternTimeBegin, patternTimeEnd, patternTimeDelta;
 
   int chanToMove, sysToMove, sysToDelete, opToMove;
 
@@ -1612,6 +1786,29 @@ class FurnaceGUI {
   ImVec2 noteCellSize, insCellSize, volCellSize, effectCellSize, effectValCellSize;
   SelectionPoint sel1, sel2;
   int dummyRows, demandX;
+
+  // row label cache (a few patterns per channel, least recently used one is replaced)
+  FurnaceGUIPatRowCacheSlot patRowCache[DIV_MAX_CHANS][GUI_PAT_ROW_CACHE_SLOTS];
+  unsigned int patRowCacheUse;
+  unsigned int patRowCacheGen;
+  int patRowCacheHits, patRowCacheMisses;
+
+  // instrument library
+  std::vector<FurnaceGUIInsLibEntry> insLib;
+  std::vector<int> insLibFiltered;
+  std::thread* insLibThread;
+  std::mutex insLibLock;
+  std::atomic<bool> insLibQuit, insLibScanning, insLibChanged;
+  std::atomic<int> insLibScanned;
+  String insLibPath, insLibRoot, insLibQuery;
+  // engine used by the scan thread to parse instrument files
+  DivEngine* insLibParser;
+  // last bank a patch was loaded from
+  DivInsBank* insLibBank;
+  String insLibBankPath;
+  int insLibSel, insLibPrevIns;
+  bool insLibShowDups, insLibFilterDirty;
+
   int transposeAmount, randomizeMin, randomizeMax, fadeMin, fadeMax;
   float scaleMax;
   bool fadeMode, randomMode, haveHitBounds, pendingStepUpdate;
@@ -1645,8 +1842,10 @@ class FurnaceGUI {
   bool openSampleResizeOpt, openSampleResampleOpt, openSampleAmplifyOpt, openSampleSilenceOpt, openSampleFilterOpt;
 
   // oscilloscope
-  int oscTotal;
+  unsigned int oscTapBlock;
   float oscValues[512];
+  float oscRMS[2];
+  std::vector<float> oscWindow[2];
   float oscZoom;
   float oscWindowSize;
   bool oscZoomSlider;
@@ -1665,6 +1864,8 @@ class FurnaceGUI {
   float chanOscBright[DIV_MAX_CHANS];
   unsigned short lastNeedlePos[DIV_MAX_CHANS];
   unsigned short lastCorrPos[DIV_MAX_CHANS];
+  // copy of the visible part of a channel's buffer (see DivEngine::readChanOscWindow())
+  std::vector<short> chanOscData;
   struct ChanOscStatus {
     double* inBuf;
     size_t inBufPos;
@@ -1766,6 +1967,10 @@ class FurnaceGUI {
 
   float calcBPM(int s1, int s2, float hz, int vN, int vD);
 
+  bool checkDamage();
+  int damageTimeout();
+
+  const FurnaceGUIPatRowCache& patternRowLabels(int i, int j, int patIndex, const DivPattern* pat, int effectCols);
   void patternRow(int i, bool isPlaying, float lineHeight, int chans, int ord, const DivPattern** patCache, bool inhibitSel);
 
   void drawMacroEdit(FurnaceGUIMacroDesc& i, int totalFit, float availableWidth, int index);
@@ -1813,6 +2018,7 @@ class FurnaceGUI {
   void drawFindReplace();
   void drawSpoiler();
   void drawClock();
+  void drawInsLibrary();
 
   void parseKeybinds();
   void promptKey(int which);
@@ -1867,6 +2073,8 @@ class FurnaceGUI {
   void doExpand(int multiplier);
   void doUndo();
   void doRedo();
+  bool queryMatches(FurnaceGUIFindQuery& l, DivPattern* p, int row, int effectCols);
+  void findIndexTouch(int subSong, int chan, int pat, int row);
   void doFind();
   void doReplace();
   void doDrag();
@@ -1899,6 +2107,14 @@ class FurnaceGUI {
   int load(String path);
   void pushRecentFile(String path);
   void exportAudio(String path, DivAudioExportModes mode);
+  void startMultiExport(const String& vgmPath, const String& zsmPath, const String& cmdPath, bool cmdBinary);
+  void finishMultiExport();
+  void startInsLibScan();
+  void stopInsLibScan();
+  void runInsLibScan(String root, String cachePath);
+  String getInsLibRoot();
+  void loadInsLibEntry(const FurnaceGUIInsLibEntry& entry, bool add);
+  bool openInsBank(const String& path, bool single);
 
   bool parseSysEx(unsigned char* data, size_t len);
 
@@ -0,0 +1,495 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2022 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "gui.h"
+#include "imgui.h"
+#include "IconsFontAwesome4.h"
+#include "misc/cpp/imgui_stdlib.h"
+#include "guiConst.h"
+#include "../fileutils.h"
+#include "../ta-log.h"
+#include <fmt/printf.h>
+#include <algorithm>
+#include <unordered_set>
+
+#define INSLIB_CACHE_VERSION 1
+
+static const char* insLibFormats[]={
+  "fui", "dmp", "tfi", "vgi", "s3i", "sbi", "opli", "opni", "y12", "bnk", "ff", "gyb", "opm", "wopl", "wopn", NULL
+};
+
+// lowercase extension without the dot, or empty if not an instrument file
+static String insLibFormat(const String& name) {
+  size_t dot=name.rfind('.');
+  if (dot==String::npos) return "";
+  String ext=name.substr(dot+1);
+  for (char& i: ext) {
+    if (i>='A' && i<='Z') i+='a'-'A';
+  }
+  for (int i=0; insLibFormats[i]; i++) {
+    if (ext==insLibFormats[i]) return ext;
+  }
+  return "";
+}
+
+// FNV-1a over the instrument data, without the name
+static uint64_t insLibHash(DivInstrument* ins) {
+  String name=ins->name;
+  ins->name="";
+  SafeWriter* w=new SafeWriter;
+  w->init();
+  ins->putInsData2(w,false);
+  ins->name=name;
+
+  uint64_t hash=0xcbf29ce484222325ULL;
+  unsigned char* buf=w->getFinalBuf();
+  for (size_t i=0; i<w->size(); i++) {
+    hash^=buf[i];
+    hash*=0x100000001b3ULL;
+  }
+  w->finish();
+  delete w;
+  return hash;
+}
+
+static void insLibScanFile(DivEngine* parser, const String& fullPath, const FurnaceGUIInsLibEntry& base, std::vector<FurnaceGUIInsLibEntry>& result) {
+  size_t countBefore=result.size();
+  DivInsBank* bank=parser->indexInsBank(fullPath.c_str());
+  if (bank!=NULL) {
+    for (size_t i=0; i<bank->entries.size(); i++) {
+      DivInstrument* ins=parser->instrumentFromBank(bank,i);
+      if (ins==NULL) continue;
+      FurnaceGUIInsLibEntry entry=base;
+      entry.name=ins->name;
+      entry.type=ins->type;
+      entry.hash=insLibHash(ins);
+      entry.index=i;
+      result.push_back(entry);
+      delete ins;
+    }
+    delete bank;
+  } else {
+    std::vector<DivInstrument*> list=parser->instrumentFromFile(fullPath.c_str(),false);
+    for (size_t i=0; i<list.size(); i++) {
+      FurnaceGUIInsLibEntry entry=base;
+      entry.name=list[i]->name;
+      entry.type=list[i]->type;
+      entry.hash=insLibHash(list[i]);
+      entry.index=i;
+      result.push_back(entry);
+      delete list[i];
+    }
+  }
+  // remember files which could not be loaded so that they aren't parsed on every scan
+  if (result.size()==countBefore) {
+    result.push_back(base);
+  }
+}
+
+// cache format (one entry per line, tab-separated):
+// mtime size format type hash index path name
+static bool insLibLoadCache(const String& cachePath, const String& root, std::vector<FurnaceGUIInsLibEntry>& ret) {
+  FILE* f=ps_fopen(cachePath.c_str(),"rb");
+  if (f==NULL) return false;
+
+  char line[4096];
+  int version=0;
+  if (fgets(line,4096,f)==NULL || sscanf(line,"furnace-inslib %d",&version)!=1 || version!=INSLIB_CACHE_VERSION) {
+    fclose(f);
+    return false;
+  }
+  // discard the cache if the library directory changed
+  if (fgets(line,4096,f)==NULL || String(line)!=root+"\n") {
+    fclose(f);
+    return false;
+  }
+  while (fgets(line,4096,f)!=NULL) {
+    String l=line;
+    if (!l.empty() && l[l.size()-1]=='\n') l.resize(l.size()-1);
+    std::vector<String> fields;
+    size_t pos=0;
+    for (int i=0; i<7; i++) {
+      size_t next=l.find('\t',pos);
+      if (next==String::npos) break;
+      fields.push_back(l.substr(pos,next-pos));
+      pos=next+1;
+    }
+    if (fields.size()<7) continue;
+    FurnaceGUIInsLibEntry entry;
+    try {
+      entry.mtime=std::stoll(fields[0]);
+      entry.size=std::stoll(fields[1]);
+      entry.format=fields[2];
+      entry.type=(DivInstrumentType)std::stoi(fields[3]);
+      entry.hash=std::stoull(fields[4],NULL,16);
+      entry.index=std::stoi(fields[5]);
+    } catch (std::exception& e) {
+      continue;
+    }
+    entry.path=fields[6];
+    entry.name=l.substr(pos);
+    ret.push_back(entry);
+  }
+  fclose(f);
+  return true;
+}
+
+static void insLibSaveCache(const String& cachePath, const String& root, const std::vector<FurnaceGUIInsLibEntry>& list) {
+  FILE* f=ps_fopen(cachePath.c_str(),"wb");
+  if (f==NULL) {
+    logW("could not write instrument library cache! (%s)",strerror(errno));
+    return;
+  }
+  fprintf(f,"furnace-inslib %d\n",INSLIB_CACHE_VERSION);
+  fprintf(f,"%s\n",root.c_str());
+  for (const FurnaceGUIInsLibEntry& i: list) {
+    String name=i.name;
+    for (char& j: name) {
+      if (j=='\t' || j=='\n' || j=='\r') j=' ';
+    }
+    fmt::fprintf(f,"%d\t%d\t%s\t%d\t%x\t%d\t%s\t%s\n",i.mtime,i.size,i.format,(int)i.type,i.hash,i.index,i.path,name);
+  }
+  fclose(f);
+}
+
+String FurnaceGUI::getInsLibRoot() {
+  if (!insLibPath.empty()) return insLibPath;
+  // the instruments directory, either next to us or installed
+  const char* candidates[]={
+    "instruments",
+#ifndef _WIN32
+    "/usr/share/furnace/instruments",
+    "/usr/local/share/furnace/instruments",
+#endif
+    NULL
+  };
+  for (int i=0; candidates[i]; i++) {
+    std::vector<String> files, dirs;
+    if (ps_listDir(candidates[i],files,dirs)) return candidates[i];
+  }
+  return "instruments";
+}
+
+void FurnaceGUI::runInsLibScan(String root, String cachePath) {
+  std::vector<FurnaceGUIInsLibEntry> old;
+  insLibLock.lock();
+  old=insLib;
+  insLibLock.unlock();
+  if (old.empty()) {
+    insLibLoadCache(cachePath,root,old);
+  }
+
+  // previous entries of each file
+  std::unordered_map<String,std::vector<size_t>> oldFiles;
+  for (size_t i=0; i<old.size(); i++) {
+    oldFiles[old[i].path].push_back(i);
+  }
+
+  // instruments are parsed using a separate engine (created by startInsLibScan()).
+  // loading instruments does not touch the song, so it doesn't need to be initialized.
+  std::vector<FurnaceGUIInsLibEntry> result;
+  std::vector<String> pendingDirs;
+  int parsed=0;
+  pendingDirs.push_back("");
+
+  while (!pendingDirs.empty() && !insLibQuit) {
+    String dir=pendingDirs.back();
+    pendingDirs.pop_back();
+    String fullDir=dir.empty()?root:(root+DIR_SEPARATOR_STR+dir);
+
+    std::vector<String> files, dirs;
+    if (!ps_listDir(fullDir.c_str(),files,dirs)) {
+      logW("could not list %s!",fullDir);
+      continue;
+    }
+    std::sort(files.begin(),files.end());
+    // the last one is visited first
+    std::sort(dirs.begin(),dirs.end(),std::greater<String>());
+    for (String& i: dirs) {
+      pendingDirs.push_back(dir.empty()?i:(dir+DIR_SEPARATOR_STR+i));
+    }
+
+    for (String& i: files) {
+      if (insLibQuit) break;
+      FurnaceGUIInsLibEntry base;
+      base.format=insLibFormat(i);
+      if (base.format.empty()) continue;
+      base.path=dir.empty()?i:(dir+DIR_SEPARATOR_STR+i);
+      String fullPath=root+DIR_SEPARATOR_STR+base.path;
+      if (!ps_fileInfo(fullPath.c_str(),&base.mtime,&base.size)) continue;
+
+      auto prev=oldFiles.find(base.path);
+      if (prev!=oldFiles.end() && old[prev->second[0]].mtime==base.mtime && old[prev->second[0]].size==base.size) {
+        // unchanged
+        for (size_t j: prev->second) {
+          result.push_back(old[j]);
+        }
+      } else {
+        insLibScanFile(insLibParser,fullPath,base,result);
+        parsed++;
+      }
+      insLibScanned++;
+    }
+  }
+  if (insLibQuit) {
+    insLibScanning=false;
+    return;
+  }
+
+  std::unordered_set<uint64_t> seen;
+  for (FurnaceGUIInsLibEntry& i: result) {
+    i.dup=false;
+    if (i.index<0) continue;
+    if (!seen.insert(i.hash).second) i.dup=true;
+  }
+
+  if (parsed>0 || result.size()!=old.size()) {
+    insLibSaveCache(cachePath,root,result);
+  }
+  logI("instrument library: %d entries (%d files parsed)",(int)result.size(),parsed);
+
+  insLibLock.lock();
+  insLib=result;
+  insLibLock.unlock();
+  insLibChanged=true;
+  insLibScanning=false;
+}
+
+void FurnaceGUI::startInsLibScan() {
+  if (insLibScanning) return;
+  stopInsLibScan();
+  insLibRoot=getInsLibRoot();
+  // created here rather than in the scan thread, and kept for later scans
+  if (insLibParser==NULL) insLibParser=new DivEngine;
+  insLibQuit=false;
+  insLibScanning=true;
+  insLibScanned=0;
+  String root=insLibRoot;
+  String cachePath=e->getConfigPath()+DIR_SEPARATOR_STR+"inslib.cache";
+  insLibThread=new std::thread([this,root,cachePath]() {
+    runInsLibScan(root,cachePath);
+  });
+}
+
+void FurnaceGUI::stopInsLibScan() {
+  if (insLibThread==NULL) return;
+  insLibQuit=true;
+  insLibThread->join();
+  delete insLibThread;
+  insLibThread=NULL;
+  insLibQuit=false;
+}
+
+void FurnaceGUI::loadInsLibEntry(const FurnaceGUIInsLibEntry& entry, bool add) {
+  String fullPath=insLibRoot+DIR_SEPARATOR_STR+entry.path;
+  int sampleCountBefore=e->song.sampleLen;
+  DivInstrument* ins=NULL;
+  if (insLibBank==NULL || insLibBankPath!=fullPath) {
+    if (insLibBank!=NULL) {
+      delete insLibBank;
+      insLibBankPath="";
+    }
+    insLibBank=e->indexInsBank(fullPath.c_str());
+    if (insLibBank!=NULL) insLibBankPath=fullPath;
+  }
+  if (insLibBank!=NULL) {
+    ins=e->instrumentFromBank(insLibBank,entry.index);
+  } else {
+    std::vector<DivInstrument*> list=e->instrumentFromFile(fullPath.c_str(),add);
+    for (size_t i=0; i<list.size(); i++) {
+      if ((int)i==entry.index) {
+        ins=list[i];
+      } else {
+        delete list[i];
+      }
+    }
+  }
+  if (e->song.sampleLen!=sampleCountBefore) {
+    e->renderSamplesP();
+  }
+  if (ins==NULL) {
+    showError("cannot load instrument! ("+e->getLastError()+")");
+    return;
+  }
+
+  if (add) {
+    int index=e->addInstrumentPtr(ins);
+    if (index<0) {
+      showError("too many instruments!");
+      return;
+    }
+    curIns=index-1;
+    insLibPrevIns=-3;
+    MARK_MODIFIED;
+  } else {
+    // preview using the temporary instrument
+    e->loadTempIns(ins);
+    delete ins;
+    if (curIns!=-2) insLibPrevIns=curIns;
+    curIns=-2;
+  }
+  wantScrollList=true;
+}
+
+void FurnaceGUI::drawInsLibrary() {
+  if (nextWindow==GUI_WINDOW_INS_LIBRARY) {
+    insLibOpen=true;
+    ImGui::SetNextWindowFocus();
+    nextWindow=GUI_WINDOW_NOTHING;
+  }
+  if (!insLibOpen) {
+    // stop previewing
+    if (insLibPrevIns!=-3) {
+      if (curIns==-2) curIns=insLibPrevIns;
+      insLibPrevIns=-3;
+    }
+    return;
+  }
+  if (insLib.empty() && !insLibScanning && insLibThread==NULL) {
+    startInsLibScan();
+  }
+  if (insLibChanged) {
+    insLibChanged=false;
+    insLibFilterDirty=true;
+    insLibSel=-1;
+  }
+
+  if (ImGui::Begin("Instrument Library",&insLibOpen,globalWinFlags)) {
+    ImGui::AlignTextToFramePadding();
+    ImGui::Text("Directory");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x-ImGui::CalcTextSize(ICON_FA_REFRESH).x-ImGui::GetStyle().FramePadding.x*2.0f-ImGui::GetStyle().ItemSpacing.x);
+    if (ImGui::InputTextWithHint("##InsLibPath",getInsLibRoot().c_str(),&insLibPath)) {
+      // takes effect on rescan
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(insLibScanning);
+    if (ImGui::Button(ICON_FA_REFRESH "##InsLibRescan")) {
+      if (getInsLibRoot()!=insLibRoot) {
+        // different directory; start from scratch
+        stopInsLibScan();
+        insLibLock.lock();
+        insLib.clear();
+        insLibLock.unlock();
+        insLibFilterDirty=true;
+      }
+      startInsLibScan();
+    }
+    ImGui::EndDisabled();
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("Rescan");
+    }
+
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    if (ImGui::InputTextWithHint("##InsLibQuery","Search...",&insLibQuery)) {
+      insLibFilterDirty=true;
+    }
+    if (ImGui::Checkbox("Show duplicates",&insLibShowDups)) {
+      insLibFilterDirty=true;
+    }
+    ImGui::SameLine();
+    if (insLibScanning) {
+      ImGui::Text("scanning... (%d files)",(int)insLibScanned);
+    } else {
+      ImGui::Text("%d instruments",(int)insLibFiltered.size());
+    }
+
+    if (insLibFilterDirty && insLibLock.try_lock()) {
+      String query=insLibQuery;
+      for (char& i: query) {
+        if (i>='A' && i<='Z') i+='a'-'A';
+      }
+      insLibFiltered.clear();
+      for (size_t i=0; i<insLib.size(); i++) {
+        const FurnaceGUIInsLibEntry& entry=insLib[i];
+        if (entry.index<0) continue;
+        if (entry.dup && !insLibShowDups) continue;
+        if (!query.empty()) {
+          String haystack=entry.name+" "+entry.path+" "+((entry.type<DIV_INS_MAX)?insTypes[entry.type]:"");
+          for (char& j: haystack) {
+            if (j>='A' && j<='Z') j+='a'-'A';
+          }
+          if (haystack.find(query)==String::npos) continue;
+        }
+        insLibFiltered.push_back(i);
+      }
+      insLibLock.unlock();
+      insLibFilterDirty=false;
+    }
+
+    ImVec2 tableSize=ImGui::GetContentRegionAvail();
+    tableSize.y-=ImGui::GetFrameHeightWithSpacing();
+    if (ImGui::BeginTable("InsLibList",3,ImGuiTableFlags_ScrollY|ImGuiTableFlags_RowBg|ImGuiTableFlags_BordersInnerV|ImGuiTableFlags_Resizable,tableSize)) {
+      ImGui::TableSetupScrollFreeze(0,1);
+      ImGui::TableSetupColumn("Name",ImGuiTableColumnFlags_WidthStretch,0.5f);
+      ImGui::TableSetupColumn("Type",ImGuiTableColumnFlags_WidthFixed);
+      ImGui::TableSetupColumn("File",ImGuiTableColumnFlags_WidthStretch,0.5f);
+      ImGui::TableHeadersRow();
+      if (insLibLock.try_lock()) {
+        ImGuiListClipper clipper;
+        clipper.Begin(insLibFiltered.size());
+        while (clipper.Step()) {
+          for (int i=clipper.DisplayStart; i<clipper.DisplayEnd; i++) {
+            int index=insLibFiltered[i];
+            if (index<0 || index>=(int)insLib.size()) continue;
+            const FurnaceGUIInsLibEntry& entry=insLib[index];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::PushID(index);
+            if (entry.dup) ImGui::PushStyleColor(ImGuiCol_Text,ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled));
+            if (ImGui::Selectable(entry.name.c_str(),insLibSel==index,ImGuiSelectableFlags_SpanAllColumns|ImGuiSelectableFlags_AllowDoubleClick)) {
+              insLibSel=index;
+              // only now the instrument is loaded
+              loadInsLibEntry(entry,ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left));
+            }
+            if (ImGui::IsItemHovered() && entry.dup) {
+              ImGui::SetTooltip("duplicate of another instrument");
+            }
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted((entry.type<DIV_INS_MAX)?insTypes[entry.type]:"???");
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(entry.path.c_str());
+            if (entry.dup) ImGui::PopStyleColor();
+            ImGui::PopID();
+          }
+        }
+        insLibLock.unlock();
+      }
+      ImGui::EndTable();
+    }
+
+    // copy the selected entry since the scan thread may replace the list
+    FurnaceGUIInsLibEntry selEntry;
+    bool canAdd=false;
+    if (!insLibScanning && insLibLock.try_lock()) {
+      if (insLibSel>=0 && insLibSel<(int)insLib.size()) {
+        selEntry=insLib[insLibSel];
+        canAdd=true;
+      }
+      insLibLock.unlock();
+    }
+    ImGui::BeginDisabled(!canAdd);
+    if (ImGui::Button(ICON_FA_PLUS " Add to song")) {
+      loadInsLibEntry(selEntry,true);
+    }
+    ImGui::EndDisabled();
+  }
+  if (ImGui::IsWindowFocused(ImGuiFocusedFlags_ChildWindows)) curWindow=GUI_WINDOW_INS_LIBRARY;
+  ImGui::End();
+}
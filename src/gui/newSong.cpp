@@ -146,6 +146,7 @@ void FurnaceGUI::drawNewSong() {
     e->createNew(nextDesc.c_str(),nextDescName,false);
     undoHist.clear();
     redoHist.clear();
+    findIndex.clear();
     curFileName="";
     modified=false;
     curNibble=false;
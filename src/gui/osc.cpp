@@ -22,59 +22,41 @@
 #include <imgui.h>
 
 void FurnaceGUI::readOsc() {
-  int writePos=e->oscWritePos;
-  int readPos=e->oscReadPos;
-  int avail=0;
-  int total=0;
-  if (firstFrame) {
-    readPos=writePos;
-  }
-  if (writePos>=readPos) {
-    avail=writePos-readPos;
-  } else {
-    avail=writePos-readPos+32768;
+  DivOscTap tap;
+  int winSize=e->getAudioDescGot().rate*(oscWindowSize/1000.0);
+  if (winSize<1) winSize=1;
+  if ((int)oscWindow[0].size()<winSize) {
+    oscWindow[0].resize(winSize);
+    oscWindow[1].resize(winSize);
   }
-  if (oscTotal==0) {
-    oscTotal=ImGui::GetIO().DeltaTime*e->getAudioDescGot().rate;
-  } else {
-    oscTotal=(oscTotal+(int)round(ImGui::GetIO().DeltaTime*e->getAudioDescGot().rate))>>1;
+  // the snapshot and the samples are taken together
+  if (!e->readOscWindow(tap,winSize,oscWindow[0].data(),oscWindow[1].data())) return;
+  if (firstFrame) {
+    oscTapBlock=tap.block;
   }
-  int bias=avail-oscTotal-e->getAudioDescGot().bufsize;
-  if (bias<0) bias=0;
-  total=oscTotal+(bias>>6);
-  if (total>avail) total=avail;
-  //printf("total: %d. avail: %d bias: %d\n",total,avail,bias);
-
-  int winSize=e->getAudioDescGot().rate*(oscWindowSize/1000.0);
-  int oscReadPos=(writePos-winSize)&0x7fff;
   for (int i=0; i<512; i++) {
-    int pos=(oscReadPos+(i*winSize/512))&0x7fff;
-    oscValues[i]=(e->oscBuf[0][pos]+e->oscBuf[1][pos])*0.5f;
-    if (oscValues[i]>0.001f || oscValues[i]<-0.001f) {
+    int pos=i*winSize/512;
+    oscValues[i]=(oscWindow[0][pos]+oscWindow[1][pos])*0.5f;
+    // with damageRedraw, checkDamage() wakes up at the visualizer rate instead
+    if ((oscValues[i]>0.001f || oscValues[i]<-0.001f) && !settings.damageRedraw) {
       WAKE_UP;
     }
   }
 
+  float newPeak[2];
+  e->getOscPeak(oscTapBlock,newPeak,oscRMS);
+
   float peakDecay=0.05f*60.0f*ImGui::GetIO().DeltaTime;
   for (int i=0; i<2; i++) {
     peak[i]*=1.0-peakDecay;
     if (peak[i]<0.0001) {
       peak[i]=0.0;
-    } else {
+    } else if (!settings.damageRedraw) {
       WAKE_UP;
     }
-    float newPeak=peak[i];
-    for (int j=0; j<total; j++) {
-      int pos=(readPos+j)&0x7fff;
-      if (fabs(e->oscBuf[i][pos])>newPeak) {
-        newPeak=fabs(e->oscBuf[i][pos]);
-      }
-    }
-    peak[i]+=(newPeak-peak[i])*0.9;
+    if (newPeak[i]<peak[i]) newPeak[i]=peak[i];
+    peak[i]+=(newPeak[i]-peak[i])*0.9;
   }
-
-  readPos=(readPos+total)&0x7fff;
-  e->oscReadPos=readPos;
 }
 
 void FurnaceGUI::drawOsc() {
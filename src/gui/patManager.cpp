@@ -98,6 +98,7 @@ void FurnaceGUI::drawPatManager() {
               delete e->curSubSong->pat[i].data[k];
               e->curSubSong->pat[i].data[k]=NULL;
             });
+            findIndex.dropPattern(e->getCurrentSubSong(),i,k);
           }
           ImGui::PopStyleColor();
         }
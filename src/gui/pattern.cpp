@@ -56,6 +56,75 @@ void FurnaceGUI::popPartBlend() {
   SDL_SetRenderDrawBlendMode(sdlRend,SDL_BLENDMODE_BLEND);
 }
 
+// two-digit hex labels, shared by all pattern cells
+static char patHexLabels[256][3];
+static bool patHexLabelsReady=false;
+
+static const char* patHexLabel(unsigned char val) {
+  if (!patHexLabelsReady) {
+    for (int i=0; i<256; i++) {
+      snprintf(patHexLabels[i],3,"%.2X",i);
+    }
+    patHexLabelsReady=true;
+  }
+  return patHexLabels[val];
+}
+
+// the labels hold no ID, so cells are told apart by the ID of their row/channel and column
+static inline void patternCell(int col, const char* label, bool selected, const ImVec2& size) {
+  ImGui::PushID(col);
+  ImGui::Selectable(label,selected,ImGuiSelectableFlags_NoPadWithHalfSpacing,size);
+  ImGui::PopID();
+}
+
+// get the labels of a cell row, looking them up again only if the row changed
+const FurnaceGUIPatRowCache& FurnaceGUI::patternRowLabels(int i, int j, int patIndex, const DivPattern* pat, int effectCols) {
+  FurnaceGUIPatRowCacheSlot* slot=NULL;
+  FurnaceGUIPatRowCacheSlot* oldest=&patRowCache[j][0];
+  for (int k=0; k<GUI_PAT_ROW_CACHE_SLOTS; k++) {
+    FurnaceGUIPatRowCacheSlot* s=&patRowCache[j][k];
+    if (s->pat==patIndex) {
+      slot=s;
+      break;
+    }
+    if (s->lastUse<oldest->lastUse) oldest=s;
+  }
+  if (slot==NULL) {
+    // labels only depend on the cell data, so the old entries are still checked against it
+    slot=oldest;
+    slot->pat=patIndex;
+  }
+  slot->lastUse=++patRowCacheUse;
+  // only the rows of the pattern are ever drawn
+  if ((int)slot->rows.size()<=i) slot->rows.resize(MAX(i+1,e->curSubSong->patLen));
+  FurnaceGUIPatRowCache& c=slot->rows[i];
+  const short* data=pat->data[i];
+  if (c.gen==patRowCacheGen && c.fxCols>=effectCols && memcmp(c.data,data,DIV_MAX_COLS*sizeof(short))==0) {
+    patRowCacheHits++;
+    return c;
+  }
+  patRowCacheMisses++;
+  memcpy(c.data,data,DIV_MAX_COLS*sizeof(short));
+  c.gen=patRowCacheGen;
+  c.fxCols=effectCols;
+
+  c.note=noteName(data[0],data[1]);
+  c.ins=(data[2]==-1)?emptyLabel2:patHexLabel(data[2]);
+  c.vol=(data[3]==-1)?emptyLabel2:patHexLabel(data[3]);
+  for (int k=0; k<effectCols; k++) {
+    int index=4+(k<<1);
+    if (data[index]==-1) {
+      c.fx[k]=emptyLabel2;
+    } else if (data[index]>0xff) {
+      c.fx[k]="??";
+    } else {
+      c.fx[k]=patHexLabel(data[index]);
+    }
+    c.fxVal[k]=(data[index+1]==-1)?emptyLabel2:patHexLabel(data[index+1]);
+  }
+  return c;
+}
+
 // draw a pattern row
 inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int chans, int ord, const DivPattern** patCache, bool inhibitSel) {
   static char id[64];
@@ -74,6 +143,12 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
   if (i<0 || i>=e->curSubSong->patLen) {
     return;
   }
+  // remember which rows are on screen (for damage tracking)
+  if (!inhibitSel) {
+    damageVisOrder=ord;
+    if (i<damageVisRowMin) damageVisRowMin=i;
+    if (i>damageVisRowMax) damageVisRowMax=i;
+  }
   bool isPushing=false;
   ImVec4 activeColor=uiColors[GUI_COLOR_PATTERN_ACTIVE];
   ImVec4 inactiveColor=uiColors[GUI_COLOR_PATTERN_INACTIVE];
@@ -142,8 +217,11 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
     int chanVolMax=e->getMaxVolumeChan(j);
     if (chanVolMax<1) chanVolMax=1;
     const DivPattern* pat=patCache[j];
+    const FurnaceGUIPatRowCache& labels=patternRowLabels(i,j,e->curOrders->ord[j][ord],pat,e->curPat[j].effectCols);
     ImGui::TableNextColumn();
     patChanX[j]=ImGui::GetCursorScreenPos().x;
+    // above the channel header IDs (2048+channel)
+    ImGui::PushID(4096+i*DIV_MAX_CHANS+j);
 
     // selection highlight flags
     int sel1XSum=sel1.xCoarse*32+sel1.xFine;
@@ -157,7 +235,6 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
     bool cursorVol=(cursor.y==i && cursor.xCoarse==j && cursor.xFine==2 && curWindowLast==GUI_WINDOW_PATTERN);
 
     // note
-    snprintf(id,63,"%.31s##PN_%d_%d",noteName(pat->data[i][0],pat->data[i][1]),i,j);
     if (pat->data[i][0]==0 && pat->data[i][1]==0) {
       ImGui::PushStyleColor(ImGuiCol_Text,inactiveColor);
     } else {
@@ -167,12 +244,12 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
       ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_CURSOR]);
       ImGui::PushStyleColor(ImGuiCol_HeaderActive,uiColors[GUI_COLOR_PATTERN_CURSOR_ACTIVE]);
       ImGui::PushStyleColor(ImGuiCol_HeaderHovered,uiColors[GUI_COLOR_PATTERN_CURSOR_HOVER]);
-      ImGui::Selectable(id,true,ImGuiSelectableFlags_NoPadWithHalfSpacing,noteCellSize);
+      patternCell(0,labels.note,true,noteCellSize);
       demandX=ImGui::GetCursorPosX();
       ImGui::PopStyleColor(3);
     } else {
       if (selectedNote) ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_SELECTION]);
-      ImGui::Selectable(id,isPushing || selectedNote,ImGuiSelectableFlags_NoPadWithHalfSpacing,noteCellSize);
+      patternCell(0,labels.note,isPushing || selectedNote,noteCellSize);
       if (selectedNote) ImGui::PopStyleColor();
     }
     if (ImGui::IsItemClicked()) {
@@ -192,7 +269,6 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
       // instrument
       if (pat->data[i][2]==-1) {
         ImGui::PushStyleColor(ImGuiCol_Text,inactiveColor);
-        snprintf(id,63,"%.31s##PI_%d_%d",emptyLabel2,i,j);
       } else {
         if (pat->data[i][2]<0 || pat->data[i][2]>=e->song.insLen) {
           ImGui::PushStyleColor(ImGuiCol_Text,uiColors[GUI_COLOR_PATTERN_INS_ERROR]);
@@ -204,19 +280,18 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
             ImGui::PushStyleColor(ImGuiCol_Text,uiColors[GUI_COLOR_PATTERN_INS]);
           }
         }
-        snprintf(id,63,"%.2X##PI_%d_%d",pat->data[i][2],i,j);
       }
       ImGui::SameLine(0.0f,0.0f);
       if (cursorIns) {
         ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_CURSOR]);
         ImGui::PushStyleColor(ImGuiCol_HeaderActive,uiColors[GUI_COLOR_PATTERN_CURSOR_ACTIVE]);
         ImGui::PushStyleColor(ImGuiCol_HeaderHovered,uiColors[GUI_COLOR_PATTERN_CURSOR_HOVER]);
-        ImGui::Selectable(id,true,ImGuiSelectableFlags_NoPadWithHalfSpacing,insCellSize);
+        patternCell(1,labels.ins,true,insCellSize);
         demandX=ImGui::GetCursorPosX();
         ImGui::PopStyleColor(3);
       } else {
         if (selectedIns) ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_SELECTION]);
-        ImGui::Selectable(id,isPushing || selectedIns,ImGuiSelectableFlags_NoPadWithHalfSpacing,insCellSize);
+        patternCell(1,labels.ins,isPushing || selectedIns,insCellSize);
         if (selectedIns) ImGui::PopStyleColor();
       }
       if (ImGui::IsItemClicked()) {
@@ -235,13 +310,11 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
     if (e->curSubSong->chanCollapse[j]<2) {
       // volume
       if (pat->data[i][3]==-1) {
-        snprintf(id,63,"%.31s##PV_%d_%d",emptyLabel2,i,j);
         ImGui::PushStyleColor(ImGuiCol_Text,inactiveColor);
       } else {
         int volColor=(pat->data[i][3]*127)/chanVolMax;
         if (volColor>127) volColor=127;
         if (volColor<0) volColor=0;
-        snprintf(id,63,"%.2X##PV_%d_%d",pat->data[i][3],i,j);
         ImGui::PushStyleColor(ImGuiCol_Text,volColors[volColor]);
       }
       ImGui::SameLine(0.0f,0.0f);
@@ -249,12 +322,12 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
         ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_CURSOR]);
         ImGui::PushStyleColor(ImGuiCol_HeaderActive,uiColors[GUI_COLOR_PATTERN_CURSOR_ACTIVE]);
         ImGui::PushStyleColor(ImGuiCol_HeaderHovered,uiColors[GUI_COLOR_PATTERN_CURSOR_HOVER]);
-        ImGui::Selectable(id,true,ImGuiSelectableFlags_NoPadWithHalfSpacing,volCellSize);
+        patternCell(2,labels.vol,true,volCellSize);
         demandX=ImGui::GetCursorPosX();
         ImGui::PopStyleColor(3);
       } else {
         if (selectedVol) ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_SELECTION]);
-        ImGui::Selectable(id,isPushing || selectedVol,ImGuiSelectableFlags_NoPadWithHalfSpacing,volCellSize);
+        patternCell(2,labels.vol,isPushing || selectedVol,volCellSize);
         if (selectedVol) ImGui::PopStyleColor();
       }
       if (ImGui::IsItemClicked()) {
@@ -281,15 +354,12 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
         
         // effect
         if (pat->data[i][index]==-1) {
-          snprintf(id,63,"%.31s##PE%d_%d_%d",emptyLabel2,k,i,j);
           ImGui::PushStyleColor(ImGuiCol_Text,inactiveColor);
         } else {
           if (pat->data[i][index]>0xff) {
-            snprintf(id,63,"??##PE%d_%d_%d",k,i,j);
             ImGui::PushStyleColor(ImGuiCol_Text,uiColors[GUI_COLOR_PATTERN_EFFECT_INVALID]);
           } else {
             const unsigned char data=pat->data[i][index];
-            snprintf(id,63,"%.2X##PE%d_%d_%d",data,k,i,j);
             ImGui::PushStyleColor(ImGuiCol_Text,uiColors[fxColors[data]]);
           }
         }
@@ -298,12 +368,12 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
           ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_CURSOR]);  
           ImGui::PushStyleColor(ImGuiCol_HeaderActive,uiColors[GUI_COLOR_PATTERN_CURSOR_ACTIVE]);
           ImGui::PushStyleColor(ImGuiCol_HeaderHovered,uiColors[GUI_COLOR_PATTERN_CURSOR_HOVER]);
-          ImGui::Selectable(id,true,ImGuiSelectableFlags_NoPadWithHalfSpacing,effectCellSize);
+          patternCell(3+(k<<1),labels.fx[k],true,effectCellSize);
           demandX=ImGui::GetCursorPosX();
           ImGui::PopStyleColor(3);
         } else {
           if (selectedEffect) ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_SELECTION]);
-          ImGui::Selectable(id,isPushing || selectedEffect,ImGuiSelectableFlags_NoPadWithHalfSpacing,effectCellSize);
+          patternCell(3+(k<<1),labels.fx[k],isPushing || selectedEffect,effectCellSize);
           if (selectedEffect) ImGui::PopStyleColor();
         }
         if (ImGui::IsItemClicked()) {
@@ -318,22 +388,17 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
         }
 
         // effect value
-        if (pat->data[i][index+1]==-1) {
-          snprintf(id,63,"%.31s##PF%d_%d_%d",emptyLabel2,k,i,j);
-        } else {
-          snprintf(id,63,"%.2X##PF%d_%d_%d",pat->data[i][index+1],k,i,j);
-        }
         ImGui::SameLine(0.0f,0.0f);
         if (cursorEffectVal) {
           ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_CURSOR]);  
           ImGui::PushStyleColor(ImGuiCol_HeaderActive,uiColors[GUI_COLOR_PATTERN_CURSOR_ACTIVE]);
           ImGui::PushStyleColor(ImGuiCol_HeaderHovered,uiColors[GUI_COLOR_PATTERN_CURSOR_HOVER]);
-          ImGui::Selectable(id,true,ImGuiSelectableFlags_NoPadWithHalfSpacing,effectValCellSize);
+          patternCell(4+(k<<1),labels.fxVal[k],true,effectValCellSize);
           demandX=ImGui::GetCursorPosX();
           ImGui::PopStyleColor(3);
         } else {
           if (selectedEffectVal) ImGui::PushStyleColor(ImGuiCol_Header,uiColors[GUI_COLOR_PATTERN_SELECTION]);
-          ImGui::Selectable(id,isPushing || selectedEffectVal,ImGuiSelectableFlags_NoPadWithHalfSpacing,effectValCellSize);
+          patternCell(4+(k<<1),labels.fxVal[k],isPushing || selectedEffectVal,effectValCellSize);
           if (selectedEffectVal) ImGui::PopStyleColor();
         }
         if (ImGui::IsItemClicked()) {
@@ -349,6 +414,7 @@ inline void FurnaceGUI::patternRow(int i, bool isPlaying, float lineHeight, int
         ImGui::PopStyleColor();
       }
     }
+    ImGui::PopID();
   }
   if (isPushing) {
     ImGui::PopStyleColor();
@@ -364,6 +430,9 @@ void FurnaceGUI::drawPattern() {
     ImGui::SetNextWindowFocus();
     nextWindow=GUI_WINDOW_NOTHING;
   }
+  damageVisOrder=-1;
+  damageVisRowMin=DIV_MAX_ROWS;
+  damageVisRowMax=-1;
   if (!patternOpen) return;
 
   bool inhibitMenu=false;
@@ -909,6 +978,10 @@ void FurnaceGUI::drawPattern() {
 
       dummyRows=(ImGui::GetWindowSize().y/lineHeight)/2;
 
+      patRowCacheHits=0;
+      patRowCacheMisses=0;
+      patternTimeBegin=SDL_GetPerformanceCounter();
+
       // オップナー2608 i owe you one more for this horrible code
       // previous pattern
       ImGui::BeginDisabled();
@@ -951,6 +1024,8 @@ void FurnaceGUI::drawPattern() {
       }
       ImGui::EndDisabled();
       ImGui::PopStyleVar();
+      patternTimeEnd=SDL_GetPerformanceCounter();
+      patternTimeDelta=patternTimeEnd-patternTimeBegin;
       oldRow=curRow;
       if (demandScrollX) {
         int totalDemand=demandX-ImGui::GetScrollX();
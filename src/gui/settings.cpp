@@ -77,6 +77,12 @@ const char* audioQualities[]={
   "Low"
 };
 
+const char* qualityTiers[]={
+  "Draft",
+  "Normal",
+  "Accurate"
+};
+
 const char* arcadeCores[]={
   "ymfm",
   "Nuked-OPM"
@@ -546,6 +552,22 @@ void FurnaceGUI::drawSettings() {
             ImGui::SetTooltip("saves power by lowering the frame rate to 2fps when idle.\nmay cause issues under Mesa drivers!");
           }
 
+          bool damageRedrawB=settings.damageRedraw;
+          if (ImGui::Checkbox("Only redraw when something changes",&damageRedrawB)) {
+            settings.damageRedraw=damageRedrawB;
+          }
+          if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("redraws the interface only on input, when the play head moves within view or when a visualizer needs a frame.\nreduces CPU usage during playback.");
+          }
+
+          if (ImGui::SliderInt("Visualizer frame rate",&settings.visualizerRate,1,120,"%d fps")) {
+            if (settings.visualizerRate<1) settings.visualizerRate=1;
+            if (settings.visualizerRate>120) settings.visualizerRate=120;
+          }
+          if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("maximum frame rate of the oscilloscopes, meters, piano and register view when redrawing only on changes.");
+          }
+
 #ifndef IS_MOBILE
           bool noThreadedInputB=settings.noThreadedInput;
           if (ImGui::Checkbox("Disable threaded input (restart after changing!)",&noThreadedInputB)) {
@@ -592,6 +614,23 @@ void FurnaceGUI::drawSettings() {
             settings.persistFadeOut=1;
           }
 
+          bool renderCacheB=settings.renderCache;
+          if (ImGui::Checkbox("Cache exports",&renderCacheB)) {
+            settings.renderCache=renderCacheB;
+          }
+          if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("exporting a song again with the same settings reuses the previous result.");
+          }
+          ImGui::BeginDisabled(!settings.renderCache);
+          if (ImGui::InputInt("Cache size (MB)",&settings.renderCacheSize,16,64)) {
+            if (settings.renderCacheSize<1) settings.renderCacheSize=1;
+            if (settings.renderCacheSize>65536) settings.renderCacheSize=65536;
+          }
+          ImGui::EndDisabled();
+          if (ImGui::Button("Clear cache")) {
+            e->clearRenderCache();
+          }
+
           ImGui::Text("Note preview behavior:");
           if (ImGui::RadioButton("Never##npb0",settings.notePreviewBehavior==0)) {
             settings.notePreviewBehavior=0;
@@ -1045,6 +1084,15 @@ void FurnaceGUI::drawSettings() {
         ImVec2 settingsViewSize=ImGui::GetContentRegionAvail();
         settingsViewSize.y-=ImGui::GetFrameHeight()+ImGui::GetStyle().WindowPadding.y;
         if (ImGui::BeginChild("SettingsView",settingsViewSize)) {
+          ImGui::Text("Quality tier");
+          ImGui::SameLine();
+          ImGui::Combo("##QualityTier",&settings.qualityTier,qualityTiers,3);
+          if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Draft: fastest cores, low quality resampling and no per-channel oscilloscope.\nNormal: use the cores below.\nAccurate: most precise cores.");
+          }
+
+          ImGui::Separator();
+
           ImGui::Text("Arcade/YM2151 core");
           ImGui::SameLine();
           ImGui::Combo("##ArcadeCore",&settings.arcadeCore,arcadeCores,2);
@@ -2328,6 +2376,7 @@ void FurnaceGUI::syncSettings() {
   settings.midiOutDevice=e->getConfString("midiOutDevice","");
   settings.c163Name=e->getConfString("c163Name",DIV_C163_DEFAULT_NAME);
   settings.audioQuality=e->getConfInt("audioQuality",0);
+  settings.qualityTier=e->getConfInt("qualityTier",1);
   settings.audioBufSize=e->getConfInt("audioBufSize",1024);
   settings.audioRate=e->getConfInt("audioRate",44100);
   settings.arcadeCore=e->getConfInt("arcadeCore",0);
@@ -2404,6 +2453,8 @@ void FurnaceGUI::syncSettings() {
   settings.lowLatency=e->getConfInt("lowLatency",0);
   settings.notePreviewBehavior=e->getConfInt("notePreviewBehavior",1);
   settings.powerSave=e->getConfInt("powerSave",POWER_SAVE_DEFAULT);
+  settings.damageRedraw=e->getConfInt("damageRedraw",0);
+  settings.visualizerRate=e->getConfInt("visualizerRate",30);
   settings.absorbInsInput=e->getConfInt("absorbInsInput",0);
   settings.eventDelay=e->getConfInt("eventDelay",0);
   settings.moveWindowTitle=e->getConfInt("moveWindowTitle",1);
@@ -2446,6 +2497,8 @@ void FurnaceGUI::syncSettings() {
   settings.persistFadeOut=e->getConfInt("persistFadeOut",1);
   settings.exportLoops=e->getConfInt("exportLoops",0);
   settings.exportFadeOut=e->getConfDouble("exportFadeOut",0.0);
+  settings.renderCache=e->getConfInt("renderCache",0);
+  settings.renderCacheSize=e->getConfInt("renderCacheSize",256);
   settings.macroLayout=e->getConfInt("macroLayout",0);
 
   clampSetting(settings.mainFontSize,2,96);
@@ -2453,6 +2506,7 @@ void FurnaceGUI::syncSettings() {
   clampSetting(settings.iconSize,2,48);
   clampSetting(settings.audioEngine,0,1);
   clampSetting(settings.audioQuality,0,1);
+  clampSetting(settings.qualityTier,0,2);
   clampSetting(settings.audioBufSize,32,4096);
   clampSetting(settings.audioRate,8000,384000);
   clampSetting(settings.arcadeCore,0,1);
@@ -2519,6 +2573,8 @@ void FurnaceGUI::syncSettings() {
   clampSetting(settings.lowLatency,0,1);
   clampSetting(settings.notePreviewBehavior,0,3);
   clampSetting(settings.powerSave,0,1);
+  clampSetting(settings.damageRedraw,0,1);
+  clampSetting(settings.visualizerRate,1,120);
   clampSetting(settings.absorbInsInput,0,1);
   clampSetting(settings.eventDelay,0,1);
   clampSetting(settings.moveWindowTitle,0,1);
@@ -2557,6 +2613,8 @@ void FurnaceGUI::syncSettings() {
 
   if (settings.exportLoops<0.0) settings.exportLoops=0.0;
   if (settings.exportFadeOut<0.0) settings.exportFadeOut=0.0;
+  clampSetting(settings.renderCache,0,1);
+  clampSetting(settings.renderCacheSize,1,65536);
 
   String initialSys2=e->getConfString("initialSys2","");
   if (initialSys2.empty()) {
@@ -2616,6 +2674,7 @@ void FurnaceGUI::commitSettings() {
   e->setConf("midiOutDevice",settings.midiOutDevice);
   e->setConf("c163Name",settings.c163Name);
   e->setConf("audioQuality",settings.audioQuality);
+  e->setConf("qualityTier",settings.qualityTier);
   e->setConf("audioBufSize",settings.audioBufSize);
   e->setConf("audioRate",settings.audioRate);
   e->setConf("arcadeCore",settings.arcadeCore);
@@ -2692,6 +2751,8 @@ void FurnaceGUI::commitSettings() {
   e->setConf("lowLatency",settings.lowLatency);
   e->setConf("notePreviewBehavior",settings.notePreviewBehavior);
   e->setConf("powerSave",settings.powerSave);
+  e->setConf("damageRedraw",settings.damageRedraw);
+  e->setConf("visualizerRate",settings.visualizerRate);
   e->setConf("absorbInsInput",settings.absorbInsInput);
   e->setConf("eventDelay",settings.eventDelay);
   e->setConf("moveWindowTitle",settings.moveWindowTitle);
@@ -2735,6 +2796,8 @@ void FurnaceGUI::commitSettings() {
   e->setConf("persistFadeOut",settings.persistFadeOut);
   e->setConf("exportLoops",settings.exportLoops);
   e->setConf("exportFadeOut",settings.exportFadeOut);
+  e->setConf("renderCache",settings.renderCache);
+  e->setConf("renderCacheSize",settings.renderCacheSize);
   e->setConf("macroLayout",settings.macroLayout);
 
   // colors
@@ -2757,6 +2820,8 @@ void FurnaceGUI::commitSettings() {
 
   e->saveConf();
 
+  e->setRenderCache(settings.renderCache,settings.renderCacheSize);
+
   while (!recentFile.empty() && (int)recentFile.size()>settings.maxRecentFile) {
     recentFile.pop_back();
   }
@@ -2767,6 +2832,8 @@ void FurnaceGUI::commitSettings() {
     }
   }
 
+  e->setQualityTier((DivQualityTier)settings.qualityTier);
+
   if (!e->switchMaster(coresChanged)) {
     showError("could not initialize audio!");
   }
@@ -3182,6 +3249,9 @@ void FurnaceGUI::applyUISettings(bool updateFonts) {
     ImGui::StyleColorsDark(&sty);
   }
 
+  // pattern labels depend on these
+  patRowCacheGen++;
+
   setupLabel(settings.noteOffLabel.c_str(),noteOffLabel,3);
   setupLabel(settings.noteRelLabel.c_str(),noteRelLabel,3);
   setupLabel(settings.macroRelLabel.c_str(),macroRelLabel,3);
@@ -25,6 +25,8 @@ int logLevel=LOGLEVEL_TRACE;
 int logLevel=LOGLEVEL_INFO;
 #endif
 
+bool logToStderr=false;
+
 std::atomic<unsigned short> logPosition;
 
 LogEntry logEntries[TA_LOG_SIZE];
@@ -33,8 +35,8 @@ static constexpr unsigned int TA_LOG_MASK=TA_LOG_SIZE-1;
 
 int writeLog(int level, const char* msg, fmt::printf_args args) {
   time_t thisMakesNoSense=time(NULL);
-  int pos=logPosition;
-  logPosition=(logPosition+1)&TA_LOG_MASK;
+  // several threads may log at once. each one claims its own slot.
+  int pos=(logPosition++)&TA_LOG_MASK;
 
   logEntries[pos].text=fmt::vsprintf(msg,args);
   // why do I have to pass a pointer
@@ -55,17 +57,18 @@ int writeLog(int level, const char* msg, fmt::printf_args args) {
   logEntries[pos].ready=true;
 
   if (logLevel<level) return 0;
+  FILE* out=logToStderr?stderr:stdout;
   switch (level) {
     case LOGLEVEL_ERROR:
-      return fmt::printf("\x1b[1;31m[ERROR]\x1b[m %s\n",logEntries[pos].text);
+      return fmt::fprintf(out,"\x1b[1;31m[ERROR]\x1b[m %s\n",logEntries[pos].text);
     case LOGLEVEL_WARN:
-      return fmt::printf("\x1b[1;33m[warning]\x1b[m %s\n",logEntries[pos].text);
+      return fmt::fprintf(out,"\x1b[1;33m[warning]\x1b[m %s\n",logEntries[pos].text);
     case LOGLEVEL_INFO:
-      return fmt::printf("\x1b[1;32m[info]\x1b[m %s\n",logEntries[pos].text);
+      return fmt::fprintf(out,"\x1b[1;32m[info]\x1b[m %s\n",logEntries[pos].text);
     case LOGLEVEL_DEBUG:
-      return fmt::printf("\x1b[1;34m[debug]\x1b[m %s\n",logEntries[pos].text);
+      return fmt::fprintf(out,"\x1b[1;34m[debug]\x1b[m %s\n",logEntries[pos].text);
     case LOGLEVEL_TRACE:
-      return fmt::printf("\x1b[1;37m[trace]\x1b[m %s\n",logEntries[pos].text);
+      return fmt::fprintf(out,"\x1b[1;37m[trace]\x1b[m %s\n",logEntries[pos].text);
   }
   return -1;
 }
@@ -37,6 +37,7 @@
 #endif
 
 #include "cli/cli.h"
+#include "cli/server.h"
 
 #ifdef HAVE_GUI
 #include "gui/gui.h"
@@ -56,7 +57,10 @@ String zsmOutName;
 String cmdOutName;
 int loops=1;
 int benchMode=0;
+int testMode=0;
 DivAudioExportModes outMode=DIV_EXPORT_MODE_ONE;
+DivAudioExportFormats outFormat=DIV_EXPORT_FORMAT_WAV;
+bool outFormatSet=false;
 
 #ifdef HAVE_GUI
 bool consoleMode=false;
@@ -66,7 +70,13 @@ bool consoleMode=true;
 
 bool displayEngineFailError=false;
 bool cmdOutBinary=false;
+bool cmdOutCompress=false;
+bool renderCache=false;
+int qualityTier=-1;
+String serverPath;
+int serverInstances=1;
 bool vgmOutDirect=false;
+bool vgmOutOptimize=false;
 
 std::vector<TAParam> params;
 
@@ -123,11 +133,48 @@ TAParamResult pBinary(String val) {
   return TA_PARAM_SUCCESS;
 }
 
+TAParamResult pCompress(String val) {
+  cmdOutBinary=true;
+  cmdOutCompress=true;
+  return TA_PARAM_SUCCESS;
+}
+
+TAParamResult pRenderCache(String val) {
+  renderCache=true;
+  return TA_PARAM_SUCCESS;
+}
+
+TAParamResult pServer(String val) {
+  serverPath=val;
+  // standard output may carry replies
+  logToStderr=true;
+  return TA_PARAM_SUCCESS;
+}
+
+TAParamResult pInstances(String val) {
+  try {
+    serverInstances=std::stoi(val);
+  } catch (std::exception& e) {
+    logE("instance count shall be a number.");
+    return TA_PARAM_ERROR;
+  }
+  if (serverInstances<1 || serverInstances>64) {
+    logE("instance count shall be between 1 and 64.");
+    return TA_PARAM_ERROR;
+  }
+  return TA_PARAM_SUCCESS;
+}
+
 TAParamResult pDirect(String val) {
   vgmOutDirect=true;
   return TA_PARAM_SUCCESS;
 }
 
+TAParamResult pVGMOptimize(String val) {
+  vgmOutOptimize=true;
+  return TA_PARAM_SUCCESS;
+}
+
 TAParamResult pLogLevel(String val) {
   if (val=="trace") {
     logLevel=LOGLEVEL_TRACE;
@@ -244,13 +291,67 @@ TAParamResult pOutMode(String val) {
   return TA_PARAM_SUCCESS;
 }
 
+TAParamResult pOutFormat(String val) {
+  if (val=="wav") {
+    outFormat=DIV_EXPORT_FORMAT_WAV;
+  } else if (val=="wav24") {
+    outFormat=DIV_EXPORT_FORMAT_WAV_24;
+  } else if (val=="wavfloat") {
+    outFormat=DIV_EXPORT_FORMAT_WAV_FLOAT;
+  } else if (val=="flac") {
+    outFormat=DIV_EXPORT_FORMAT_FLAC;
+  } else if (val=="ogg") {
+    outFormat=DIV_EXPORT_FORMAT_OGG;
+  } else if (val=="raw16") {
+    outFormat=DIV_EXPORT_FORMAT_RAW_S16;
+  } else if (val=="raw24") {
+    outFormat=DIV_EXPORT_FORMAT_RAW_S24;
+  } else if (val=="rawfloat") {
+    outFormat=DIV_EXPORT_FORMAT_RAW_F32;
+  } else {
+    logE("invalid value for outformat! valid values are: wav, wav24, wavfloat, flac, ogg, raw16, raw24 and rawfloat.");
+    return TA_PARAM_ERROR;
+  }
+  outFormatSet=true;
+  return TA_PARAM_SUCCESS;
+}
+
+TAParamResult pQuality(String val) {
+  if (val=="draft") {
+    qualityTier=DIV_QUALITY_DRAFT;
+  } else if (val=="normal") {
+    qualityTier=DIV_QUALITY_NORMAL;
+  } else if (val=="accurate") {
+    qualityTier=DIV_QUALITY_ACCURATE;
+  } else {
+    logE("invalid value for quality! valid values are: draft, normal and accurate.");
+    return TA_PARAM_ERROR;
+  }
+  return TA_PARAM_SUCCESS;
+}
+
 TAParamResult pBenchmark(String val) {
   if (val=="render") {
     benchMode=1;
   } else if (val=="seek") {
     benchMode=2;
+  } else if (val=="chips") {
+    benchMode=3;
+  } else {
+    logE("invalid value for benchmark! valid values are: render, seek and chips.");
+    return TA_PARAM_ERROR;
+  }
+  e.setAudio(DIV_AUDIO_DUMMY);
+  return TA_PARAM_SUCCESS;
+}
+
+TAParamResult pTest(String val) {
+  if (val=="engines") {
+    testMode=1;
+  } else if (val=="cmdstream") {
+    testMode=2;
   } else {
-    logE("invalid value for benchmark! valid values are: render and seek.");
+    logE("invalid value for test! valid values are: engines and cmdstream.");
     return TA_PARAM_ERROR;
   }
   e.setAudio(DIV_AUDIO_DUMMY);
@@ -259,6 +360,8 @@ TAParamResult pBenchmark(String val) {
 
 TAParamResult pOutput(String val) {
   outName=val;
+  // keep stdout clean for audio data
+  if (outName=="-") logToStderr=true;
   e.setAudio(DIV_AUDIO_DUMMY);
   return TA_PARAM_SUCCESS;
 }
@@ -294,20 +397,29 @@ void initParams() {
   params.push_back(TAParam("h","help",false,pHelp,"","display this help"));
 
   params.push_back(TAParam("a","audio",true,pAudio,"jack|sdl","set audio engine (SDL by default)"));
-  params.push_back(TAParam("o","output",true,pOutput,"<filename>","output audio to file"));
-  params.push_back(TAParam("O","vgmout",true,pVGMOut,"<filename>","output .vgm data"));
+  params.push_back(TAParam("o","output",true,pOutput,"<filename>","output audio to file (- for stdout)"));
+  params.push_back(TAParam("O","vgmout",true,pVGMOut,"<filename>","output .vgm data (.vgz to compress)"));
   params.push_back(TAParam("D","direct",false,pDirect,"","set VGM export direct stream mode"));
+  params.push_back(TAParam("P","vgmoptimize",false,pVGMOptimize,"","remove redundant register writes from VGM output"));
   params.push_back(TAParam("Z","zsmout",true,pZSMOut,"<filename>","output .zsm data for Commander X16 Zsound"));
   params.push_back(TAParam("C","cmdout",true,pCmdOut,"<filename>","output command stream"));
   params.push_back(TAParam("b","binary",false,pBinary,"","set command stream output format to binary"));
+  params.push_back(TAParam("z","compress",false,pCompress,"","compress binary command stream (implies -binary)"));
   params.push_back(TAParam("L","loglevel",true,pLogLevel,"debug|info|warning|error","set the log level (info by default)"));
   params.push_back(TAParam("v","view",true,pView,"pattern|commands|nothing","set visualization (pattern by default)"));
   params.push_back(TAParam("c","console",false,pConsole,"","enable console mode"));
 
   params.push_back(TAParam("l","loops",true,pLoops,"<count>","set number of loops (-1 means loop forever)"));
   params.push_back(TAParam("o","outmode",true,pOutMode,"one|persys|perchan","set file output mode"));
+  params.push_back(TAParam("F","outformat",true,pOutFormat,"wav|wav24|wavfloat|flac|ogg|raw16|raw24|rawfloat","set audio output format (guessed from file name by default)"));
+  params.push_back(TAParam("q","quality",true,pQuality,"draft|normal|accurate","set emulation quality tier (draft picks the fastest cores)"));
+  params.push_back(TAParam("R","rendercache",false,pRenderCache,"","reuse previous exports of the same song and settings"));
+
+  params.push_back(TAParam("S","server",true,pServer,"<socket>","run a headless render server on a Unix domain socket (- for stdin/stdout). requests are key=value lines ending with an empty line (cmd=render|ping|quit, file, audio, vgm, zsm, cmdstream)"));
+  params.push_back(TAParam("I","instances",true,pInstances,"<count>","set number of engine instances in the render server (1 by default) or in -test engines (4 by default)"));
 
-  params.push_back(TAParam("B","benchmark",true,pBenchmark,"render|seek","run performance test"));
+  params.push_back(TAParam("B","benchmark",true,pBenchmark,"render|seek|chips","run performance test"));
+  params.push_back(TAParam("T","test",true,pTest,"engines|cmdstream","run self-test on the song (engines: render on several engines at once and compare against one; cmdstream: play the exported command stream back and compare register writes)"));
 
   params.push_back(TAParam("V","version",false,pVersion,"","view information about Furnace."));
   params.push_back(TAParam("W","warranty",false,pWarranty,"","view warranty disclaimer."));
@@ -331,6 +443,28 @@ void reportError(String what) {
 }
 #endif
 
+void writeExportFile(SafeWriter* w, const String& name, bool compress, const char* errorMsg) {
+  if (w==NULL) {
+    reportError(errorMsg);
+    return;
+  }
+  FILE* f=fopen(name.c_str(),"wb");
+  if (f!=NULL) {
+    if (compress) {
+      if (!e.writeVGZ(w,f)) {
+        reportError(fmt::sprintf("could not compress file! (%s)",e.getLastError()));
+      }
+    } else {
+      fwrite(w->getFinalBuf(),1,w->size(),f);
+    }
+    fclose(f);
+  } else {
+    reportError(fmt::sprintf("could not open file! (%s)",e.getLastError()));
+  }
+  w->finish();
+  delete w;
+}
+
 // TODO: CoInitializeEx on Windows?
 // TODO: add crash log
 int main(int argc, char** argv) {
@@ -395,6 +529,18 @@ int main(int argc, char** argv) {
     }
   }
 
+  if (!serverPath.empty()) {
+    FurnaceServer server;
+    if (!server.init(serverPath,serverInstances,renderCache)) {
+      server.finish();
+      reportError("could not start render server!");
+      return 1;
+    }
+    server.loop();
+    server.finish();
+    return 0;
+  }
+
   e.setConsoleMode(consoleMode);
 
 #ifdef _WIN32
@@ -472,51 +618,87 @@ int main(int argc, char** argv) {
       displayEngineFailError=true;
     }
   }
+  if (renderCache) {
+    e.setRenderCache(true);
+  }
+  if (qualityTier>=0) {
+    e.setQualityTier((DivQualityTier)qualityTier);
+  }
   if (benchMode) {
     logI("starting benchmark!");
     if (benchMode==2) {
       e.benchmarkSeek();
+    } else if (benchMode==3) {
+      e.benchmarkChips();
     } else {
       e.benchmarkPlayback();
     }
     return 0;
   }
-  if (outName!="" || vgmOutName!="" || cmdOutName!="") {
+  if (testMode) {
+    logI("starting test!");
+    // the tests print their own results
+    e.setConsoleMode(false);
+    bool passed=true;
+    if (testMode==1) {
+      passed=e.testEngines((serverInstances>1)?serverInstances:4);
+    } else if (testMode==2) {
+      passed=e.testCommandStream();
+    }
+    return passed?0:1;
+  }
+  if (outName!="" || vgmOutName!="" || zsmOutName!="" || cmdOutName!="") {
+    // VGM, ZSM and command stream are written from a single pass over the song.
+    // direct stream VGM needs its own.
+    DivMultiExport ex;
+    ex.vgm=(vgmOutName!="" && !vgmOutDirect);
+    ex.vgmOptimize=vgmOutOptimize;
+    ex.zsm=(zsmOutName!="");
+    ex.cmd=(cmdOutName!="");
+    ex.cmdBinary=cmdOutBinary;
+    ex.cmdCompress=cmdOutCompress;
+    if (ex.vgm || ex.zsm || ex.cmd) {
+      e.saveMulti(ex);
+    }
+    if (vgmOutName!="" && vgmOutDirect) {
+      ex.vgmOut=e.saveVGM(NULL,true,0x171,false,true,vgmOutOptimize);
+    }
     if (cmdOutName!="") {
-      SafeWriter* w=e.saveCommand(cmdOutBinary);
-      if (w!=NULL) {
-        FILE* f=fopen(cmdOutName.c_str(),"wb");
-        if (f!=NULL) {
-          fwrite(w->getFinalBuf(),1,w->size(),f);
-          fclose(f);
-        } else {
-          reportError(fmt::sprintf("could not open file! (%s)",e.getLastError()));
-        }
-        w->finish();
-        delete w;
-      } else {
-        reportError("could not write command stream!");
-      }
+      writeExportFile(ex.cmdOut,cmdOutName,false,"could not write command stream!");
     }
     if (vgmOutName!="") {
-      SafeWriter* w=e.saveVGM(NULL,true,0x171,false,vgmOutDirect);
-      if (w!=NULL) {
-        FILE* f=fopen(vgmOutName.c_str(),"wb");
-        if (f!=NULL) {
-          fwrite(w->getFinalBuf(),1,w->size(),f);
-          fclose(f);
-        } else {
-          reportError(fmt::sprintf("could not open file! (%s)",e.getLastError()));
-        }
-        w->finish();
-        delete w;
-      } else {
-        reportError("could not write VGM!");
-      }
+      // write compressed file if the name ends in .vgz
+      bool compress=(vgmOutName.size()>4 && vgmOutName.compare(vgmOutName.size()-4,4,".vgz")==0);
+      writeExportFile(ex.vgmOut,vgmOutName,compress,"could not write VGM!");
+    }
+    if (zsmOutName!="") {
+      writeExportFile(ex.zsmOut,zsmOutName,false,"could not write ZSM!");
     }
     if (outName!="") {
+      if (!outFormatSet) {
+        String lowerCase=outName;
+        for (char& i: lowerCase) {
+          if (i>='A' && i<='Z') i+='a'-'A';
+        }
+        if (outName=="-") {
+          outFormat=DIV_EXPORT_FORMAT_RAW_S16;
+        } else if (lowerCase.size()>5 && lowerCase.compare(lowerCase.size()-5,5,".flac")==0) {
+          outFormat=DIV_EXPORT_FORMAT_FLAC;
+        } else if (lowerCase.size()>4 && lowerCase.compare(lowerCase.size()-4,4,".ogg")==0) {
+          outFormat=DIV_EXPORT_FORMAT_OGG;
+        } else if (lowerCase.size()>4 && lowerCase.compare(lowerCase.size()-4,4,".raw")==0) {
+          outFormat=DIV_EXPORT_FORMAT_RAW_S16;
+        }
+      }
+      if (outName=="-") {
+        // the pattern view would end up in the audio stream
+        e.setView(DIV_STATUS_NOTHING);
+      }
       e.setConsoleMode(true);
-      e.saveAudio(outName.c_str(),loops,outMode);
+      if (!e.saveAudio(outName.c_str(),loops,outMode,0.0,outFormat)) {
+        reportError("could not export audio!");
+        return 1;
+      }
       e.waitAudioFile();
     }
     return 0;
@@ -36,6 +36,8 @@
 #define TA_LOG_SIZE 2048
 
 extern int logLevel;
+// print log messages to stderr instead of stdout (for streaming output to stdout)
+extern bool logToStderr;
 
 extern std::atomic<unsigned short> logPosition;
 
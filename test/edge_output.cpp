@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "engine/engine.h"
+#include "engine/platform/tia.h"
+#include "engine/platform/pcspkr.h"
+#include "engine/platform/pokemini.h"
+
+#define MAX_RUN 4096
+#define ITERATIONS 20000
+
+// renders TIA, PC speaker and Pokémon mini through both acquire() and
+// acquireEdges() under random commands, and checks that the edges expand to
+// the same samples and that both paths write the same oscilloscope data.
+// the platforms only call a few engine functions, which are defined below so
+// the rest of the engine doesn't have to be linked.
+// build (from the repository root):
+//   g++ -std=c++14 -DFMT_HEADER_ONLY -Isrc -Iextern/fmt/include -o test/edge_output test/edge_output.cpp src/engine/platform/abstract.cpp src/engine/platform/tia.cpp src/engine/platform/pcspkr.cpp src/engine/platform/pokemini.cpp src/engine/platform/sound/tia/Audio.cpp src/engine/platform/sound/tia/AudioChannel.cpp src/engine/macroInt.cpp src/engine/pattern.cpp src/engine/config.cpp src/log.cpp src/baseutils.cpp src/fileutils.cpp -lpthread
+// usage: edge_output [seed]
+// return values:
+// - 0: pass (both paths match)
+// - 1: fail (mismatch found)
+
+void DivEngine::changeSong(size_t songIndex) {
+}
+
+DivInstrument* DivEngine::getIns(int index, DivInstrumentType fallbackType) {
+  return NULL;
+}
+
+int DivEngine::getConfInt(String key, int fallback) {
+  return fallback;
+}
+
+double DivEngine::calcBaseFreq(double clock, double divider, int note, bool period) {
+  double base=440.0*pow(2.0,(double)(note-57)/12.0);
+  return period?(clock/(base*divider)):(base*divider/clock);
+}
+
+int DivEngine::calcFreq(int base, int pitch, bool period, int octave, int pitch2, double clock, double divider, int blockBits) {
+  return period?(base-pitch-pitch2):(base+pitch+pitch2);
+}
+
+int DivEngine::calcArp(int note, int arp, int offset) {
+  return note+arp+offset;
+}
+
+TAAudioDesc& DivEngine::getAudioDescGot() {
+  return got;
+}
+
+DivSample::~DivSample() {
+}
+
+static DivEngine* engine;
+
+static short bufL[MAX_RUN], bufR[MAX_RUN];
+static short edgeL[MAX_RUN], edgeR[MAX_RUN];
+
+// renders one run through both paths and returns the number of mismatching
+// samples.
+static long renderBoth(DivDispatch* sampled, DivDispatch* edged, int oscChans) {
+  size_t start=rand()%64;
+  size_t len=1+rand()%(MAX_RUN-start-1);
+  long bad=0;
+
+  unsigned short needle[2];
+  for (int i=0; i<oscChans; i++) {
+    needle[i]=sampled->getOscBuffer(i)->needle;
+  }
+
+  memset(bufL,0,sizeof(bufL));
+  memset(bufR,0,sizeof(bufR));
+  sampled->acquire(bufL,bufR,start,len);
+
+  std::vector<DivDispatchEdge> edges;
+  edged->acquireEdges(edges,start,len);
+  if (edges.empty() || edges[0].time!=start) {
+    fprintf(stderr,"no edge at start of run\n");
+    return len;
+  }
+  size_t k=0;
+  short lastL=0, lastR=0;
+  for (size_t i=start; i<start+len; i++) {
+    while (k<edges.size() && edges[k].time<=i) {
+      lastL=edges[k].val[0];
+      lastR=edges[k].val[1];
+      k++;
+    }
+    edgeL[i]=lastL;
+    edgeR[i]=lastR;
+  }
+  if (k!=edges.size()) {
+    fprintf(stderr,"edge past end of run\n");
+    bad++;
+  }
+
+  for (size_t i=start; i<start+len; i++) {
+    if (bufL[i]!=edgeL[i]) bad++;
+    if (sampled->isStereo() && bufR[i]!=edgeR[i]) bad++;
+  }
+
+  for (int i=0; i<oscChans; i++) {
+    DivDispatchOscBuffer* a=sampled->getOscBuffer(i);
+    DivDispatchOscBuffer* b=edged->getOscBuffer(i);
+    if (a->needle!=b->needle) {
+      fprintf(stderr,"oscilloscope needle mismatch on channel %d: %d vs. %d\n",i,a->needle,b->needle);
+      bad++;
+      continue;
+    }
+    unsigned short count=a->needle-needle[i];
+    for (unsigned short j=0; j<count; j++) {
+      unsigned short pos=needle[i]+j;
+      if (a->data[pos]!=b->data[pos]) bad++;
+    }
+  }
+  return bad;
+}
+
+// sends the same random command to both chips.
+static void commandBoth(DivDispatch* a, DivDispatch* b) {
+  DivCommand c(DIV_CMD_NOTE_ON,0,0);
+  switch (rand()%5) {
+    case 0: case 1:
+      c=DivCommand(DIV_CMD_NOTE_ON,0,rand()%180);
+      break;
+    case 2:
+      c=DivCommand(DIV_CMD_NOTE_OFF,0);
+      break;
+    case 3:
+      c=DivCommand(DIV_CMD_PITCH,0,(rand()%512)-256);
+      break;
+    case 4:
+      c=DivCommand(DIV_CMD_VOLUME,0,rand()%16);
+      break;
+  }
+  a->dispatch(c);
+  b->dispatch(c);
+  if (rand()%50==0) {
+    bool mute=rand()&1;
+    a->muteChannel(0,mute);
+    b->muteChannel(0,mute);
+  }
+  a->tick();
+  b->tick();
+}
+
+static long testTIA() {
+  long bad=0;
+  for (int mixingType=0; mixingType<3; mixingType++) {
+    DivConfig flags;
+    flags.set("mixingType",mixingType);
+    DivPlatformTIA a, b;
+    a.init(engine,2,44100,flags);
+    b.init(engine,2,44100,flags);
+    for (int i=0; i<ITERATIONS; i++) {
+      int writes=rand()%4;
+      for (int j=0; j<writes; j++) {
+        unsigned int addr=0x15+rand()%6;
+        unsigned short val=rand()&0xff;
+        a.poke(addr,val);
+        b.poke(addr,val);
+      }
+      bad+=renderBoth(&a,&b,2);
+    }
+    a.quit();
+    b.quit();
+  }
+  return bad;
+}
+
+static long testPCSpeaker() {
+  DivConfig flags;
+  flags.set("speakerType",0);
+  DivPlatformPCSpeaker a, b;
+  a.init(engine,1,44100,flags);
+  b.init(engine,1,44100,flags);
+  long bad=0;
+  for (int i=0; i<ITERATIONS; i++) {
+    commandBoth(&a,&b);
+    bad+=renderBoth(&a,&b,1);
+  }
+  a.quit();
+  b.quit();
+  return bad;
+}
+
+static long testPokeMini() {
+  DivConfig flags;
+  DivPlatformPokeMini a, b;
+  a.init(engine,1,44100,flags);
+  b.init(engine,1,44100,flags);
+  long bad=0;
+  for (int i=0; i<ITERATIONS; i++) {
+    commandBoth(&a,&b);
+    bad+=renderBoth(&a,&b,1);
+  }
+  a.quit();
+  b.quit();
+  return bad;
+}
+
+int main(int argc, char** argv) {
+  srand((argc>1)?atoi(argv[1]):1234);
+  engine=new DivEngine;
+
+  long tiaBad=testTIA();
+  printf("TIA: %ld mismatches\n",tiaBad);
+  long pcSpeakerBad=testPCSpeaker();
+  printf("PC speaker: %ld mismatches\n",pcSpeakerBad);
+  long pokeMiniBad=testPokeMini();
+  printf("Pokémon mini: %ld mismatches\n",pokeMiniBad);
+
+  return (tiaBad!=0 || pcSpeakerBad!=0 || pokeMiniBad!=0);
+}
@@ -0,0 +1,392 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "engine/engine.h"
+#include "engine/platform/arcade.h"
+#include "engine/platform/genesis.h"
+
+#define MAX_RUN 2048
+#define ITERATIONS 1000
+
+// plays a random register dump through the Nuked-OPM (arcade) and Nuked-OPN2
+// (Genesis) paths, and checks that the scheduled writes in acquire_nuked()
+// land on the same clock as the old loop which polled the busy flag.
+// the old loops are kept below as acquireBusyPoll(). after every run the
+// output, oscilloscope data, register pool, write queue and chip state of
+// both paths are compared.
+// the platforms only call a few engine functions, which are defined below so
+// the rest of the engine doesn't have to be linked.
+// needs the Nuked-OPN2 submodule.
+// build (from the repository root):
+//   g++ -std=c++14 -DFMT_HEADER_ONLY -Isrc -Iextern/fmt/include -o test/fm_write_schedule test/fm_write_schedule.cpp src/engine/platform/abstract.cpp src/engine/platform/arcade.cpp src/engine/platform/genesis.cpp src/engine/platform/sound/ymfm/ymfm_opm.cpp src/engine/platform/sound/ymfm/ymfm_opn.cpp src/engine/platform/sound/ymfm/ymfm_adpcm.cpp src/engine/platform/sound/ymfm/ymfm_ssg.cpp extern/opm/opm.c extern/Nuked-OPN2/ym3438.c src/engine/macroInt.cpp src/engine/pattern.cpp src/engine/config.cpp src/log.cpp src/baseutils.cpp src/fileutils.cpp -lpthread
+// usage: fm_write_schedule [seed]
+// return values:
+// - 0: pass (both paths match)
+// - 1: fail (mismatch found)
+
+void DivEngine::changeSong(size_t songIndex) {
+}
+
+DivInstrument* DivEngine::getIns(int index, DivInstrumentType fallbackType) {
+  return NULL;
+}
+
+DivSample* DivEngine::getSample(int index) {
+  return NULL;
+}
+
+int DivEngine::getConfInt(String key, int fallback) {
+  return fallback;
+}
+
+double DivEngine::calcBaseFreq(double clock, double divider, int note, bool period) {
+  double base=440.0*pow(2.0,(double)(note-57)/12.0);
+  return period?(clock/(base*divider)):(base*divider/clock);
+}
+
+int DivEngine::calcBaseFreqFNumBlock(double clock, double divider, int note, int bits) {
+  return note;
+}
+
+int DivEngine::calcFreq(int base, int pitch, bool period, int octave, int pitch2, double clock, double divider, int blockBits) {
+  return period?(base-pitch-pitch2):(base+pitch+pitch2);
+}
+
+int DivEngine::calcArp(int note, int arp, int offset) {
+  return note+arp+offset;
+}
+
+TAAudioDesc& DivEngine::getAudioDescGot() {
+  return got;
+}
+
+bool DivSample::isLoopable() {
+  return false;
+}
+
+DivSample::~DivSample() {
+}
+
+class TestArcade: public DivPlatformArcade {
+  public:
+    bool busyPoll;
+
+    // the Nuked-OPM loop before writes were scheduled.
+    void acquireBusyPoll(short* bufL, short* bufR, size_t start, size_t len) {
+      int o[2];
+
+      for (size_t h=start; h<start+len; h++) {
+        for (int i=0; i<8; i++) {
+          if (!writes.empty() && !fm.write_busy) {
+            QueuedWrite& w=writes.front();
+            if (w.addrOrVal) {
+              OPM_Write(&fm,1,w.val);
+              regPool[w.addr&0xff]=w.val;
+              writes.pop_front();
+            } else {
+              OPM_Write(&fm,0,w.addr);
+              w.addrOrVal=true;
+            }
+          }
+
+          OPM_Clock(&fm,NULL,NULL,NULL,NULL);
+          OPM_Clock(&fm,NULL,NULL,NULL,NULL);
+          OPM_Clock(&fm,NULL,NULL,NULL,NULL);
+          OPM_Clock(&fm,o,NULL,NULL,NULL);
+        }
+
+        for (int i=0; i<8; i++) {
+          oscBuf[i]->data[oscBuf[i]->needle++]=fm.ch_out[i];
+        }
+
+        if (o[0]<-32768) o[0]=-32768;
+        if (o[0]>32767) o[0]=32767;
+
+        if (o[1]<-32768) o[1]=-32768;
+        if (o[1]>32767) o[1]=32767;
+
+        bufL[h]=o[0];
+        bufR[h]=o[1];
+      }
+    }
+
+    void acquire(short* bufL, short* bufR, size_t start, size_t len) {
+      if (busyPoll) {
+        acquireBusyPoll(bufL,bufR,start,len);
+      } else {
+        DivPlatformArcade::acquire(bufL,bufR,start,len);
+      }
+    }
+
+    // returns the number of differences in the write queue and chip state.
+    long compareState(TestArcade& other) {
+      long bad=0;
+      if (writes.size()!=other.writes.size()) {
+        fprintf(stderr,"OPM write queue mismatch: %d vs. %d\n",(int)writes.size(),(int)other.writes.size());
+        bad++;
+      } else if (!writes.empty() && writes.front().addrOrVal!=other.writes.front().addrOrVal) {
+        fprintf(stderr,"OPM pending address write mismatch\n");
+        bad++;
+      }
+      if (memcmp(regPool,other.regPool,256)!=0) bad++;
+      if (memcmp(&fm,&other.fm,sizeof(opm_t))!=0) bad++;
+      return bad;
+    }
+
+    TestArcade(bool poll):
+      DivPlatformArcade(),
+      busyPoll(poll) {}
+};
+
+class TestGenesis: public DivPlatformGenesis {
+  public:
+    bool busyPoll;
+
+    // the Nuked-OPN2 loop before writes were scheduled.
+    void acquireBusyPoll(short* bufL, short* bufR, size_t start, size_t len) {
+      short o[2];
+      int os[2];
+
+      for (size_t h=start; h<start+len; h++) {
+        processDAC(rate);
+
+        os[0]=0; os[1]=0;
+        for (int i=0; i<6; i++) {
+          if (!writes.empty()) {
+            QueuedWrite& w=writes.front();
+            if (w.addrOrVal) {
+              OPN2_Write(&fm,0x1+((w.addr>>8)<<1),w.val);
+              lastBusy=0;
+              regPool[w.addr&0x1ff]=w.val;
+              writes.pop_front();
+            } else {
+              lastBusy++;
+              if (fm.write_busy==0) {
+                OPN2_Write(&fm,0x0+((w.addr>>8)<<1),w.addr);
+                w.addrOrVal=true;
+              }
+            }
+          }
+
+          OPN2_Clock(&fm,o); os[0]+=o[0]; os[1]+=o[1];
+          if (i==5) {
+            if (fm.dacen) {
+              if (softPCM) {
+                oscBuf[5]->data[oscBuf[5]->needle++]=chan[5].dacOutput<<7;
+                oscBuf[6]->data[oscBuf[6]->needle++]=chan[6].dacOutput<<7;
+              } else {
+                oscBuf[i]->data[oscBuf[i]->needle++]=fm.dacdata<<7;
+              }
+            } else {
+              oscBuf[i]->data[oscBuf[i]->needle++]=fm.ch_out[i]<<7;
+            }
+          } else {
+            oscBuf[i]->data[oscBuf[i]->needle++]=fm.ch_out[i]<<7;
+          }
+        }
+
+        os[0]=(os[0]<<5);
+        if (os[0]<-32768) os[0]=-32768;
+        if (os[0]>32767) os[0]=32767;
+
+        os[1]=(os[1]<<5);
+        if (os[1]<-32768) os[1]=-32768;
+        if (os[1]>32767) os[1]=32767;
+
+        bufL[h]=os[0];
+        bufR[h]=os[1];
+      }
+    }
+
+    void acquire(short* bufL, short* bufR, size_t start, size_t len) {
+      if (busyPoll) {
+        acquireBusyPoll(bufL,bufR,start,len);
+      } else {
+        DivPlatformGenesis::acquire(bufL,bufR,start,len);
+      }
+    }
+
+    long compareState(TestGenesis& other) {
+      long bad=0;
+      if (writes.size()!=other.writes.size()) {
+        fprintf(stderr,"OPN2 write queue mismatch: %d vs. %d\n",(int)writes.size(),(int)other.writes.size());
+        bad++;
+      } else if (!writes.empty() && writes.front().addrOrVal!=other.writes.front().addrOrVal) {
+        fprintf(stderr,"OPN2 pending address write mismatch\n");
+        bad++;
+      }
+      if (lastBusy!=other.lastBusy) bad++;
+      if (memcmp(regPool,other.regPool,512)!=0) bad++;
+      if (memcmp(&fm,&other.fm,sizeof(ym3438_t))!=0) bad++;
+      return bad;
+    }
+
+    TestGenesis(bool poll):
+      DivPlatformGenesis(),
+      busyPoll(poll) {}
+};
+
+static DivEngine* engine;
+
+static short bufL[2][MAX_RUN], bufR[2][MAX_RUN];
+
+// renders one run through both paths and returns the number of mismatching
+// samples.
+static long renderBoth(DivDispatch* scheduled, DivDispatch* polled, int oscChans) {
+  size_t len=1+rand()%MAX_RUN;
+  long bad=0;
+
+  unsigned short needle[10];
+  for (int i=0; i<oscChans; i++) {
+    needle[i]=scheduled->getOscBuffer(i)->needle;
+  }
+
+  scheduled->acquire(bufL[0],bufR[0],0,len);
+  polled->acquire(bufL[1],bufR[1],0,len);
+
+  for (size_t i=0; i<len; i++) {
+    if (bufL[0][i]!=bufL[1][i]) bad++;
+    if (bufR[0][i]!=bufR[1][i]) bad++;
+  }
+
+  for (int i=0; i<oscChans; i++) {
+    DivDispatchOscBuffer* a=scheduled->getOscBuffer(i);
+    DivDispatchOscBuffer* b=polled->getOscBuffer(i);
+    if (a->needle!=b->needle) {
+      fprintf(stderr,"oscilloscope needle mismatch on channel %d: %d vs. %d\n",i,a->needle,b->needle);
+      bad++;
+      continue;
+    }
+    unsigned short count=a->needle-needle[i];
+    for (unsigned short j=0; j<count; j++) {
+      unsigned short pos=needle[i]+j;
+      if (a->data[pos]!=b->data[pos]) bad++;
+    }
+  }
+  return bad;
+}
+
+// a random OPM register write, weighted towards key on and the operator
+// registers.
+static void randomWriteOPM(unsigned short& addr, unsigned char& val) {
+  val=rand();
+  switch (rand()%8) {
+    case 0:
+      addr=0x08;
+      break;
+    case 1:
+      // TL, kept loud
+      addr=0x60+rand()%0x20;
+      val&=0x1f;
+      break;
+    case 2:
+      addr=0x0f+(rand()&1)*9;
+      break;
+    case 3:
+      addr=0x19;
+      break;
+    default:
+      addr=0x20+rand()%0xe0;
+      break;
+  }
+}
+
+// a random OPN2 register write, weighted towards key on and the channel
+// registers of both ports. also writes the DAC.
+static void randomWriteOPN2(unsigned short& addr, unsigned char& val) {
+  val=rand();
+  switch (rand()%8) {
+    case 0:
+      addr=0x28;
+      break;
+    case 1:
+      // TL, kept loud
+      addr=(rand()&1)*0x100+0x40+rand()%0x10;
+      val&=0x1f;
+      break;
+    case 2:
+      addr=0x2a+(rand()&1);
+      break;
+    case 3:
+      addr=0x22+rand()%6;
+      if (addr==0x24 || addr==0x25 || addr==0x26) addr=0x22;
+      break;
+    default:
+      addr=(rand()&1)*0x100+0x30+rand()%0x88;
+      break;
+  }
+}
+
+// pokes the same dump into both platforms, then plays it back in random runs
+// with more writes in between. some of them are sent in bursts, so that the
+// queue stays busy across several runs.
+template<typename T> static long testChip(T& a, T& b, int oscChans, void (*randomWrite)(unsigned short&,unsigned char&)) {
+  long bad=0;
+  unsigned short addr;
+  unsigned char val;
+  for (int i=0; i<256; i++) {
+    randomWrite(addr,val);
+    a.poke(addr,val);
+    b.poke(addr,val);
+  }
+  for (int i=0; i<ITERATIONS; i++) {
+    int writes=(rand()%16==0)?(rand()%128):(rand()%6);
+    for (int j=0; j<writes; j++) {
+      randomWrite(addr,val);
+      a.poke(addr,val);
+      b.poke(addr,val);
+    }
+    bad+=renderBoth(&a,&b,oscChans);
+    bad+=a.compareState(b);
+    if (rand()%500==0) {
+      a.reset();
+      b.reset();
+    }
+  }
+  return bad;
+}
+
+static long testArcade() {
+  DivConfig flags;
+  TestArcade a(false), b(true);
+  a.setYMFM(false);
+  b.setYMFM(false);
+  a.init(engine,8,44100,flags);
+  b.init(engine,8,44100,flags);
+  long bad=testChip(a,b,8,randomWriteOPM);
+  a.quit();
+  b.quit();
+  return bad;
+}
+
+static long testGenesis() {
+  long bad=0;
+  for (int ladder=0; ladder<2; ladder++) {
+    DivConfig flags;
+    flags.set("ladderEffect",ladder!=0);
+    TestGenesis a(false), b(true);
+    a.setYMFM(false);
+    b.setYMFM(false);
+    a.setSoftPCM(false);
+    b.setSoftPCM(false);
+    a.init(engine,10,44100,flags);
+    b.init(engine,10,44100,flags);
+    bad+=testChip(a,b,6,randomWriteOPN2);
+    a.quit();
+    b.quit();
+  }
+  return bad;
+}
+
+int main(int argc, char** argv) {
+  srand((argc>1)?atoi(argv[1]):1234);
+  engine=new DivEngine;
+
+  long arcadeBad=testArcade();
+  printf("arcade (Nuked-OPM): %ld mismatches\n",arcadeBad);
+  long genesisBad=testGenesis();
+  printf("Genesis (Nuked-OPN2): %ld mismatches\n",genesisBad);
+
+  return (arcadeBad!=0 || genesisBad!=0);
+}
@@ -21,9 +21,26 @@ fi
   
 
 echo "furnace test suite begin..."
+echo "--- STEP 0: unit tests"
+gcc -Wall -Isrc/engine/platform/sound -o "test/qsound_block" "test/qsound_block.c" "src/engine/platform/sound/qsound.c" -lm || exit 1
+./test/qsound_block || exit 1
+g++ -std=c++14 -Wall -Iextern/vgsound_emu-modified -o "test/n163_block" "test/n163_block.cpp" extern/vgsound_emu-modified/vgsound_emu/src/n163/n163.cpp || exit 1
+./test/n163_block || exit 1
+g++ -std=c++14 -Wall -Isrc/engine/platform/sound/snes -o "test/snes_block" "test/snes_block.cpp" src/engine/platform/sound/snes/SPC_DSP.cpp || exit 1
+./test/snes_block || exit 1
+g++ -std=c++14 -DFMT_HEADER_ONLY -Isrc -Iextern/fmt/include -o "test/edge_output" "test/edge_output.cpp" src/engine/platform/abstract.cpp src/engine/platform/tia.cpp src/engine/platform/pcspkr.cpp src/engine/platform/pokemini.cpp src/engine/platform/sound/tia/Audio.cpp src/engine/platform/sound/tia/AudioChannel.cpp src/engine/macroInt.cpp src/engine/pattern.cpp src/engine/config.cpp src/log.cpp src/baseutils.cpp src/fileutils.cpp -lpthread || exit 1
+./test/edge_output || exit 1
+g++ -std=c++14 -DFMT_HEADER_ONLY -Isrc -Iextern/fmt/include -o "test/pcm_voice" "test/pcm_voice.cpp" src/engine/platform/abstract.cpp src/engine/platform/amiga.cpp src/engine/platform/segapcm.cpp src/engine/platform/pcmdac.cpp src/engine/waveSynth.cpp src/engine/macroInt.cpp src/engine/pattern.cpp src/engine/config.cpp src/log.cpp src/baseutils.cpp src/fileutils.cpp -lpthread || exit 1
+./test/pcm_voice || exit 1
+g++ -std=c++14 -DFMT_HEADER_ONLY -Isrc -Iextern/fmt/include -o "test/fm_write_schedule" "test/fm_write_schedule.cpp" src/engine/platform/abstract.cpp src/engine/platform/arcade.cpp src/engine/platform/genesis.cpp src/engine/platform/sound/ymfm/ymfm_opm.cpp src/engine/platform/sound/ymfm/ymfm_opn.cpp src/engine/platform/sound/ymfm/ymfm_adpcm.cpp src/engine/platform/sound/ymfm/ymfm_ssg.cpp extern/opm/opm.c extern/Nuked-OPN2/ym3438.c src/engine/macroInt.cpp src/engine/pattern.cpp src/engine/config.cpp src/log.cpp src/baseutils.cpp src/fileutils.cpp -lpthread || exit 1
+./test/fm_write_schedule || exit 1
+g++ -std=c++14 -DFMT_HEADER_ONLY -Isrc -Iextern/fmt/include -o "test/opl_block" "test/opl_block.cpp" src/engine/platform/abstract.cpp src/engine/platform/opl.cpp src/engine/platform/oplAInterface.cpp src/engine/platform/sound/ymfm/ymfm_adpcm.cpp extern/opl/opl3.c src/engine/macroInt.cpp src/engine/pattern.cpp src/engine/config.cpp src/log.cpp src/baseutils.cpp src/fileutils.cpp -lpthread || exit 1
+./test/opl_block || exit 1
 echo "--- STEP 1: render test files"
 mkdir -p "test/result/$testDir" || exit 1
 ls "test/songs/" | parallel --verbose -j8 ./build/furnace -output "test/result/$testDir/{0}.wav" "test/songs/{0}"
+ls "test/songs/" | parallel --verbose --halt now,fail=1 -j2 ./build/furnace -loglevel error -test engines "test/songs/{0}" || exit 1
+ls "test/songs/" | parallel --verbose --halt now,fail=1 -j2 ./build/furnace -loglevel error -test cmdstream "test/songs/{0}" || exit 1
 echo "--- STEP 2: calculate deltas"
 if [ -z $lastTest ]; then
   echo "skipping since this apparently is your first run."
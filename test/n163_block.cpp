@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vgsound_emu/src/n163/n163.hpp"
+
+#define MAX_RUN 1024
+#define ITERATIONS 40000
+
+// checks that n163_core::tick_run() produces the same output, oscilloscope
+// snapshots and RAM contents as calling tick() once per sample, under random
+// register writes (including waveforms which overlap the voice registers).
+// build (from the repository root):
+//   g++ -std=c++14 -Wall -Iextern/vgsound_emu-modified -o test/n163_block test/n163_block.cpp extern/vgsound_emu-modified/vgsound_emu/src/n163/n163.cpp
+// usage: n163_block [seed]
+// return values:
+// - 0: pass (both paths match)
+// - 1: fail (mismatch found)
+
+static n163_core chipA, chipB;
+
+static void writeBoth(unsigned char addr, unsigned char val) {
+  chipA.addr_w(addr);
+  chipA.data_w(val);
+  chipB.addr_w(addr);
+  chipB.data_w(val);
+}
+
+static void randomWrite() {
+  unsigned char addr;
+  unsigned char val=rand();
+  int kind=rand()%10;
+  if (kind<4) {
+    // voice registers, mostly in the active area
+    addr=0x40+rand()%0x40;
+  } else if (kind<6) {
+    // frequency, kept low sometimes so that the position moves slowly
+    addr=0x40+((rand()%8)<<3)+((rand()&1)<<1);
+    if (rand()&1) val&=0x0f;
+  } else if (kind<7) {
+    // voice count and volume of voice 8
+    addr=0x7f;
+  } else {
+    // waveform
+    addr=rand()%0x80;
+  }
+  writeBoth(addr,val);
+}
+
+int main(int argc, char** argv) {
+  srand((argc>1)?atoi(argv[1]):1234);
+
+  static short outB[MAX_RUN];
+  static short snapB[MAX_RUN*8];
+
+  long total=0;
+  long bad=0;
+  for (int mode=0; mode<2; mode++) {
+    bool multiplex=(mode==0);
+    chipA.reset();
+    chipB.reset();
+    chipA.set_multiplex(multiplex);
+    chipB.set_multiplex(multiplex);
+    for (int i=0; i<0x80; i++) writeBoth(i,rand());
+
+    for (int iter=0; iter<ITERATIONS; iter++) {
+      int writes=rand()%4;
+      for (int i=0; i<writes; i++) randomWrite();
+      if (rand()%200==0) {
+        bool disable=rand()&1;
+        chipA.set_disable(disable);
+        chipB.set_disable(disable);
+      }
+
+      unsigned int len=1+rand()%MAX_RUN;
+      unsigned int cyclesB=chipB.tick_run(outB,snapB,len);
+      unsigned int cyclesA=0;
+      for (unsigned int i=0; i<len; i++) {
+        chipA.tick();
+        total++;
+        bool mismatch=(chipA.out()!=outB[i]);
+        if (chipA.voice_cycle()==0x78) {
+          // tick_run() doesn't report wraps while disabled
+          if (cyclesA<cyclesB) for (int j=0; j<8; j++) {
+            if (chipA.voice_out(j)!=snapB[cyclesA*8+j]) mismatch=true;
+          }
+          cyclesA++;
+        }
+        if (mismatch) {
+          if (bad<5) fprintf(stderr,"mismatch at iteration %d sample %u: %d vs. %d\n",iter,i,chipA.out(),outB[i]);
+          bad++;
+        }
+      }
+      if (cyclesB!=0 && cyclesA!=cyclesB) {
+        if (bad<5) fprintf(stderr,"cycle count mismatch at iteration %d: %u vs. %u\n",iter,cyclesA,cyclesB);
+        bad++;
+      }
+      if (chipA.voice_cycle()!=chipB.voice_cycle()) {
+        if (bad<5) fprintf(stderr,"voice cycle mismatch at iteration %d\n",iter);
+        bad++;
+      }
+      for (int i=0; i<0x80; i++) {
+        if (chipA.reg(i)!=chipB.reg(i)) {
+          if (bad<5) fprintf(stderr,"RAM mismatch at iteration %d address %.2x\n",iter,i);
+          bad++;
+          break;
+        }
+      }
+    }
+  }
+
+  printf("%ld samples, %ld mismatches\n",total,bad);
+  return (bad!=0);
+}
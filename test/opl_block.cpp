@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "engine/engine.h"
+#include "engine/platform/opl.h"
+
+#define MAX_RUN 2048
+#define ITERATIONS 300
+
+// checks that rendering Nuked-OPL3 in blocks (acquireBlocks() with
+// applyDueWrites() and acquireRun()) produces the same output, oscilloscope
+// data and register pool as the old loop which checked the write queue on
+// every sample, while a random register dump is played back.
+// the old loop is kept below as acquirePerSample().
+// OPL2, OPL3 (also downsampled), Y8950 and YMU759 are tested, with and
+// without drums.
+// the platform only calls a few engine functions, which are defined below so
+// the rest of the engine doesn't have to be linked.
+// build (from the repository root):
+//   g++ -std=c++14 -DFMT_HEADER_ONLY -Isrc -Iextern/fmt/include -o test/opl_block test/opl_block.cpp src/engine/platform/abstract.cpp src/engine/platform/opl.cpp src/engine/platform/oplAInterface.cpp src/engine/platform/sound/ymfm/ymfm_adpcm.cpp extern/opl/opl3.c src/engine/macroInt.cpp src/engine/pattern.cpp src/engine/config.cpp src/log.cpp src/baseutils.cpp src/fileutils.cpp -lpthread
+// usage: opl_block [seed]
+// return values:
+// - 0: pass (both paths match)
+// - 1: fail (mismatch found)
+
+void DivEngine::changeSong(size_t songIndex) {
+}
+
+DivInstrument* DivEngine::getIns(int index, DivInstrumentType fallbackType) {
+  return NULL;
+}
+
+DivSample* DivEngine::getSample(int index) {
+  return NULL;
+}
+
+int DivEngine::getConfInt(String key, int fallback) {
+  return fallback;
+}
+
+double DivEngine::calcBaseFreq(double clock, double divider, int note, bool period) {
+  double base=440.0*pow(2.0,(double)(note-57)/12.0);
+  return period?(clock/(base*divider)):(base*divider/clock);
+}
+
+int DivEngine::calcBaseFreqFNumBlock(double clock, double divider, int note, int bits) {
+  return note;
+}
+
+int DivEngine::calcFreq(int base, int pitch, bool period, int octave, int pitch2, double clock, double divider, int blockBits) {
+  return period?(base-pitch-pitch2):(base+pitch+pitch2);
+}
+
+int DivEngine::calcArp(int note, int arp, int offset) {
+  return note+arp+offset;
+}
+
+TAAudioDesc& DivEngine::getAudioDescGot() {
+  return got;
+}
+
+bool DivSample::isLoopable() {
+  return false;
+}
+
+DivSample::~DivSample() {
+}
+
+class TestOPL: public DivPlatformOPL {
+  public:
+    bool perSample;
+
+    // the Nuked-OPL3 loop before it was split into blocks.
+    void acquirePerSample(short* bufL, short* bufR, size_t start, size_t len) {
+      short o[2];
+      int os[2];
+      ymfm::ymfm_output<2> aOut;
+
+      for (size_t h=start; h<start+len; h++) {
+        os[0]=0; os[1]=0;
+        if (!writes.empty() && --delay<0) {
+          delay=1;
+          QueuedWrite& w=writes.front();
+          switch (w.addr) {
+            case 8:
+              if (adpcmChan>=0) {
+                adpcmB->write(w.addr-7,(w.val&15)|0x80);
+                OPL3_WriteReg(&fm,w.addr,w.val&0xc0);
+              } else {
+                OPL3_WriteReg(&fm,w.addr,w.val);
+              }
+              break;
+            case 7: case 9: case 10: case 11: case 12: case 13: case 14: case 15: case 16: case 17: case 18: case 21: case 22: case 23:
+              if (adpcmChan>=0) {
+                adpcmB->write(w.addr-7,w.val);
+              } else {
+                OPL3_WriteReg(&fm,w.addr,w.val);
+              }
+              break;
+            default:
+              OPL3_WriteReg(&fm,w.addr,w.val);
+              break;
+          }
+          regPool[w.addr&511]=w.val;
+          writes.pop();
+        }
+
+        if (downsample) {
+          OPL3_GenerateResampled(&fm,o);
+        } else {
+          OPL3_Generate(&fm,o);
+        }
+        os[0]+=o[0]; os[1]+=o[1];
+
+        if (adpcmChan>=0) {
+          adpcmB->clock();
+          aOut.clear();
+          adpcmB->output<2>(aOut,0);
+
+          if (!isMuted[adpcmChan]) {
+            os[0]-=aOut.data[0]>>3;
+            os[1]-=aOut.data[0]>>3;
+            oscBuf[adpcmChan]->data[oscBuf[adpcmChan]->needle++]=aOut.data[0];
+          } else {
+            oscBuf[adpcmChan]->data[oscBuf[adpcmChan]->needle++]=0;
+          }
+        }
+
+        if (fm.rhy&0x20) {
+          for (int i=0; i<melodicChans+1; i++) {
+            unsigned char ch=outChanMap[i];
+            if (ch==255) continue;
+            oscBuf[i]->data[oscBuf[i]->needle]=0;
+            if (fm.channel[i].out[0]!=NULL) {
+              oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[0];
+            }
+            if (fm.channel[i].out[1]!=NULL) {
+              oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[1];
+            }
+            oscBuf[i]->data[oscBuf[i]->needle]<<=1;
+            oscBuf[i]->needle++;
+          }
+          // special
+          oscBuf[melodicChans+1]->data[oscBuf[melodicChans+1]->needle++]=fm.slot[16].out*6;
+          oscBuf[melodicChans+2]->data[oscBuf[melodicChans+2]->needle++]=fm.slot[14].out*6;
+          oscBuf[melodicChans+3]->data[oscBuf[melodicChans+3]->needle++]=fm.slot[17].out*6;
+          oscBuf[melodicChans+4]->data[oscBuf[melodicChans+4]->needle++]=fm.slot[13].out*6;
+        } else {
+          for (int i=0; i<chans; i++) {
+            unsigned char ch=outChanMap[i];
+            if (ch==255) continue;
+            oscBuf[i]->data[oscBuf[i]->needle]=0;
+            if (fm.channel[i].out[0]!=NULL) {
+              oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[0];
+            }
+            if (fm.channel[i].out[1]!=NULL) {
+              oscBuf[i]->data[oscBuf[i]->needle]+=*fm.channel[ch].out[1];
+            }
+            oscBuf[i]->data[oscBuf[i]->needle]<<=1;
+            oscBuf[i]->needle++;
+          }
+        }
+
+        if (os[0]<-32768) os[0]=-32768;
+        if (os[0]>32767) os[0]=32767;
+
+        if (os[1]<-32768) os[1]=-32768;
+        if (os[1]>32767) os[1]=32767;
+
+        bufL[h]=os[0];
+        if (oplType==3 || oplType==759) {
+          bufR[h]=os[1];
+        }
+      }
+    }
+
+    void acquire(short* bufL, short* bufR, size_t start, size_t len) {
+      if (perSample) {
+        acquirePerSample(bufL,bufR,start,len);
+      } else {
+        DivPlatformOPL::acquire(bufL,bufR,start,len);
+      }
+    }
+
+    // both copies must get the same ADPCM-B memory.
+    void fillADPCMMem(unsigned int seed) {
+      if (adpcmChan<0) return;
+      for (size_t i=0; i<getSampleMemCapacity(0); i++) {
+        seed=seed*1103515245+12345;
+        adpcmBMem[i]=seed>>16;
+      }
+    }
+
+    // returns the number of differences in the write queue and register pool.
+    long compareState(TestOPL& other) {
+      long bad=0;
+      if (writes.size()!=other.writes.size()) {
+        fprintf(stderr,"write queue mismatch: %d vs. %d\n",(int)writes.size(),(int)other.writes.size());
+        bad++;
+      }
+      if (memcmp(regPool,other.regPool,512)!=0) bad++;
+      return bad;
+    }
+
+    // getOscBuffer() maps 4-op channels and leaves out the last ones.
+    DivDispatchOscBuffer* getRawOscBuffer(int ch) {
+      return oscBuf[ch];
+    }
+
+    TestOPL(bool slow):
+      DivPlatformOPL(),
+      perSample(slow) {}
+};
+
+static DivEngine* engine;
+
+static short bufL[2][MAX_RUN], bufR[2][MAX_RUN];
+
+// renders one run through both paths and returns the number of mismatching
+// samples.
+static long renderBoth(TestOPL& block, TestOPL& perSample) {
+  size_t len=1+rand()%MAX_RUN;
+  long bad=0;
+  unsigned short needle[20];
+  for (int i=0; i<20; i++) {
+    needle[i]=block.getRawOscBuffer(i)->needle;
+  }
+
+  memset(bufL,0,sizeof(bufL));
+  memset(bufR,0,sizeof(bufR));
+  block.acquire(bufL[0],bufR[0],0,len);
+  perSample.acquire(bufL[1],bufR[1],0,len);
+
+  for (size_t i=0; i<len; i++) {
+    if (bufL[0][i]!=bufL[1][i]) bad++;
+    if (bufR[0][i]!=bufR[1][i]) bad++;
+  }
+
+  for (int i=0; i<20; i++) {
+    DivDispatchOscBuffer* a=block.getRawOscBuffer(i);
+    DivDispatchOscBuffer* b=perSample.getRawOscBuffer(i);
+    if (a->needle!=b->needle) {
+      fprintf(stderr,"oscilloscope needle mismatch on channel %d: %d vs. %d\n",i,a->needle,b->needle);
+      bad++;
+      continue;
+    }
+    unsigned short count=a->needle-needle[i];
+    for (unsigned short j=0; j<count; j++) {
+      unsigned short pos=needle[i]+j;
+      if (a->data[pos]!=b->data[pos]) bad++;
+    }
+  }
+  return bad;
+}
+
+// a random OPL register write, weighted towards key on and the operator
+// registers. the second bank is only used on OPL3, and ADPCM-B registers are
+// only written on chips which have it.
+static void randomWrite(unsigned short& addr, unsigned char& val, bool opl3, bool adpcm, bool drums) {
+  val=rand();
+  switch (rand()%10) {
+    case 0:
+      addr=0xb0+rand()%9;
+      break;
+    case 1:
+      // TL, kept loud
+      addr=0x40+rand()%0x16;
+      val&=0x1f;
+      break;
+    case 2:
+      addr=0xbd;
+      if (drums) {
+        val|=0x20;
+      } else {
+        val&=0xc0;
+      }
+      break;
+    case 3:
+      if (adpcm) {
+        addr=7+rand()%17;
+        if (addr==19 || addr==20) addr=8;
+      } else {
+        addr=0x08;
+      }
+      break;
+    case 4:
+      addr=0xa0+rand()%9;
+      break;
+    case 5:
+      addr=0xc0+rand()%9;
+      break;
+    case 6:
+      addr=0xe0+rand()%0x16;
+      break;
+    default:
+      addr=0x20+rand()%0x76;
+      break;
+  }
+  if (opl3) {
+    if (rand()&1) addr|=0x100;
+    if (rand()%32==0) {
+      addr=0x104;
+      val&=0x3f;
+    }
+  }
+}
+
+// pokes the same dump into both copies, then plays it back in random runs
+// with more writes in between. some of them are sent in bursts, so that the
+// queue stays busy across several runs.
+static long testChip(int type, bool drums) {
+  DivConfig flags;
+  TestOPL a(false), b(true);
+  a.setOPLType(type,drums);
+  b.setOPLType(type,drums);
+  a.init(engine,drums?20:18,44100,flags);
+  b.init(engine,drums?20:18,44100,flags);
+  a.fillADPCMMem(type);
+  b.fillADPCMMem(type);
+
+  bool opl3=(type==3 || type==4 || type==759);
+  bool adpcm=(type==8950 || type==759);
+  long bad=0;
+  unsigned short addr;
+  unsigned char val;
+  for (int i=0; i<256; i++) {
+    randomWrite(addr,val,opl3,adpcm,drums);
+    a.poke(addr,val);
+    b.poke(addr,val);
+  }
+  for (int i=0; i<ITERATIONS; i++) {
+    int writes=(rand()%16==0)?(rand()%128):(rand()%6);
+    for (int j=0; j<writes; j++) {
+      randomWrite(addr,val,opl3,adpcm,drums);
+      a.poke(addr,val);
+      b.poke(addr,val);
+    }
+    bad+=renderBoth(a,b);
+    bad+=a.compareState(b);
+    if (rand()%500==0) {
+      a.reset();
+      b.reset();
+    }
+  }
+  a.quit();
+  b.quit();
+  return bad;
+}
+
+int main(int argc, char** argv) {
+  srand((argc>1)?atoi(argv[1]):1234);
+  engine=new DivEngine;
+
+  static const int types[]={2, 3, 4, 8950, 759};
+  static const char* names[]={"OPL2", "OPL3", "OPL3 (downsampled)", "Y8950", "YMU759"};
+  long totalBad=0;
+  for (int i=0; i<5; i++) {
+    for (int drums=0; drums<2; drums++) {
+      long bad=testChip(types[i],drums);
+      printf("%s%s: %ld mismatches\n",names[i],drums?" (drums)":"",bad);
+      totalBad+=bad;
+    }
+  }
+
+  return (totalBad!=0);
+}
@@ -0,0 +1,633 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "engine/engine.h"
+#include "engine/platform/amiga.h"
+#include "engine/platform/segapcm.h"
+#include "engine/platform/pcmdac.h"
+
+#define MAX_RUN 2048
+#define ITERATIONS 20000
+#define SAMPLE_COUNT 8
+#define AMIGA_DIVIDER 8
+
+// checks that the block renderers of Amiga, SegaPCM and PCM DAC (built on
+// pcmVoice.h) produce the same output, oscilloscope data and channel state
+// as the old loops which rendered every voice one sample at a time.
+// the old loops are kept below as acquirePerSample(). both copies of a chip
+// get the same random voice state (position, pitch, volume, sample, loop,
+// wavetable and modulation), then render random runs.
+// the platforms only call a few engine functions, which are defined below so
+// the rest of the engine doesn't have to be linked.
+// build (from the repository root):
+//   g++ -std=c++14 -DFMT_HEADER_ONLY -Isrc -Iextern/fmt/include -o test/pcm_voice test/pcm_voice.cpp src/engine/platform/abstract.cpp src/engine/platform/amiga.cpp src/engine/platform/segapcm.cpp src/engine/platform/pcmdac.cpp src/engine/waveSynth.cpp src/engine/macroInt.cpp src/engine/pattern.cpp src/engine/config.cpp src/log.cpp src/baseutils.cpp src/fileutils.cpp -lpthread
+// usage: pcm_voice [seed]
+// return values:
+// - 0: pass (both paths match)
+// - 1: fail (mismatch found)
+
+static DivSample samples[SAMPLE_COUNT];
+static DivWavetable wave;
+
+void DivEngine::changeSong(size_t songIndex) {
+}
+
+DivInstrument* DivEngine::getIns(int index, DivInstrumentType fallbackType) {
+  return NULL;
+}
+
+DivSample* DivEngine::getSample(int index) {
+  return &samples[index];
+}
+
+DivWavetable* DivEngine::getWave(int index) {
+  return &wave;
+}
+
+int DivEngine::getConfInt(String key, int fallback) {
+  return fallback;
+}
+
+double DivEngine::calcBaseFreq(double clock, double divider, int note, bool period) {
+  double base=440.0*pow(2.0,(double)(note-57)/12.0);
+  return period?(clock/(base*divider)):(base*divider/clock);
+}
+
+int DivEngine::calcFreq(int base, int pitch, bool period, int octave, int pitch2, double clock, double divider, int blockBits) {
+  return period?(base-pitch-pitch2):(base+pitch+pitch2);
+}
+
+int DivEngine::calcArp(int note, int arp, int offset) {
+  return note+arp+offset;
+}
+
+TAAudioDesc& DivEngine::getAudioDescGot() {
+  return got;
+}
+
+bool DivSample::isLoopable() {
+  return loop && ((loopStart>=0 && loopStart<loopEnd) && (loopEnd>loopStart && loopEnd<=(int)samples));
+}
+
+int DivSample::getLoopStartPosition(DivSampleDepth depth) {
+  return loopStart;
+}
+
+int DivSample::getLoopEndPosition(DivSampleDepth depth) {
+  return loopEnd;
+}
+
+DivSample::~DivSample() {
+}
+
+#define writeAudDat(x) \
+  chan[i].audDat=x; \
+  if (i<3 && chan[i].useV) { \
+    chan[i+1].outVol=(unsigned char)chan[i].audDat^0x80; \
+    if (chan[i+1].outVol>64) chan[i+1].outVol=64; \
+  } \
+  if (i<3 && chan[i].useP) { \
+    chan[i+1].freq=(unsigned char)chan[i].audDat^0x80; \
+    if (chan[i+1].freq<AMIGA_DIVIDER) chan[i+1].freq=AMIGA_DIVIDER; \
+  }
+
+class TestAmiga: public DivPlatformAmiga {
+  public:
+    bool perSample;
+
+    // the Amiga loop before voices were rendered in blocks.
+    void acquirePerSample(short* bufL, short* bufR, size_t start, size_t len) {
+      int outL, outR, output;
+      for (size_t h=start; h<start+len; h++) {
+        outL=0;
+        outR=0;
+        for (int i=0; i<4; i++) {
+          if (!chan[i].active) {
+            oscBuf[i]->data[oscBuf[i]->needle++]=0;
+            continue;
+          }
+          if (chan[i].useWave || (chan[i].sample>=0 && chan[i].sample<parent->song.sampleLen)) {
+            chan[i].audSub-=AMIGA_DIVIDER;
+            if (chan[i].audSub<0) {
+              if (chan[i].useWave) {
+                writeAudDat(chan[i].ws.output[chan[i].audPos++]^0x80);
+                if (chan[i].audPos>=(unsigned int)(chan[i].audLen<<1)) {
+                  chan[i].audPos=0;
+                }
+              } else {
+                DivSample* s=parent->getSample(chan[i].sample);
+                if (s->samples>0) {
+                  if (chan[i].audPos<s->samples) {
+                    writeAudDat(s->data8[chan[i].audPos++]);
+                  }
+                  if (s->isLoopable() && chan[i].audPos>=MIN(131071,(unsigned int)s->loopEnd)) {
+                    chan[i].audPos=s->loopStart;
+                  } else if (chan[i].audPos>=MIN(131071,s->samples)) {
+                    chan[i].sample=-1;
+                  }
+                } else {
+                  chan[i].sample=-1;
+                }
+              }
+              if (bypassLimits) {
+                chan[i].audSub+=MAX(AMIGA_DIVIDER,chan[i].freq);
+              } else {
+                chan[i].audSub+=MAX(114,chan[i].freq);
+              }
+            }
+          }
+          if (!isMuted[i]) {
+            output=chan[i].audDat*chan[i].outVol;
+            if (i==0 || i==3) {
+              outL+=(output*sep1)>>7;
+              outR+=(output*sep2)>>7;
+            } else {
+              outL+=(output*sep2)>>7;
+              outR+=(output*sep1)>>7;
+            }
+            oscBuf[i]->data[oscBuf[i]->needle++]=output<<2;
+          } else {
+            oscBuf[i]->data[oscBuf[i]->needle++]=0;
+          }
+        }
+        filter[0][0]+=(filtConst*(outL-filter[0][0]))>>12;
+        filter[0][1]+=(filtConst*(filter[0][0]-filter[0][1]))>>12;
+        filter[1][0]+=(filtConst*(outR-filter[1][0]))>>12;
+        filter[1][1]+=(filtConst*(filter[1][0]-filter[1][1]))>>12;
+        bufL[h]=filter[0][1];
+        bufR[h]=filter[1][1];
+      }
+    }
+
+    void acquire(short* bufL, short* bufR, size_t start, size_t len) {
+      if (perSample) {
+        acquirePerSample(bufL,bufR,start,len);
+      } else {
+        DivPlatformAmiga::acquire(bufL,bufR,start,len);
+      }
+    }
+
+    void randomize(int i) {
+      chan[i].active=(rand()%8)!=0;
+      chan[i].useWave=(rand()%4)==0;
+      if (chan[i].useWave) {
+        chan[i].audLen=1+rand()%128;
+        chan[i].audPos=rand()%(chan[i].audLen<<1);
+        for (int j=0; j<256; j++) chan[i].ws.output[j]=rand()&0xff;
+      } else {
+        chan[i].sample=(rand()%(SAMPLE_COUNT+2))-1;
+        chan[i].audPos=rand()%600;
+      }
+      chan[i].audSub=rand()%1200;
+      chan[i].freq=rand()%1200;
+      chan[i].outVol=rand()%65;
+      chan[i].audDat=rand();
+      // modulation is rare, since it falls back to rendering every sample
+      chan[i].useV=(rand()%16)==0;
+      chan[i].useP=(rand()%16)==0;
+      isMuted[i]=(rand()%8)==0;
+      bypassLimits=rand()&1;
+    }
+
+    void copyFrom(TestAmiga& other) {
+      for (int i=0; i<4; i++) {
+        chan[i].active=other.chan[i].active;
+        chan[i].useWave=other.chan[i].useWave;
+        chan[i].audLen=other.chan[i].audLen;
+        chan[i].audPos=other.chan[i].audPos;
+        memcpy(chan[i].ws.output,other.chan[i].ws.output,sizeof(chan[i].ws.output));
+        chan[i].sample=other.chan[i].sample;
+        chan[i].audSub=other.chan[i].audSub;
+        chan[i].freq=other.chan[i].freq;
+        chan[i].outVol=other.chan[i].outVol;
+        chan[i].audDat=other.chan[i].audDat;
+        chan[i].useV=other.chan[i].useV;
+        chan[i].useP=other.chan[i].useP;
+        isMuted[i]=other.isMuted[i];
+      }
+      bypassLimits=other.bypassLimits;
+    }
+
+    // returns the number of differences in the channel state.
+    long compareState(TestAmiga& other) {
+      long bad=0;
+      for (int i=0; i<4; i++) {
+        if (chan[i].audPos!=other.chan[i].audPos) bad++;
+        if (chan[i].audSub!=other.chan[i].audSub) bad++;
+        if (chan[i].audDat!=other.chan[i].audDat) bad++;
+        if (chan[i].sample!=other.chan[i].sample) bad++;
+        if (chan[i].outVol!=other.chan[i].outVol) bad++;
+        if (chan[i].freq!=other.chan[i].freq) bad++;
+      }
+      if (memcmp(filter,other.filter,sizeof(filter))!=0) bad++;
+      return bad;
+    }
+
+    TestAmiga(bool old):
+      DivPlatformAmiga(),
+      perSample(old) {}
+};
+
+class TestSegaPCM: public DivPlatformSegaPCM {
+  public:
+    bool perSample;
+
+    // the SegaPCM loop before voices were rendered in blocks.
+    void acquirePerSample(short* bufL, short* bufR, size_t start, size_t len) {
+      int os[2];
+
+      for (size_t h=start; h<start+len; h++) {
+        os[0]=0; os[1]=0;
+        // do a PCM cycle
+        pcmL=0; pcmR=0;
+        for (int i=0; i<16; i++) {
+          if (chan[i].pcm.sample>=0 && chan[i].pcm.sample<parent->song.sampleLen) {
+            DivSample* s=parent->getSample(chan[i].pcm.sample);
+            if (s->samples<=0) {
+              chan[i].pcm.sample=-1;
+              oscBuf[i]->data[oscBuf[i]->needle++]=0;
+              continue;
+            }
+            if (!isMuted[i]) {
+              oscBuf[i]->data[oscBuf[i]->needle++]=s->data8[chan[i].pcm.pos>>8]*(chan[i].chVolL+chan[i].chVolR)>>1;
+              pcmL+=(s->data8[chan[i].pcm.pos>>8]*chan[i].chVolL);
+              pcmR+=(s->data8[chan[i].pcm.pos>>8]*chan[i].chVolR);
+            }
+            chan[i].pcm.pos+=chan[i].pcm.freq;
+            if (s->isLoopable() && chan[i].pcm.pos>=((unsigned int)s->loopEnd<<8)) {
+              chan[i].pcm.pos=s->loopStart<<8;
+            } else if (chan[i].pcm.pos>=(s->samples<<8)) {
+              chan[i].pcm.sample=-1;
+            }
+          } else {
+            oscBuf[i]->data[oscBuf[i]->needle++]=0;
+          }
+        }
+
+        os[0]=pcmL;
+        if (os[0]<-32768) os[0]=-32768;
+        if (os[0]>32767) os[0]=32767;
+
+        os[1]=pcmR;
+        if (os[1]<-32768) os[1]=-32768;
+        if (os[1]>32767) os[1]=32767;
+
+        bufL[h]=os[0];
+        bufR[h]=os[1];
+      }
+    }
+
+    void acquire(short* bufL, short* bufR, size_t start, size_t len) {
+      if (perSample) {
+        acquirePerSample(bufL,bufR,start,len);
+      } else {
+        DivPlatformSegaPCM::acquire(bufL,bufR,start,len);
+      }
+    }
+
+    void randomize(int i) {
+      chan[i].pcm.sample=(rand()%(SAMPLE_COUNT+2))-1;
+      // the old loop reads the position before checking it, so it has to be
+      // inside the sample
+      if (chan[i].pcm.sample>=0 && chan[i].pcm.sample<SAMPLE_COUNT && samples[chan[i].pcm.sample].samples>0) {
+        chan[i].pcm.pos=rand()%(samples[chan[i].pcm.sample].samples<<8);
+      } else {
+        chan[i].pcm.pos=0;
+      }
+      chan[i].pcm.freq=rand();
+      chan[i].chVolL=rand()&0x7f;
+      chan[i].chVolR=rand()&0x7f;
+      isMuted[i]=(rand()%8)==0;
+    }
+
+    void copyFrom(TestSegaPCM& other) {
+      for (int i=0; i<16; i++) {
+        chan[i].pcm=other.chan[i].pcm;
+        chan[i].chVolL=other.chan[i].chVolL;
+        chan[i].chVolR=other.chan[i].chVolR;
+        isMuted[i]=other.isMuted[i];
+      }
+    }
+
+    long compareState(TestSegaPCM& other) {
+      long bad=0;
+      for (int i=0; i<16; i++) {
+        if (chan[i].pcm.pos!=other.chan[i].pcm.pos) bad++;
+        if (chan[i].pcm.sample!=other.chan[i].pcm.sample) bad++;
+      }
+      if (pcmL!=other.pcmL || pcmR!=other.pcmR) bad++;
+      return bad;
+    }
+
+    TestSegaPCM(bool old):
+      DivPlatformSegaPCM(),
+      perSample(old) {}
+};
+
+class TestPCMDAC: public DivPlatformPCMDAC {
+  public:
+    bool perSample;
+
+    // the PCM DAC loop before forward runs were rendered in one go.
+    void acquirePerSample(short* bufL, short* bufR, size_t start, size_t len) {
+      const int depthScale=(15-outDepth);
+      int output=0;
+      for (size_t h=start; h<start+len; h++) {
+        if (!chan.active || isMuted) {
+          bufL[h]=0;
+          bufR[h]=0;
+          oscBuf->data[oscBuf->needle++]=0;
+          continue;
+        }
+        if (chan.useWave || (chan.sample>=0 && chan.sample<parent->song.sampleLen)) {
+          chan.audPos+=((!chan.useWave) && chan.audDir)?-(chan.freq>>16):(chan.freq>>16);
+          chan.audSub+=(chan.freq&0xffff);
+          if (chan.audSub>=0x10000) {
+            chan.audSub-=0x10000;
+            chan.audPos+=((!chan.useWave) && chan.audDir)?-1:1;
+          }
+          if (chan.useWave) {
+            if (chan.audPos>=(int)chan.audLen) {
+              chan.audPos%=chan.audLen;
+              chan.audDir=false;
+            }
+            output=(chan.ws.output[chan.audPos]-0x80)<<8;
+          } else {
+            DivSample* s=parent->getSample(chan.sample);
+            if (s->samples>0) {
+              if (chan.audDir) {
+                if (s->isLoopable()) {
+                  switch (s->loopMode) {
+                    case DIV_SAMPLE_LOOP_FORWARD:
+                    case DIV_SAMPLE_LOOP_PINGPONG:
+                      if (chan.audPos<s->loopStart) {
+                        chan.audPos=s->loopStart+(s->loopStart-chan.audPos);
+                        chan.audDir=false;
+                      }
+                      break;
+                    case DIV_SAMPLE_LOOP_BACKWARD:
+                      if (chan.audPos<s->loopStart) {
+                        chan.audPos=s->loopEnd-1-(s->loopStart-chan.audPos);
+                        chan.audDir=true;
+                      }
+                      break;
+                    default:
+                      if (chan.audPos<0) {
+                        chan.sample=-1;
+                      }
+                      break;
+                  }
+                } else if (chan.audPos>=(int)s->samples) {
+                  chan.sample=-1;
+                }
+              } else {
+                if (s->isLoopable()) {
+                  switch (s->loopMode) {
+                    case DIV_SAMPLE_LOOP_FORWARD:
+                      if (chan.audPos>=s->loopEnd) {
+                        chan.audPos=(chan.audPos+s->loopStart)-s->loopEnd;
+                        chan.audDir=false;
+                      }
+                      break;
+                    case DIV_SAMPLE_LOOP_BACKWARD:
+                    case DIV_SAMPLE_LOOP_PINGPONG:
+                      if (chan.audPos>=s->loopEnd) {
+                        chan.audPos=s->loopEnd-1-(s->loopEnd-1-chan.audPos);
+                        chan.audDir=true;
+                      }
+                      break;
+                    default:
+                      if (chan.audPos>=(int)s->samples) {
+                        chan.sample=-1;
+                      }
+                      break;
+                  }
+                } else if (chan.audPos>=(int)s->samples) {
+                  chan.sample=-1;
+                }
+              }
+              if (chan.audPos>=0 && chan.audPos<(int)s->samples) {
+                output=s->data16[chan.audPos];
+              }
+            } else {
+              chan.sample=-1;
+            }
+          }
+        }
+        output=output*chan.vol*chan.envVol/16384;
+        oscBuf->data[oscBuf->needle++]=output;
+        if (outStereo) {
+          bufL[h]=((output*chan.panL)>>(depthScale+8))<<depthScale;
+          bufR[h]=((output*chan.panR)>>(depthScale+8))<<depthScale;
+        } else {
+          output=(output>>depthScale)<<depthScale;
+          bufL[h]=output;
+          bufR[h]=output;
+        }
+      }
+    }
+
+    void acquire(short* bufL, short* bufR, size_t start, size_t len) {
+      if (perSample) {
+        acquirePerSample(bufL,bufR,start,len);
+      } else {
+        DivPlatformPCMDAC::acquire(bufL,bufR,start,len);
+      }
+    }
+
+    void randomize() {
+      chan.active=(rand()%8)!=0;
+      chan.useWave=(rand()%4)==0;
+      chan.audDir=(rand()%4)==0;
+      if (chan.useWave) {
+        chan.audLen=1+rand()%256;
+        chan.audPos=rand()%chan.audLen;
+        chan.audDir=false;
+        for (int j=0; j<256; j++) chan.ws.output[j]=rand()&0xff;
+      } else {
+        chan.sample=(rand()%(SAMPLE_COUNT+2))-1;
+        chan.audPos=rand()%600;
+      }
+      chan.audSub=rand()&0xffff;
+      // mostly below one sample per output sample, sometimes above
+      chan.freq=(rand()%4)?(rand()&0xffff):(rand()&0x3ffff);
+      chan.vol=rand()&0xff;
+      chan.envVol=rand()%65;
+      chan.panL=rand()&0xff;
+      chan.panR=rand()&0xff;
+      isMuted=(rand()%16)==0;
+      outDepth=rand()%16;
+      outStereo=rand()&1;
+    }
+
+    void copyFrom(TestPCMDAC& other) {
+      chan.active=other.chan.active;
+      chan.useWave=other.chan.useWave;
+      chan.audDir=other.chan.audDir;
+      chan.audLen=other.chan.audLen;
+      chan.audPos=other.chan.audPos;
+      memcpy(chan.ws.output,other.chan.ws.output,sizeof(chan.ws.output));
+      chan.sample=other.chan.sample;
+      chan.audSub=other.chan.audSub;
+      chan.freq=other.chan.freq;
+      chan.vol=other.chan.vol;
+      chan.envVol=other.chan.envVol;
+      chan.panL=other.chan.panL;
+      chan.panR=other.chan.panR;
+      isMuted=other.isMuted;
+      outDepth=other.outDepth;
+      outStereo=other.outStereo;
+    }
+
+    long compareState(TestPCMDAC& other) {
+      long bad=0;
+      if (chan.audPos!=other.chan.audPos) bad++;
+      if (chan.audSub!=other.chan.audSub) bad++;
+      if (chan.audDir!=other.chan.audDir) bad++;
+      if (chan.sample!=other.chan.sample) bad++;
+      return bad;
+    }
+
+    TestPCMDAC(bool old):
+      DivPlatformPCMDAC(),
+      perSample(old) {}
+};
+
+static DivEngine* engine;
+
+static short bufL[2][MAX_RUN], bufR[2][MAX_RUN];
+
+// random sample lengths, contents and loops. some loops are invalid, and one
+// sample is empty.
+static void makeSamples() {
+  for (int i=0; i<SAMPLE_COUNT; i++) {
+    DivSample& s=samples[i];
+    s.samples=(i==0)?0:(1+rand()%((i&1)?8:512));
+    s.data8=new signed char[s.samples+1];
+    s.data16=new short[s.samples+1];
+    for (unsigned int j=0; j<s.samples; j++) {
+      s.data8[j]=rand();
+      s.data16[j]=rand();
+    }
+    s.loop=(rand()%4)!=0;
+    s.loopStart=(s.samples>0)?(rand()%s.samples):0;
+    s.loopEnd=s.loopStart+1+((s.samples>0)?(rand()%s.samples):0);
+    if (s.loopEnd>(int)s.samples && rand()%4!=0) s.loopEnd=s.samples;
+    s.loopMode=(DivSampleLoopMode)(rand()%3);
+  }
+  engine->song.sampleLen=SAMPLE_COUNT;
+}
+
+// renders one run through both paths and returns the number of mismatching
+// samples.
+static long renderBoth(DivDispatch* block, DivDispatch* perSample, int oscChans) {
+  size_t len=1+rand()%MAX_RUN;
+  long bad=0;
+
+  unsigned short needle[16];
+  for (int i=0; i<oscChans; i++) {
+    needle[i]=block->getOscBuffer(i)->needle;
+  }
+
+  block->acquire(bufL[0],bufR[0],0,len);
+  perSample->acquire(bufL[1],bufR[1],0,len);
+
+  for (size_t i=0; i<len; i++) {
+    if (bufL[0][i]!=bufL[1][i]) bad++;
+    if (bufR[0][i]!=bufR[1][i]) bad++;
+  }
+
+  for (int i=0; i<oscChans; i++) {
+    DivDispatchOscBuffer* a=block->getOscBuffer(i);
+    DivDispatchOscBuffer* b=perSample->getOscBuffer(i);
+    if (a->needle!=b->needle) {
+      fprintf(stderr,"oscilloscope needle mismatch on channel %d: %d vs. %d\n",i,a->needle,b->needle);
+      bad++;
+      continue;
+    }
+    unsigned short count=a->needle-needle[i];
+    for (unsigned short j=0; j<count; j++) {
+      unsigned short pos=needle[i]+j;
+      if (a->data[pos]!=b->data[pos]) bad++;
+    }
+  }
+  return bad;
+}
+
+static long testAmiga() {
+  long bad=0;
+  for (int model=0; model<2; model++) {
+    DivConfig flags;
+    flags.set("chipType",model);
+    flags.set("stereoSep",rand()%128);
+    TestAmiga a(false), b(true);
+    a.init(engine,4,44100,flags);
+    b.init(engine,4,44100,flags);
+    for (int i=0; i<ITERATIONS; i++) {
+      if (rand()%4==0) {
+        a.randomize(rand()&3);
+        b.copyFrom(a);
+      }
+      bad+=renderBoth(&a,&b,4);
+      bad+=a.compareState(b);
+    }
+    a.quit();
+    b.quit();
+  }
+  return bad;
+}
+
+static long testSegaPCM() {
+  DivConfig flags;
+  TestSegaPCM a(false), b(true);
+  a.init(engine,16,44100,flags);
+  b.init(engine,16,44100,flags);
+  long bad=0;
+  for (int i=0; i<ITERATIONS; i++) {
+    if (rand()%4==0) {
+      a.randomize(rand()&15);
+      b.copyFrom(a);
+    }
+    bad+=renderBoth(&a,&b,16);
+    bad+=a.compareState(b);
+  }
+  a.quit();
+  b.quit();
+  return bad;
+}
+
+static long testPCMDAC() {
+  DivConfig flags;
+  TestPCMDAC a(false), b(true);
+  a.init(engine,1,44100,flags);
+  b.init(engine,1,44100,flags);
+  long bad=0;
+  for (int i=0; i<ITERATIONS; i++) {
+    if (rand()%4==0) {
+      a.randomize();
+      b.copyFrom(a);
+    }
+    bad+=renderBoth(&a,&b,1);
+    bad+=a.compareState(b);
+  }
+  a.quit();
+  b.quit();
+  return bad;
+}
+
+int main(int argc, char** argv) {
+  srand((argc>1)?atoi(argv[1]):1234);
+  engine=new DivEngine;
+  makeSamples();
+
+  long amigaBad=testAmiga();
+  printf("Amiga: %ld mismatches\n",amigaBad);
+  long segaPCMBad=testSegaPCM();
+  printf("SegaPCM: %ld mismatches\n",segaPCMBad);
+  long pcmDACBad=testPCMDAC();
+  printf("PCM DAC: %ld mismatches\n",pcmDACBad);
+
+  return (amigaBad!=0 || segaPCMBad!=0 || pcmDACBad!=0);
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "qsound.h"
+
+#define MAX_BLOCK 256
+#define ITERATIONS 40000
+#define ROM_SIZE (1<<20)
+
+// checks that qsound_update_block() produces the same output as calling
+// qsound_update() once per sample, under random register traffic.
+// build (from the repository root):
+//   gcc -Wall -Isrc/engine/platform/sound -o test/qsound_block test/qsound_block.c src/engine/platform/sound/qsound.c -lm
+// usage: qsound_block [seed]
+// return values:
+// - 0: pass (both paths match)
+// - 1: fail (mismatch found)
+
+static struct qsound_chip chipA, chipB;
+static uint8_t rom[ROM_SIZE];
+
+static const uint8_t miscRegs[]={
+  0x93, 0xd9, 0xe2, 0xe3, 0xda, 0xdb, 0xde, 0xdf, 0xe4, 0xe5, 0xca, 0xcb, 0xcc, 0xcd, 0xd6
+};
+
+static void writeBoth(uint8_t addr, uint16_t data) {
+  qsound_write_data(&chipA,addr,data);
+  qsound_write_data(&chipB,addr,data);
+}
+
+static void randomWrite(void) {
+  uint8_t addr;
+  uint16_t data=rand();
+  int kind=rand()%10;
+  if (kind<6) {
+    // PCM voice registers
+    addr=rand()%0x80;
+    if ((addr&7)==0) data=0x8000|(rand()%16);
+  } else if (kind<8) {
+    // pan
+    addr=0x80+rand()%0x13;
+    data=0x110+rand()%100;
+  } else if (kind<9) {
+    // ADPCM voices
+    addr=0xba+rand()%16;
+  } else {
+    // echo, filter and delay
+    addr=miscRegs[rand()%(sizeof(miscRegs)/sizeof(miscRegs[0]))];
+    switch (addr) {
+      case 0xe3:
+        data=(rand()&1)?0x288:0x61a;
+        break;
+      case 0xd9:
+        data=0x554+rand()%1000;
+        break;
+      case 0xde: case 0xdf:
+        data=rand()%40;
+        break;
+      case 0xcc:
+        data=0x8000|(rand()%16);
+        break;
+    }
+  }
+  writeBoth(addr,data);
+}
+
+int main(int argc, char** argv) {
+  srand((argc>1)?atoi(argv[1]):1234);
+
+  for (int i=0; i<ROM_SIZE; i++) rom[i]=rand();
+
+  qsound_start(&chipA,60000000);
+  qsound_start(&chipB,60000000);
+  chipA.rom_data=rom;
+  chipB.rom_data=rom;
+  chipA.rom_mask=ROM_SIZE-1;
+  chipB.rom_mask=ROM_SIZE-1;
+  qsound_reset(&chipA);
+  qsound_reset(&chipB);
+
+  static int16_t outL[MAX_BLOCK], outR[MAX_BLOCK];
+  static int16_t voiceBuf[19][MAX_BLOCK];
+  int16_t* voiceOut[19];
+  for (int i=0; i<19; i++) voiceOut[i]=voiceBuf[i];
+
+  long total=0;
+  long bad=0;
+  for (int iter=0; iter<ITERATIONS; iter++) {
+    int writes=rand()%4;
+    for (int i=0; i<writes; i++) randomWrite();
+
+    // lengths cross QSOUND_BLOCK_SIZE on purpose
+    int len=1+rand()%(MAX_BLOCK-1);
+    qsound_update_block(&chipB,outL,outR,voiceOut,len);
+    for (int i=0; i<len; i++) {
+      qsound_update(&chipA);
+      total++;
+      int mismatch=(chipA.out[0]!=outL[i] || chipA.out[1]!=outR[i]);
+      for (int j=0; j<19; j++) {
+        if (chipA.voice_output[j]!=voiceBuf[j][i]) mismatch=1;
+      }
+      if (mismatch) {
+        if (bad<5) fprintf(stderr,"mismatch at iteration %d sample %d: %d/%d vs. %d/%d\n",iter,i,chipA.out[0],chipA.out[1],outL[i],outR[i]);
+        bad++;
+      }
+    }
+  }
+
+  printf("%ld samples, %ld mismatches\n",total,bad);
+  return (bad!=0);
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SPC_DSP.h"
+
+#define MAX_RUN 256
+#define ITERATIONS 20000
+
+// checks that rendering SPC_DSP output with one run() call per block (and
+// set_voice_output() for the per-voice outputs) produces the same output,
+// voice outputs and RAM contents (echo buffer included) as running one sample
+// at a time and reading the voice outputs after each sample, under random
+// register traffic.
+// build (from the repository root):
+//   g++ -std=c++14 -Wall -Isrc/engine/platform/sound/snes -o test/snes_block test/snes_block.cpp src/engine/platform/sound/snes/SPC_DSP.cpp
+// usage: snes_block [seed]
+// return values:
+// - 0: pass (both paths match)
+// - 1: fail (mismatch found)
+
+static SPC_DSP dspA, dspB;
+static unsigned char ramA[65536], ramB[65536];
+
+static void writeBoth(int addr, int val) {
+  dspA.write(addr,val);
+  dspB.write(addr,val);
+}
+
+static void randomWrite() {
+  int addr;
+  int val=rand()&0xff;
+  int kind=rand()%12;
+  if (kind<5) {
+    // voice registers
+    addr=((rand()&7)<<4)|(rand()%10);
+  } else if (kind<7) {
+    // KON/KOFF
+    addr=(rand()&1)?SPC_DSP::r_kon:SPC_DSP::r_koff;
+  } else if (kind<8) {
+    // FLG, without soft reset most of the time
+    addr=SPC_DSP::r_flg;
+    if (rand()%8) val&=0x7f;
+  } else if (kind<10) {
+    // volume, echo and noise registers
+    static const int regs[]={
+      SPC_DSP::r_mvoll, SPC_DSP::r_mvolr, SPC_DSP::r_evoll, SPC_DSP::r_evolr,
+      SPC_DSP::r_efb, SPC_DSP::r_pmon, SPC_DSP::r_non, SPC_DSP::r_eon,
+      SPC_DSP::r_edl
+    };
+    addr=regs[rand()%9];
+    if (addr==SPC_DSP::r_edl) val&=3;
+  } else {
+    // FIR coefficients
+    addr=((rand()&7)<<4)|0x0f;
+  }
+  writeBoth(addr,val);
+}
+
+int main(int argc, char** argv) {
+  srand((argc>1)?atoi(argv[1]):1234);
+
+  static short outA[2];
+  static short voiceA[16];
+  static short outB[MAX_RUN*2];
+  static short voiceB[MAX_RUN*16];
+
+  // random sample data. the directory is at 0x0100 and the echo buffer at
+  // 0xe000.
+  for (int i=0; i<65536; i++) ramA[i]=rand();
+  for (int i=0; i<256; i++) {
+    int start=0x0400+(rand()%0xd800);
+    int loop=0x0400+(rand()%0xd800);
+    ramA[0x100+i*4]=start&0xff;
+    ramA[0x101+i*4]=start>>8;
+    ramA[0x102+i*4]=loop&0xff;
+    ramA[0x103+i*4]=loop>>8;
+  }
+  memcpy(ramB,ramA,65536);
+
+  dspA.init(ramA);
+  dspB.init(ramB);
+  dspA.reset();
+  dspB.reset();
+  writeBoth(SPC_DSP::r_dir,0x01);
+  writeBoth(SPC_DSP::r_esa,0xe0);
+  writeBoth(SPC_DSP::r_flg,0x00);
+  writeBoth(SPC_DSP::r_mvoll,0x7f);
+  writeBoth(SPC_DSP::r_mvolr,0x7f);
+  for (int i=0; i<8; i++) {
+    writeBoth((i<<4)|0x00,0x7f);
+    writeBoth((i<<4)|0x01,0x7f);
+    writeBoth((i<<4)|0x03,0x10);
+    writeBoth((i<<4)|0x04,rand()&0xff);
+    writeBoth((i<<4)|0x05,0x00);
+    writeBoth((i<<4)|0x07,0x7f);
+  }
+  writeBoth(SPC_DSP::r_kon,0xff);
+
+  long total=0;
+  long bad=0;
+  for (int iter=0; iter<ITERATIONS; iter++) {
+    int writes=rand()%4;
+    for (int i=0; i<writes; i++) randomWrite();
+
+    int len=1+rand()%MAX_RUN;
+    dspB.set_output(outB,len*2);
+    dspB.set_voice_output(voiceB);
+    dspB.run(32*len);
+    dspB.set_voice_output(NULL);
+    for (int i=0; i<len; i++) {
+      dspA.set_output(outA,1);
+      dspA.run(32);
+      dspA.get_voice_outputs(voiceA);
+      total++;
+      bool mismatch=(outA[0]!=outB[i*2] || outA[1]!=outB[i*2+1]);
+      if (memcmp(voiceA,&voiceB[i*16],sizeof(voiceA))!=0) mismatch=true;
+      if (mismatch) {
+        if (bad<5) fprintf(stderr,"mismatch at iteration %d sample %d: %d %d vs. %d %d\n",iter,i,outA[0],outA[1],outB[i*2],outB[i*2+1]);
+        bad++;
+      }
+    }
+    if (memcmp(ramA,ramB,65536)!=0) {
+      if (bad<5) fprintf(stderr,"RAM mismatch at iteration %d\n",iter);
+      bad++;
+    }
+  }
+
+  printf("%ld samples, %ld mismatches\n",total,bad);
+  return (bad!=0);
+}